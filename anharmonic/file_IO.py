@@ -635,16 +635,50 @@ def read_fc4_from_hdf5(filename='fc4.hdf5'):
     f.close()
     return fc4
     
-def write_fc3_to_hdf5(force_constants_third, filename='fc3.hdf5'):
+def write_fc3_to_hdf5(force_constants_third,
+                      filename='fc3.hdf5',
+                      p2s_map=None):
+    """Compact fc3 [num_patom, num_satom, num_satom, 3, 3, 3] is written
+    with p2s_map that gives the supercell indices of its first atoms.
+    For SparseFC3, its values are written as fc3 with fc3_triplets."""
+    # Imported here since anharmonic.phonon3 imports this module.
+    from anharmonic.phonon3.sparse_fc3 import is_sparse_fc3
+
     w = h5py.File(filename, 'w')
+    if is_sparse_fc3(force_constants_third):
+        fc3 = force_constants_third
+        w.create_dataset('fc3', data=fc3.get_values())
+        w.create_dataset('fc3_triplets', data=fc3.get_triplets())
+        w.create_dataset('p2s_map', data=fc3.get_primitive_to_supercell_map())
+        w.create_dataset('num_satom', data=fc3.get_number_of_supercell_atoms())
+        w.create_dataset('cutoff_distance', data=fc3.get_cutoff_distance())
+        w.close()
+        return
     w.create_dataset('fc3', data=force_constants_third)
+    if (p2s_map is not None and
+        force_constants_third.shape[0] != force_constants_third.shape[1]):
+        w.create_dataset('p2s_map', data=np.array(p2s_map, dtype='intc'))
     w.close()
 
-def read_fc3_from_hdf5(filename='fc3.hdf5'):
+def read_fc3_from_hdf5(filename='fc3.hdf5', p2s_map=None):
     f = h5py.File(filename, 'r')
     fc3 = f['fc3'][:]
+    if p2s_map is not None and 'p2s_map' in f.keys():
+        if (f['p2s_map'][:] != p2s_map).any():
+            print "Primitive cell of compact fc3 in %s is different." % filename
+            f.close()
+            raise ValueError
+    if 'fc3_triplets' in f.keys():
+        from anharmonic.phonon3.sparse_fc3 import SparseFC3
+        fc3 = SparseFC3(np.array(fc3, dtype='double', order='C'),
+                        np.array(f['fc3_triplets'][:], dtype='intc', order='C'),
+                        f['p2s_map'][:],
+                        int(f['num_satom'][()]),
+                        float(f['cutoff_distance'][()]))
+        f.close()
+        return fc3
     f.close()
-    return fc3
+    return np.array(fc3, dtype='double', order='C')
     
 def write_fc2_dat(force_constants, filename='fc2.dat'):
     w = open(filename, 'w')
@@ -1493,23 +1527,108 @@ def parse_FORCES_SECOND(disp_dataset, filename="FORCES_SECOND"):
         second_forces = parse_force_lines(f2, num_atom)
         disp1['forces'] = second_forces
 
-def parse_FORCES_FC2(disp_dataset, filename="FORCES_FC2"):
+def parse_FORCES_FC2(disp_dataset, filename="FORCES_FC2", hdf5_filename=None):
     num_atom = disp_dataset['natom']
     num_disp = len(disp_dataset['first_atoms'])
-    f2 = open(filename, 'r')
-    forces_fc2 = [parse_force_lines(f2, num_atom) for i in range(num_disp)]
-    f2.close()
-    return forces_fc2
+    return _parse_force_sets(filename, num_atom, num_disp, hdf5_filename)
 
-def parse_FORCES_FC3(disp_dataset, filename="FORCES_FC3"):
+def parse_FORCES_FC3(disp_dataset, filename="FORCES_FC3", hdf5_filename=None):
     num_atom = disp_dataset['natom']
     num_disp = len(disp_dataset['first_atoms'])
     for disp1 in disp_dataset['first_atoms']:
         num_disp += len(disp1['second_atoms'])
-    f3 = open(filename, 'r')
-    forces_fc3 = [parse_force_lines(f3, num_atom) for i in range(num_disp)]
-    f3.close()
-    return forces_fc3
+    return _parse_force_sets(filename, num_atom, num_disp, hdf5_filename)
+
+def write_forces_to_hdf5(force_sets,
+                         filename='forces_fc3.hdf5',
+                         source_filename=None):
+    """Sets of forces are written up to the first missing one
+
+    With source_filename, its absolute path, size, and mtime are also
+    written, which are compared by read_forces_from_hdf5.
+    """
+    num_sets = len(force_sets)
+    for i, forces in enumerate(force_sets):
+        if forces is None:
+            num_sets = i
+            break
+    w = h5py.File(filename, 'w')
+    w.create_dataset('forces',
+                     data=np.array(force_sets[:num_sets], dtype='double'))
+    w.create_dataset('num_disp', data=len(force_sets))
+    if source_filename is not None:
+        path, size, mtime = _get_file_stamp(source_filename)
+        w.create_dataset('source_filename', data=np.string_(path))
+        w.create_dataset('source_size', data=size)
+        w.create_dataset('source_mtime', data=mtime)
+    w.close()
+
+def read_forces_from_hdf5(filename='forces_fc3.hdf5', source_filename=None):
+    """Sets of forces written by write_forces_to_hdf5
+
+    With source_filename, None is returned unless the file was written
+    from the same source file with the same size and mtime.
+    """
+    f = h5py.File(filename, 'r')
+    if source_filename is not None:
+        if ('source_filename' not in f or
+            (str(f['source_filename'][()]),
+             int(f['source_size'][()]),
+             float(f['source_mtime'][()])) !=
+            _get_file_stamp(source_filename)):
+            f.close()
+            return None
+    forces = f['forces'][:]
+    num_disp = int(f['num_disp'][()])
+    f.close()
+    return list(forces) + [None] * (num_disp - len(forces))
+
+def _get_file_stamp(filename):
+    stat = os.stat(filename)
+    return os.path.abspath(filename), int(stat.st_size), float(stat.st_mtime)
+
+def _parse_force_sets(filename, num_atom, num_disp, hdf5_filename=None):
+    """Sets of forces in FORCES_FC3 or FORCES_FC2
+
+    With hdf5_filename, the sets are read from this file when it was
+    written from filename in its current state (path, size, and mtime).
+    Otherwise they are parsed from filename and written to it. When it
+    can not be written, e.g., in a read-only directory, the sets are
+    returned without it.
+    """
+    if hdf5_filename is not None and os.path.exists(hdf5_filename):
+        try:
+            force_sets = read_forces_from_hdf5(filename=hdf5_filename,
+                                               source_filename=filename)
+        except (IOError, OSError, KeyError):
+            force_sets = None
+        if (force_sets is not None and
+            len(force_sets) == num_disp and
+            (force_sets[0] is None or len(force_sets[0]) == num_atom)):
+            return force_sets
+
+    try:
+        import anharmonic._phono3py as phono3c
+        forces = np.zeros((num_disp, num_atom, 3), dtype='double')
+        num_sets = phono3c.force_blocks(forces, filename)
+        if num_sets < 0:
+            print "%s could not be parsed." % filename
+            raise ValueError
+        force_sets = list(forces[:num_sets]) + [None] * (num_disp - num_sets)
+    except ImportError:
+        f = open(filename, 'r')
+        force_sets = [parse_force_lines(f, num_atom) for i in range(num_disp)]
+        f.close()
+
+    if hdf5_filename is not None:
+        try:
+            write_forces_to_hdf5(force_sets,
+                                 filename=hdf5_filename,
+                                 source_filename=filename)
+        except (IOError, OSError):
+            print "%s could not be written." % hdf5_filename
+
+    return force_sets
 
 def parse_DELTA_FC2_SETS(disp_dataset,
                          filename='DELTA_FC2_SETS'):
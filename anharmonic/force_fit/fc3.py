@@ -2,7 +2,7 @@ import sys
 import numpy as np
 from phonopy.harmonic.force_constants import similarity_transformation, get_positions_sent_by_rot_inv
 from anharmonic.phonon3.displacement_fc3 import get_reduced_site_symmetry
-from anharmonic.phonon3.fc3 import distribute_fc3
+from anharmonic.phonon3.fc3 import distribute_fc3, rotate_fc3_of_pair
 
 class FC3Fit:
     def __init__(self,
@@ -68,8 +68,15 @@ class FC3Fit:
         rot_map_syms = get_positions_sent_by_rot_inv(positions,
                                                      site_symmetry,
                                                      self._symprec)
+        site_syms_cart = [similarity_transformation(self._lattice, sym)
+                          for sym in site_symmetry]
 
+        # Fitted only for one second atom of each orbit under site
+        # symmetry, and rotated to the others as in solve_fc3.
+        done = np.zeros(self._num_atom, dtype='bool')
         for second_atom_num in range(self._num_atom):
+            if done[second_atom_num]:
+                continue
             rot_atom_map = rot_map_syms[:, second_atom_num]
             rot_disps = self._create_displacement_matrix(disp_pairs,
                                                          site_symmetry,
@@ -86,14 +93,18 @@ class FC3Fit:
             for i, j in list(np.ndindex(3, 3)):
                 self._fc3[first_atom_num, second_atom_num, :, i, j, :] = (
                     fc3[:, i, j, :] + fc3_21[:, j, i, :]) / 2
+            done[second_atom_num] = True
+            fc3_pair = self._fc3[first_atom_num, second_atom_num]
+            for sym, map_sym in zip(site_syms_cart, rot_map_syms):
+                i_rot = np.where(map_sym == second_atom_num)[0][0]
+                if not done[i_rot]:
+                    self._fc3[first_atom_num, i_rot] = rotate_fc3_of_pair(
+                        sym, fc3_pair[map_sym])
+                    done[i_rot] = True
 
     def _solve(self, rot_disps, rot_forces):
-        fc = []
         inv_disps = np.linalg.pinv(rot_disps)
-        for i in range(self._num_atom):
-            fc.append(-np.dot(inv_disps, rot_forces[i]))
-        
-        return np.array(fc)
+        return -np.dot(inv_disps, rot_forces).swapaxes(0, 1)
 
     def _create_force_matrix(self,
                              sets_of_forces,
@@ -54,6 +54,7 @@ class Isotope:
         self._frequencies = None
         self._eigenvectors = None
         self._phonon_done = None
+        self._phonon_solver = None
         self._dm = None
         self._band_indices = None
         self._grid_point = None
@@ -99,10 +100,22 @@ class Isotope:
     def get_phonons(self):
         return self._frequencies, self._eigenvectors, self._phonon_done
     
-    def set_phonons(self, frequencies, eigenvectors, phonon_done, dm=None):
+    def set_phonons(self,
+                    frequencies,
+                    eigenvectors,
+                    phonon_done,
+                    dm=None,
+                    phonon_solver=None):
+        """Phonon arrays are shared with those of the caller
+
+        phonon_solver(grid_points) is used to solve phonons at grid
+        points instead of writing into the arrays here, e.g.,
+        Interaction.set_phonon when the arrays are in a phonon store.
+        """
         self._frequencies = frequencies
         self._eigenvectors = eigenvectors
         self._phonon_done = phonon_done
+        self._phonon_solver = phonon_solver
         if dm is not None:
             self._dm = dm
 
@@ -239,6 +252,9 @@ class Isotope:
         self._gamma = np.array(t_inv, dtype='double') / 2
             
     def _set_phonon_c(self, grid_points):
+        if self._phonon_solver is not None:
+            self._phonon_solver(grid_points)
+            return
         set_phonon_c(self._dm,
                      self._frequencies,
                      self._eigenvectors,
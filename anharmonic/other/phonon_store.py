@@ -0,0 +1,172 @@
+import os
+import fcntl
+import shutil
+import hashlib
+import numpy as np
+
+class PhononStore:
+    """Persistent phonon storage on the BZ grid
+
+    Frequencies and eigenvectors are stored in .npy files in a
+    sub-directory of 'directory' whose name is a hash of everything
+    that determines the phonons: fc2, shortest vectors, masses,
+    reciprocal lattice, mesh, BZ grid address, NAC parameters,
+    q-direction for NAC, frequency conversion factor, and lapack zheev
+    UPLO. The files are opened by numpy.memmap, so the arrays can be
+    read by the C routines directly and pages are shared among
+    processes running on the same node.
+
+    Phonons are computed by each process in its own buffers and copied
+    into the store by 'store'. A grid point is written only while its
+    byte of the lock file is locked and its 'done' is still 0, so rows
+    already marked done are never overwritten. 'done' is set after the
+    rows are flushed, so other processes never read half-written
+    eigenvectors.
+
+    """
+    def __init__(self,
+                 directory,
+                 dynamical_matrix,
+                 mesh,
+                 grid_address,
+                 frequency_factor_to_THz,
+                 nac_q_direction=None,
+                 lapack_zheev_uplo='L'):
+        self._directory = directory
+        self._key = get_phonon_store_key(
+            dynamical_matrix,
+            mesh,
+            grid_address,
+            frequency_factor_to_THz,
+            nac_q_direction=nac_q_direction,
+            lapack_zheev_uplo=lapack_zheev_uplo)
+        self._path = os.path.join(directory, self._key)
+        self._num_grid = len(grid_address)
+        self._num_band = dynamical_matrix.get_dimension()
+
+        self._frequencies = None
+        self._eigenvectors = None
+        self._done = None
+        self._lock_fd = None
+        self._open()
+
+    def get_key(self):
+        return self._key
+
+    def get_path(self):
+        return self._path
+
+    def get_phonons(self):
+        """Memory mapped arrays of frequencies, eigenvectors and done"""
+        return self._frequencies, self._eigenvectors, self._done
+
+    def store(self, grid_points, frequencies, eigenvectors):
+        """Phonons computed by this process are copied into the store
+
+        frequencies[i] and eigenvectors[i] are those at grid_points[i].
+        Grid points already stored by other processes are skipped. Locks
+        are taken in ascending order of grid points, so processes
+        storing overlapping sets of grid points do not deadlock.
+        """
+        order = np.argsort(grid_points)
+        locked = []
+        try:
+            for i in order:
+                fcntl.lockf(self._lock_fd, fcntl.LOCK_EX, 1, grid_points[i])
+                locked.append(grid_points[i])
+            indices = [i for i in order if self._done[grid_points[i]] == 0]
+            if indices:
+                gps = np.array(grid_points)[indices]
+                self._frequencies[gps] = frequencies[indices]
+                self._eigenvectors[gps] = eigenvectors[indices]
+                self._frequencies.flush()
+                self._eigenvectors.flush()
+                self._done[gps] = 1
+                self._done.flush()
+        finally:
+            for gp in locked:
+                fcntl.lockf(self._lock_fd, fcntl.LOCK_UN, 1, gp)
+
+    def _open(self):
+        if not os.path.isdir(self._path):
+            self._create()
+        self._frequencies = np.load(
+            os.path.join(self._path, 'frequencies.npy'), mmap_mode='r+')
+        self._eigenvectors = np.load(
+            os.path.join(self._path, 'eigenvectors.npy'), mmap_mode='r+')
+        self._done = np.load(
+            os.path.join(self._path, 'done.npy'), mmap_mode='r+')
+        self._lock_fd = os.open(os.path.join(self._path, 'lock'), os.O_RDWR)
+
+        if (self._frequencies.shape != (self._num_grid, self._num_band) or
+            self._done.shape != (self._num_grid,)):
+            print "Phonon store %s is inconsistent." % self._path
+            raise ValueError
+
+    def _create(self):
+        """Files are created in a temporary directory and renamed
+
+        Renaming a directory on an existing non-empty directory fails,
+        therefore only one of processes starting at the same time wins
+        and the others use its store.
+        """
+        if not os.path.isdir(self._directory):
+            try:
+                os.makedirs(self._directory)
+            except OSError:
+                if not os.path.isdir(self._directory):
+                    raise
+        tmp_path = "%s.tmp%d" % (self._path, os.getpid())
+        os.mkdir(tmp_path)
+        num_grid = self._num_grid
+        num_band = self._num_band
+        for filename, shape, dtype in (
+            ('frequencies.npy', (num_grid, num_band), 'double'),
+            ('eigenvectors.npy', (num_grid, num_band, num_band), 'complex128'),
+            ('done.npy', (num_grid,), 'byte')):
+            array = np.lib.format.open_memmap(os.path.join(tmp_path, filename),
+                                              mode='w+',
+                                              dtype=dtype,
+                                              shape=shape)
+            array.flush()
+            del array
+        open(os.path.join(tmp_path, 'lock'), 'w').close()
+        try:
+            os.rename(tmp_path, self._path)
+        except OSError:
+            shutil.rmtree(tmp_path)
+            if not os.path.isdir(self._path):
+                raise
+
+def get_phonon_store_key(dynamical_matrix,
+                         mesh,
+                         grid_address,
+                         frequency_factor_to_THz,
+                         nac_q_direction=None,
+                         lapack_zheev_uplo='L'):
+    dm = dynamical_matrix
+    svecs, multiplicity = dm.get_shortest_vectors()
+    h = hashlib.sha1()
+    for array in (dm.get_force_constants(),
+                  svecs,
+                  multiplicity,
+                  dm.get_primitive().get_masses(),
+                  dm.get_primitive_to_supercell_map(),
+                  dm.get_supercell_to_primitive_map()):
+        h.update(np.ascontiguousarray(array).tostring())
+    h.update(np.array(np.linalg.inv(dm.get_primitive().get_cell()),
+                      dtype='double').tostring())
+    h.update(np.array(mesh, dtype='intc').tostring())
+    h.update(np.array(grid_address, dtype='intc').tostring())
+    h.update(np.array([frequency_factor_to_THz], dtype='double').tostring())
+    h.update(lapack_zheev_uplo)
+    if dm.is_nac():
+        h.update("nac")
+        h.update(np.array(dm.get_born_effective_charges(),
+                          dtype='double').tostring())
+        h.update(np.array(dm.get_dielectric_constant(),
+                          dtype='double').tostring())
+        h.update(np.array([dm.get_nac_factor()], dtype='double').tostring())
+        if nac_q_direction is not None:
+            h.update(np.array(nac_q_direction, dtype='double').tostring())
+    return h.hexdigest()
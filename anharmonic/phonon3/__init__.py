@@ -68,8 +68,8 @@ class Phono3py:
         self._symmetry = None
         self._primitive_symmetry = None
         self._phonon_supercell_symmetry = None
-        self._search_symmetry()
         self._search_primitive_symmetry()
+        self._search_symmetry()
         self._search_phonon_supercell_symmetry()
 
         # Displacements and supercells
@@ -114,7 +114,8 @@ class Phono3py:
                              nac_params=None,
                              nac_q_direction=None,
                              use_Peierls_model=False,
-                             frequency_scale_factor=None):
+                             frequency_scale_factor=None,
+                             phonon_store=None):
         self._interaction = Interaction(
             self._supercell,
             self._primitive,
@@ -135,6 +136,8 @@ class Phono3py:
             nac_params=nac_params,
             frequency_scale_factor=frequency_scale_factor)
         self._interaction.set_nac_q_direction(nac_q_direction=nac_q_direction)
+        if phonon_store is not None:
+            self._interaction.set_phonon_store(phonon_store)
 
     def generate_displacements(self,
                                distance=0.03,
@@ -189,7 +192,15 @@ class Phono3py:
                     displacement_dataset=None,
                     cutoff_distance=None, # set fc3 zero
                     translational_symmetry_type=0,
-                    is_permutation_symmetry=False):
+                    is_permutation_symmetry=False,
+                    is_compact_fc=False,
+                    is_sparse_fc=False):
+        """fc3 is calculated from sets of forces
+
+        With is_sparse_fc, only fc3 elements of atom triplets within
+        cutoff_distance, or that of the displacement dataset, are
+        calculated and stored in SparseFC3.
+        """
         if displacement_dataset is None:
             disp_dataset = self._displacement_dataset
         else:
@@ -210,6 +221,16 @@ class Phono3py:
             for disp2 in disp1['second_atoms']:
                 disp2['delta_forces'] = forces_fc3[count] - disp1['forces']
                 count += 1
+        if is_sparse_fc:
+            if cutoff_distance:
+                sparse_cutoff_distance = cutoff_distance
+            elif 'cutoff_distance' in disp_dataset:
+                sparse_cutoff_distance = disp_dataset['cutoff_distance']
+            else:
+                print "Cutoff distance is necessary for sparse fc3."
+                raise ValueError
+        else:
+            sparse_cutoff_distance = None
         self._fc3 = get_fc3(
             self._supercell,
             disp_dataset,
@@ -217,10 +238,13 @@ class Phono3py:
             self._symmetry,
             translational_symmetry_type=translational_symmetry_type,
             is_permutation_symmetry=is_permutation_symmetry,
+            primitive=(self._primitive
+                       if is_compact_fc or is_sparse_fc else None),
+            sparse_cutoff_distance=sparse_cutoff_distance,
             verbose=self._log_level)
 
         # Set fc3 elements zero beyond cutoff_distance
-        if cutoff_distance:
+        if cutoff_distance and not is_sparse_fc:
             if self._log_level:
                 print ("Cutting-off fc3 by zero (cut-off distance: %f)" %
                        cutoff_distance)
@@ -234,13 +258,17 @@ class Phono3py:
         cutoff_fc3_by_zero(self._fc3,
                            self._supercell,
                            cutoff_distance,
-                           self._symprec)
+                           self._symprec,
+                           p2s_map=self._primitive.get_primitive_to_supercell_map())
             
     def set_permutation_symmetry(self):
         if self._fc2 is not None:
             set_permutation_symmetry(self._fc2)
         if self._fc3 is not None:
-            set_permutation_symmetry_fc3(self._fc3)
+            set_permutation_symmetry_fc3(self._fc3,
+                                         supercell=self._supercell,
+                                         primitive=self._primitive,
+                                         symprec=self._symprec)
 
     def set_translational_invariance(self,
                                      translational_symmetry_type=1):
@@ -251,7 +279,10 @@ class Phono3py:
         if self._fc3 is not None:
             set_translational_invariance_fc3(
                 self._fc3,
-                translational_symmetry_type=translational_symmetry_type)
+                translational_symmetry_type=translational_symmetry_type,
+                supercell=self._supercell,
+                primitive=self._primitive,
+                symprec=self._symprec)
         
     def get_interaction_strength(self):
         return self._interaction
@@ -448,13 +479,9 @@ class Phono3py:
                 print "%d / %d" % (len(weights), weights.sum())
             fst.run_interaction()
             fst.set_epsilon(epsilon)
-            delta = np.zeros((len(temperatures),
-                              len(self._band_indices_flatten)),
-                             dtype='double')
-            for i, t in enumerate(temperatures):
-                fst.set_temperature(t)
-                fst.run()
-                delta[i] = fst.get_frequency_shift()
+            fst.set_temperatures(temperatures)
+            fst.run()
+            delta = fst.get_frequency_shift()[:, 0, :]
 
             for i, bi in enumerate(self._band_indices):
                 pos = 0
@@ -472,12 +499,18 @@ class Phono3py:
     def _search_symmetry(self):
         self._symmetry = Symmetry(self._supercell,
                                   self._symprec,
-                                  self._is_symmetry)
+                                  self._is_symmetry,
+                                  primitive_symmetry=self._primitive_symmetry)
+        self._check_primitive_symmetry()
 
     def _search_primitive_symmetry(self):
         self._primitive_symmetry = Symmetry(self._primitive,
                                             self._symprec,
                                             self._is_symmetry)
+        if self._symmetry is not None:
+            self._check_primitive_symmetry()
+
+    def _check_primitive_symmetry(self):
         if (len(self._symmetry.get_pointgroup_operations()) !=
             len(self._primitive_symmetry.get_pointgroup_operations())):
             print ("Warning: point group symmetries of supercell and primitive"
@@ -1,5 +1,5 @@
 import numpy as np
-from phonopy.phonon.group_velocity import get_group_velocity
+from phonopy.phonon.group_velocity import get_group_velocity, GroupVelocity
 from phonopy.harmonic.force_constants import similarity_transformation
 from phonopy.units import EV, THz, Angstrom
 from anharmonic.phonon3.triplets import get_grid_address, reduce_grid_points, get_ir_grid_points, from_coarse_to_dense_grid_points
@@ -62,6 +62,7 @@ class Conductivity:
         self._read_gamma_iso = False
         self._frequencies = None
         self._gv = None
+        self._gv_at_grid_points = None
         self._gamma_iso = None
 
         self._mesh = None
@@ -213,7 +214,8 @@ class Conductivity:
             self._isotope.set_phonons(pp_freqs,
                                       pp_eigvecs,
                                       pp_phonon_done,
-                                      dm=self._dm)
+                                      dm=self._dm,
+                                      phonon_solver=self._pp.set_phonon)
             gp = self._grid_points[i]
             self._isotope.set_grid_point(gp)
             self._isotope.run()
@@ -294,7 +296,25 @@ class Conductivity:
         
     def _set_gv(self, i):
         # Group velocity [num_freqs, 3]
-        self._gv[i] = self._get_gv(self._qpoints[i])
+        if self._gv_delta_q is None:
+            if self._gv_at_grid_points is None:
+                self._set_gv_at_grid_points()
+            self._gv[i] = self._gv_at_grid_points[i]
+        else:
+            self._gv[i] = self._get_gv(self._qpoints[i])
+
+    def _set_gv_at_grid_points(self):
+        # Analytical group velocities at all grid points at once using
+        # phonons already stored in Interaction
+        freqs, eigvecs, _ = self._pp.get_phonons()
+        gv = GroupVelocity(
+            self._dm,
+            symmetry=self._symmetry,
+            frequency_factor_to_THz=self._frequency_factor_to_THz)
+        gv.set_q_points(self._qpoints,
+                        frequencies=freqs[self._grid_points],
+                        eigenvectors=eigvecs[self._grid_points])
+        self._gv_at_grid_points = gv.get_group_velocity()
 
     def _get_gv(self, q):
         return get_group_velocity(
@@ -403,6 +403,7 @@ class Conductivity_LBTE(Conductivity):
                     self._grid_address[ir_gp],
                     self._point_operations,
                     self._mesh,
+                    self._pp.get_grid_address(),
                     self._pp.get_bz_map())
             self._collision = CollisionMatrix(
                 self._pp,
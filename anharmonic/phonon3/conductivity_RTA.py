@@ -281,6 +281,7 @@ class Conductivity_RTA(Conductivity):
                               log_level=log_level)
 
         self._cv = None
+        self._pp.set_grid_points(self._grid_points)
 
         if self._temperatures is not None:
             self._allocate_values()
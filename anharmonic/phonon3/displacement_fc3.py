@@ -2,6 +2,7 @@ import numpy as np
 from phonopy.harmonic.displacement import get_least_displacements, \
     directions_axis, get_displacement, is_minus_displacement
 from phonopy.harmonic.dynamical_matrix import get_equivalent_smallest_vectors
+from phonopy.structure.cells import get_reduced_bases
 
 def direction_to_displacement(dataset,
                               distance,
@@ -193,6 +194,24 @@ def get_least_orbits(atom_index, cell, site_symmetry, symprec=1e-5):
 
     return np.unique(mapping)
 
+def get_pair_distances(cell, symprec=1e-5):
+    """Shortest distances of all atom pairs in periodic cell
+
+    These are the pair distances used for the cutoff of second atoms,
+    i.e., those by get_equivalent_smallest_vectors.
+    """
+    reduced_bases = get_reduced_bases(cell.get_cell(), symprec)
+    positions = np.dot(cell.get_positions(), np.linalg.inv(reduced_bases))
+    positions -= np.rint(positions)
+    lattice_points = np.array(list(np.ndindex(3, 3, 3))) - 1
+    num_atom = len(positions)
+    distances = np.zeros((num_atom, num_atom), dtype='double')
+    for i, pos in enumerate(positions):
+        vectors = np.dot((positions - pos)[:, None, :] + lattice_points,
+                         reduced_bases)
+        distances[i] = np.sqrt((vectors ** 2).sum(axis=2)).min(axis=1)
+    return distances
+
 def _get_orbits(atom_index, cell, site_symmetry, symprec=1e-5):
     positions = cell.get_scaled_positions()
     center = positions[atom_index]
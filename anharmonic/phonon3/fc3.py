@@ -1,8 +1,9 @@
 import sys
 import numpy as np
-from phonopy.harmonic.force_constants import similarity_transformation, set_permutation_symmetry, distribute_force_constants, solve_force_constants, get_rotated_displacement, get_positions_sent_by_rot_inv, set_translational_invariance, show_drift_force_constants
+from phonopy.harmonic.force_constants import similarity_transformation, set_permutation_symmetry, distribute_force_constants, solve_force_constants, get_rotated_displacement, get_positions_sent_by_rot_inv, get_atom_permutations, set_translational_invariance, show_drift_force_constants
 from phonopy.harmonic.dynamical_matrix import get_equivalent_smallest_vectors
-from anharmonic.phonon3.displacement_fc3 import get_reduced_site_symmetry, get_bond_symmetry
+from anharmonic.phonon3.displacement_fc3 import get_reduced_site_symmetry, get_bond_symmetry, get_pair_distances
+from anharmonic.phonon3.sparse_fc3 import get_sparse_fc3, is_sparse_fc3
 from anharmonic.file_IO import write_fc2_dat
 
 def get_fc3(supercell,
@@ -11,10 +12,39 @@ def get_fc3(supercell,
             symmetry,
             translational_symmetry_type=0,
             is_permutation_symmetry=False,
+            primitive=None,
+            sparse_cutoff_distance=None,
             verbose=False):
+    """fc3 from displacement dataset
+
+    With primitive, compact fc3 [num_patom, num_satom, num_satom, 3, 3, 3]
+    whose first atoms are those of primitive.get_primitive_to_supercell_map()
+    is returned. Otherwise full fc3 [num_satom, num_satom, num_satom, 3, 3, 3]
+    is returned. With primitive and sparse_cutoff_distance, SparseFC3
+    is returned.
+    """
+    if primitive is not None and sparse_cutoff_distance is not None:
+        return _get_sparse_fc3(supercell,
+                               disp_dataset,
+                               fc2,
+                               symmetry,
+                               primitive,
+                               sparse_cutoff_distance,
+                               translational_symmetry_type,
+                               is_permutation_symmetry,
+                               verbose)
+
     num_atom = supercell.get_number_of_atoms()
-    fc3_least_atoms = np.zeros((num_atom, num_atom, num_atom, 3, 3, 3),
-                               dtype='double')
+    first_disp_atoms = np.unique(
+        [x['number'] for x in disp_dataset['first_atoms']])
+    if primitive is None or 'cutoff_distance' in disp_dataset:
+        fc3_least_atoms = np.zeros((num_atom, num_atom, num_atom, 3, 3, 3),
+                                   dtype='double')
+    else:
+        # Only rows of displaced atoms in order of first_disp_atoms
+        fc3_least_atoms = np.zeros(
+            (len(first_disp_atoms), num_atom, num_atom, 3, 3, 3),
+            dtype='double')
 
     if 'cutoff_distance' in disp_dataset:
         _get_fc3_least_atoms(fc3_least_atoms,
@@ -38,14 +68,17 @@ def get_fc3(supercell,
     if verbose:
         print "Expanding fc3"
         
-    first_disp_atoms = np.unique(
-        [x['number'] for x in disp_dataset['first_atoms']])
     rotations = symmetry.get_symmetry_operations()['rotations']
     translations = symmetry.get_symmetry_operations()['translations']
     symprec = symmetry.get_symmetry_tolerance()
     lattice = supercell.get_cell().T
     positions = supercell.get_scaled_positions()
 
+    if primitive is None or 'cutoff_distance' in disp_dataset:
+        p2s_map = None
+    else:
+        p2s_map = primitive.get_primitive_to_supercell_map()
+
     fc3 = distribute_fc3(fc3_least_atoms,
                          first_disp_atoms,
                          lattice,
@@ -53,7 +86,8 @@ def get_fc3(supercell,
                          rotations,
                          translations,
                          symprec,
-                         verbose)
+                         verbose,
+                         p2s_map=p2s_map)
     
     if 'cutoff_distance' in disp_dataset:
         if verbose:
@@ -73,16 +107,27 @@ def get_fc3(supercell,
             if verbose:
                 print "Imposing index permulation symmetry to fc3"
             set_permutation_symmetry_fc3(fc3)
+        if primitive is not None:
+            # Contraction needs full fc3, which is compacted afterwards.
+            fc3 = np.array(fc3[primitive.get_primitive_to_supercell_map()],
+                           dtype='double', order='C')
     else:
         if translational_symmetry_type:
             if verbose:
                 print "Imposing translational invariance symmetry to fc3"
             set_translational_invariance_fc3_per_index(
-                fc3, translational_symmetry_type=translational_symmetry_type)
+                fc3,
+                translational_symmetry_type=translational_symmetry_type,
+                supercell=supercell,
+                primitive=primitive,
+                symprec=symprec)
         if is_permutation_symmetry:
             if verbose:
                 print "Imposing index permulation symmetry to fc3"
-            set_permutation_symmetry_fc3(fc3)
+            set_permutation_symmetry_fc3(fc3,
+                                         supercell=supercell,
+                                         primitive=primitive,
+                                         symprec=symprec)
         
     return fc3
 
@@ -94,51 +139,45 @@ def distribute_fc3(fc3_least_atoms,
                    rotations,
                    translations,
                    symprec,
-                   verbose):
+                   verbose,
+                   p2s_map=None):
+    """Rows of fc3 are made from those of the least atoms by symmetry
+
+    fc3_least_atoms has either rows of all atoms or only rows of
+    first_disp_atoms in this order. With p2s_map, compact fc3 that has
+    only rows of p2s_map is returned.
+    """
     num_atom = len(positions)
-    atom_mapping = np.zeros(num_atom, dtype='intc')
-    fc3 = np.zeros((num_atom, num_atom, num_atom, 3, 3, 3), dtype='double')
+    if p2s_map is None:
+        target_atoms = range(num_atom)
+    else:
+        target_atoms = p2s_map
+    fc3 = np.zeros((len(target_atoms), num_atom, num_atom, 3, 3, 3),
+                   dtype='double')
+    permutations = get_atom_permutations(positions,
+                                         rotations,
+                                         translations,
+                                         symprec)
 
-    for i in range(num_atom):
+    for i_target, i in enumerate(target_atoms):
         # if i in first_disp_atoms:
         #     continue
 
-        for atom_index_done in first_disp_atoms:
-            rot_num = get_atom_mapping_by_symmetry(positions,
-                                                   i,
-                                                   atom_index_done,
-                                                   rotations,
-                                                   translations,
-                                                   symprec)
-            if rot_num > -1:
-                i_rot = atom_index_done
-                rot = rotations[rot_num]
-                trans = translations[rot_num]
-                break
-
-        if rot_num < 0:
-            print "Position or symmetry may be wrong."
-            raise ValueError
-
-        if verbose > 2:
-            print "    [ %d, x, x ] to [ %d, x, x ]" % (i_rot + 1, i + 1)
-            sys.stdout.flush()
-
-        for j in range(num_atom):
-            atom_mapping[j] = get_atom_by_symmetry(positions,
-                                                   rot,
-                                                   trans,
-                                                   j,
-                                                   symprec)
-
-        rot_cart_inv = np.array(similarity_transformation(lattice, rot).T,
-                                dtype='double', order='C')
+        i_source, atom_mapping, rot_cart_inv = _get_fc3_row_mapping(
+            i,
+            fc3_least_atoms,
+            first_disp_atoms,
+            lattice,
+            rotations,
+            permutations,
+            verbose)
 
         try:
             import anharmonic._phono3py as phono3c
             phono3c.distribute_fc3(fc3,
                                    fc3_least_atoms,
-                                   i,
+                                   i_target,
+                                   i_source,
                                    atom_mapping,
                                    rot_cart_inv)
         
@@ -147,12 +186,160 @@ def distribute_fc3(fc3_least_atoms,
                 j_rot = atom_mapping[j]
                 for k in range(num_atom):
                     k_rot = atom_mapping[k]
-                    fc3[i, j, k] = third_rank_tensor_rotation(
-                        rot_cart_inv, fc3_least_atoms[i_rot, j_rot, k_rot])
+                    fc3[i_target, j, k] = third_rank_tensor_rotation(
+                        rot_cart_inv, fc3_least_atoms[i_source, j_rot, k_rot])
 
     return fc3
 
-def set_permutation_symmetry_fc3(fc3):
+def distribute_sparse_fc3(fc3,
+                          fc3_least_atoms,
+                          first_disp_atoms,
+                          lattice,
+                          positions,
+                          rotations,
+                          translations,
+                          symprec,
+                          verbose):
+    """Values of SparseFC3 are made from rows of the least atoms by symmetry
+
+    fc3_least_atoms has only rows of first_disp_atoms in this order.
+    """
+    values = fc3.get_values()
+    triplets = fc3.get_triplets()
+    permutations = get_atom_permutations(positions,
+                                         rotations,
+                                         translations,
+                                         symprec)
+    for i_target, i in enumerate(fc3.get_primitive_to_supercell_map()):
+        i_source, atom_mapping, rot_cart_inv = _get_fc3_row_mapping(
+            i,
+            fc3_least_atoms,
+            first_disp_atoms,
+            lattice,
+            rotations,
+            permutations,
+            verbose)
+
+        try:
+            import anharmonic._phono3py as phono3c
+            phono3c.distribute_sparse_fc3(values,
+                                          triplets,
+                                          fc3_least_atoms,
+                                          i_target,
+                                          i_source,
+                                          atom_mapping,
+                                          rot_cart_inv)
+        except ImportError:
+            for n in np.where(triplets[:, 0] == i_target)[0]:
+                j_rot = atom_mapping[triplets[n, 1]]
+                k_rot = atom_mapping[triplets[n, 2]]
+                values[n] = third_rank_tensor_rotation(
+                    rot_cart_inv, fc3_least_atoms[i_source, j_rot, k_rot])
+
+def _get_fc3_row_mapping(i,
+                         fc3_least_atoms,
+                         first_disp_atoms,
+                         lattice,
+                         rotations,
+                         permutations,
+                         verbose):
+    """Symmetry operation that sends row i of fc3 to that of least atoms
+
+    Index of the row in fc3_least_atoms, atom mapping, and the inverse
+    rotation in Cartesian coordinates are returned. The atom mapping is
+    taken from permutations given by get_atom_permutations.
+    """
+    num_atom = permutations.shape[1]
+    rot_num = -1
+    for atom_index_done in first_disp_atoms:
+        syms = np.where(permutations[:, i] == atom_index_done)[0]
+        if len(syms) > 0:
+            i_rot = atom_index_done
+            rot_num = syms[0]
+            break
+
+    if rot_num < 0:
+        print "Position or symmetry may be wrong."
+        raise ValueError
+
+    if verbose > 2:
+        print "    [ %d, x, x ] to [ %d, x, x ]" % (i_rot + 1, i + 1)
+        sys.stdout.flush()
+
+    if len(fc3_least_atoms) == num_atom:
+        i_source = i_rot
+    else:
+        i_source = np.searchsorted(first_disp_atoms, i_rot)
+
+    atom_mapping = permutations[rot_num]
+    if (atom_mapping < 0).any():
+        print "Position or symmetry is wrong."
+        raise ValueError
+
+    rot_cart_inv = np.array(
+        similarity_transformation(lattice, rotations[rot_num]).T,
+        dtype='double', order='C')
+
+    return i_source, atom_mapping, rot_cart_inv
+
+def get_compact_fc3_tables(supercell, primitive, symprec=1e-5):
+    """Tables to find rows of full fc3 in compact fc3
+
+    fc3[b, j, k] = compact_fc3[s2pp[b], perms[trans[b], j], perms[trans[b], k]]
+    trans[b] is the index of the lattice translation that sends the atom
+    in primitive cell to b, and perms[t] is the atom permutation by the
+    inverse of the translation t.
+    """
+    positions = supercell.get_scaled_positions()
+    num_atom = len(positions)
+    p2s = primitive.get_primitive_to_supercell_map()
+    s2p = np.array(primitive.get_supercell_to_primitive_map(), dtype='intc')
+    p2p = primitive.get_primitive_to_primitive_map()
+    lattice_points = np.array([positions[i] - positions[p2s[0]]
+                               for i in range(num_atom) if s2p[i] == p2s[0]],
+                              dtype='double', order='C')
+
+    rotations = np.array([np.eye(3, dtype='intc')] * len(lattice_points),
+                         dtype='intc', order='C')
+    perms = get_atom_permutations(positions,
+                                  rotations,
+                                  -lattice_points,
+                                  symprec=symprec)
+    if (perms < 0).any():
+        print "Positions or tolerance are wrong."
+        raise ValueError
+
+    # perms[t, b] is s2p[b] only for the translation t that sends s2p[b] to b.
+    is_trans = (perms == s2p)
+    if (is_trans.sum(axis=0) != 1).any():
+        print "Positions or tolerance are wrong."
+        raise ValueError
+    trans = np.array(is_trans.argmax(axis=0), dtype='intc')
+    s2pp = np.array([p2p[s2p[i]] for i in range(num_atom)], dtype='intc')
+
+    return np.array(p2s, dtype='intc'), s2pp, trans, perms
+
+def is_compact_fc3(fc3):
+    return fc3.shape[0] != fc3.shape[1]
+
+def set_permutation_symmetry_fc3(fc3,
+                                 supercell=None,
+                                 primitive=None,
+                                 symprec=1e-5):
+    """Index permutation symmetry of fc3
+
+    Compact and sparse fc3 need supercell and primitive.
+    """
+    if is_sparse_fc3(fc3):
+        _set_permutation_symmetry_sparse_fc3(
+            fc3, get_compact_fc3_tables(supercell, primitive, symprec))
+        return
+
+    if is_compact_fc3(fc3):
+        _set_permutation_symmetry_compact_fc3(
+            fc3, get_compact_fc3_tables(supercell, primitive, symprec))
+        return
+
     try:
         import anharmonic._phono3py as phono3c
         phono3c.permutation_symmetry_fc3(fc3)
@@ -164,6 +351,115 @@ def set_permutation_symmetry_fc3(fc3):
                     fc3_elem = set_permutation_symmetry_fc3_elem(fc3, i, j, k)
                     copy_permutation_symmetry_fc3_elem(fc3, fc3_elem, i, j, k)
 
+def _set_permutation_symmetry_compact_fc3(fc3, tables):
+    p2s, s2pp, trans, perms = tables
+    try:
+        import anharmonic._phono3py as phono3c
+        phono3c.permutation_symmetry_compact_fc3(fc3, p2s, s2pp, trans, perms)
+    except ImportError:
+        def row(a):
+            perm = perms[trans[a]]
+            return fc3_copy[s2pp[a]][np.ix_(perm, perm)]
+
+        fc3_copy = fc3.copy()
+        num_atom = fc3.shape[1]
+        for i, a in enumerate(p2s):
+            fc3_a = row(a)
+            for b in range(num_atom):
+                fc3_b = row(b)
+                for c in range(num_atom):
+                    fc3_c = row(c)
+                    fc3[i, b, c] = (fc3_a[b, c] +
+                                    fc3_a[c, b].transpose(0, 2, 1) +
+                                    fc3_b[a, c].transpose(1, 0, 2) +
+                                    fc3_b[c, a].transpose(2, 0, 1) +
+                                    fc3_c[a, b].transpose(1, 2, 0) +
+                                    fc3_c[b, a].transpose(2, 1, 0)) / 6
+
+def _set_permutation_symmetry_sparse_fc3(fc3, tables):
+    p2s, s2pp, trans, perms = tables
+    values = fc3.get_values()
+    triplets = fc3.get_triplets()
+    try:
+        import anharmonic._phono3py as phono3c
+        phono3c.permutation_symmetry_sparse_fc3(
+            values, triplets, p2s, s2pp, trans, perms)
+    except ImportError:
+        num_atom = fc3.get_number_of_supercell_atoms()
+        keys = _get_sparse_fc3_keys(triplets, num_atom)
+        values_copy = values.copy()
+        for n, (i, b, c) in enumerate(triplets):
+            a = p2s[i]
+            tensor3 = np.zeros((3, 3, 3), dtype='double')
+            for (x, y, z), axes in (((a, b, c), (0, 1, 2)),
+                                    ((a, c, b), (0, 2, 1)),
+                                    ((b, a, c), (1, 0, 2)),
+                                    ((b, c, a), (2, 0, 1)),
+                                    ((c, a, b), (1, 2, 0)),
+                                    ((c, b, a), (2, 1, 0))):
+                perm = perms[trans[x]]
+                key = (s2pp[x] * num_atom + perm[y]) * num_atom + perm[z]
+                pos = np.searchsorted(keys, key)
+                if pos < len(keys) and keys[pos] == key:
+                    tensor3 += values_copy[pos].transpose(axes)
+            values[n] = tensor3 / 6
+
+def _get_sparse_fc3_keys(triplets, num_atom):
+    """Sorted keys of triplets to search elements of sparse fc3"""
+    t = np.array(triplets, dtype='int64')
+    return (t[:, 0] * num_atom + t[:, 1]) * num_atom + t[:, 2]
+
+def _get_sparse_fc3_sums(fc3, index, tables, func=None):
+    """Sums of sparse fc3 along an index
+
+    Elements are grouped by the other two indices of full fc3. Indices
+    of groups of elements, sums of groups, and numbers of elements in
+    groups are returned. For the first index, elements of all rows of
+    full fc3 are made by lattice translations.
+    """
+    values = fc3.get_values()
+    if func is not None:
+        values = func(values)
+    triplets = np.array(fc3.get_triplets(), dtype='int64')
+    num_atom = fc3.get_number_of_supercell_atoms()
+    if index == 0:
+        keys = triplets[:, 1] * num_atom + triplets[:, 2]
+    elif index == 1:
+        keys = triplets[:, 0] * num_atom + triplets[:, 2]
+    else:
+        keys = triplets[:, 0] * num_atom + triplets[:, 1]
+    group_keys, group_index = np.unique(keys, return_inverse=True)
+    fc3_sum = np.zeros((len(group_keys), 3, 3, 3), dtype='double')
+    counts = np.zeros(len(group_keys), dtype='double')
+
+    if index == 0:
+        p2s, s2pp, trans, perms = tables
+        for inv_perm in np.argsort(perms, axis=1):
+            keys_t = (inv_perm[triplets[:, 1]] * num_atom +
+                      inv_perm[triplets[:, 2]])
+            pos = np.minimum(np.searchsorted(group_keys, keys_t),
+                             len(group_keys) - 1)
+            found = np.where(group_keys[pos] == keys_t)[0]
+            np.add.at(fc3_sum, pos[found], values[found])
+            np.add.at(counts, pos[found], 1)
+    else:
+        np.add.at(fc3_sum, group_index, values)
+        np.add.at(counts, group_index, 1)
+
+    return group_index, fc3_sum, counts
+
+def _get_compact_fc3_sum_first_index(fc3, tables, func=None):
+    """Sum of full fc3[:, j, k] (or func(fc3[:, j, k])) from compact fc3"""
+    p2s, s2pp, trans, perms = tables
+    fc3_sum = np.zeros(fc3.shape[1:], dtype='double')
+    for perm in perms:
+        for fc3_p in fc3:
+            if func is None:
+                fc3_sum += fc3_p[np.ix_(perm, perm)]
+            else:
+                fc3_sum += func(fc3_p[np.ix_(perm, perm)])
+    return fc3_sum
+
 def set_permutation_symmetry_fc3_deprecated(fc3):
     fc3_sym = np.zeros(fc3.shape, dtype='double')
     for (i, j, k) in list(np.ndindex(fc3.shape[:3])):
@@ -193,16 +489,53 @@ def set_permutation_symmetry_fc3_elem(fc3, a, b, c, divisor=6):
     return tensor3
 
 def set_translational_invariance_fc3(fc3,
-                                     translational_symmetry_type=1):
+                                     translational_symmetry_type=1,
+                                     supercell=None,
+                                     primitive=None,
+                                     symprec=1e-5):
     for i in range(3):
         set_translational_invariance_fc3_per_index(
             fc3,
             index=i,
-            translational_symmetry_type=translational_symmetry_type)
+            translational_symmetry_type=translational_symmetry_type,
+            supercell=supercell,
+            primitive=primitive,
+            symprec=symprec)
 
 def set_translational_invariance_fc3_per_index(fc3,
                                                index=0,
-                                               translational_symmetry_type=1):
+                                               translational_symmetry_type=1,
+                                               supercell=None,
+                                               primitive=None,
+                                               symprec=1e-5):
+    """Translational invariance of fc3 along one index
+
+    Compact fc3 needs supercell and primitive for the first index, and
+    sparse fc3 needs them always. For sparse fc3, drifts are distributed
+    only to the stored elements.
+    """
+    if is_sparse_fc3(fc3):
+        tables = get_compact_fc3_tables(supercell, primitive, symprec)
+        values = fc3.get_values()
+        group_index, fc_sum, counts = _get_sparse_fc3_sums(fc3, index, tables)
+        if translational_symmetry_type == 2:
+            fc_abs_sum = _get_sparse_fc3_sums(fc3, index, tables, np.abs)[1]
+            fc_abs_sum[fc_abs_sum == 0] = 1
+            values -= (fc_sum / fc_abs_sum)[group_index] * np.abs(values)
+        else:
+            values -= (fc_sum / counts[:, None, None, None])[group_index]
+        return
+
+    if index == 0 and is_compact_fc3(fc3):
+        tables = get_compact_fc3_tables(supercell, primitive, symprec)
+        fc_sum = _get_compact_fc3_sum_first_index(fc3, tables)
+        if translational_symmetry_type == 2:
+            fc_abs_sum = _get_compact_fc3_sum_first_index(fc3, tables, np.abs)
+            fc3 -= fc_sum / fc_abs_sum * np.abs(fc3)
+        else:
+            fc3 -= fc_sum / fc3.shape[1]
+        return
+
     for i in range(fc3.shape[(1 + index) % 3]):
         for j in range(fc3.shape[(2 + index) % 3]):
             for k, l, m in list(np.ndindex(3, 3, 3)):
@@ -214,10 +547,10 @@ def set_translational_invariance_fc3_per_index(fc3,
                         fc3[:, i, j, k, l, m] -= (
                             fc_sum / fc_abs_sum * fc_abs)
                     elif index == 1:
-                        fc_abs = np.abs(fc3[i, :, j, k, l, m])
-                        fc_sum = np.sum(fc3[i, :, j, k, l, m])
+                        fc_abs = np.abs(fc3[j, :, i, k, l, m])
+                        fc_sum = np.sum(fc3[j, :, i, k, l, m])
                         fc_abs_sum = np.sum(fc_abs)
-                        fc3[i, :, j, k, l, m] -= (
+                        fc3[j, :, i, k, l, m] -= (
                             fc_sum / fc_abs_sum * fc_abs)
                     elif index == 2:
                         fc_abs = np.abs(fc3[i, j, :, k, l, m])
@@ -372,7 +705,8 @@ def solve_fc3(fc3,
               displacements_first,
               delta_fc2s,
               symprec,
-              pinv="numpy"):
+              pinv="numpy",
+              fc3_index=None):
     lattice = supercell.get_cell().T
     site_sym_cart = [similarity_transformation(lattice, sym)
                      for sym in site_symmetry]
@@ -397,9 +731,28 @@ def solve_fc3(fc3,
         except ImportError:
             inv_U = np.linalg.pinv(rot_disps)
             
-    for (i, j) in list(np.ndindex(num_atom, num_atom)):
-        fc3[first_atom_num, i, j] = np.dot(inv_U, _get_rotated_fc2s(
-                i, j, delta_fc2s, rot_map_syms, site_sym_cart)).reshape(3, 3, 3)
+    if fc3_index is None:
+        fc3_index = first_atom_num
+
+    # Least squares is solved only for one second atom of each orbit
+    # under site symmetry. Since the rows of the equations of the other
+    # second atoms in the orbit are permutations of the rotated rows,
+    # their fc3 are obtained by fc3[S(i), S(j)] = S S S fc3[i, j].
+    done = np.zeros(num_atom, dtype='bool')
+    for i in range(num_atom):
+        if done[i]:
+            continue
+        rot_fc2s = _get_rotated_fc2s(i, delta_fc2s, rot_map_syms, site_sym_cart)
+        fc3[fc3_index, i] = np.dot(
+            inv_U, rot_fc2s.reshape(len(rot_disps), -1)).reshape(
+            3, num_atom, 3, 3).swapaxes(0, 1)
+        done[i] = True
+        for sym, map_sym in zip(site_sym_cart, rot_map_syms):
+            i_rot = np.where(map_sym == i)[0][0]
+            if not done[i_rot]:
+                fc3[fc3_index, i_rot] = rotate_fc3_of_pair(
+                    sym, fc3[fc3_index, i][map_sym])
+                done[i_rot] = True
 
 def cutoff_fc3(fc3,
                supercell,
@@ -439,7 +792,26 @@ def _set_permutation_symmetry_fc3_elem_with_cutoff(fc3, fc3_done, a, b, c):
             tensor3[i, j, k] /= sum_done
     return tensor3
         
-def cutoff_fc3_by_zero(fc3, supercell, cutoff_distance, symprec=1e-5):
+def cutoff_fc3_by_zero(fc3,
+                       supercell,
+                       cutoff_distance,
+                       symprec=1e-5,
+                       p2s_map=None):
+    """fc3 elements are set zero beyond cutoff_distance
+
+    Compact fc3 needs p2s_map.
+    """
+    if is_sparse_fc3(fc3):
+        distances = get_pair_distances(supercell, symprec)
+        p2s = fc3.get_primitive_to_supercell_map()
+        i, j, k = fc3.get_triplets().T
+        i = p2s[i]
+        beyond = ((distances[i, j] > cutoff_distance) |
+                  (distances[j, k] > cutoff_distance) |
+                  (distances[k, i] > cutoff_distance))
+        fc3.get_values()[beyond] = 0
+        return
+
     num_atom = supercell.get_number_of_atoms()
     lattice = supercell.get_cell()
     min_distances = np.zeros((num_atom, num_atom), dtype='double')
@@ -449,14 +821,34 @@ def cutoff_fc3_by_zero(fc3, supercell, cutoff_distance, symprec=1e-5):
                     get_equivalent_smallest_vectors(
                         i, j, supercell, lattice, symprec)[0], lattice))
             
-    for i, j, k in np.ndindex(num_atom, num_atom, num_atom):
-        for pair in ((i, j), (j, k), (k, i)):
-            if min_distances[pair] > cutoff_distance:
-                fc3[i, j, k] = 0
-                break
-
-def show_drift_fc3(fc3, name="fc3"):
-    num_atom = fc3.shape[0]
+    if is_compact_fc3(fc3):
+        first_atoms = p2s_map
+    else:
+        first_atoms = range(num_atom)
+    for i_row, i in enumerate(first_atoms):
+        for j, k in np.ndindex(num_atom, num_atom):
+            for pair in ((i, j), (j, k), (k, i)):
+                if min_distances[pair] > cutoff_distance:
+                    fc3[i_row, j, k] = 0
+                    break
+
+def show_drift_fc3(fc3,
+                   name="fc3",
+                   supercell=None,
+                   primitive=None,
+                   symprec=1e-5):
+    """Compact and sparse fc3 need supercell and primitive"""
+    if is_sparse_fc3(fc3):
+        _show_drift_sparse_fc3(fc3, name, supercell, primitive, symprec)
+        return
+
+    num_atom = fc3.shape[1]
+    num_row = fc3.shape[0]
+    if is_compact_fc3(fc3):
+        sum_first = _get_compact_fc3_sum_first_index(
+            fc3, get_compact_fc3_tables(supercell, primitive, symprec))
+    else:
+        sum_first = fc3.sum(axis=0)
     maxval1 = 0
     maxval2 = 0
     maxval3 = 0
@@ -464,9 +856,12 @@ def show_drift_fc3(fc3, name="fc3"):
     klm2 = [0, 0, 0]
     klm3 = [0, 0, 0]
     for i, j, k, l, m in list(np.ndindex((num_atom, num_atom, 3, 3, 3))):
-        val1 = fc3[:, i, j, k, l, m].sum()
-        val2 = fc3[i, :, j, k, l, m].sum()
-        val3 = fc3[i, j, :, k, l, m].sum()
+        val1 = sum_first[i, j, k, l, m]
+        val2 = 0
+        val3 = 0
+        if i < num_row:
+            val2 = fc3[i, :, j, k, l, m].sum()
+            val3 = fc3[i, j, :, k, l, m].sum()
         if abs(val1) > abs(maxval1):
             maxval1 = val1
             klm1 = [k, l, m]
@@ -484,6 +879,103 @@ def show_drift_fc3(fc3, name="fc3"):
     print "%f (%s%s%s)" % (maxval3,
                            "xyz"[klm3[0]], "xyz"[klm3[1]], "xyz"[klm3[2]])
 
+def _show_drift_sparse_fc3(fc3, name, supercell, primitive, symprec):
+    tables = get_compact_fc3_tables(supercell, primitive, symprec)
+    print "max drift of %s:" % name,
+    for index in range(3):
+        fc_sum = _get_sparse_fc3_sums(fc3, index, tables)[1]
+        n, k, l, m = np.unravel_index(np.abs(fc_sum).argmax(), fc_sum.shape)
+        print "%f (%s%s%s)" % (fc_sum[n, k, l, m], "xyz"[k], "xyz"[l], "xyz"[m]),
+    print
+
+def _get_sparse_fc3(supercell,
+                    disp_dataset,
+                    fc2,
+                    symmetry,
+                    primitive,
+                    cutoff_distance,
+                    translational_symmetry_type,
+                    is_permutation_symmetry,
+                    verbose):
+    """Only elements of atom triplets within cutoff_distance are computed
+
+    With cutoff_distance of the dataset, the cutoff distance is limited
+    to it. Then all elements whose first indices are permuted are also
+    computed, and the contraction of cutoff_fc3 reduces to averaging
+    over the index permutations.
+    """
+    num_atom = supercell.get_number_of_atoms()
+    first_disp_atoms = np.unique(
+        [x['number'] for x in disp_dataset['first_atoms']])
+    fc3_least_atoms = np.zeros(
+        (len(first_disp_atoms), num_atom, num_atom, 3, 3, 3), dtype='double')
+    if 'cutoff_distance' in disp_dataset:
+        cutoff_distance = min(cutoff_distance, disp_dataset['cutoff_distance'])
+        _get_fc3_least_atoms(fc3_least_atoms,
+                             supercell,
+                             disp_dataset,
+                             fc2,
+                             symmetry,
+                             False,
+                             False,
+                             verbose)
+    else:
+        _get_fc3_least_atoms(fc3_least_atoms,
+                             supercell,
+                             disp_dataset,
+                             fc2,
+                             symmetry,
+                             translational_symmetry_type,
+                             is_permutation_symmetry,
+                             verbose)
+
+    symprec = symmetry.get_symmetry_tolerance()
+    if verbose:
+        print "Expanding fc3 (sparse, cut-off distance: %f)" % cutoff_distance
+    fc3 = get_sparse_fc3(supercell, primitive, cutoff_distance, symprec)
+    distribute_sparse_fc3(fc3,
+                          fc3_least_atoms,
+                          first_disp_atoms,
+                          supercell.get_cell().T,
+                          supercell.get_scaled_positions(),
+                          symmetry.get_symmetry_operations()['rotations'],
+                          symmetry.get_symmetry_operations()['translations'],
+                          symprec,
+                          verbose)
+
+    if 'cutoff_distance' in disp_dataset:
+        set_permutation_symmetry_fc3(fc3,
+                                     supercell=supercell,
+                                     primitive=primitive,
+                                     symprec=symprec)
+        if translational_symmetry_type:
+            if verbose:
+                print "Imposing translational invariance symmetry to fc3"
+            set_translational_invariance_fc3(
+                fc3,
+                translational_symmetry_type=translational_symmetry_type,
+                supercell=supercell,
+                primitive=primitive,
+                symprec=symprec)
+    elif translational_symmetry_type:
+        if verbose:
+            print "Imposing translational invariance symmetry to fc3"
+        set_translational_invariance_fc3_per_index(
+            fc3,
+            translational_symmetry_type=translational_symmetry_type,
+            supercell=supercell,
+            primitive=primitive,
+            symprec=symprec)
+    if is_permutation_symmetry:
+        if verbose:
+            print "Imposing index permulation symmetry to fc3"
+        set_permutation_symmetry_fc3(fc3,
+                                     supercell=supercell,
+                                     primitive=primitive,
+                                     symprec=symprec)
+
+    return fc3
+
 def _get_fc3_least_atoms(fc3,
                          supercell,
                          disp_dataset,
@@ -495,7 +987,12 @@ def _get_fc3_least_atoms(fc3,
     symprec = symmetry.get_symmetry_tolerance()
     unique_first_atom_nums = np.unique(
         [x['number'] for x in disp_dataset['first_atoms']])
-    for first_atom_num in unique_first_atom_nums:
+    for i, first_atom_num in enumerate(unique_first_atom_nums):
+        # fc3 has rows of all atoms or only of unique_first_atom_nums
+        if len(fc3) == supercell.get_number_of_atoms():
+            fc3_index = first_atom_num
+        else:
+            fc3_index = i
         _get_fc3_one_atom(fc3,
                           supercell,
                           disp_dataset,
@@ -505,7 +1002,8 @@ def _get_fc3_least_atoms(fc3,
                           translational_symmetry_type,
                           is_permutation_symmetry,
                           symprec,
-                          verbose)
+                          verbose,
+                          fc3_index=fc3_index)
 
 def _get_fc3_one_atom(fc3,
                       supercell,
@@ -516,7 +1014,8 @@ def _get_fc3_one_atom(fc3,
                       translational_symmetry_type,
                       is_permutation_symmetry,
                       symprec,
-                      verbose):
+                      verbose,
+                      fc3_index=None):
     displacements_first = []
     delta_fc2s = []
     for dataset_first_atom in disp_dataset['first_atoms']:
@@ -547,7 +1046,8 @@ def _get_fc3_one_atom(fc3,
               site_symmetry,
               displacements_first,
               delta_fc2s,
-              symprec)
+              symprec,
+              fc3_index=fc3_index)
 
     if verbose:
         print "- Displacements for fc3[ %d, x, x ]" % (first_atom_num + 1)
@@ -562,14 +1062,26 @@ def _get_fc3_one_atom(fc3,
                 print "    [%2d %2d %2d]\n" % tuple(v[2])
                 sys.stdout.flush()
 
-def _get_rotated_fc2s(i, j, fc2s, rot_map_syms, site_sym_cart):
-    num_sym = len(site_sym_cart)
+def rotate_fc3_of_pair(rot_cart, fc3_pair):
+    """R R R fc3[i, j] of all j, fc3_pair is [num_atom, 3, 3, 3]"""
+    return np.dot(np.dot(np.dot(fc3_pair, rot_cart.T).swapaxes(2, 3),
+                         rot_cart.T).swapaxes(1, 3),
+                  rot_cart.T).transpose(0, 3, 1, 2)
+
+def _get_rotated_fc2s(i, fc2s, rot_map_syms, site_sym_cart):
+    """Rotated delta fc2[i, j] of all j
+
+    Returns [num_fc2s * num_sym, num_atom, 9] whose rows are in the
+    order of get_rotated_displacement.
+    """
     rotated_fc2s = []
     for fc2 in fc2s:
         for sym, map_sym in zip(site_sym_cart, rot_map_syms):
-            fc2_rot = fc2[map_sym[i], map_sym[j]]
-            rotated_fc2s.append(similarity_transformation(sym, fc2_rot))
-    return np.reshape(rotated_fc2s, (-1, 9))
+            fc2_rot = fc2[map_sym[i]][map_sym]
+            rotated_fc2s.append(
+                np.dot(np.dot(fc2_rot, sym.T).swapaxes(1, 2), sym.T))
+    return np.reshape(np.swapaxes(rotated_fc2s, 2, 3),
+                      (len(rotated_fc2s), -1, 9))
             
 def _third_rank_tensor_rotation_elem(rot, tensor, l, m, n):
     sum_elems = 0.
@@ -586,17 +1098,14 @@ def _get_fc3_done(supercell, disp_dataset, symmetry):
     positions = supercell.get_scaled_positions()
     rotations = symmetry.get_symmetry_operations()['rotations']
     translations = symmetry.get_symmetry_operations()['translations']
+    atom_mapping = get_atom_permutations(positions,
+                                         rotations,
+                                         translations,
+                                         symprec)
+    if (atom_mapping < 0).any():
+        print "Position or symmetry is wrong."
+        raise ValueError
 
-    atom_mapping = []
-    for rot, trans in zip(rotations, translations):
-        atom_indices = []
-        for rot_pos in (np.dot(positions, rot.T) + trans):
-            diff = positions - rot_pos
-            diff -= np.rint(diff)
-            atom_indices.append(
-                np.where((np.abs(diff) < symprec).all(axis=1))[0][0])
-        atom_mapping.append(atom_indices)
-    
     for dataset_first_atom in disp_dataset['first_atoms']:
         first_atom_num = dataset_first_atom['number']
         site_symmetry = symmetry.get_site_symmetry(first_atom_num)        
@@ -611,15 +1120,14 @@ def _get_fc3_done(supercell, disp_dataset, symmetry):
         positions_shifted = positions - positions[first_atom_num]
         least_second_atom_nums = np.unique(least_second_atom_nums)
 
-        second_atom_nums = []
-        for red_rot in reduced_site_sym:
-            for i in least_second_atom_nums:
-                second_atom_nums.append(
-                    get_atom_by_symmetry(positions_shifted,
-                                         red_rot,
-                                         np.zeros(3, dtype='double'),
-                                         i,
-                                         symprec))
+        second_atom_nums = get_atom_permutations(
+            positions_shifted,
+            reduced_site_sym,
+            np.zeros((len(reduced_site_sym), 3), dtype='double'),
+            symprec)[:, least_second_atom_nums]
+        if (second_atom_nums < 0).any():
+            print "Position or symmetry is wrong."
+            raise ValueError
         second_atom_nums = np.unique(second_atom_nums)
                 
         for i in range(len(rotations)):
@@ -16,7 +16,7 @@ class FrequencyShift:
         self.set_grid_point(grid_point=grid_point)
 
         self._lang = lang
-        self._frequency_ = None
+        self._frequency_points = None
         self._fc3_normal_squared = None
         self._frequencies = None
         self._grid_point_triplets = None
@@ -28,12 +28,30 @@ class FrequencyShift:
         self._frequency_shifts = None
 
     def run(self):
+        """Frequency shifts of all temperatures and epsilons in one pass
+
+        frequency_shifts[num_temp, num_epsilon, num_band0], or with
+        frequency points,
+        frequency_shifts[num_fpoints, num_temp, num_epsilon, num_band0]
+        """
         if self._fc3_normal_squared is None:        
             self.run_interaction()
 
         num_band0 = self._fc3_normal_squared.shape[1]
-        self._frequency_shifts = np.zeros(num_band0, dtype='double')
-        self._run_py_with_band_indices()
+        shape = (len(self._temperatures), len(self._epsilons), num_band0)
+        if self._frequency_points is None:
+            self._frequency_shifts = np.zeros(shape, dtype='double')
+            if self._lang == 'C':
+                self._run_c_with_band_indices()
+            else:
+                self._run_py_with_band_indices()
+        else:
+            self._frequency_shifts = np.zeros(
+                (len(self._frequency_points),) + shape, dtype='double')
+            if self._lang == 'C':
+                self._run_c_with_frequency_points()
+            else:
+                self._run_py_with_frequency_points()
 
     def run_interaction(self):
         self._interaction.run(lang=self._lang)
@@ -70,10 +88,14 @@ class FrequencyShift:
                         bi_set.append(i)
                 if len(bi_set) > 0:
                     for i in bi_set:
-                        shifts[i] = (self._frequency_shifts[bi_set].sum() /
-                                     len(bi_set))
+                        shifts[..., i] = (
+                            self._frequency_shifts[..., bi_set].sum(axis=-1) /
+                            len(bi_set))
             return shifts
 
+    def get_frequency_points(self):
+        return self._frequency_points
+
     def set_grid_point(self, grid_point=None):
         if grid_point is None:
             self._grid_point = None
@@ -86,79 +108,140 @@ class FrequencyShift:
         
     def set_epsilon(self, epsilon):
         if epsilon is None:
-            self._epsilon = None
+            self._epsilons = None
         else:
-            self._epsilon = float(epsilon)
+            self._epsilons = np.array([epsilon], dtype='double')
+
+    def set_epsilons(self, epsilons):
+        if epsilons is None:
+            self._epsilons = None
+        else:
+            self._epsilons = np.array(epsilons, dtype='double').ravel()
 
     def set_temperature(self, temperature):
+        # None is 0 K.
         if temperature is None:
-            self._temperature = None
+            self._temperatures = np.zeros(1, dtype='double')
         else:
-            self._temperature = float(temperature)
-        
+            self._temperatures = np.array([temperature], dtype='double')
+
+    def set_temperatures(self, temperatures):
+        if temperatures is None:
+            self._temperatures = np.zeros(1, dtype='double')
+        else:
+            self._temperatures = np.array(temperatures, dtype='double').ravel()
+
+    def set_frequency_points(self, frequency_points):
+        if frequency_points is None:
+            self._frequency_points = None
+        else:
+            self._frequency_points = np.array(frequency_points, dtype='double')
+
+    def _run_c_with_band_indices(self):
+        import anharmonic._phono3py as phono3c
+        phono3c.frequency_shift_at_bands(self._frequency_shifts,
+                                         self._fc3_normal_squared,
+                                         self._grid_point_triplets,
+                                         self._triplet_weights,
+                                         self._frequencies,
+                                         self._band_indices,
+                                         self._temperatures,
+                                         self._epsilons,
+                                         self._unit_conversion,
+                                         self._cutoff_frequency)
+
+    def _run_c_with_frequency_points(self):
+        import anharmonic._phono3py as phono3c
+        phono3c.frequency_shift(self._frequency_shifts,
+                                self._fc3_normal_squared,
+                                self._frequency_points,
+                                self._grid_point_triplets,
+                                self._triplet_weights,
+                                self._frequencies,
+                                self._temperatures,
+                                self._epsilons,
+                                self._unit_conversion,
+                                self._cutoff_frequency)
+
     def _run_py_with_band_indices(self):
+        fpoints = self._frequencies[self._grid_point][self._band_indices]
+        self._run_py_at_fpoints(self._frequency_shifts, fpoints)
+
+    def _run_py_with_frequency_points(self):
+        num_band0 = len(self._band_indices)
+        for i, fpoint in enumerate(self._frequency_points):
+            self._run_py_at_fpoints(self._frequency_shifts[i],
+                                    [fpoint] * num_band0)
+
+    def _run_py_at_fpoints(self, frequency_shifts, fpoints):
         for i, (triplet, w, interaction) in enumerate(
             zip(self._grid_point_triplets,
                 self._triplet_weights,
                 self._fc3_normal_squared)):
 
             freqs = self._frequencies[triplet]
-            for j, bi in enumerate(self._band_indices):
-                if self._temperature > 0:
-                    self._frequency_shifts[j] += (
-                        self._frequency_shifts_at_bands(
-                            j, bi, freqs, interaction, w))
-                else:
-                    self._frequency_shifts[j] += (
-                        self._frequency_shifts_at_bands_0K(
-                            j, bi, freqs, interaction, w))
-
-        self._frequency_shifts *= self._unit_conversion
-
-    def _frequency_shifts_at_bands(self, i, bi, freqs, interaction, weight):
+            for j, t in enumerate(self._temperatures):
+                for k, epsilon in enumerate(self._epsilons):
+                    for l, fpoint in enumerate(fpoints):
+                        if t > 0:
+                            frequency_shifts[j, k, l] += (
+                                self._frequency_shifts_at_bands(
+                                    l, fpoint, freqs, interaction, w,
+                                    t, epsilon))
+                        else:
+                            frequency_shifts[j, k, l] += (
+                                self._frequency_shifts_at_bands_0K(
+                                    l, fpoint, freqs, interaction, w,
+                                    epsilon))
+
+        frequency_shifts *= self._unit_conversion
+
+    def _frequency_shifts_at_bands(self, i, fpoint, freqs, interaction, weight,
+                                   t, epsilon):
         sum_d = 0
         for (j, k) in list(np.ndindex(interaction.shape[1:])):
             if (freqs[1, j] > self._cutoff_frequency and
                 freqs[2, k] > self._cutoff_frequency):
                 d = 0.0
-                n2 = occupation(freqs[1, j], self._temperature)
-                n3 = occupation(freqs[2, k], self._temperature)
-                f1 = freqs[0, bi] + freqs[1, j] + freqs[2, k]
-                f2 = freqs[0, bi] - freqs[1, j] - freqs[2, k]
-                f3 = freqs[0, bi] - freqs[1, j] + freqs[2, k]
-                f4 = freqs[0, bi] + freqs[1, j] - freqs[2, k]
-
-                # if abs(f1) > self._epsilon:
+                n2 = occupation(freqs[1, j], t)
+                n3 = occupation(freqs[2, k], t)
+                f1 = fpoint + freqs[1, j] + freqs[2, k]
+                f2 = fpoint - freqs[1, j] - freqs[2, k]
+                f3 = fpoint - freqs[1, j] + freqs[2, k]
+                f4 = fpoint + freqs[1, j] - freqs[2, k]
+
+                # if abs(f1) > epsilon:
                 #     d -= (n2 + n3 + 1) / f1
-                # if abs(f2) > self._epsilon:
+                # if abs(f2) > epsilon:
                 #     d += (n2 + n3 + 1) / f2
-                # if abs(f3) > self._epsilon:
+                # if abs(f3) > epsilon:
                 #     d -= (n2 - n3) / f3
-                # if abs(f4) > self._epsilon:
+                # if abs(f4) > epsilon:
                 #     d += (n2 - n3) / f4
-                d -= (n2 + n3 + 1) * f1 / (f1 ** 2 + self._epsilon ** 2)
-                d += (n2 + n3 + 1) * f2 / (f2 ** 2 + self._epsilon ** 2)
-                d -= (n2 - n3) * f3 / (f3 ** 2 + self._epsilon ** 2)
-                d += (n2 - n3) * f4 / (f4 ** 2 + self._epsilon ** 2)
+                d -= (n2 + n3 + 1) * f1 / (f1 ** 2 + epsilon ** 2)
+                d += (n2 + n3 + 1) * f2 / (f2 ** 2 + epsilon ** 2)
+                d -= (n2 - n3) * f3 / (f3 ** 2 + epsilon ** 2)
+                d += (n2 - n3) * f4 / (f4 ** 2 + epsilon ** 2)
 
                 sum_d += d * interaction[i, j, k] * weight
         return sum_d
 
-    def _frequency_shifts_at_bands_0K(self, i, bi, freqs, interaction, weight):
+    def _frequency_shifts_at_bands_0K(self, i, fpoint, freqs, interaction,
+                                      weight, epsilon):
         sum_d = 0
         for (j, k) in list(np.ndindex(interaction.shape[1:])):
             if (freqs[1, j] > self._cutoff_frequency and
                 freqs[2, k] > self._cutoff_frequency):
                 d = 0.0
-                f1 = freqs[0, bi] + freqs[1, j] + freqs[2, k]
-                f2 = freqs[0, bi] - freqs[1, j] - freqs[2, k]
+                f1 = fpoint + freqs[1, j] + freqs[2, k]
+                f2 = fpoint - freqs[1, j] - freqs[2, k]
 
-                # if abs(f1) > self._epsilon:
+                # if abs(f1) > epsilon:
                 #     d -= 1.0 / f1
-                # if abs(f2) > self._epsilon:
+                # if abs(f2) > epsilon:
                 #     d += 1.0 / f2
-                d -= 1.0 * f1 / (f1 ** 2 + self._epsilon ** 2)
-                d += 1.0 * f2 / (f2 ** 2 + self._epsilon ** 2)
+                d -= 1.0 * f1 / (f1 ** 2 + epsilon ** 2)
+                d += 1.0 * f2 / (f2 ** 2 + epsilon ** 2)
 
                 sum_d += d * interaction[i, j, k] * weight
         return sum_d
@@ -5,6 +5,7 @@ from phonopy.structure.cells import get_supercell
 from anharmonic.file_IO import write_fc3_dat, write_fc2_dat
 from phonopy.units import VaspToTHz
 from phonopy.structure.grid_points import get_qpoints
+from anharmonic.phonon3.sparse_fc3 import is_sparse_fc3
 
 class Gruneisen:
     def __init__(self,
@@ -18,7 +19,10 @@ class Gruneisen:
                  factor=VaspToTHz,
                  symprec=1e-5):
         self._fc2 = fc2
-        self._fc3 = fc3
+        if is_sparse_fc3(fc3):
+            self._fc3 = fc3.get_compact_fc3()
+        else:
+            self._fc3 = fc3
         self._scell = supercell
         self._pcell = primitive
         self._ion_clamped = ion_clamped
@@ -249,6 +253,10 @@ class Gruneisen:
         dPhidu = np.zeros((num_atom_prim, num_atom_super, 3, 3, 3, 3),
                           dtype=float)
 
+        # Compact fc3 has only rows of atoms in primitive cell.
+        if fc3.shape[0] != num_atom_super:
+            p2s = range(num_atom_prim)
+
         for nu in range(num_atom_prim):
             Y = self._get_Y(nu)
             for pi in range(num_atom_super):
@@ -1,10 +1,12 @@
 import numpy as np
 from anharmonic.other.phonon import get_dynamical_matrix, set_phonon_c, set_phonon_py
+from anharmonic.other.phonon_store import PhononStore
 from phonopy.harmonic.dynamical_matrix import get_smallest_vectors
 from phonopy.units import VaspToTHz, Hbar, EV, Angstrom, THz, AMU, THzToEv
 from anharmonic.phonon3.real_to_reciprocal import RealToReciprocal
 from anharmonic.phonon3.reciprocal_to_normal import ReciprocalToNormal
-from anharmonic.phonon3.triplets import get_triplets_at_q, get_nosym_triplets_at_q, get_bz_grid_address
+from anharmonic.phonon3.sparse_fc3 import is_sparse_fc3
+from anharmonic.phonon3.triplets import get_triplets_at_q, get_triplets_at_qs, get_nosym_triplets_at_q, get_bz_grid_address
 
 class Interaction:
     def __init__(self,
@@ -49,6 +51,9 @@ class Interaction:
         self._ir_map_at_q = None
         self._grid_address = None
         self._bz_map = None
+        self._batch_grid_points = None
+        self._batch_chunk = None
+        self._batch_triplets = None
         self._interaction_strength = None
 
         self._phonon_done = None
@@ -56,6 +61,7 @@ class Interaction:
         self._eigenvectors = None
         self._dm = None
         self._nac_q_direction = None
+        self._phonon_store = None
         
         self._allocate_phonon()
         
@@ -119,6 +125,20 @@ class Interaction:
     def get_cutoff_frequency(self):
         return self._cutoff_frequency
         
+    def set_grid_points(self, grid_points, max_batch_triplets=4194304):
+        """Triplets at these grid points are searched in batches
+
+        A batch of the following grid points is searched at the call of
+        set_grid_point with one of them that is not in the current
+        batch. The number of grid points in a batch is chosen so that
+        the buffer for triplets has at most max_batch_triplets rows.
+        """
+        self._batch_grid_points = np.array(grid_points, dtype='intc')
+        self._batch_size = max(
+            1, max_batch_triplets // (np.prod(self._mesh) // 2 + 1))
+        self._batch_chunk = None
+        self._batch_triplets = None
+
     def set_grid_point(self, grid_point, stores_triplets_map=False):
         reciprocal_lattice = np.linalg.inv(self._primitive.get_cell())
         if self._is_nosym:
@@ -132,6 +152,16 @@ class Interaction:
                  self._mesh,
                  reciprocal_lattice,
                  stores_triplets_map=stores_triplets_map)
+        elif (not stores_triplets_map and
+              self._batch_grid_points is not None and
+              grid_point in self._batch_grid_points):
+            (triplets_at_q,
+             weights_at_q,
+             grid_address,
+             bz_map,
+             triplets_map_at_q,
+             ir_map_at_q) = self._get_triplets_in_batch(grid_point,
+                                                        reciprocal_lattice)
         else:
             (triplets_at_q,
              weights_at_q,
@@ -161,6 +191,39 @@ class Interaction:
         self._bz_map = bz_map
         self._ir_map_at_q = ir_map_at_q
 
+    def _get_triplets_in_batch(self, grid_point, reciprocal_lattice):
+        if self._batch_chunk is None or grid_point not in self._batch_chunk:
+            i = np.where(self._batch_grid_points == grid_point)[0][0]
+            chunk = self._batch_grid_points[i:(i + self._batch_size)]
+            if self._batch_triplets is None:
+                max_num_triplets = None
+            else:
+                # Estimated from the number of triplets in the last batch
+                num_triplets = len(self._batch_triplets[0])
+                max_num_triplets = (
+                    num_triplets * len(chunk) // len(self._batch_chunk)
+                    * 5 // 4 + len(chunk))
+            self._batch_triplets = None
+            self._batch_triplets = get_triplets_at_qs(
+                chunk,
+                self._mesh,
+                self._symmetry.get_pointgroup_operations(),
+                reciprocal_lattice,
+                max_num_triplets=max_num_triplets)
+            self._batch_chunk = chunk
+        (triplets,
+         weights,
+         offsets,
+         grid_address,
+         bz_map) = self._batch_triplets[:5]
+        i = np.where(self._batch_chunk == grid_point)[0][0]
+        return (triplets[offsets[i]:offsets[i + 1]],
+                weights[offsets[i]:offsets[i + 1]],
+                grid_address,
+                bz_map,
+                None,
+                None)
+
     def set_dynamical_matrix(self,
                              fc2,
                              supercell,
@@ -181,11 +244,36 @@ class Interaction:
         if nac_q_direction is not None:
             self._nac_q_direction = np.array(nac_q_direction, dtype='double')
 
+    def set_phonon_store(self, directory):
+        """Phonons are stored in and reused from files in directory
+
+        This has to be called after set_dynamical_matrix and
+        set_nac_q_direction.
+        """
+        self._phonon_store = PhononStore(
+            directory,
+            self._dm,
+            self._mesh,
+            self._grid_address,
+            self._frequency_factor_to_THz,
+            nac_q_direction=self._nac_q_direction,
+            lapack_zheev_uplo=self._lapack_zheev_uplo)
+        (self._frequencies,
+         self._eigenvectors,
+         phonon_done) = self._phonon_store.get_phonons()
+        self._phonon_done = np.array(phonon_done, dtype='byte')
+
+    def get_phonon_store(self):
+        return self._phonon_store
+
     def set_phonon(self, grid_points):
         # for i, grid_triplet in enumerate(self._triplets_at_q):
         #     for gp in grid_triplet:
         #         self._set_phonon_py(gp)
-        self._set_phonon_c(grid_points)
+        if self._phonon_store is None:
+            self._set_phonon_c(grid_points)
+        else:
+            self._set_phonon_to_store(grid_points)
 
     def get_mean_square_strength(self):
         unit_conversion = (
@@ -209,6 +297,12 @@ class Interaction:
         masses = np.array(self._primitive.get_masses(), dtype='double')
         p2s = self._primitive.get_primitive_to_supercell_map()
         s2p = self._primitive.get_supercell_to_primitive_map()
+        if is_sparse_fc3(self._fc3):
+            fc3 = self._fc3.get_values()
+            fc3_triplets = self._fc3.get_triplets()
+        else:
+            fc3 = self._fc3
+            fc3_triplets = None
 
         phono3c.interaction(self._interaction_strength,
                             self._frequencies,
@@ -216,7 +310,8 @@ class Interaction:
                             self._triplets_at_q,
                             self._grid_address,
                             self._mesh,
-                            self._fc3,
+                            fc3,
+                            fc3_triplets,
                             svecs,
                             multiplicity,
                             masses,
@@ -226,6 +321,42 @@ class Interaction:
                             self._symmetrize_fc3_q,
                             self._cutoff_frequency)
 
+    def _set_phonon_to_store(self, grid_points, chunk_size=1000):
+        """Phonons are solved in private buffers and copied to the store
+
+        Rows of the shared store are never used as work space of zheev,
+        because other processes may be reading them.
+        """
+        # Phonons stored by other processes after opening the store
+        self._phonon_done |= self._phonon_store.get_phonons()[2]
+        gps = np.unique(grid_points)
+        undone = np.array(gps[self._phonon_done[gps] == 0], dtype='intc')
+        num_band = self._primitive.get_number_of_atoms() * 3
+        for i in range(0, len(undone), chunk_size):
+            gps = undone[i:(i + chunk_size)]
+            frequencies = np.zeros((len(gps), num_band), dtype='double')
+            eigenvectors = np.zeros((len(gps), num_band, num_band),
+                                    dtype='complex128')
+            # q-direction of NAC is applied only at Gamma point, which is
+            # the first of the private buffers if it is in gps.
+            if gps[0] == 0:
+                nac_q_direction = self._nac_q_direction
+            else:
+                nac_q_direction = None
+            set_phonon_c(self._dm,
+                         frequencies,
+                         eigenvectors,
+                         np.zeros(len(gps), dtype='byte'),
+                         np.arange(len(gps), dtype='intc'),
+                         np.array(self._grid_address[gps],
+                                  dtype='intc', order='C'),
+                         self._mesh,
+                         self._frequency_factor_to_THz,
+                         nac_q_direction,
+                         self._lapack_zheev_uplo)
+            self._phonon_store.store(gps, frequencies, eigenvectors)
+            self._phonon_done[gps] = 1
+
     def _set_phonon_c(self, grid_points):
         set_phonon_c(self._dm,
                      self._frequencies,
@@ -1,5 +1,6 @@
 import numpy as np
 from phonopy.harmonic.dynamical_matrix import get_smallest_vectors
+from anharmonic.phonon3.sparse_fc3 import is_sparse_fc3
 
 class RealToReciprocal:
     def __init__(self,
@@ -8,7 +9,10 @@ class RealToReciprocal:
                  primitive,
                  mesh,
                  symprec=1e-5):
-        self._fc3 = fc3
+        if is_sparse_fc3(fc3):
+            self._fc3 = fc3.get_compact_fc3()
+        else:
+            self._fc3 = fc3
         self._supercell = supercell
         self._primitive = primitive
         self._mesh = mesh
@@ -51,7 +55,11 @@ class RealToReciprocal:
     def _real_to_reciprocal_elements(self, patom_indices):
         num_satom = self._supercell.get_number_of_atoms()
         pi = patom_indices
-        i = self._p2s_map[pi[0]]
+        # Compact fc3 has only rows of atoms in primitive cell.
+        if self._fc3.shape[0] == num_satom:
+            i = self._p2s_map[pi[0]]
+        else:
+            i = pi[0]
         fc3_reciprocal = np.zeros((3, 3, 3), dtype='complex128')
         for j in range(num_satom):
             if self._s2p_map[j] != self._p2s_map[pi[1]]:
@@ -0,0 +1,81 @@
+import numpy as np
+from anharmonic.phonon3.displacement_fc3 import get_pair_distances
+
+class SparseFC3:
+    """fc3 of atom triplets within cutoff distance
+
+    Elements of compact fc3 [num_patom, num_satom, num_satom, 3, 3, 3]
+    whose three atom pairs are all closer than cutoff_distance are
+    stored. triplets[n] = (i, j, k) gives the indices of values[n] in
+    compact fc3, i.e., values[n] = fc3[p2s_map[i], j, k]. triplets are
+    sorted in ascending order. This set of triplets is closed under
+    index permutations and lattice translations.
+    """
+    def __init__(self,
+                 values,
+                 triplets,
+                 p2s_map,
+                 num_satom,
+                 cutoff_distance):
+        self._values = values
+        self._triplets = triplets
+        self._p2s_map = np.array(p2s_map, dtype='intc')
+        self._num_satom = num_satom
+        self._cutoff_distance = cutoff_distance
+
+    def get_values(self):
+        return self._values
+
+    def get_triplets(self):
+        return self._triplets
+
+    def get_primitive_to_supercell_map(self):
+        return self._p2s_map
+
+    def get_number_of_supercell_atoms(self):
+        return self._num_satom
+
+    def get_cutoff_distance(self):
+        return self._cutoff_distance
+
+    def get_compact_fc3(self):
+        fc3 = np.zeros((len(self._p2s_map),
+                        self._num_satom,
+                        self._num_satom, 3, 3, 3), dtype='double')
+        i, j, k = self._triplets.T
+        fc3[i, j, k] = self._values
+        return fc3
+
+def get_sparse_fc3(supercell, primitive, cutoff_distance, symprec=1e-5):
+    """Sparse fc3 whose values are zero"""
+    triplets = get_sparse_fc3_triplets(supercell,
+                                       primitive,
+                                       cutoff_distance,
+                                       symprec=symprec)
+    values = np.zeros((len(triplets), 3, 3, 3), dtype='double')
+    return SparseFC3(values,
+                     triplets,
+                     primitive.get_primitive_to_supercell_map(),
+                     supercell.get_number_of_atoms(),
+                     cutoff_distance)
+
+def get_sparse_fc3_triplets(supercell, primitive, cutoff_distance,
+                            symprec=1e-5):
+    """Atom triplets whose pair distances are all below cutoff_distance
+
+    The cutoff is the same as that of second atoms in the displacement
+    dataset.
+    """
+    distances = get_pair_distances(supercell, symprec)
+    triplets = []
+    for i, atom1 in enumerate(primitive.get_primitive_to_supercell_map()):
+        neighbors = np.where(distances[atom1] < cutoff_distance)[0]
+        j, k = np.nonzero(
+            distances[np.ix_(neighbors, neighbors)] < cutoff_distance)
+        triplets.append(np.transpose([[i] * len(j),
+                                      neighbors[j],
+                                      neighbors[k]]))
+    return np.array(np.vstack(triplets), dtype='intc', order='C')
+
+def is_sparse_fc3(fc3):
+    return isinstance(fc3, SparseFC3)
@@ -44,6 +44,40 @@ def get_triplets_at_q(grid_point,
         
     return triplets_at_q, weights, bz_grid_address, bz_map, map_triplets, map_q
 
+def get_triplets_at_qs(grid_points,
+                       mesh,
+                       point_group, # real space point group of space group
+                       primitive_lattice, # column vectors
+                       is_time_reversal=True,
+                       stores_triplets_map=False,
+                       max_num_triplets=None):
+    """Triplets at grid points in one call
+
+    Triplets and weights at grid_points[i] are those from offsets[i]
+    to offsets[i + 1] in triplets and weights. BZ grid address is
+    shared by all the grid points.
+    """
+    grid_address = get_grid_address(mesh)
+    bz_grid_address, bz_map = spg.relocate_BZ_grid_address(grid_address,
+                                                           mesh,
+                                                           primitive_lattice)
+    (triplets,
+     weights,
+     offsets,
+     map_triplets,
+     map_q) = spg.get_BZ_triplets_at_qs(
+         grid_points,
+         mesh,
+         point_group,
+         bz_grid_address,
+         bz_map,
+         is_time_reversal=is_time_reversal,
+         stores_triplets_map=stores_triplets_map,
+         max_num_triplets=max_num_triplets)
+
+    return (triplets, weights, offsets, bz_grid_address, bz_map,
+            map_triplets, map_q)
+
 def get_triplets_third_q_list(grid_point,
                               bz_grid_address,
                               bz_map,
@@ -108,17 +142,19 @@ def get_grid_point_from_address(address, mesh):
             (address[1] % m[1]) * m[0] +
             (address[2] % m[2]) * m[0] * m[1])
 
-def get_bz_grid_point_from_address(address, mesh, bz_map):
-    # X runs first in XYZ
-    # (*In spglib, Z first is possible with MACRO setting.)
-    # 2m is defined in kpoint.c of spglib.
-    m = 2 * np.array(mesh, dtype='intc')
-    return bz_map[get_grid_point_from_address(address, m)]
+def get_bz_grid_point_from_address(address, mesh, bz_grid_address, bz_map):
+    return spg.get_BZ_grid_points_from_addresses(address,
+                                                 mesh,
+                                                 bz_grid_address,
+                                                 bz_map)
 
 def invert_grid_point(grid_point, mesh, grid_address, bz_map):
     # gp --> [address] --> [-address] --> inv_gp
     address = grid_address[grid_point]
-    return get_bz_grid_point_from_address(-address, mesh, bz_map)
+    return get_bz_grid_point_from_address(-address,
+                                          mesh,
+                                          grid_address,
+                                          bz_map)
 
 def get_ir_grid_points(mesh, rotations, mesh_shifts=[False, False, False]):
     grid_mapping_table, grid_address = spg.get_stabilized_reciprocal_mesh(
@@ -143,12 +179,14 @@ def get_grid_points_by_rotations(grid_point,
 def get_BZ_grid_points_by_rotations(grid_point,
                                     reciprocal_rotations,
                                     mesh,
+                                    bz_grid_address,
                                     bz_map,
                                     mesh_shifts=[False, False, False]):
     return spg.get_BZ_grid_points_by_rotations(
         grid_point,
         reciprocal_rotations,
         mesh,
+        bz_grid_address,
         bz_map,
         is_shift=np.where(mesh_shifts, 1, 0))
     
@@ -306,18 +344,18 @@ def get_tetrahedra_vertices(relative_address,
                             triplets_at_q,
                             bz_grid_address,
                             bz_map):
-    bzmesh = mesh * 2
     grid_order = [1, mesh[0], mesh[0] * mesh[1]]
-    bz_grid_order = [1, bzmesh[0], bzmesh[0] * bzmesh[1]]
     num_triplets = len(triplets_at_q)
     vertices = np.zeros((num_triplets, 2, 24, 4), dtype='intc')
     for i, tp in enumerate(triplets_at_q):
         for j, adrs_shift in enumerate(
                 (relative_address, -relative_address)):
             adrs = bz_grid_address[tp[j + 1]] + adrs_shift
-            bz_gp = np.dot(adrs % bzmesh, bz_grid_order)
             gp = np.dot(adrs % mesh, grid_order)
-            vgp = bz_map[bz_gp]
+            vgp = spg.get_BZ_grid_points_from_addresses(adrs,
+                                                        mesh,
+                                                        bz_grid_address,
+                                                        bz_map)
             vertices[i, j] = vgp + (vgp == -1) * (gp + 1)
     return vertices
 
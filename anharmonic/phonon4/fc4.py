@@ -1,7 +1,7 @@
 import sys
 import numpy as np
-from phonopy.harmonic.force_constants import similarity_transformation, get_positions_sent_by_rot_inv, get_rotated_displacement
-from anharmonic.phonon3.fc3 import set_translational_invariance_fc3_per_index, solve_fc3, distribute_fc3, third_rank_tensor_rotation, get_atom_mapping_by_symmetry, get_atom_by_symmetry, show_drift_fc3, set_permutation_symmetry_fc3, get_delta_fc2, get_constrained_fc2
+from phonopy.harmonic.force_constants import similarity_transformation, get_positions_sent_by_rot_inv, get_rotated_displacement, get_atom_permutations
+from anharmonic.phonon3.fc3 import set_translational_invariance_fc3_per_index, solve_fc3, distribute_fc3, third_rank_tensor_rotation, show_drift_fc3, set_permutation_symmetry_fc3, get_delta_fc2, get_constrained_fc2
 from anharmonic.phonon3.displacement_fc3 import get_reduced_site_symmetry, get_bond_symmetry
 from phonopy.structure.symmetry import Symmetry
 
@@ -56,8 +56,7 @@ def get_fc4(supercell,
 def set_translational_invariance_fc4(fc4):
     try:
         import anharmonic._phono4py as phono4c
-        for i in range(4):
-            phono4c.translational_invariance_fc4(fc4, i)
+        phono4c.translational_invariance_fc4(fc4)
     except ImportError:
         for i in range(4):
             set_translational_invariance_fc4_per_index(fc4, index=i)
@@ -173,22 +172,22 @@ def distribute_fc4(fc4,
                    symprec,
                    verbose):
     num_atom = len(positions)
+    permutations = get_atom_permutations(positions,
+                                         rotations,
+                                         translations,
+                                         symprec)
 
     for i in range(num_atom):
         if i in first_disp_atoms:
             continue
 
+        rot_num = -1
         for atom_index_done in first_disp_atoms:
-            rot_num = get_atom_mapping_by_symmetry(positions,
-                                                   i,
-                                                   atom_index_done,
-                                                   rotations,
-                                                   translations,
-                                                   symprec)
-            if rot_num > -1:
+            syms = np.where(permutations[:, i] == atom_index_done)[0]
+            if len(syms) > 0:
                 i_rot = atom_index_done
+                rot_num = syms[0]
                 rot = rotations[rot_num]
-                trans = translations[rot_num]
                 break
 
         if rot_num < 0:
@@ -199,14 +198,12 @@ def distribute_fc4(fc4,
             print "  [ %d, x, x, x ] to [ %d, x, x, x ]" % (i_rot + 1, i + 1)
             sys.stdout.flush()
 
-        atom_mapping = np.zeros(num_atom, dtype='intc')
-        for j in range(num_atom):
-            atom_mapping[j] = get_atom_by_symmetry(positions,
-                                                   rot,
-                                                   trans,
-                                                   j,
-                                                   symprec)
-            
+        atom_mapping = permutations[rot_num]
+        if (atom_mapping < 0).any():
+            print "Position or symmetry is wrong."
+            raise ValueError
+
+
         rot_cart_inv = np.double(
             similarity_transformation(lattice, rot).T.copy())
 
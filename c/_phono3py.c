@@ -11,8 +11,10 @@
 #include "phonon3_h/interaction.h"
 #include "phonon3_h/imag_self_energy.h"
 #include "phonon3_h/imag_self_energy_with_g.h"
+#include "phonon3_h/frequency_shift.h"
 #include "phonon3_h/collision_matrix.h"
 #include "other_h/isotope.h"
+#include "other_h/force_file.h"
 #include "spglib_h/kpoint.h"
 #include "spglib_h/tetrahedron_method.h"
 
@@ -28,14 +30,22 @@ static PyObject * py_get_imag_self_energy(PyObject *self, PyObject *args);
 static PyObject * py_get_imag_self_energy_at_bands(PyObject *self,
 						   PyObject *args);
 static PyObject * py_get_thm_imag_self_energy(PyObject *self, PyObject *args);
+static PyObject * py_get_frequency_shift(PyObject *self, PyObject *args);
+static PyObject * py_get_frequency_shift_at_bands(PyObject *self,
+						  PyObject *args);
 static PyObject * py_get_collision_matrix(PyObject *self, PyObject *args);
 static PyObject * py_get_reducible_collision_matrix(PyObject *self, PyObject *args);
 static PyObject * py_symmetrize_collision_matrix(PyObject *self, PyObject *args);
 static PyObject * py_set_phonons_at_gridpoints(PyObject *self, PyObject *args);
 static PyObject * py_get_phonon(PyObject *self, PyObject *args);
 static PyObject * py_distribute_fc3(PyObject *self, PyObject *args);
+static PyObject * py_distribute_sparse_fc3(PyObject *self, PyObject *args);
 static PyObject * py_get_isotope_strength(PyObject *self, PyObject *args);
 static PyObject * py_get_thm_isotope_strength(PyObject *self, PyObject *args);
+static PyObject *
+py_set_permutation_symmetry_compact_fc3(PyObject *self, PyObject *args);
+static PyObject *
+py_set_permutation_symmetry_sparse_fc3(PyObject *self, PyObject *args);
 static PyObject * py_set_permutation_symmetry_fc3(PyObject *self,
 						  PyObject *args);
 static PyObject * py_get_neighboring_gird_points(PyObject *self, PyObject *args);
@@ -47,6 +57,7 @@ py_set_triplets_integration_weights_with_sigma(PyObject *self, PyObject *args);
 static PyObject * py_phonopy_zheev(PyObject *self, PyObject *args);
 static PyObject * py_inverse_collision_matrix(PyObject *self, PyObject *args);
 static PyObject * py_phonopy_pinv(PyObject *self, PyObject *args);
+static PyObject * py_read_force_blocks(PyObject *self, PyObject *args);
 static PyObject * py_inverse_collision_matrix_libflame(PyObject *self, PyObject *args);
 
 static void get_triplet_tetrahedra_vertices
@@ -63,15 +74,20 @@ static PyMethodDef functions[] = {
   {"imag_self_energy", py_get_imag_self_energy, METH_VARARGS, "Imaginary part of self energy"},
   {"imag_self_energy_at_bands", py_get_imag_self_energy_at_bands, METH_VARARGS, "Imaginary part of self energy at phonon frequencies of bands"},
   {"thm_imag_self_energy", py_get_thm_imag_self_energy, METH_VARARGS, "Imaginary part of self energy at phonon frequencies of bands for tetrahedron method"},
+  {"frequency_shift", py_get_frequency_shift, METH_VARARGS, "Real part of self energy at frequency points"},
+  {"frequency_shift_at_bands", py_get_frequency_shift_at_bands, METH_VARARGS, "Real part of self energy at phonon frequencies of bands"},
   {"collision_matrix", py_get_collision_matrix, METH_VARARGS, "Collision matrix with g"},
   {"reducible_collision_matrix", py_get_reducible_collision_matrix, METH_VARARGS, "Collision matrix with g for reducible grid points"},
   {"symmetrize_collision_matrix", py_symmetrize_collision_matrix, METH_VARARGS, "Symmetrize collision matrix"},
   {"phonons_at_gridpoints", py_set_phonons_at_gridpoints, METH_VARARGS, "Set phonons at grid points"},
   {"phonon", py_get_phonon, METH_VARARGS, "Get phonon"},
   {"distribute_fc3", py_distribute_fc3, METH_VARARGS, "Distribute least fc3 to full fc3"},
+  {"distribute_sparse_fc3", py_distribute_sparse_fc3, METH_VARARGS, "Distribute least fc3 to sparse fc3"},
   {"isotope_strength", py_get_isotope_strength, METH_VARARGS, "Isotope scattering strength"},
   {"thm_isotope_strength", py_get_thm_isotope_strength, METH_VARARGS, "Isotope scattering strength for tetrahedron_method"},
   {"permutation_symmetry_fc3", py_set_permutation_symmetry_fc3, METH_VARARGS, "Set permutation symmetry for fc3"},
+  {"permutation_symmetry_compact_fc3", py_set_permutation_symmetry_compact_fc3, METH_VARARGS, "Set permutation symmetry for compact fc3"},
+  {"permutation_symmetry_sparse_fc3", py_set_permutation_symmetry_sparse_fc3, METH_VARARGS, "Set permutation symmetry for sparse fc3"},
   {"neighboring_grid_points", py_get_neighboring_gird_points, METH_VARARGS, "Neighboring grid points by relative grid addresses"},
   {"integration_weights", py_set_integration_weights, METH_VARARGS, "Integration weights of tetrahedron method"},
   {"triplets_integration_weights", py_set_triplets_integration_weights, METH_VARARGS, "Integration weights of tetrahedron method for triplets"},
@@ -79,6 +95,7 @@ static PyMethodDef functions[] = {
   {"zheev", py_phonopy_zheev, METH_VARARGS, "Lapack zheev wrapper"},
   {"inverse_collision_matrix", py_inverse_collision_matrix, METH_VARARGS, "Pseudo-inverse using Lapack dsyev"},
   {"pinv", py_phonopy_pinv, METH_VARARGS, "Pseudo-inverse using Lapack dgesvd"},
+  {"force_blocks", py_read_force_blocks, METH_VARARGS, "Read sets of forces from FORCES_FC3 or FORCES_FC2"},
 #ifdef LIBFLAME
   {"inverse_collision_matrix_libflame", py_inverse_collision_matrix_libflame, METH_VARARGS, "Pseudo-inverse using libflame hevd"},
 #endif
@@ -307,6 +324,7 @@ static PyObject * py_get_interaction(PyObject *self, PyObject *args)
   PyArrayObject* shortest_vectors;
   PyArrayObject* multiplicity;
   PyArrayObject* fc3_py;
+  PyArrayObject* fc3_triplets_py;
   PyArrayObject* atomic_masses;
   PyArrayObject* p2s_map;
   PyArrayObject* s2p_map;
@@ -314,7 +332,7 @@ static PyObject * py_get_interaction(PyObject *self, PyObject *args)
   double cutoff_frequency;
   int symmetrize_fc3_q;
 
-  if (!PyArg_ParseTuple(args, "OOOOOOOOOOOOOid",
+  if (!PyArg_ParseTuple(args, "OOOOOOOOOOOOOOid",
 			&fc3_normal_squared_py,
 			&frequencies,
 			&eigenvectors,
@@ -322,6 +340,7 @@ static PyObject * py_get_interaction(PyObject *self, PyObject *args)
 			&grid_address_py,
 			&mesh_py,
 			&fc3_py,
+			&fc3_triplets_py,
 			&shortest_vectors,
 			&multiplicity,
 			&atomic_masses,
@@ -343,6 +362,7 @@ static PyObject * py_get_interaction(PyObject *self, PyObject *args)
   const int* grid_address = (int*)grid_address_py->data;
   const int* mesh = (int*)mesh_py->data;
   Darray* fc3 = convert_to_darray(fc3_py);
+  Iarray* fc3_triplets;
   Darray* svecs = convert_to_darray(shortest_vectors);
   Iarray* multi = convert_to_iarray(multiplicity);
   const double* masses = (double*)atomic_masses->data;
@@ -350,6 +370,13 @@ static PyObject * py_get_interaction(PyObject *self, PyObject *args)
   const int* s2p = (int*)s2p_map->data;
   const int* band_indicies = (int*)band_indicies_py->data;
 
+  /* fc3 is sparse when atom triplets of its elements are given. */
+  if ((PyObject*)fc3_triplets_py == Py_None) {
+    fc3_triplets = NULL;
+  } else {
+    fc3_triplets = convert_to_iarray(fc3_triplets_py);
+  }
+
   get_interaction(fc3_normal_squared,
 		  freqs,
 		  eigvecs,
@@ -357,6 +384,7 @@ static PyObject * py_get_interaction(PyObject *self, PyObject *args)
 		  grid_address,
 		  mesh,
 		  fc3,
+		  fc3_triplets,
 		  svecs,
 		  multi,
 		  masses,
@@ -371,6 +399,9 @@ static PyObject * py_get_interaction(PyObject *self, PyObject *args)
   free(eigvecs);
   free(triplets);
   free(fc3);
+  if (fc3_triplets) {
+    free(fc3_triplets);
+  }
   free(svecs);
   free(multi);
   
@@ -518,6 +549,119 @@ static PyObject * py_get_thm_imag_self_energy(PyObject *self, PyObject *args)
   Py_RETURN_NONE;
 }
 
+static PyObject * py_get_frequency_shift_at_bands(PyObject *self,
+						  PyObject *args)
+{
+  PyArrayObject* shift_py;
+  PyArrayObject* fc3_normal_squared_py;
+  PyArrayObject* frequencies_py;
+  PyArrayObject* grid_point_triplets_py;
+  PyArrayObject* triplet_weights_py;
+  PyArrayObject* band_indices_py;
+  PyArrayObject* epsilons_py;
+  PyArrayObject* temperatures_py;
+  double unit_conversion_factor, cutoff_frequency;
+
+  if (!PyArg_ParseTuple(args, "OOOOOOOOdd",
+			&shift_py,
+			&fc3_normal_squared_py,
+			&grid_point_triplets_py,
+			&triplet_weights_py,
+			&frequencies_py,
+			&band_indices_py,
+			&temperatures_py,
+			&epsilons_py,
+			&unit_conversion_factor,
+			&cutoff_frequency)) {
+    return NULL;
+  }
+
+  Darray* fc3_normal_squared = convert_to_darray(fc3_normal_squared_py);
+  double* shift = (double*)shift_py->data;
+  const double* frequencies = (double*)frequencies_py->data;
+  const int* band_indices = (int*)band_indices_py->data;
+  const int* grid_point_triplets = (int*)grid_point_triplets_py->data;
+  const int* triplet_weights = (int*)triplet_weights_py->data;
+  const double* temperatures = (double*)temperatures_py->data;
+  const int num_temp = (int)temperatures_py->dimensions[0];
+  const double* epsilons = (double*)epsilons_py->data;
+  const int num_epsilon = (int)epsilons_py->dimensions[0];
+
+  get_frequency_shift_at_bands(shift,
+			       fc3_normal_squared,
+			       band_indices,
+			       frequencies,
+			       grid_point_triplets,
+			       triplet_weights,
+			       epsilons,
+			       num_epsilon,
+			       temperatures,
+			       num_temp,
+			       unit_conversion_factor,
+			       cutoff_frequency);
+
+  free(fc3_normal_squared);
+  
+  Py_RETURN_NONE;
+}
+
+static PyObject * py_get_frequency_shift(PyObject *self, PyObject *args)
+{
+  PyArrayObject* shift_py;
+  PyArrayObject* fc3_normal_squared_py;
+  PyArrayObject* frequency_points_py;
+  PyArrayObject* frequencies_py;
+  PyArrayObject* grid_point_triplets_py;
+  PyArrayObject* triplet_weights_py;
+  PyArrayObject* epsilons_py;
+  PyArrayObject* temperatures_py;
+  double unit_conversion_factor, cutoff_frequency;
+
+  if (!PyArg_ParseTuple(args, "OOOOOOOOdd",
+			&shift_py,
+			&fc3_normal_squared_py,
+			&frequency_points_py,
+			&grid_point_triplets_py,
+			&triplet_weights_py,
+			&frequencies_py,
+			&temperatures_py,
+			&epsilons_py,
+			&unit_conversion_factor,
+			&cutoff_frequency)) {
+    return NULL;
+  }
+
+  Darray* fc3_normal_squared = convert_to_darray(fc3_normal_squared_py);
+  double* shift = (double*)shift_py->data;
+  const double* frequency_points = (double*)frequency_points_py->data;
+  const int num_fpoints = (int)frequency_points_py->dimensions[0];
+  const double* frequencies = (double*)frequencies_py->data;
+  const int* grid_point_triplets = (int*)grid_point_triplets_py->data;
+  const int* triplet_weights = (int*)triplet_weights_py->data;
+  const double* temperatures = (double*)temperatures_py->data;
+  const int num_temp = (int)temperatures_py->dimensions[0];
+  const double* epsilons = (double*)epsilons_py->data;
+  const int num_epsilon = (int)epsilons_py->dimensions[0];
+
+  get_frequency_shift(shift,
+		      fc3_normal_squared,
+		      frequency_points,
+		      num_fpoints,
+		      frequencies,
+		      grid_point_triplets,
+		      triplet_weights,
+		      epsilons,
+		      num_epsilon,
+		      temperatures,
+		      num_temp,
+		      unit_conversion_factor,
+		      cutoff_frequency);
+
+  free(fc3_normal_squared);
+  
+  Py_RETURN_NONE;
+}
+
 static PyObject * py_get_collision_matrix(PyObject *self, PyObject *args)
 {
   PyArrayObject* collision_matrix_py;
@@ -868,14 +1012,16 @@ static PyObject * py_distribute_fc3(PyObject *self, PyObject *args)
 {
   PyArrayObject* force_constants_third_copy;
   PyArrayObject* force_constants_third;
-  int third_atom;
+  int target;
+  int source;
   PyArrayObject* rotation_cart_inv;
   PyArrayObject* atom_mapping_py;
 
-  if (!PyArg_ParseTuple(args, "OOiOO",
+  if (!PyArg_ParseTuple(args, "OOiiOO",
 			&force_constants_third_copy,
 			&force_constants_third,
-			&third_atom,
+			&target,
+			&source,
 			&atom_mapping_py,
 			&rotation_cart_inv)) {
     return NULL;
@@ -889,7 +1035,8 @@ static PyObject * py_distribute_fc3(PyObject *self, PyObject *args)
 
   distribute_fc3(fc3_copy,
 		 fc3,
-		 third_atom,
+		 target,
+		 source,
 		 atom_mapping,
 		 num_atom,
 		 rot_cart_inv);
@@ -897,6 +1044,48 @@ static PyObject * py_distribute_fc3(PyObject *self, PyObject *args)
   Py_RETURN_NONE;
 }
 
+static PyObject * py_distribute_sparse_fc3(PyObject *self, PyObject *args)
+{
+  PyArrayObject* values_py;
+  PyArrayObject* triplets_py;
+  PyArrayObject* force_constants_third;
+  int target;
+  int source;
+  PyArrayObject* rotation_cart_inv;
+  PyArrayObject* atom_mapping_py;
+
+  if (!PyArg_ParseTuple(args, "OOOiiOO",
+			&values_py,
+			&triplets_py,
+			&force_constants_third,
+			&target,
+			&source,
+			&atom_mapping_py,
+			&rotation_cart_inv)) {
+    return NULL;
+  }
+
+  double* values = (double*)values_py->data;
+  const int* triplets = (int*)triplets_py->data;
+  const int num_triplets = (int)triplets_py->dimensions[0];
+  const double* fc3 = (double*)force_constants_third->data;
+  const double* rot_cart_inv = (double*)rotation_cart_inv->data;
+  const int* atom_mapping = (int*)atom_mapping_py->data;
+  const int num_atom = (int)atom_mapping_py->dimensions[0];
+
+  distribute_sparse_fc3(values,
+			triplets,
+			num_triplets,
+			fc3,
+			target,
+			source,
+			atom_mapping,
+			num_atom,
+			rot_cart_inv);
+  
+  Py_RETURN_NONE;
+}
+
 static PyObject * py_set_permutation_symmetry_fc3(PyObject *self, PyObject *args)
 {
   PyArrayObject* fc3_py;
@@ -914,6 +1103,84 @@ static PyObject * py_set_permutation_symmetry_fc3(PyObject *self, PyObject *args
   Py_RETURN_NONE;
 }
 
+static PyObject *
+py_set_permutation_symmetry_compact_fc3(PyObject *self, PyObject *args)
+{
+  PyArrayObject* fc3_py;
+  PyArrayObject* p2s_py;
+  PyArrayObject* s2pp_py;
+  PyArrayObject* trans_py;
+  PyArrayObject* perms_py;
+
+  if (!PyArg_ParseTuple(args, "OOOOO",
+			&fc3_py,
+			&p2s_py,
+			&s2pp_py,
+			&trans_py,
+			&perms_py)) {
+    return NULL;
+  }
+
+  double* fc3 = (double*)fc3_py->data;
+  const int* p2s = (int*)p2s_py->data;
+  const int* s2pp = (int*)s2pp_py->data;
+  const int* trans = (int*)trans_py->data;
+  const int* perms = (int*)perms_py->data;
+  const int num_patom = (int)fc3_py->dimensions[0];
+  const int num_satom = (int)fc3_py->dimensions[1];
+
+  set_permutation_symmetry_compact_fc3(fc3,
+				       p2s,
+				       s2pp,
+				       trans,
+				       perms,
+				       num_patom,
+				       num_satom);
+
+  Py_RETURN_NONE;
+}
+
+static PyObject *
+py_set_permutation_symmetry_sparse_fc3(PyObject *self, PyObject *args)
+{
+  PyArrayObject* values_py;
+  PyArrayObject* triplets_py;
+  PyArrayObject* p2s_py;
+  PyArrayObject* s2pp_py;
+  PyArrayObject* trans_py;
+  PyArrayObject* perms_py;
+
+  if (!PyArg_ParseTuple(args, "OOOOOO",
+			&values_py,
+			&triplets_py,
+			&p2s_py,
+			&s2pp_py,
+			&trans_py,
+			&perms_py)) {
+    return NULL;
+  }
+
+  double* values = (double*)values_py->data;
+  const int* triplets = (int*)triplets_py->data;
+  const int num_triplets = (int)triplets_py->dimensions[0];
+  const int* p2s = (int*)p2s_py->data;
+  const int* s2pp = (int*)s2pp_py->data;
+  const int* trans = (int*)trans_py->data;
+  const int* perms = (int*)perms_py->data;
+  const int num_satom = (int)perms_py->dimensions[1];
+
+  set_permutation_symmetry_sparse_fc3(values,
+				      triplets,
+				      num_triplets,
+				      p2s,
+				      s2pp,
+				      trans,
+				      perms,
+				      num_satom);
+
+  Py_RETURN_NONE;
+}
+
 static PyObject * py_get_neighboring_gird_points(PyObject *self, PyObject *args)
 {
   PyArrayObject* relative_grid_points_py;
@@ -996,9 +1263,11 @@ static PyObject * py_set_integration_weights(PyObject *self, PyObject *args)
   int i, j, k, bi;
   int vertices[24][4];
   double freq_vertices[24][4];
+  double *g;
     
-#pragma omp parallel for private(j, k, bi, vertices, freq_vertices)
+#pragma omp parallel for private(j, k, bi, vertices, freq_vertices, g)
   for (i = 0; i < num_gp; i++) {
+    g = (double*)malloc(sizeof(double) * num_band0);
     for (j = 0; j < 24; j++) {
       kpt_get_neighboring_grid_points(vertices[j],
 				      grid_points[i],
@@ -1014,11 +1283,16 @@ static PyObject * py_set_integration_weights(PyObject *self, PyObject *args)
 	  freq_vertices[j][k] = frequencies[vertices[j][k] * num_band + bi];
 	}
       }
+      thm_get_integration_weight_at_omegas(g,
+					   num_band0,
+					   frequency_points,
+					   freq_vertices,
+					   'I');
       for (j = 0; j < num_band0; j++) {
-	iw[i * num_band0 * num_band + j * num_band + bi] =
-	  thm_get_integration_weight(frequency_points[j], freq_vertices, 'I');
+	iw[i * num_band0 * num_band + j * num_band + bi] = g[j];
       }
     }
+    free(g);
   }
 	    
   Py_RETURN_NONE;
@@ -1065,7 +1339,8 @@ py_set_triplets_integration_weights(PyObject *self, PyObject *args)
   int tp_relative_grid_address[2][24][4][3];
   int vertices[2][24][4];
   int adrs_shift;
-  double f0, f1, f2, g0, g1, g2;
+  double f1, f2;
+  double *g;
   double freq_vertices[3][24][4];
     
   for (i = 0; i < 2; i++) {
@@ -1080,8 +1355,9 @@ py_set_triplets_integration_weights(PyObject *self, PyObject *args)
     }
   }
 
-#pragma omp parallel for private(j, k, b1, b2, vertices, adrs_shift, f0, f1, f2, g0, g1, g2, freq_vertices)
+#pragma omp parallel for private(j, k, b1, b2, vertices, adrs_shift, f1, f2, g, freq_vertices)
   for (i = 0; i < num_triplets; i++) {
+    g = (double*)malloc(sizeof(double) * num_band0 * 3);
     get_triplet_tetrahedra_vertices(vertices,
 				    tp_relative_grid_address,
 				    mesh,
@@ -1099,23 +1375,27 @@ py_set_triplets_integration_weights(PyObject *self, PyObject *args)
 	    freq_vertices[2][j][k] = f1 - f2;
 	  }
 	}
+	for (j = 0; j < 3; j++) {
+	  thm_get_integration_weight_at_omegas(g + j * num_band0,
+					       num_band0,
+					       frequency_points,
+					       freq_vertices[j],
+					       'I');
+	}
 	for (j = 0; j < num_band0; j++) {
-	  f0 = frequency_points[j];
-	  g0 = thm_get_integration_weight(f0, freq_vertices[0], 'I');
-	  g1 = thm_get_integration_weight(f0, freq_vertices[1], 'I');
-	  g2 = thm_get_integration_weight(f0, freq_vertices[2], 'I');
 	  adrs_shift = i * num_band0 * num_band * num_band +
 	    j * num_band * num_band + b1 * num_band + b2;
-	  iw[adrs_shift] = g0;
+	  iw[adrs_shift] = g[j];
 	  adrs_shift += num_triplets * num_band0 * num_band * num_band;
-	  iw[adrs_shift] = g1 - g2;
+	  iw[adrs_shift] = g[num_band0 + j] - g[2 * num_band0 + j];
 	  if (num_iw == 3) {
 	    adrs_shift += num_triplets * num_band0 * num_band * num_band;
-	    iw[adrs_shift] = g0 + g1 + g2;
+	    iw[adrs_shift] = g[j] + g[num_band0 + j] + g[2 * num_band0 + j];
 	  }
 	}
       }	
     }
+    free(g);
   }
 	    
   Py_RETURN_NONE;
@@ -1239,6 +1519,27 @@ static PyObject * py_phonopy_pinv(PyObject *self, PyObject *args)
   return PyInt_FromLong((long) info);
 }
 
+static PyObject * py_read_force_blocks(PyObject *self, PyObject *args)
+{
+  PyArrayObject* forces_py;
+  char* filename;
+
+  if (!PyArg_ParseTuple(args, "Os",
+			&forces_py,
+			&filename)) {
+    return NULL;
+  }
+
+  double *forces = (double*)forces_py->data;
+  const int num_disp = (int)forces_py->dimensions[0];
+  const int num_atom = (int)forces_py->dimensions[1];
+  int num_blocks;
+
+  num_blocks = read_force_blocks(forces, filename, num_atom, num_disp);
+
+  return PyInt_FromLong((long) num_blocks);
+}
+
 #ifdef LIBFLAME
 static PyObject * py_inverse_collision_matrix_libflame(PyObject *self, PyObject *args)
 {
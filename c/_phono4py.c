@@ -441,7 +441,9 @@ static PyObject * py_set_translational_invariance_fc4(PyObject *self,
   PyArrayObject* fc4_py;
   int index;
 
-  if (!PyArg_ParseTuple(args, "Oi",
+  /* Without index, all four indices are treated at once. */
+  index = -1;
+  if (!PyArg_ParseTuple(args, "O|i",
 			&fc4_py,
 			&index)) {
     return NULL;
@@ -450,7 +452,11 @@ static PyObject * py_set_translational_invariance_fc4(PyObject *self,
   double* fc4 = (double*)fc4_py->data;
   const int num_atom = (int)fc4_py->dimensions[0];
 
-  set_translational_invariance_fc4_per_index(fc4, num_atom, index);
+  if (index < 0) {
+    set_translational_invariance_fc4(fc4, num_atom);
+  } else {
+    set_translational_invariance_fc4_per_index(fc4, num_atom, index);
+  }
 
   Py_RETURN_NONE;
 }
@@ -34,41 +34,47 @@
 
 #include <Python.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
 #include <numpy/arrayobject.h>
 #include "dynmat.h"
 #include "derivative_dynmat.h"
+#include "group_velocity.h"
 
 #define KB 8.6173382568083159E-05
 
 /* Build dynamical matrix */
 static PyObject * py_get_dynamical_matrix(PyObject *self, PyObject *args);
 static PyObject * py_get_nac_dynamical_matrix(PyObject *self, PyObject *args);
+static PyObject * py_get_dynmat_table_size(PyObject *self, PyObject *args);
+static PyObject * py_set_dynmat_table(PyObject *self, PyObject *args);
+static PyObject * py_get_dynamical_matrices(PyObject *self, PyObject *args);
 static PyObject * py_get_derivative_dynmat(PyObject *self, PyObject *args);
+static PyObject * py_get_group_velocities(PyObject *self, PyObject *args);
 static PyObject * py_get_thermal_properties(PyObject *self, PyObject *args);
 static PyObject * py_distribute_fc2(PyObject *self, PyObject *args);
 
-static double get_free_energy_omega(const double temperature,
-				    const double omega);
-static double get_entropy_omega(const double temperature,
-				const double omega);
-static double get_heat_capacity_omega(const double temperature,
-				      const double omega);
-/* static double get_energy_omega(double temperature, double omega); */
-static int distribute_fc2(double * fc2,
-			  const double * pos,
-			  const int num_pos,
-			  const int atom_disp,
-			  const int map_atom_disp,
-			  const double * r_cart,
-			  const int * r,
-			  const double * t,
-			  const double symprec);
-static int nint(const double a);
+static void add_thermal_properties_omega(double thermal_props[4],
+					 const double temperature,
+					 const double omega,
+					 const int weight);
+static void distribute_fc2(double * fc2,
+			   const int * atom_list,
+			   const int num_atom_list,
+			   const int * map_atoms,
+			   const int * map_syms,
+			   const double * r_carts,
+			   const int * permutations,
+			   const int num_pos);
 
 static PyMethodDef functions[] = {
   {"dynamical_matrix", py_get_dynamical_matrix, METH_VARARGS, "Dynamical matrix"},
   {"nac_dynamical_matrix", py_get_nac_dynamical_matrix, METH_VARARGS, "NAC dynamical matrix"},
+  {"dynmat_table_size", py_get_dynmat_table_size, METH_VARARGS, "Size of real space table of dynamical matrix"},
+  {"dynmat_table", py_set_dynmat_table, METH_VARARGS, "Real space table of dynamical matrix"},
+  {"dynamical_matrices", py_get_dynamical_matrices, METH_VARARGS, "Dynamical matrices at q-points"},
   {"derivative_dynmat", py_get_derivative_dynmat, METH_VARARGS, "Q derivative of dynamical matrix"},
+  {"group_velocities", py_get_group_velocities, METH_VARARGS, "Group velocities at q-points"},
   {"thermal_properties", py_get_thermal_properties, METH_VARARGS, "Thermal properties"},
   {"distribute_fc2", py_distribute_fc2, METH_VARARGS, "Distribute force constants"},
   {NULL, NULL, 0, NULL}
@@ -202,6 +208,155 @@ static PyObject * py_get_nac_dynamical_matrix(PyObject *self, PyObject *args)
   Py_RETURN_NONE;
 }
 
+static PyObject * py_get_dynmat_table_size(PyObject *self, PyObject *args)
+{
+  PyArrayObject* multiplicity;
+  PyArrayObject* super2prim_map;
+  PyArrayObject* prim2super_map;
+
+  if (!PyArg_ParseTuple(args, "OOO",
+			&multiplicity,
+			&super2prim_map,
+			&prim2super_map))
+    return NULL;
+
+  const int* multi = (int*)multiplicity->data;
+  const int* s2p_map = (int*)super2prim_map->data;
+  const int* p2s_map = (int*)prim2super_map->data;
+  const int num_patom = prim2super_map->dimensions[0];
+  const int num_satom = super2prim_map->dimensions[0];
+
+  return PyInt_FromLong((long) get_dynmat_table_size(num_patom,
+						     num_satom,
+						     multi,
+						     s2p_map,
+						     p2s_map));
+}
+
+static PyObject * py_set_dynmat_table(PyObject *self, PyObject *args)
+{
+  PyArrayObject* table_index;
+  PyArrayObject* table_vectors;
+  PyArrayObject* table_weights;
+  PyArrayObject* table_phase_weights;
+  PyArrayObject* force_constants;
+  PyArrayObject* r_vector;
+  PyArrayObject* multiplicity;
+  PyArrayObject* mass;
+  PyArrayObject* super2prim_map;
+  PyArrayObject* prim2super_map;
+
+  if (!PyArg_ParseTuple(args, "OOOOOOOOOO",
+			&table_index,
+			&table_vectors,
+			&table_weights,
+			&table_phase_weights,
+			&force_constants,
+			&r_vector,
+			&multiplicity,
+			&mass,
+			&super2prim_map,
+			&prim2super_map))
+    return NULL;
+
+  int* index = (int*)table_index->data;
+  double* vectors = (double*)table_vectors->data;
+  double* weights = (double*)table_weights->data;
+  double* phase_weights = (double*)table_phase_weights->data;
+  const double* fc = (double*)force_constants->data;
+  const double* r = (double*)r_vector->data;
+  const double* m = (double*)mass->data;
+  const int* multi = (int*)multiplicity->data;
+  const int* s2p_map = (int*)super2prim_map->data;
+  const int* p2s_map = (int*)prim2super_map->data;
+  const int num_patom = prim2super_map->dimensions[0];
+  const int num_satom = super2prim_map->dimensions[0];
+
+  set_dynmat_table(index,
+		   vectors,
+		   weights,
+		   phase_weights,
+		   num_patom,
+		   num_satom,
+		   fc,
+		   r,
+		   multi,
+		   m,
+		   s2p_map,
+		   p2s_map);
+
+  Py_RETURN_NONE;
+}
+
+static PyObject * py_get_dynamical_matrices(PyObject *self, PyObject *args)
+{
+  PyArrayObject* dynamical_matrices_real;
+  PyArrayObject* dynamical_matrices_imag;
+  PyArrayObject* qpoints;
+  PyArrayObject* table_index;
+  PyArrayObject* table_vectors;
+  PyArrayObject* table_weights;
+  PyArrayObject* table_phase_weights;
+  PyArrayObject* mass;
+  PyObject* q_cart_py;
+  PyObject* nac_factors_py;
+  PyObject* born_py;
+
+  if (!PyArg_ParseTuple(args, "OOOOOOOOOOO",
+			&dynamical_matrices_real,
+			&dynamical_matrices_imag,
+			&qpoints,
+			&table_index,
+			&table_vectors,
+			&table_weights,
+			&table_phase_weights,
+			&mass,
+			&q_cart_py,
+			&nac_factors_py,
+			&born_py))
+    return NULL;
+
+  double* dm_r = (double*)dynamical_matrices_real->data;
+  double* dm_i = (double*)dynamical_matrices_imag->data;
+  const double* q = (double*)qpoints->data;
+  const int* index = (int*)table_index->data;
+  const double* vectors = (double*)table_vectors->data;
+  const double* weights = (double*)table_weights->data;
+  const double* phase_weights = (double*)table_phase_weights->data;
+  const double* m = (double*)mass->data;
+  const int num_qpoints = qpoints->dimensions[0];
+  const int num_patom = mass->dimensions[0];
+  const double* q_cart;
+  const double* nac_factors;
+  const double* born;
+
+  if (q_cart_py == Py_None) {
+    q_cart = NULL;
+    nac_factors = NULL;
+    born = NULL;
+  } else {
+    q_cart = (double*)((PyArrayObject*)q_cart_py)->data;
+    nac_factors = (double*)((PyArrayObject*)nac_factors_py)->data;
+    born = (double*)((PyArrayObject*)born_py)->data;
+  }
+
+  get_dynamical_matrices_at_qpoints(dm_r,
+				    dm_i,
+				    num_qpoints,
+				    num_patom,
+				    q,
+				    index,
+				    vectors,
+				    weights,
+				    phase_weights,
+				    m,
+				    q_cart,
+				    nac_factors,
+				    born);
+
+  Py_RETURN_NONE;
+}
+
 static PyObject * py_get_derivative_dynmat(PyObject *self, PyObject *args)
 {
   PyArrayObject* derivative_dynmat_real;
@@ -288,201 +443,283 @@ static PyObject * py_get_derivative_dynmat(PyObject *self, PyObject *args)
   Py_RETURN_NONE;
 }
 
+static PyObject * py_get_group_velocities(PyObject *self, PyObject *args)
+{
+  PyArrayObject* group_velocities;
+  PyArrayObject* frequencies;
+  PyArrayObject* eigenvectors;
+  PyArrayObject* qpoints;
+  PyArrayObject* force_constants;
+  PyArrayObject* r_vector;
+  PyArrayObject* lattice;
+  PyArrayObject* multiplicity;
+  PyArrayObject* mass;
+  PyArrayObject* super2prim_map;
+  PyArrayObject* prim2super_map;
+  PyArrayObject* born;
+  PyArrayObject* dielectric;
+  PyArrayObject* q_direction;
+  PyArrayObject* perturbation;
+  double nac_factor, frequency_factor, cutoff_frequency;
+  double degeneracy_tolerance;
+
+  if (!PyArg_ParseTuple(args, "OOOOOOOOOOOdOOOOddd",
+			&group_velocities,
+			&frequencies,
+			&eigenvectors,
+			&qpoints,
+			&force_constants,
+			&lattice, /* column vectors */
+			&r_vector,
+			&multiplicity,
+			&mass,
+			&super2prim_map,
+			&prim2super_map,
+			&nac_factor,
+			&born,
+			&dielectric,
+			&q_direction,
+			&perturbation,
+			&frequency_factor,
+			&cutoff_frequency,
+			&degeneracy_tolerance)) {
+    return NULL;
+  }
+
+  double* gv = (double*)group_velocities->data;
+  const double* freqs = (double*)frequencies->data;
+  const double* eigvecs = (double*)eigenvectors->data;
+  const double* q = (double*)qpoints->data;
+  const double* fc = (double*)force_constants->data;
+  const double* lat = (double*)lattice->data;
+  const double* r = (double*)r_vector->data;
+  const double* m = (double*)mass->data;
+  const double* pert = (double*)perturbation->data;
+  const int* multi = (int*)multiplicity->data;
+  const int* s2p_map = (int*)super2prim_map->data;
+  const int* p2s_map = (int*)prim2super_map->data;
+  const int num_qpoints = qpoints->dimensions[0];
+  const int num_patom = prim2super_map->dimensions[0];
+  const int num_satom = super2prim_map->dimensions[0];
+  double *z;
+  double *epsilon;
+  double *q_dir;
+  if ((PyObject*)born == Py_None) {
+    z = NULL;
+  } else {
+    z = (double*)born->data;
+  }
+  if ((PyObject*)dielectric == Py_None) {
+    epsilon = NULL;
+  } else {
+    epsilon = (double*)dielectric->data;
+  }
+  if ((PyObject*)q_direction == Py_None) {
+    q_dir = NULL;
+  } else {
+    q_dir = (double*)q_direction->data;
+  }
+
+  get_group_velocities(gv,
+		       freqs,
+		       eigvecs,
+		       q,
+		       num_qpoints,
+		       num_patom,
+		       num_satom,
+		       fc,
+		       lat,
+		       r,
+		       multi,
+		       m,
+		       s2p_map,
+		       p2s_map,
+		       nac_factor,
+		       z,
+		       epsilon,
+		       q_dir,
+		       pert,
+		       frequency_factor,
+		       cutoff_frequency,
+		       degeneracy_tolerance);
+
+  Py_RETURN_NONE;
+}
+
 /* Thermal properties */
 static PyObject * py_get_thermal_properties(PyObject *self, PyObject *args)
 {
-  double temperature;
+  PyArrayObject* thermal_props_py;
+  PyArrayObject* temperatures_py;
   PyArrayObject* frequencies;
   PyArrayObject* weights;
 
-  if (!PyArg_ParseTuple(args, "dOO",
-			&temperature,
+  if (!PyArg_ParseTuple(args, "OOOO",
+			&thermal_props_py,
+			&temperatures_py,
 			&frequencies,
 			&weights)) {
     return NULL;
   }
 
+  double* thermal_props = (double*)thermal_props_py->data;
+  const double* temperatures = (double*)temperatures_py->data;
+  const int num_temp = temperatures_py->dimensions[0];
   const double* freqs = (double*)frequencies->data;
   const int* w = (int*)weights->data;
   const int num_qpoints = frequencies->dimensions[0];
   const int num_bands = frequencies->dimensions[1];
 
-  int i, j;
+  int i, j, k;
   long sum_weights = 0;
-  double free_energy = 0;
-  double entropy = 0;
-  double heat_capacity = 0;
-  double omega = 0;
-
-  for (i = 0; i < num_qpoints; i++){
-    sum_weights += w[i];
-    for (j = 0; j < num_bands; j++){
-      omega = freqs[i * num_bands + j];
-      if (omega > 0.0) {
-	free_energy += get_free_energy_omega(temperature, omega) * w[i];
-	entropy += get_entropy_omega(temperature, omega) * w[i];
-	heat_capacity += get_heat_capacity_omega(temperature, omega)* w[i];
-      }
-    }
+  double *tp;
+
+  for (i = 0; i < num_temp * 4; i++) {
+    thermal_props[i] = 0;
   }
 
-  return PyTuple_Pack(3,
-		      PyFloat_FromDouble(free_energy / sum_weights), 
-		      PyFloat_FromDouble(entropy / sum_weights),
-		      PyFloat_FromDouble(heat_capacity / sum_weights));
-}
+#pragma omp parallel private(j, k, tp)
+  {
+    tp = (double*)malloc(sizeof(double) * num_temp * 4);
+    for (j = 0; j < num_temp * 4; j++) {
+      tp[j] = 0;
+    }
 
-static double get_free_energy_omega(const double temperature,
-				    const double omega)
-{
-  /* temperature is defined by T (K) */
-  /* omega must be normalized to eV. */
-  return KB * temperature * log(1 - exp(- omega / (KB * temperature)));
-}
+#pragma omp for reduction(+:sum_weights)
+    for (i = 0; i < num_qpoints; i++) {
+      sum_weights += w[i];
+      for (j = 0; j < num_bands; j++) {
+	if (freqs[i * num_bands + j] > 0.0) {
+	  for (k = 0; k < num_temp; k++) {
+	    if (temperatures[k] > 0) {
+	      add_thermal_properties_omega(tp + k * 4,
+					   temperatures[k],
+					   freqs[i * num_bands + j],
+					   w[i]);
+	    }
+	  }
+	}
+      }
+    }
 
-static double get_entropy_omega(const double temperature,
-				const double omega)
-{
-  /* temperature is defined by T (K) */
-  /* omega must be normalized to eV. */
-  double val;
+#pragma omp critical
+    for (j = 0; j < num_temp * 4; j++) {
+      thermal_props[j] += tp[j];
+    }
+    free(tp);
+  }
+
+  for (i = 0; i < num_temp * 4; i++) {
+    thermal_props[i] /= sum_weights;
+  }
 
-  val = omega / (2 * KB * temperature);
-  return 1 / (2 * temperature) * omega * cosh(val) / sinh(val) - KB * log(2 * sinh(val));
+  Py_RETURN_NONE;
 }
 
-static double get_heat_capacity_omega(const double temperature,
-				      const double omega)
+static void add_thermal_properties_omega(double thermal_props[4],
+					 const double temperature,
+					 const double omega,
+					 const int weight)
 {
   /* temperature is defined by T (K) */
   /* omega must be normalized to eV. */
-  /* If val is close to 1. Then expansion is used. */
-  double val, val1, val2;
-
-  val = omega / (KB * temperature);
-  val1 = exp(val);
-  val2 = (val) / (val1 - 1);
-  return KB * val1 * val2 * val2;
+  /* Free energy, entropy, heat capacity, and energy without zero */
+  /* point energy are written in terms of exp(-x) and occupation */
+  /* number n = 1 / (exp(x) - 1). expm1 keeps precision at high */
+  /* temperature and exp(-x) underflows to zero at low temperature. */
+  double x, exp_x, one_exp_x, n;
+
+  x = omega / (KB * temperature);
+  exp_x = exp(-x);
+  one_exp_x = -expm1(-x);
+  n = exp_x / one_exp_x;
+  thermal_props[0] += KB * temperature * log(one_exp_x) * weight;
+  thermal_props[1] += KB * (x * n - log(one_exp_x)) * weight;
+  thermal_props[2] += KB * x * x * n * (n + 1) * weight;
+  thermal_props[3] += omega * n * weight;
 }
 
-/* static double get_energy_omega(double temperature, double omega){ */
-/*   /\* temperature is defined by T (K) *\/ */
-/*   /\* omega must be normalized to eV. *\/ */
-/*   return omega / (exp(omega / (KB * temperature)) - 1); */
-/* } */
-
-
 static PyObject * py_distribute_fc2(PyObject *self, PyObject *args)
 {
   PyArrayObject* force_constants;
-  PyArrayObject* positions;
-  PyArrayObject* rotation;
-  PyArrayObject* rotation_cart;
-  PyArrayObject* translation;
-  int atom_disp, map_atom_disp;
-  double symprec;
-
-  if (!PyArg_ParseTuple(args, "OOiiOOOd",
+  PyArrayObject* atom_list_py;
+  PyArrayObject* map_atoms_py;
+  PyArrayObject* map_syms_py;
+  PyArrayObject* rotations_cart;
+  PyArrayObject* permutations_py;
+
+  if (!PyArg_ParseTuple(args, "OOOOOO",
 			&force_constants,
-			&positions,
-			&atom_disp,
-			&map_atom_disp,
-			&rotation_cart,
-			&rotation,
-			&translation,
-			&symprec)) {
+			&atom_list_py,
+			&map_atoms_py,
+			&map_syms_py,
+			&rotations_cart,
+			&permutations_py)) {
     return NULL;
   }
 
-  const int* r = (int*)rotation->data;
-  const double* r_cart = (double*)rotation_cart->data;
   double* fc2 = (double*)force_constants->data;
-  const double* t = (double*)translation->data;
-  const double* pos = (double*)positions->data;
-  const int num_pos = positions->dimensions[0];
+  const int* atom_list = (int*)atom_list_py->data;
+  const int num_atom_list = (int)atom_list_py->dimensions[0];
+  const int* map_atoms = (int*)map_atoms_py->data;
+  const int* map_syms = (int*)map_syms_py->data;
+  const double* r_carts = (double*)rotations_cart->data;
+  const int* permutations = (int*)permutations_py->data;
+  const int num_pos = (int)permutations_py->dimensions[1];
 
   distribute_fc2(fc2,
-		 pos,
-		 num_pos,
-		 atom_disp,
-		 map_atom_disp,
-		 r_cart,
-		 r,
-		 t,
-		 symprec);
+		 atom_list,
+		 num_atom_list,
+		 map_atoms,
+		 map_syms,
+		 r_carts,
+		 permutations,
+		 num_pos);
 
   Py_RETURN_NONE;
 }
 
-static int distribute_fc2(double * fc2,
-			  const double * pos,
-			  const int num_pos,
-			  const int atom_disp,
-			  const int map_atom_disp,
-			  const double * r_cart,
-			  const int * r,
-			  const double * t,
-			  const double symprec)
+/* fc2[atom_list[i], j] = R^T fc2[map_atoms[i], perm[j]] R */
+/* where R is r_carts[map_syms[i]] and perm is */
+/* permutations[map_syms[i]]. All atoms of atom_list are distributed */
+/* at once since their sources are not in atom_list. */
+static void distribute_fc2(double * fc2,
+			   const int * atom_list,
+			   const int num_atom_list,
+			   const int * map_atoms,
+			   const int * map_syms,
+			   const double * r_carts,
+			   const int * permutations,
+			   const int num_pos)
 {
-  int i, j, k, l, m, address_new, address;
-  int is_found, rot_atom;
-  double rot_pos[3], diff[3];
-
-#pragma omp parallel for private(j, k, l, m, rot_pos, diff, is_found, rot_atom, address_new, address)
-  for (i = 0; i < num_pos; i++) {
-    for (j = 0; j < 3; j++) {
-      rot_pos[j] = t[j];
-      for (k = 0; k < 3; k++) {
-	rot_pos[j] += r[j * 3 + k] * pos[i * 3 + k];
-      }
-    }
+  int i, j, k, l, ij;
+  double tmp[9];
+  const double *r, *fc2_src;
+  double *fc2_dst;
+
+#pragma omp parallel for private(i, j, k, l, tmp, r, fc2_src, fc2_dst)
+  for (ij = 0; ij < num_atom_list * num_pos; ij++) {
+    i = ij / num_pos;
+    j = ij % num_pos;
+    r = r_carts + map_syms[i] * 9;
+    fc2_src = fc2 + (map_atoms[i] * num_pos +
+		     permutations[map_syms[i] * num_pos + j]) * 9;
+    fc2_dst = fc2 + (atom_list[i] * num_pos + j) * 9;
 
-    for (j = 0; j < num_pos; j++) {
-      is_found = 1;
-      for (k = 0; k < 3; k++) {
-	diff[k] = pos[j * 3 + k] - rot_pos[k];
-	diff[k] -= nint(diff[k]);
-	if (fabs(diff[k]) > symprec) {
-	  is_found = 0;
-	  break;
-	}
-      }
-      if (is_found) {
-	rot_atom = j;
-	break;
+    /* R^-1 P R */
+    for (k = 0; k < 3; k++) {
+      for (l = 0; l < 3; l++) {
+	tmp[k * 3 + l] = (fc2_src[k * 3] * r[l] +
+			  fc2_src[k * 3 + 1] * r[3 + l] +
+			  fc2_src[k * 3 + 2] * r[6 + l]);
       }
     }
-
-    if (! is_found) {
-      printf("Encounter some problem in distribute_fc2.\n");
-      goto end;
-    }
-
-    /* R^-1 P R */
-    address = map_atom_disp * num_pos * 9 + rot_atom * 9;
-    address_new = atom_disp * num_pos * 9 + i * 9;
-    for (j = 0; j < 3; j++) {
-      for (k = 0; k < 3; k++) {
-	for (l = 0; l < 3; l++) {
-	  for (m = 0; m < 3; m++) {
-	    fc2[address_new + j * 3 + k] +=
-	      r_cart[l * 3 + j] * r_cart[m * 3 + k] *
-	      fc2[address + l * 3 + m];
-	  }
-	}
+    for (k = 0; k < 3; k++) {
+      for (l = 0; l < 3; l++) {
+	fc2_dst[k * 3 + l] += (r[k] * tmp[l] +
+			       r[3 + k] * tmp[3 + l] +
+			       r[6 + k] * tmp[6 + l]);
       }
     }
-  end:
-    ;
   }
-
-  return is_found;
-}
-
-static int nint(const double a)
-{
-  if (a < 0.0)
-    return (int) (a - 0.5);
-  else
-    return (int) (a + 0.5);
 }
@@ -14,18 +14,22 @@ static PyObject * get_spacegroup(PyObject *self, PyObject *args);
 static PyObject * get_pointgroup(PyObject *self, PyObject *args);
 static PyObject * refine_cell(PyObject *self, PyObject *args);
 static PyObject * get_symmetry(PyObject *self, PyObject *args);
+static PyObject * get_supercell_symmetry(PyObject *self, PyObject *args);
+static PyObject * get_atom_permutations(PyObject *self, PyObject *args);
 static PyObject *
 get_symmetry_with_collinear_spin(PyObject *self, PyObject *args);
 static PyObject * find_primitive(PyObject *self, PyObject *args);
 static PyObject * get_grid_point_from_address(PyObject *self, PyObject *args);
 static PyObject * get_ir_reciprocal_mesh(PyObject *self, PyObject *args);
 static PyObject * get_stabilized_reciprocal_mesh(PyObject *self, PyObject *args);
+static PyObject * get_ir_grid_points(PyObject *self, PyObject *args);
 static PyObject * get_grid_points_by_rotations(PyObject *self, PyObject *args);
 static PyObject * get_BZ_grid_points_by_rotations(PyObject *self, PyObject *args);
 static PyObject * relocate_BZ_grid_address(PyObject *self, PyObject *args);
 static PyObject *
 get_triplets_reciprocal_mesh_at_q(PyObject *self, PyObject *args);
 static PyObject * get_BZ_triplets_at_q(PyObject *self, PyObject *args);
+static PyObject * get_BZ_triplets_at_qs(PyObject *self, PyObject *args);
 static PyObject * get_neighboring_grid_points(PyObject *self, PyObject *args);
 static PyObject *
 get_tetrahedra_relative_grid_address(PyObject *self, PyObject *args);
@@ -43,6 +47,10 @@ static PyMethodDef functions[] = {
    "International symbol of pointgroup"},
   {"refine_cell", refine_cell, METH_VARARGS, "Refine cell"},
   {"symmetry", get_symmetry, METH_VARARGS, "Symmetry operations"},
+  {"supercell_symmetry", get_supercell_symmetry, METH_VARARGS,
+   "Symmetry operations of supercell from those of smaller cell"},
+  {"atom_permutations", get_atom_permutations, METH_VARARGS,
+   "Atoms sent by symmetry operations"},
   {"symmetry_with_collinear_spin", get_symmetry_with_collinear_spin,
    METH_VARARGS, "Symmetry operations with collinear spin magnetic moments"},
   {"primitive", find_primitive, METH_VARARGS,
@@ -53,6 +61,8 @@ static PyMethodDef functions[] = {
    "Reciprocal mesh points with map"},
   {"stabilized_reciprocal_mesh", get_stabilized_reciprocal_mesh, METH_VARARGS,
    "Reciprocal mesh points with map"},
+  {"ir_grid_points", get_ir_grid_points, METH_VARARGS,
+   "Irreducible grid points and weights with optional map"},
   {"grid_points_by_rotations", get_grid_points_by_rotations, METH_VARARGS,
    "Rotated grid points are returned"},
   {"BZ_grid_points_by_rotations", get_BZ_grid_points_by_rotations, METH_VARARGS,
@@ -63,6 +73,8 @@ static PyMethodDef functions[] = {
    METH_VARARGS, "Triplets on reciprocal mesh points at a specific q-point"},
   {"BZ_triplets_at_q", get_BZ_triplets_at_q,
    METH_VARARGS, "Triplets in reciprocal primitive lattice are transformed to those in BZ."},
+  {"BZ_triplets_at_qs", get_BZ_triplets_at_qs,
+   METH_VARARGS, "Triplets in BZ at many grid points stored one after another"},
   {"neighboring_grid_points", get_neighboring_grid_points,
    METH_VARARGS, "Neighboring grid points by relative grid addresses"},
   {"tetrahedra_relative_grid_address", get_tetrahedra_relative_grid_address,
@@ -412,6 +424,81 @@ static PyObject * get_symmetry(PyObject *self, PyObject *args)
   return PyLong_FromLong((long) num_sym);
 }
 
+static PyObject * get_supercell_symmetry(PyObject *self, PyObject *args)
+{
+  PyArrayObject* rotation;
+  PyArrayObject* translation;
+  PyArrayObject* rotations_cell;
+  PyArrayObject* translations_cell;
+  PyArrayObject* supercell_matrix_py;
+  if (!PyArg_ParseTuple(args, "OOOOO",
+			&rotation,
+			&translation,
+			&rotations_cell,
+			&translations_cell,
+			&supercell_matrix_py)) {
+    return NULL;
+  }
+
+  int (*rot)[3][3] = (int(*)[3][3])rotation->data;
+  double (*trans)[3] = (double(*)[3])translation->data;
+  const int num_sym_from_array_size = rotation->dimensions[0];
+  SPGCONST int (*rot_cell)[3][3] = (int(*)[3][3])rotations_cell->data;
+  SPGCONST double (*trans_cell)[3] = (double(*)[3])translations_cell->data;
+  const int num_sym_cell = rotations_cell->dimensions[0];
+  SPGCONST int (*smat)[3] = (int(*)[3])supercell_matrix_py->data;
+
+  const int num_sym = spg_get_supercell_symmetry(rot,
+						 trans,
+						 num_sym_from_array_size,
+						 rot_cell,
+						 trans_cell,
+						 num_sym_cell,
+						 smat);
+  return PyLong_FromLong((long) num_sym);
+}
+
+static PyObject * get_atom_permutations(PyObject *self, PyObject *args)
+{
+  double symprec;
+  PyArrayObject* permutations;
+  PyArrayObject* rotation;
+  PyArrayObject* translation;
+  PyArrayObject* lattice;
+  PyArrayObject* position;
+  PyArrayObject* atom_type;
+  if (!PyArg_ParseTuple(args, "OOOOOOd",
+			&permutations,
+			&rotation,
+			&translation,
+			&lattice,
+			&position,
+			&atom_type,
+			&symprec)) {
+    return NULL;
+  }
+
+  int *perms = (int*)permutations->data;
+  SPGCONST int (*rot)[3][3] = (int(*)[3][3])rotation->data;
+  SPGCONST double (*trans)[3] = (double(*)[3])translation->data;
+  const int num_sym = rotation->dimensions[0];
+  SPGCONST double (*lat)[3] = (double(*)[3])lattice->data;
+  SPGCONST double (*pos)[3] = (double(*)[3])position->data;
+  const int* types = (int*)atom_type->data;
+  const int num_atom = position->dimensions[0];
+
+  const int is_found = spg_get_atom_permutations(perms,
+						 rot,
+						 trans,
+						 num_sym,
+						 lat,
+						 pos,
+						 types,
+						 num_atom,
+						 symprec);
+  return PyBool_FromLong((long) is_found);
+}
+
 static PyObject * get_symmetry_with_collinear_spin(PyObject *self,
 						   PyObject *args)
 {
@@ -567,6 +654,59 @@ static PyObject * get_stabilized_reciprocal_mesh(PyObject *self, PyObject *args)
   return PyLong_FromLong((long) num_ir);
 }
 
+static PyObject * get_ir_grid_points(PyObject *self, PyObject *args)
+{
+  PyArrayObject* ir_grid_points_py;
+  PyArrayObject* ir_weights_py;
+  PyArrayObject* map_py;
+  PyArrayObject* mesh;
+  PyArrayObject* is_shift;
+  int is_time_reversal;
+  PyArrayObject* rotations;
+  PyArrayObject* qpoints;
+  if (!PyArg_ParseTuple(args, "OOOOOiOO",
+			&ir_grid_points_py,
+			&ir_weights_py,
+			&map_py,
+			&mesh,
+			&is_shift,
+			&is_time_reversal,
+			&rotations,
+			&qpoints)) {
+    return NULL;
+  }
+
+  int *ir_grid_points = (int*)ir_grid_points_py->data;
+  int *ir_weights = (int*)ir_weights_py->data;
+  const int max_num_ir = ir_grid_points_py->dimensions[0];
+  int *map_int;
+  if ((PyObject*)map_py == Py_None) {
+    map_int = NULL;
+  } else {
+    map_int = (int*)map_py->data;
+  }
+  const int* mesh_int = (int*)mesh->data;
+  const int* is_shift_int = (int*)is_shift->data;
+  SPGCONST int (*rot)[3][3] = (int(*)[3][3])rotations->data;
+  const int num_rot = rotations->dimensions[0];
+  SPGCONST double (*q)[3] = (double(*)[3])qpoints->data;
+  const int num_q = qpoints->dimensions[0];
+
+  const int num_ir = spg_get_ir_grid_points(ir_grid_points,
+					    ir_weights,
+					    map_int,
+					    max_num_ir,
+					    mesh_int,
+					    is_shift_int,
+					    is_time_reversal,
+					    num_rot,
+					    rot,
+					    num_q,
+					    q);
+
+  return PyLong_FromLong((long) num_ir);
+}
+
 static PyObject * get_grid_points_by_rotations(PyObject *self, PyObject *args)
 {
   PyArrayObject* rot_grid_points_py;
@@ -606,13 +746,15 @@ static PyObject * get_BZ_grid_points_by_rotations(PyObject *self, PyObject *args
   PyArrayObject* rot_reciprocal_py;
   PyArrayObject* mesh_py;
   PyArrayObject* is_shift_py;
+  PyArrayObject* bz_grid_address_py;
   PyArrayObject* bz_map_py;
-  if (!PyArg_ParseTuple(args, "OOOOOO",
+  if (!PyArg_ParseTuple(args, "OOOOOOO",
 			&rot_grid_points_py,
 			&address_orig_py,
 			&rot_reciprocal_py,
 			&mesh_py,
 			&is_shift_py,
+			&bz_grid_address_py,
 			&bz_map_py)) {
     return NULL;
   }
@@ -623,6 +765,7 @@ static PyObject * get_BZ_grid_points_by_rotations(PyObject *self, PyObject *args
   const int num_rot = rot_reciprocal_py->dimensions[0];
   const int* mesh = (int*)mesh_py->data;
   const int* is_shift = (int*)is_shift_py->data;
+  SPGCONST int (*bz_grid_address)[3] = (int(*)[3])bz_grid_address_py->data;
   const int* bz_map = (int*)bz_map_py->data;
 
   spg_get_BZ_grid_points_by_rotations(rot_grid_points,
@@ -631,6 +774,7 @@ static PyObject * get_BZ_grid_points_by_rotations(PyObject *self, PyObject *args
 				      rot_reciprocal,
 				      mesh,
 				      is_shift,
+				      bz_grid_address,
 				      bz_map);
   Py_RETURN_NONE;
 }
@@ -750,6 +894,77 @@ static PyObject * get_BZ_triplets_at_q(PyObject *self, PyObject *args)
   return PyLong_FromLong((long) num_ir);
 }
 
+static PyObject * get_BZ_triplets_at_qs(PyObject *self, PyObject *args)
+{
+  PyArrayObject* triplets_py;
+  PyArrayObject* weights_py;
+  PyArrayObject* triplets_offsets_py;
+  PyArrayObject* map_triplets_py;
+  PyArrayObject* map_q_py;
+  PyArrayObject* grid_points_py;
+  PyArrayObject* bz_grid_address_py;
+  PyArrayObject* bz_map_py;
+  PyArrayObject* mesh_py;
+  int is_time_reversal;
+  PyArrayObject* rotations_py;
+  if (!PyArg_ParseTuple(args, "OOOOOOOOOiO",
+			&triplets_py,
+			&weights_py,
+			&triplets_offsets_py,
+			&map_triplets_py,
+			&map_q_py,
+			&grid_points_py,
+			&bz_grid_address_py,
+			&bz_map_py,
+			&mesh_py,
+			&is_time_reversal,
+			&rotations_py)) {
+    return NULL;
+  }
+
+  int (*triplets)[3] = (int(*)[3])triplets_py->data;
+  int *weights = (int*)weights_py->data;
+  const int max_num_triplets = (int)triplets_py->dimensions[0];
+  int *triplets_offsets = (int*)triplets_offsets_py->data;
+  int *map_triplets;
+  int *map_q;
+  if ((PyObject*)map_triplets_py == Py_None) {
+    map_triplets = NULL;
+  } else {
+    map_triplets = (int*)map_triplets_py->data;
+  }
+  if ((PyObject*)map_q_py == Py_None) {
+    map_q = NULL;
+  } else {
+    map_q = (int*)map_q_py->data;
+  }
+  const int *grid_points = (int*)grid_points_py->data;
+  const int num_grid_points = (int)grid_points_py->dimensions[0];
+  SPGCONST int (*bz_grid_address)[3] = (int(*)[3])bz_grid_address_py->data;
+  const int *bz_map = (int*)bz_map_py->data;
+  const int *mesh = (int*)mesh_py->data;
+  SPGCONST int (*rot)[3][3] = (int(*)[3][3])rotations_py->data;
+  const int num_rot = (int)rotations_py->dimensions[0];
+  int num_triplets;
+
+  num_triplets = spg_get_BZ_triplets_at_qs(triplets,
+					   weights,
+					   triplets_offsets,
+					   map_triplets,
+					   map_q,
+					   max_num_triplets,
+					   grid_points,
+					   num_grid_points,
+					   bz_grid_address,
+					   bz_map,
+					   mesh,
+					   is_time_reversal,
+					   num_rot,
+					   rot);
+
+  return PyLong_FromLong((long) num_triplets);
+}
+
 static PyObject *get_neighboring_grid_points(PyObject *self, PyObject *args)
 {
   PyArrayObject* relative_grid_points_py;
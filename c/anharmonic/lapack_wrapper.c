@@ -1,5 +1,6 @@
 #include "lapack_wrapper.h"
 #include <lapacke.h>
+#include <stdlib.h>
 
 #define min(a,b) ((a)>(b)?(b):(a))
 
@@ -14,50 +15,59 @@ int phonopy_zheev(double *w,
   return (int)info;
 }
 
+/* Thin SVD, A = U S VT with U [m, min(m, n)] and VT [min(m, n), n], */
+/* since the other singular vectors do not contribute to A^+. */
 int phonopy_pinv(double *data_out,
 		 const double *data_in,
 		 const int m,
 		 const int n,
 		 const double cutoff)
 {
-  int i, j, k;
+  int i, j, k, num_s;
   lapack_int info;
   double *s, *a, *u, *vt, *superb;
 
+  num_s = min(m, n);
   a = (double*)malloc(sizeof(double) * m * n);
-  s = (double*)malloc(sizeof(double) * min(m,n));
-  u = (double*)malloc(sizeof(double) * m * m);
-  vt = (double*)malloc(sizeof(double) * n * n);
-  superb = (double*)malloc(sizeof(double) * (min(m,n) - 1));
+  s = (double*)malloc(sizeof(double) * num_s);
+  u = (double*)malloc(sizeof(double) * m * num_s);
+  vt = (double*)malloc(sizeof(double) * num_s * n);
+  superb = (double*)malloc(sizeof(double) * num_s);
 
   for (i = 0; i < m * n; i++) {
     a[i] = data_in[i];
   }
   
   info = LAPACKE_dgesvd(LAPACK_ROW_MAJOR,
-			'A',
-			'A',
+			'S',
+			'S',
 			(lapack_int)m,
 			(lapack_int)n,
 			a,
 			(lapack_int)n,
 			s,
 			u,
-			(lapack_int)m,
+			(lapack_int)num_s,
 			vt,
 			(lapack_int)n,
 			superb);
 
-  for (i = 0; i < n * m; i++) {
-    data_out[i] = 0;
+  /* VT <- S^-1 VT, where singular values below cutoff are dropped */
+  for (k = 0; k < num_s; k++) {
+    for (j = 0; j < n; j++) {
+      if (s[k] > cutoff) {
+	vt[k * n + j] /= s[k];
+      } else {
+	vt[k * n + j] = 0;
+      }
+    }
   }
 
-  for (i = 0; i < m; i++) {
-    for (j = 0; j < n; j++) {
-      for (k = 0; k < min(m,n); k++) {
-	if (s[k] > cutoff) {
-	  data_out[j * m + i] += u[i * m + k] / s[k] * vt[k * n + j];
-	}
+  for (j = 0; j < n; j++) {
+    for (i = 0; i < m; i++) {
+      data_out[j * m + i] = 0;
+      for (k = 0; k < num_s; k++) {
+	data_out[j * m + i] += vt[k * n + j] * u[i * num_s + k];
       }
     }
   }
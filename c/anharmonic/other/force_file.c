@@ -0,0 +1,164 @@
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "other_h/force_file.h"
+
+#define MAX_LINE_LENGTH 256
+
+static long get_next_line(const char *data, const long size, const long pos);
+static int is_force_line(const char *data, const long size, const long pos);
+static int parse_force_line(double force[3],
+			    const char *data,
+			    const long size,
+			    const long pos);
+
+/* Sets of forces in FORCES_FC3 or FORCES_FC2 are read into */
+/* forces[num_disp, num_atom, 3]. As parse_force_lines in file_IO.py, */
+/* blank lines and lines starting with '#' are skipped and every */
+/* num_atom lines of the others make one set. The file is memory */
+/* mapped and its lines are scanned once to find where the sets start. */
+/* Then the sets are parsed in parallel. */
+/* Returns the number of complete sets read, or -1 when num_atom is */
+/* not positive, the file can not be read, or a line can not be parsed */
+/* or is longer than MAX_LINE_LENGTH. */
+int read_force_blocks(double *forces,
+		      const char *filename,
+		      const int num_atom,
+		      const int num_disp)
+{
+  int i, j, num_lines, num_blocks, is_error;
+  long pos, size, *block_pos;
+  int fd;
+  struct stat st;
+  char *data;
+
+  if (num_atom < 1) {
+    return -1;
+  }
+
+  fd = open(filename, O_RDONLY);
+  if (fd < 0) {
+    return -1;
+  }
+  if (fstat(fd, &st) < 0) {
+    close(fd);
+    return -1;
+  }
+  size = (long)st.st_size;
+  if (size == 0) {
+    close(fd);
+    return 0;
+  }
+  data = (char*)mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    return -1;
+  }
+
+  block_pos = (long*)malloc(sizeof(long) * num_disp);
+  num_lines = 0;
+  num_blocks = 0;
+  for (pos = 0; pos < size; pos = get_next_line(data, size, pos)) {
+    if (is_force_line(data, size, pos)) {
+      if (num_lines % num_atom == 0) {
+	if (num_blocks == num_disp) {
+	  break;
+	}
+	block_pos[num_blocks] = pos;
+	num_blocks++;
+      }
+      num_lines++;
+    }
+  }
+  if (num_lines < num_blocks * num_atom) {
+    num_blocks--;
+  }
+
+  is_error = 0;
+#pragma omp parallel for private(j, pos)
+  for (i = 0; i < num_blocks; i++) {
+    pos = block_pos[i];
+    for (j = 0; j < num_atom; j++) {
+      while (! is_force_line(data, size, pos)) {
+	pos = get_next_line(data, size, pos);
+      }
+      if (! parse_force_line(forces + ((long)i * num_atom + j) * 3,
+			     data, size, pos)) {
+	is_error = 1;
+      }
+      pos = get_next_line(data, size, pos);
+    }
+  }
+
+  free(block_pos);
+  munmap(data, size);
+
+  if (is_error) {
+    return -1;
+  }
+  return num_blocks;
+}
+
+static long get_next_line(const char *data, const long size, const long pos)
+{
+  const char *p;
+
+  p = (const char*)memchr(data + pos, '\n', size - pos);
+  if (p == NULL) {
+    return size;
+  }
+  return p - data + 1;
+}
+
+static int is_force_line(const char *data, const long size, const long pos)
+{
+  long i;
+
+  for (i = pos; i < size; i++) {
+    switch (data[i]) {
+    case ' ':
+    case '\t':
+    case '\r':
+      continue;
+    case '\n':
+    case '#':
+      return 0;
+    default:
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/* The line is copied to a terminated buffer for strtod since the */
+/* mapped file is not terminated. A line that does not fit in the */
+/* buffer is an error rather than being cut. */
+static int parse_force_line(double force[3],
+			    const char *data,
+			    const long size,
+			    const long pos)
+{
+  int i;
+  long length;
+  char line[MAX_LINE_LENGTH], *p, *end;
+
+  length = get_next_line(data, size, pos) - pos;
+  if (length > MAX_LINE_LENGTH - 1) {
+    return 0;
+  }
+  memcpy(line, data + pos, length);
+  line[length] = '\0';
+
+  p = line;
+  for (i = 0; i < 3; i++) {
+    force[i] = strtod(p, &end);
+    if (end == p) {
+      return 0;
+    }
+    p = end;
+  }
+  return 1;
+}
@@ -287,6 +287,37 @@ double bose_einstein(const double x, const double t)
   return 1.0 / (exp(THZTOEVPARKB * x / t) - 1);
 }
 
+/* occupations[i, j, k] is the occupation of band j at grid_points[i] */
+/* at temperatures[k]. It is zero for t <= 0 or frequency <= 0. */
+/* Computing the table once avoids exp calls per band of the other */
+/* phonon in the sums over temperatures. */
+void get_bose_einstein_table(double *occupations,
+			     const double *frequencies,
+			     const int *grid_points,
+			     const int num_grid_points,
+			     const int num_band,
+			     const double *temperatures,
+			     const int num_temp)
+{
+  int i, j, k;
+  double f, *occ;
+
+#pragma omp parallel for private(j, k, f, occ)
+  for (i = 0; i < num_grid_points; i++) {
+    for (j = 0; j < num_band; j++) {
+      f = frequencies[grid_points[i] * num_band + j];
+      occ = occupations + (i * num_band + j) * num_temp;
+      for (k = 0; k < num_temp; k++) {
+	if (temperatures[k] > 0 && f > 0) {
+	  occ[k] = bose_einstein(f, temperatures[k]);
+	} else {
+	  occ[k] = 0;
+	}
+      }
+    }
+  }
+}
+
 double gaussian(const double x, const double sigma)
 {
   return INVSQRT2PI / sigma * exp(-x * x / 2 / sigma / sigma);
@@ -1,170 +1,415 @@
 #include "phonon3_h/fc3.h"
 
-static double tensor3_rotation_elem(const double *tensor,
-				    const double *r,
-				    const int pos);
-static void copy_permutation_symmetry_fc3_elem(double *fc3,
-					       const double fc3_elem[27],
-					       const int a,
-					       const int b,
-					       const int c,
-					       const int num_atom);
-static void set_permutation_symmetry_fc3_elem(double *fc3_elem,
-					      const double *fc3,
-					      const int a,
-					      const int b,
-					      const int c,
-					      const int num_atom);
+static void rotate_tensor_index(double *rot_tensor,
+				const double *tensor,
+				const double *r,
+				const int num_outer,
+				const int num_inner);
+static int get_sparse_fc3_index(const int *triplets,
+				const int num_triplets,
+				const int a,
+				const int b,
+				const int c,
+				const int *s2pp,
+				const int *trans,
+				const int *perms,
+				const int num_satom);
+static long get_compact_fc3_adrs(const int a,
+				 const int b,
+				 const int c,
+				 const int *s2pp,
+				 const int *trans,
+				 const int *perms,
+				 const int num_satom);
 
+/* Row 'target' of fc3_copy is made from row 'source' of fc3 by the */
+/* rotation, where atom_mapping maps the atoms of row 'target' to */
+/* those of row 'source'. Full fc3 ([num_atom, num_atom, num_atom]), */
+/* compact fc3 ([num_patom, num_atom, num_atom]) and fc3 of the */
+/* least atoms are all given in this way. */
 void distribute_fc3(double *fc3_copy,
 		    const double *fc3,
-		    const int third_atom,
+		    const int target,
+		    const int source,
 		    const int *atom_mapping,
 		    const int num_atom,
 		    const double *rot_cart)
 {
   int i, j;
 
+#pragma omp parallel for private(j)
   for (i = 0; i < num_atom; i++) {
     for (j = 0; j < num_atom; j++) {
       tensor3_rotation(fc3_copy +
-		       27 * num_atom * num_atom * third_atom +
+		       27 * num_atom * num_atom * target +
 		       27 * num_atom * i +
 		       27 * j,
 		       fc3 +
-		       27 * num_atom * num_atom * atom_mapping[third_atom] +
+		       27 * num_atom * num_atom * source +
 		       27 * num_atom * atom_mapping[i] +
 		       27 * atom_mapping[j],
 		       rot_cart);
     }
   }
-  return 1;
 }
 
+/* Elements of sparse fc3 in row 'target' are made from row 'source' */
+/* of fc3 of the least atoms. triplets[i] = (target, j, k) selects */
+/* the elements computed. See distribute_fc3. */
+void distribute_sparse_fc3(double *values,
+			   const int *triplets,
+			   const int num_triplets,
+			   const double *fc3,
+			   const int target,
+			   const int source,
+			   const int *atom_mapping,
+			   const int num_atom,
+			   const double *rot_cart)
+{
+  int i;
+
+#pragma omp parallel for
+  for (i = 0; i < num_triplets; i++) {
+    if (triplets[i * 3] == target) {
+      tensor3_rotation(values + 27 * i,
+		       fc3 +
+		       27 * num_atom * num_atom * source +
+		       27 * num_atom * atom_mapping[triplets[i * 3 + 1]] +
+		       27 * atom_mapping[triplets[i * 3 + 2]],
+		       rot_cart);
+    }
+  }
+}
+
+/* The rotation is applied to one index at a time, i.e., 3 x 81 */
+/* instead of 27 x 27 multiply-adds. rot_tensor may be tensor. */
 void tensor3_rotation(double *rot_tensor,
 		      const double *tensor,
 		      const double *rot_cartesian)
 {
-  int l;
+  double t1[27], t2[27];
 
-  for (l = 0; l < 27; l++) {
-    rot_tensor[l] = tensor3_rotation_elem(tensor, rot_cartesian, l);
-  }
+  rotate_tensor_index(t1, tensor, rot_cartesian, 1, 9);
+  rotate_tensor_index(t2, t1, rot_cartesian, 3, 3);
+  rotate_tensor_index(rot_tensor, t2, rot_cartesian, 9, 1);
 }
 
+/* 4 x 243 instead of 81 x 81 multiply-adds. rot_tensor may be tensor. */
+void tensor4_rotation(double *rot_tensor,
+		      const double *tensor,
+		      const double *rot_cartesian)
+{
+  double t1[81], t2[81], t3[81];
+
+  rotate_tensor_index(t1, tensor, rot_cartesian, 1, 27);
+  rotate_tensor_index(t2, t1, rot_cartesian, 3, 9);
+  rotate_tensor_index(t3, t2, rot_cartesian, 9, 3);
+  rotate_tensor_index(rot_tensor, t3, rot_cartesian, 27, 1);
+}
+
+/* Each orbit of atom triplets under index permutations is visited */
+/* once from its ordered triplet (i <= j <= k) and is averaged in */
+/* place. Orbits are disjoint, so threads never touch the same */
+/* elements and the result does not depend on the number of threads. */
+/* Ordered pairs (i, j) are distributed dynamically since the work */
+/* for a pair is proportional to num_atom - j. */
 void set_permutation_symmetry_fc3(double *fc3, const int num_atom)
 {
-  double fc3_elem[27];
-  int i, j, k;
+  int i, j, k, l, ij;
+  int atoms[3];
+  int atom_perms[6][3], cart_perms[6][27];
+  long adrs[6];
 
-#pragma omp parallel for private(j, k, fc3_elem)
-  for (i = 0; i < num_atom; i++) {
-    for (j = i; j < num_atom; j++) {
-      for (k = j; k < num_atom; k++) {
-	set_permutation_symmetry_fc3_elem(fc3_elem, fc3, i, j, k, num_atom);
-	copy_permutation_symmetry_fc3_elem(fc3, fc3_elem,
-					   i, j, k, num_atom);
+  set_index_permutations(atom_perms[0], cart_perms[0], 3);
+
+#pragma omp parallel for schedule(dynamic) private(i, j, k, l, atoms, adrs)
+  for (ij = 0; ij < num_atom * num_atom; ij++) {
+    i = ij / num_atom;
+    j = ij % num_atom;
+    if (j < i) {
+      continue;
+    }
+    atoms[0] = i;
+    atoms[1] = j;
+    for (k = j; k < num_atom; k++) {
+      atoms[2] = k;
+      for (l = 0; l < 6; l++) {
+	adrs[l] = (((long)atoms[atom_perms[l][0]] * num_atom +
+		    atoms[atom_perms[l][1]]) * num_atom +
+		   atoms[atom_perms[l][2]]) * 27;
       }
+      symmetrize_permuted_elems(fc3, adrs, cart_perms[0], 6, 27);
     }
   }
 }
 
-static double tensor3_rotation_elem(const double *tensor,
-				    const double *r,
-				    const int pos)
+/* All permutations of 'rank' indices in lexicographic order, and */
+/* for each of them, positions of the elements of a tensor of 'rank' */
+/* whose Cartesian indices are permuted in the same way. */
+void set_index_permutations(int *atom_perms, int *cart_perms, const int rank)
 {
-  int i, j, k, l, m, n;
-  double sum;
+  int i, j, k, num_tuples, num_elems, num_perms, is_perm, adrs;
+  int digits[4], perm[4];
 
-  l = pos / 9;
-  m = (pos % 9) / 3;
-  n = pos % 3;
+  num_tuples = 1;
+  num_elems = 1;
+  for (i = 0; i < rank; i++) {
+    num_tuples *= rank;
+    num_elems *= 3;
+  }
 
-  sum = 0.0;
-  for (i = 0; i < 3; i++) {
-    for (j = 0; j < 3; j++) {
-      for (k = 0; k < 3; k++) {
-	sum += r[l * 3 + i] * r[m * 3 + j] * r[n * 3 + k] *
-	  tensor[i * 9 + j * 3 + k];
+  num_perms = 0;
+  for (i = 0; i < num_tuples; i++) {
+    adrs = i;
+    for (j = rank - 1; j > -1; j--) {
+      perm[j] = adrs % rank;
+      adrs /= rank;
+    }
+    is_perm = 1;
+    for (j = 0; j < rank; j++) {
+      for (k = j + 1; k < rank; k++) {
+	if (perm[j] == perm[k]) {
+	  is_perm = 0;
+	}
+      }
+    }
+    if (! is_perm) {
+      continue;
+    }
+
+    for (j = 0; j < rank; j++) {
+      atom_perms[num_perms * rank + j] = perm[j];
+    }
+    for (j = 0; j < num_elems; j++) {
+      adrs = j;
+      for (k = rank - 1; k > -1; k--) {
+	digits[k] = adrs % 3;
+	adrs /= 3;
+      }
+      adrs = 0;
+      for (k = 0; k < rank; k++) {
+	adrs = adrs * 3 + digits[perm[k]];
       }
+      cart_perms[num_perms * num_elems + j] = adrs;
     }
+    num_perms++;
   }
-  return sum;
 }
 
+/* Elements at adrs[i] + cart_perms[i * num_elems + j] for all i are */
+/* replaced by their average. */
+void symmetrize_permuted_elems(double *fc,
+			       const long *adrs,
+			       const int *cart_perms,
+			       const int num_perms,
+			       const int num_elems)
+{
+  int i, j;
+  double sum;
+  double elems[81];
 
-static void copy_permutation_symmetry_fc3_elem(double *fc3,
-					       const double fc3_elem[27],
-					       const int a,
-					       const int b,
-					       const int c,
-					       const int num_atom)
+  for (j = 0; j < num_elems; j++) {
+    sum = 0;
+    for (i = 0; i < num_perms; i++) {
+      sum += fc[adrs[i] + cart_perms[i * num_elems + j]];
+    }
+    elems[j] = sum / num_perms;
+  }
+  for (i = 0; i < num_perms; i++) {
+    for (j = 0; j < num_elems; j++) {
+      fc[adrs[i] + cart_perms[i * num_elems + j]] = elems[j];
+    }
+  }
+}
+
+/* Compact fc3[num_patom, num_satom, num_satom, 3, 3, 3] */
+/* fc3[b, j, k] with b not in primitive cell is found at */
+/* fc3[s2pp[b], perms[t_b][j], perms[t_b][k]], where t_b = trans[b] */
+/* is the index of the lattice translation that sends the primitive */
+/* atom to b and perms is its inverse atom permutation. */
+/* Elements related by index permutations and lattice translations */
+/* form disjoint orbits. Each orbit is averaged in place by the thread */
+/* that visits its element of the lowest address. */
+void set_permutation_symmetry_compact_fc3(double *fc3,
+					  const int *p2s,
+					  const int *s2pp,
+					  const int *trans,
+					  const int *perms,
+					  const int num_patom,
+					  const int num_satom)
 {
-  int i, j, k;
-
-  for (i = 0; i < 3; i++) {
-    for (j = 0; j < 3; j++) {
-      for (k = 0; k < 3; k++) {
-	fc3[a * num_atom * num_atom * 27 +
-	    b * num_atom * 27 +
-	    c * 27 + i * 9 + j * 3 + k] =
-	  fc3_elem[i * 9 + j * 3 + k];
-	fc3[a * num_atom * num_atom * 27 +
-	    c * num_atom * 27 +
-	    b * 27 + i * 9 + k * 3 + j] =
-	  fc3_elem[i * 9 + j * 3 + k];
-	fc3[b * num_atom * num_atom * 27 +
-	    a * num_atom * 27 +
-	    c * 27 + j * 9 + i * 3 + k] =
-	  fc3_elem[i * 9 + j * 3 + k];
-	fc3[b * num_atom * num_atom * 27 +
-	    c * num_atom * 27 +
-	    a * 27 + j * 9 + k * 3 + i] =
-	  fc3_elem[i * 9 + j * 3 + k];
-	fc3[c * num_atom * num_atom * 27 +
-	    a * num_atom * 27 +
-	    b * 27 + k * 9 + i * 3 + j] =
-	  fc3_elem[i * 9 + j * 3 + k];
-	fc3[c * num_atom * num_atom * 27 +
-	    b * num_atom * 27 +
-	    a * 27 + k * 9 + j * 3 + i] =
-	  fc3_elem[i * 9 + j * 3 + k];
+  int i, j, l, i_p, is_first;
+  int atoms[3];
+  int atom_perms[6][3], cart_perms[6][27];
+  long adrs[6];
+
+  set_index_permutations(atom_perms[0], cart_perms[0], 3);
+
+#pragma omp parallel for private(i, i_p, j, l, is_first, atoms, adrs)
+  for (i = 0; i < num_patom * num_satom; i++) {
+    i_p = i / num_satom;
+    atoms[0] = p2s[i_p];
+    atoms[1] = i % num_satom;
+    for (j = 0; j < num_satom; j++) {
+      atoms[2] = j;
+      is_first = 1;
+      for (l = 0; l < 6; l++) {
+	adrs[l] = get_compact_fc3_adrs(atoms[atom_perms[l][0]],
+				       atoms[atom_perms[l][1]],
+				       atoms[atom_perms[l][2]],
+				       s2pp, trans, perms, num_satom);
+	if (adrs[l] < adrs[0]) {
+	  is_first = 0;
+	  break;
+	}
+      }
+      if (is_first) {
+	symmetrize_permuted_elems(fc3, adrs, cart_perms[0], 6, 27);
+      }
+    }
+  }
+}
+
+/* Sparse fc3 has only elements values[i] of compact fc3 at */
+/* triplets[i] = (i_p, j, k) sorted in ascending order. Elements */
+/* missing in triplets are zero. Orbits are averaged in place as for */
+/* compact fc3. */
+void set_permutation_symmetry_sparse_fc3(double *values,
+					 const int *triplets,
+					 const int num_triplets,
+					 const int *p2s,
+					 const int *s2pp,
+					 const int *trans,
+					 const int *perms,
+					 const int num_satom)
+{
+  int i, j, l, is_first;
+  int atoms[3], elem_index[6];
+  int atom_perms[6][3], cart_perms[6][27];
+  double sum;
+  double elems[27];
+
+  set_index_permutations(atom_perms[0], cart_perms[0], 3);
+
+#pragma omp parallel for private(j, l, is_first, atoms, elem_index, sum, elems)
+  for (i = 0; i < num_triplets; i++) {
+    atoms[0] = p2s[triplets[i * 3]];
+    atoms[1] = triplets[i * 3 + 1];
+    atoms[2] = triplets[i * 3 + 2];
+    is_first = 1;
+    for (l = 0; l < 6; l++) {
+      elem_index[l] = get_sparse_fc3_index(triplets,
+					   num_triplets,
+					   atoms[atom_perms[l][0]],
+					   atoms[atom_perms[l][1]],
+					   atoms[atom_perms[l][2]],
+					   s2pp, trans, perms, num_satom);
+      if (elem_index[l] > -1 && elem_index[l] < i) {
+	is_first = 0;
+	break;
+      }
+    }
+    if (! is_first) {
+      continue;
+    }
+
+    for (j = 0; j < 27; j++) {
+      sum = 0;
+      for (l = 0; l < 6; l++) {
+	if (elem_index[l] > -1) {
+	  sum += values[elem_index[l] * 27 + cart_perms[l][j]];
+	}
+      }
+      elems[j] = sum / 6;
+    }
+    for (l = 0; l < 6; l++) {
+      if (elem_index[l] > -1) {
+	for (j = 0; j < 27; j++) {
+	  values[elem_index[l] * 27 + cart_perms[l][j]] = elems[j];
+	}
       }
     }
   }
 }
 
-static void set_permutation_symmetry_fc3_elem(double *fc3_elem,
-					      const double *fc3,
-					      const int a,
-					      const int b,
-					      const int c,
-					      const int num_atom)
+static long get_compact_fc3_adrs(const int a,
+				 const int b,
+				 const int c,
+				 const int *s2pp,
+				 const int *trans,
+				 const int *perms,
+				 const int num_satom)
 {
-  int i, j, k;
-
-  for (i = 0; i < 3; i++) {
-    for (j = 0; j < 3; j++) {
-      for (k = 0; k < 3; k++) {
-	fc3_elem[i * 9 + j * 3 + k] =
-	  (fc3[a * num_atom * num_atom * 27 +
-	       b * num_atom * 27 +
-	       c * 27 + i * 9 + j * 3 + k] +
-	   fc3[a * num_atom * num_atom * 27 +
-	       c * num_atom * 27 +
-	       b * 27 + i * 9 + k * 3 + j] +
-	   fc3[b * num_atom * num_atom * 27 +
-	       a * num_atom * 27 +
-	       c * 27 + j * 9 + i * 3 + k] +
-	   fc3[b * num_atom * num_atom * 27 +
-	       c * num_atom * 27 +
-	       a * 27 + j * 9 + k * 3 + i] +
-	   fc3[c * num_atom * num_atom * 27 +
-	       a * num_atom * 27 +
-	       b * 27 + k * 9 + i * 3 + j] +
-	   fc3[c * num_atom * num_atom * 27 +
-	       b * num_atom * 27 +
-	       a * 27 + k * 9 + j * 3 + i]) / 6;
+  const int *perm;
+
+  perm = perms + trans[a] * num_satom;
+  return (((long)s2pp[a] * num_satom + perm[b]) * num_satom + perm[c]) * 27;
+}
+
+/* Binary search of the triplet in sorted triplets. -1 is returned */
+/* if the element is not stored. */
+static int get_sparse_fc3_index(const int *triplets,
+				const int num_triplets,
+				const int a,
+				const int b,
+				const int c,
+				const int *s2pp,
+				const int *trans,
+				const int *perms,
+				const int num_satom)
+{
+  int i, lower, upper, diff;
+  int triplet[3];
+  const int *perm;
+
+  perm = perms + trans[a] * num_satom;
+  triplet[0] = s2pp[a];
+  triplet[1] = perm[b];
+  triplet[2] = perm[c];
+
+  lower = 0;
+  upper = num_triplets;
+  while (lower < upper) {
+    i = (lower + upper) / 2;
+    diff = triplets[i * 3] - triplet[0];
+    if (diff == 0) {
+      diff = triplets[i * 3 + 1] - triplet[1];
+    }
+    if (diff == 0) {
+      diff = triplets[i * 3 + 2] - triplet[2];
+    }
+    if (diff == 0) {
+      return i;
+    }
+    if (diff < 0) {
+      lower = i + 1;
+    } else {
+      upper = i;
+    }
+  }
+  return -1;
+}
+
+/* rot_tensor[a, p, b] = sum_q r[p, q] tensor[a, q, b] */
+/* a < num_outer, b < num_inner. Called with constant sizes, the loops */
+/* are unrolled and vectorized by the compiler for each rank. */
+static void rotate_tensor_index(double *rot_tensor,
+				const double *tensor,
+				const double *r,
+				const int num_outer,
+				const int num_inner)
+{
+  int a, b, p;
+  const double *t;
+
+  for (a = 0; a < num_outer; a++) {
+    t = tensor + a * 3 * num_inner;
+    for (p = 0; p < 3; p++) {
+      for (b = 0; b < num_inner; b++) {
+	rot_tensor[(a * 3 + p) * num_inner + b] =
+	  r[p * 3] * t[b] +
+	  r[p * 3 + 1] * t[num_inner + b] +
+	  r[p * 3 + 2] * t[2 * num_inner + b];
       }
     }
   }
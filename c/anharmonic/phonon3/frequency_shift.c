@@ -1,89 +1,282 @@
-#include <lapacke.h>
 #include <stdlib.h>
 #include "phonoc_array.h"
-#include "phonoc_math.h"
 #include "phonoc_utils.h"
 #include "phonon3_h/frequency_shift.h"
-#include "phonon3_h/real_to_reciprocal.h"
-
-/*
-void get_fc4_frequency_shifts(double *frequency_shifts,
-			      const double *fc3_normal_real,
-			      const double *frequencies,
-			      const Iarray *grid_points1,
-			      const Darray *temperatures,
-			      const int *band_indicies,
-			      const int num_band0,
-			      const int num_band,
-			      const double unit_conversion_factor)
+
+static void get_frequency_shift_at_band(double *shifts,
+					const int band_index,
+					const Darray *fc3_normal_squared,
+					const double fpoint,
+					const double *frequencies,
+					const int *grid_point_triplets,
+					const int *triplet_weights,
+					const double *occupations,
+					const double *epsilons,
+					const int num_epsilon,
+					const int num_temp,
+					const double cutoff_frequency);
+static void sum_frequency_shift_at_band(double *shifts,
+					const int num_band,
+					const double *fc3_normal_squared,
+					const double fpoint,
+					const double *freqs0,
+					const double *freqs1,
+					const double *occ0,
+					const double *occ1,
+					const double *epsilons,
+					const int num_epsilon,
+					const int num_temp,
+					const double cutoff_frequency);
+static double *get_occupations_of_triplets(const double *frequencies,
+					   const int *grid_point_triplets,
+					   const int num_triplets,
+					   const int num_band,
+					   const double *temperatures,
+					   const int num_temp);
+
+/* Principal value of real part of self energy */
+/* frequency_shifts[num_temp, num_epsilon, num_band0] */
+/* fc3_normal_squared[num_triplets, num_band0, num_band, num_band] */
+void get_frequency_shift_at_bands(double *frequency_shifts,
+				  const Darray *fc3_normal_squared,
+				  const int *band_indices,
+				  const double *frequencies,
+				  const int *grid_point_triplets,
+				  const int *triplet_weights,
+				  const double *epsilons,
+				  const int num_epsilon,
+				  const double *temperatures,
+				  const int num_temp,
+				  const double unit_conversion_factor,
+				  const double cutoff_frequency)
 {
-  int i, j, k, l;
-  double shift, num_phonon;
+  int i, j, num_band0, num_band, gp0;
+  double *occupations, *shifts;
+
+  num_band0 = fc3_normal_squared->dims[1];
+  num_band = fc3_normal_squared->dims[2];
+  gp0 = grid_point_triplets[0];
+
+  occupations = get_occupations_of_triplets(frequencies,
+					    grid_point_triplets,
+					    fc3_normal_squared->dims[0],
+					    num_band,
+					    temperatures,
+					    num_temp);
+  shifts = (double*)malloc(sizeof(double) * num_temp * num_epsilon);
+
+  for (i = 0; i < num_band0; i++) {
+    get_frequency_shift_at_band(shifts,
+				i,
+				fc3_normal_squared,
+				frequencies[gp0 * num_band + band_indices[i]],
+				frequencies,
+				grid_point_triplets,
+				triplet_weights,
+				occupations,
+				epsilons,
+				num_epsilon,
+				num_temp,
+				cutoff_frequency);
+    for (j = 0; j < num_temp * num_epsilon; j++) {
+      frequency_shifts[j * num_band0 + i] = shifts[j] * unit_conversion_factor;
+    }
+  }
+
+  free(shifts);
+  free(occupations);
+}
 
+/* Real part of self energy at frequency points, i.e., the Kramers-Kronig */
+/* partner of imaginary part computed from the same fc3_normal_squared */
+/* frequency_shifts[num_fpoints, num_temp, num_epsilon, num_band0] */
+void get_frequency_shift(double *frequency_shifts,
+			 const Darray *fc3_normal_squared,
+			 const double *frequency_points,
+			 const int num_fpoints,
+			 const double *frequencies,
+			 const int *grid_point_triplets,
+			 const int *triplet_weights,
+			 const double *epsilons,
+			 const int num_epsilon,
+			 const double *temperatures,
+			 const int num_temp,
+			 const double unit_conversion_factor,
+			 const double cutoff_frequency)
+{
+  int i, j, k, num_band0, num_band, num_te;
+  double *occupations, *shifts;
+
+  num_band0 = fc3_normal_squared->dims[1];
+  num_band = fc3_normal_squared->dims[2];
+  num_te = num_temp * num_epsilon;
+
+  occupations = get_occupations_of_triplets(frequencies,
+					    grid_point_triplets,
+					    fc3_normal_squared->dims[0],
+					    num_band,
+					    temperatures,
+					    num_temp);
+  shifts = (double*)malloc(sizeof(double) * num_te);
 
-  for (i = 0; i < temperatures->dims[0]; i++) {
+  for (i = 0; i < num_fpoints; i++) {
     for (j = 0; j < num_band0; j++) {
-      shift = 0;
-#pragma omp parallel for reduction(+:shift) private(k, l, num_phonon)
-      for (k = 0; k < grid_points1->dims[0]; k++) {
-	for (l = 0; l < num_band; l++) {
-	  if (temperatures->data[i] > 0) {
-	    num_phonon = 2 *
-	      bose_einstein(frequencies[grid_points1->data[k] * num_band + l],
-			    temperatures->data[i]) + 1;
-	  } else {
-	    num_phonon = 1;
+      get_frequency_shift_at_band(shifts,
+				  j,
+				  fc3_normal_squared,
+				  frequency_points[i],
+				  frequencies,
+				  grid_point_triplets,
+				  triplet_weights,
+				  occupations,
+				  epsilons,
+				  num_epsilon,
+				  num_temp,
+				  cutoff_frequency);
+      for (k = 0; k < num_te; k++) {
+	frequency_shifts[(i * num_te + k) * num_band0 + j] =
+	  shifts[k] * unit_conversion_factor;
+      }
+    }
+  }
+
+  free(shifts);
+  free(occupations);
+}
+
+/* Triplets are summed up in a fixed order after the parallel loop */
+/* to obtain results independent of the number of threads. */
+static void get_frequency_shift_at_band(double *shifts,
+					const int band_index,
+					const Darray *fc3_normal_squared,
+					const double fpoint,
+					const double *frequencies,
+					const int *grid_point_triplets,
+					const int *triplet_weights,
+					const double *occupations,
+					const double *epsilons,
+					const int num_epsilon,
+					const int num_temp,
+					const double cutoff_frequency)
+{
+  int i, j, num_triplets, num_band0, num_band, num_te, gp1, gp2;
+  double *shifts_at_triplets;
+
+  num_triplets = fc3_normal_squared->dims[0];
+  num_band0 = fc3_normal_squared->dims[1];
+  num_band = fc3_normal_squared->dims[2];
+  num_te = num_temp * num_epsilon;
+
+  shifts_at_triplets = (double*)malloc(sizeof(double) * num_triplets * num_te);
+
+#pragma omp parallel for private(gp1, gp2)
+  for (i = 0; i < num_triplets; i++) {
+    gp1 = grid_point_triplets[i * 3 + 1];
+    gp2 = grid_point_triplets[i * 3 + 2];
+    sum_frequency_shift_at_band(shifts_at_triplets + i * num_te,
+				num_band,
+				fc3_normal_squared->data +
+				i * num_band0 * num_band * num_band +
+				band_index * num_band * num_band,
+				fpoint,
+				frequencies + gp1 * num_band,
+				frequencies + gp2 * num_band,
+				occupations + i * 2 * num_band * num_temp,
+				occupations + (i * 2 + 1) * num_band * num_temp,
+				epsilons,
+				num_epsilon,
+				num_temp,
+				cutoff_frequency);
+  }
+
+  for (i = 0; i < num_te; i++) {
+    shifts[i] = 0;
+  }
+  for (i = 0; i < num_triplets; i++) {
+    for (j = 0; j < num_te; j++) {
+      shifts[j] += shifts_at_triplets[i * num_te + j] * triplet_weights[i];
+    }
+  }
+
+  free(shifts_at_triplets);
+}
+
+/* Occupations are zero at T <= 0, which gives the formula at 0K. */
+/* shifts[num_temp, num_epsilon] */
+static void sum_frequency_shift_at_band(double *shifts,
+					const int num_band,
+					const double *fc3_normal_squared,
+					const double fpoint,
+					const double *freqs0,
+					const double *freqs1,
+					const double *occ0,
+					const double *occ1,
+					const double *epsilons,
+					const int num_epsilon,
+					const int num_temp,
+					const double cutoff_frequency)
+{
+  int i, j, k, l;
+  double f1, f2, f3, f4, e2, d_sum, d_diff, fc3;
+  const double *n2, *n3;
+
+  for (i = 0; i < num_temp * num_epsilon; i++) {
+    shifts[i] = 0;
+  }
+
+  for (i = 0; i < num_band; i++) {
+    if (freqs0[i] > cutoff_frequency) {
+      n2 = occ0 + i * num_temp;
+      for (j = 0; j < num_band; j++) {
+	if (freqs1[j] > cutoff_frequency) {
+	  n3 = occ1 + j * num_temp;
+	  fc3 = fc3_normal_squared[i * num_band + j];
+	  f1 = fpoint + freqs0[i] + freqs1[j];
+	  f2 = fpoint - freqs0[i] - freqs1[j];
+	  f3 = fpoint - freqs0[i] + freqs1[j];
+	  f4 = fpoint + freqs0[i] - freqs1[j];
+	  for (k = 0; k < num_epsilon; k++) {
+	    e2 = epsilons[k] * epsilons[k];
+	    d_sum = (f2 / (f2 * f2 + e2) - f1 / (f1 * f1 + e2)) * fc3;
+	    d_diff = (f4 / (f4 * f4 + e2) - f3 / (f3 * f3 + e2)) * fc3;
+	    for (l = 0; l < num_temp; l++) {
+	      shifts[l * num_epsilon + k] +=
+		(n2[l] + n3[l] + 1) * d_sum + (n2[l] - n3[l]) * d_diff;
+	    }
 	  }
-	  shift += unit_conversion_factor * fc4_normal_real
-	    [k * num_band0 * num_band + j * num_band + l] * num_phonon;
 	}
       }
-      frequency_shifts[i * num_band0 + j] = shift;
-    }    
+    }
   }
 }
 
-void
-get_fc4_normal_for_frequency_shift(double *fc4_normal_real,
-				   const double *frequencies,
-				   const lapack_complex_double *eigenvectors,
-				   const int grid_point0,
-				   const Iarray *grid_points1,
-				   const int *grid_address,
-				   const int *mesh,
-				   const double *fc4,
-				   const Darray *shortest_vectors,
-				   const Iarray *multiplicity,
-				   const double *masses,
-				   const int *p2s_map,
-				   const int *s2p_map,
-				   const Iarray *band_indicies,
-				   const double cutoff_frequency)
+/* occupations[num_triplets, 2, num_band, num_temp] */
+static double *get_occupations_of_triplets(const double *frequencies,
+					   const int *grid_point_triplets,
+					   const int num_triplets,
+					   const int num_band,
+					   const double *temperatures,
+					   const int num_temp)
 {
-  int i, num_atom, num_band, num_band0;
-
-  num_atom = multiplicity->dims[1];
-  num_band = num_atom * 3;
-  num_band0 = band_indicies->dims[0];
-
-#pragma omp parallel for private(i)
-  for (i = 0; i < grid_points1->dims[0]; i++) {
-    get_fc4_normal_for_frequency_shift_at_gp(fc4_normal_real +
-					     i * num_band0 * num_band,
-					     frequencies,
-					     eigenvectors,
-					     grid_point0,
-					     grid_points1->data[i],
-					     grid_address,
-					     mesh,
-					     fc4,
-					     shortest_vectors,
-					     multiplicity,
-					     masses,
-					     p2s_map,
-					     s2p_map,
-					     band_indicies,
-					     cutoff_frequency);
+  int i;
+  int *grid_points;
+  double *occupations;
+
+  grid_points = (int*)malloc(sizeof(int) * num_triplets * 2);
+  for (i = 0; i < num_triplets; i++) {
+    grid_points[i * 2] = grid_point_triplets[i * 3 + 1];
+    grid_points[i * 2 + 1] = grid_point_triplets[i * 3 + 2];
   }
+  occupations = (double*)malloc(sizeof(double) *
+				num_triplets * 2 * num_band * num_temp);
+  get_bose_einstein_table(occupations,
+			  frequencies,
+			  grid_points,
+			  num_triplets * 2,
+			  num_band,
+			  temperatures,
+			  num_temp);
+  free(grid_points);
+
+  return occupations;
 }
-*/
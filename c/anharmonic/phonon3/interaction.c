@@ -21,6 +21,7 @@ static void real_to_normal(double *fc3_normal_squared,
 			   const lapack_complex_double *eigvecs1,
 			   const lapack_complex_double *eigvecs2,
 			   const Darray *fc3,
+			   const Iarray *fc3_triplets,
 			   const double q[9], /* q0, q1, q2 */
 			   const Darray *shortest_vectors,
 			   const Iarray *multiplicity,
@@ -35,6 +36,7 @@ static void real_to_normal_sym_q(double *fc3_normal_squared,
 				 double *freqs[3],
 				 lapack_complex_double *eigvecs[3],
 				 const Darray *fc3,
+				 const Iarray *fc3_triplets,
 				 const double q[9], /* q0, q1, q2 */
 				 const Darray *shortest_vectors,
 				 const Iarray *multiplicity,
@@ -54,6 +56,7 @@ void get_interaction(Darray *fc3_normal_squared,
 		     const int *grid_address,
 		     const int *mesh,
 		     const Darray *fc3,
+		     const Iarray *fc3_triplets,
 		     const Darray *shortest_vectors,
 		     const Iarray *multiplicity,
 		     const double *masses,
@@ -89,6 +92,7 @@ void get_interaction(Darray *fc3_normal_squared,
 			   freqs,
 			   eigvecs,
 			   fc3,
+			   fc3_triplets,
 			   q, /* q0, q1, q2 */
 			   shortest_vectors,
 			   multiplicity,
@@ -109,6 +113,7 @@ void get_interaction(Darray *fc3_normal_squared,
 		     eigvecs[1],
 		     eigvecs[2],
 		     fc3,
+		     fc3_triplets,
 		     q, /* q0, q1, q2 */
 		     shortest_vectors,
 		     multiplicity,
@@ -131,6 +136,7 @@ static void real_to_normal(double *fc3_normal_squared,
 			   const lapack_complex_double *eigvecs1,
 			   const lapack_complex_double *eigvecs2,
 			   const Darray *fc3,
+			   const Iarray *fc3_triplets,
 			   const double q[9], /* q0, q1, q2 */
 			   const Darray *shortest_vectors,
 			   const Iarray *multiplicity,
@@ -155,6 +161,7 @@ static void real_to_normal(double *fc3_normal_squared,
   real_to_reciprocal(fc3_reciprocal,
 		     q,
 		     fc3,
+		     fc3_triplets,
 		     shortest_vectors,
 		     multiplicity,
 		     p2s_map,
@@ -181,6 +188,7 @@ static void real_to_normal_sym_q(double *fc3_normal_squared,
 				 double *freqs[3],
 				 lapack_complex_double *eigvecs[3],
 				 const Darray *fc3,
+				 const Iarray *fc3_triplets,
 				 const double q[9], /* q0, q1, q2 */
 				 const Darray *shortest_vectors,
 				 const Iarray *multiplicity,
@@ -218,6 +226,7 @@ static void real_to_normal_sym_q(double *fc3_normal_squared,
 		   eigvecs[index_exchange[i][1]],
 		   eigvecs[index_exchange[i][2]],
 		   fc3,
+		   fc3_triplets,
 		   q_ex, /* q0, q1, q2 */
 		   shortest_vectors,
 		   multiplicity,
@@ -17,11 +17,25 @@ static void real_to_reciprocal_elements(lapack_complex_double *fc3_rec_elem,
 					const int pi0,
 					const int pi1,
 					const int pi2);
+static void real_to_reciprocal_sparse(lapack_complex_double *fc3_reciprocal,
+				      const double q[9],
+				      const Darray *fc3,
+				      const Iarray *fc3_triplets,
+				      const Darray *shortest_vectors,
+				      const Iarray *multiplicity,
+				      const int *p2s_map,
+				      const int *s2p_map);
 
 /* fc3_reciprocal[num_patom, num_patom, num_patom, 3, 3, 3] */
+/* fc3 is either full [num_satom, num_satom, num_satom, 3, 3, 3] or */
+/* compact [num_patom, num_satom, num_satom, 3, 3, 3]. */
+/* When fc3_triplets is not NULL, fc3 is sparse [num_fc3_triplets, 3, 3, 3] */
+/* of atom triplets fc3_triplets [num_fc3_triplets, 3] given by */
+/* (atom in primitive cell, atom in supercell, atom in supercell). */
 void real_to_reciprocal(lapack_complex_double *fc3_reciprocal,
 			const double q[9],
 			const Darray *fc3,
+			const Iarray *fc3_triplets,
 			const Darray *shortest_vectors,
 			const Iarray *multiplicity,
 			const int *p2s_map,
@@ -33,21 +47,33 @@ void real_to_reciprocal(lapack_complex_double *fc3_reciprocal,
   
   num_patom = multiplicity->dims[1];
 
+  if (fc3_triplets) {
+    real_to_reciprocal_sparse(fc3_reciprocal,
+			      q,
+			      fc3,
+			      fc3_triplets,
+			      shortest_vectors,
+			      multiplicity,
+			      p2s_map,
+			      s2p_map);
+  }
+
   for (i = 0; i < num_patom; i++) {
-    for (j = 0; j < num_patom; j++) {
-      for (k = 0; k < num_patom; k++) {
-	real_to_reciprocal_elements(fc3_reciprocal +
-				    i * 27 * num_patom * num_patom +
-				    j * 27 * num_patom +
-				    k * 27,
-				    q,
-				    fc3,
-				    shortest_vectors,
-				    multiplicity,
-				    p2s_map,
-				    s2p_map,
-				    i, j, k);
-	
+    if (! fc3_triplets) {
+      for (j = 0; j < num_patom; j++) {
+	for (k = 0; k < num_patom; k++) {
+	  real_to_reciprocal_elements(fc3_reciprocal +
+				      i * 27 * num_patom * num_patom +
+				      j * 27 * num_patom +
+				      k * 27,
+				      q,
+				      fc3,
+				      shortest_vectors,
+				      multiplicity,
+				      p2s_map,
+				      s2p_map,
+				      i, j, k);
+	}
       }
     }
 
@@ -90,7 +116,12 @@ static void real_to_reciprocal_elements(lapack_complex_double *fc3_rec_elem,
   
   num_satom = multiplicity->dims[0];
 
-  i = p2s[pi0];
+  /* Compact fc3 has only rows of atoms in primitive cell. */
+  if (fc3->dims[0] == num_satom) {
+    i = p2s[pi0];
+  } else {
+    i = pi0;
+  }
 
   for (j = 0; j < num_satom; j++) {
     if (s2p[j] != p2s[pi1]) {
@@ -124,3 +155,84 @@ static void real_to_reciprocal_elements(lapack_complex_double *fc3_rec_elem,
   }
 }
 
+/* Phase factors of the second and third atoms are tabulated for all */
+/* atoms in supercell, then each triplet of atoms is visited once. */
+static void real_to_reciprocal_sparse(lapack_complex_double *fc3_reciprocal,
+				      const double q[9],
+				      const Darray *fc3,
+				      const Iarray *fc3_triplets,
+				      const Darray *shortest_vectors,
+				      const Iarray *multiplicity,
+				      const int *p2s_map,
+				      const int *s2p_map)
+{
+  int i, j, k, l, i_p, num_patom, num_satom, adrs;
+  int *s2pp;
+  double *fc3_rec_real, *fc3_rec_imag, *fc3_elem;
+  double pf_real, pf_imag;
+  lapack_complex_double *phase_factor1, *phase_factor2;
+
+  num_satom = multiplicity->dims[0];
+  num_patom = multiplicity->dims[1];
+
+  s2pp = (int*)malloc(sizeof(int) * num_satom);
+  for (i = 0; i < num_satom; i++) {
+    for (j = 0; j < num_patom; j++) {
+      if (s2p_map[i] == p2s_map[j]) {
+	s2pp[i] = j;
+	break;
+      }
+    }
+  }
+
+  phase_factor1 = (lapack_complex_double*)
+    malloc(sizeof(lapack_complex_double) * num_patom * num_satom);
+  phase_factor2 = (lapack_complex_double*)
+    malloc(sizeof(lapack_complex_double) * num_patom * num_satom);
+  for (i = 0; i < num_patom; i++) {
+    for (j = 0; j < num_satom; j++) {
+      phase_factor1[i * num_satom + j] =
+	get_phase_factor(q, shortest_vectors, multiplicity, i, j, 1);
+      phase_factor2[i * num_satom + j] =
+	get_phase_factor(q, shortest_vectors, multiplicity, i, j, 2);
+    }
+  }
+
+  fc3_rec_real = (double*)malloc(sizeof(double) *
+				 num_patom * num_patom * num_patom * 27);
+  fc3_rec_imag = (double*)malloc(sizeof(double) *
+				 num_patom * num_patom * num_patom * 27);
+  for (i = 0; i < num_patom * num_patom * num_patom * 27; i++) {
+    fc3_rec_real[i] = 0;
+    fc3_rec_imag[i] = 0;
+  }
+
+  for (i = 0; i < fc3_triplets->dims[0]; i++) {
+    i_p = fc3_triplets->data[i * 3];
+    j = fc3_triplets->data[i * 3 + 1];
+    k = fc3_triplets->data[i * 3 + 2];
+    adrs = (i_p * num_patom * num_patom * 27 +
+	    s2pp[j] * num_patom * 27 +
+	    s2pp[k] * 27);
+    pf_real = lapack_complex_double_real(phonoc_complex_prod(
+      phase_factor1[i_p * num_satom + j], phase_factor2[i_p * num_satom + k]));
+    pf_imag = lapack_complex_double_imag(phonoc_complex_prod(
+      phase_factor1[i_p * num_satom + j], phase_factor2[i_p * num_satom + k]));
+    fc3_elem = fc3->data + i * 27;
+    for (l = 0; l < 27; l++) {
+      fc3_rec_real[adrs + l] += pf_real * fc3_elem[l];
+      fc3_rec_imag[adrs + l] += pf_imag * fc3_elem[l];
+    }
+  }
+
+  for (i = 0; i < num_patom * num_patom * num_patom * 27; i++) {
+    fc3_reciprocal[i] =
+      lapack_make_complex_double(fc3_rec_real[i], fc3_rec_imag[i]);
+  }
+
+  free(fc3_rec_real);
+  free(fc3_rec_imag);
+  free(phase_factor1);
+  free(phase_factor2);
+  free(s2pp);
+}
@@ -3,45 +3,14 @@
 #include "phonon3_h/fc3.h"
 #include "phonon4_h/fc4.h"
 
-static void tensor4_roation(double *rot_tensor,
-			    const double *fc4,
-			    const int atom_i,
-			    const int atom_j,
-			    const int atom_k,
-			    const int atom_l,
-			    const int atom_rot_i,
-			    const int atom_rot_j,
-			    const int atom_rot_k,
-			    const int atom_rot_l,
-			    const int num_atom,
-			    const double *rot_cartesian);
-static double tensor4_rotation_elem(const double tensor[81],
-				    const double *r,
-				    const int m,
-				    const int n,
-				    const int p,
-				    const int q);
-static double get_drift_fc4_elem(const double *fc4,
-				 const int num_atom,
-				 const int i,
-				 const int j,
-				 const int k,
-				 const int l,
-				 const int index);
-static void copy_permutation_symmetry_fc4_elem(double *fc4,
-					       const double fc4_elem[81],
-					       const int a,
-					       const int b,
-					       const int c,
-					       const int d,
-					       const int num_atom);
-static void set_permutation_symmetry_fc4_elem(double *fc4_elem,
-					      const double *fc4,
-					      const int a,
-					      const int b,
-					      const int c,
-					      const int d,
-					      const int num_atom);
+static void get_drift_fc4_index(double *drift,
+				const double *fc4,
+				const long num_atom,
+				const int index);
+static void sum_drift_fc4(double *drift_sum,
+			  const double *drift,
+			  const long num_atom,
+			  const int axis);
 
 int rotate_delta_fc3s_elem(double *rotated_delta_fc3s,
 			   const double *delta_fc3s,
@@ -54,20 +23,22 @@ int rotate_delta_fc3s_elem(double *rotated_delta_fc3s,
 			   const int atom3,
 			   const int num_atom)
 {
-  int i, j;
+  int i, j, ij;
   double *rot_tensor;
-  for (i = 0; i < num_delta_fc3s; i++) {
-    for (j = 0; j < num_rot; j++) {
-      rot_tensor = rotated_delta_fc3s + i * num_rot * 27 + j * 27;
-      tensor3_rotation(rot_tensor,
-		       delta_fc3s +
-		       i * num_atom * num_atom * num_atom * 27 +
-		       27 * num_atom * num_atom *
-		       rot_map_syms[num_atom * j + atom1] +
-		       27 * num_atom * rot_map_syms[num_atom * j + atom2] +
-		       27 * rot_map_syms[num_atom * j + atom3],
-		       site_sym_cart + j * 9);
-    }
+
+#pragma omp parallel for private(i, j, rot_tensor)
+  for (ij = 0; ij < num_delta_fc3s * num_rot; ij++) {
+    i = ij / num_rot;
+    j = ij % num_rot;
+    rot_tensor = rotated_delta_fc3s + i * num_rot * 27 + j * 27;
+    tensor3_rotation(rot_tensor,
+		     delta_fc3s +
+		     i * num_atom * num_atom * num_atom * 27 +
+		     27 * num_atom * num_atom *
+		     rot_map_syms[num_atom * j + atom1] +
+		     27 * num_atom * rot_map_syms[num_atom * j + atom2] +
+		     27 * rot_map_syms[num_atom * j + atom3],
+		     site_sym_cart + j * 9);
   }
   return 0;
 }
@@ -79,12 +50,12 @@ int distribute_fc4(double *fc4,
 		   const int num_atom,
 		   const double *rot_cart)
 {
-  int i, j, k, atom_rot_i, atom_rot_j, atom_rot_k, fourth_atom_rot;
-  double *tensor;
+  long i, j, k, n, atom_rot_i, atom_rot_j, atom_rot_k, fourth_atom_rot;
 
+  n = num_atom;
   fourth_atom_rot = atom_mapping[fourth_atom];
-  
-#pragma omp parallel for private(j, k, atom_rot_i, atom_rot_j, atom_rot_k, tensor)
+
+#pragma omp parallel for private(j, k, atom_rot_i, atom_rot_j, atom_rot_k)
   for (i = 0; i < num_atom; i++) {
     atom_rot_i = atom_mapping[i];
 
@@ -94,507 +65,287 @@ int distribute_fc4(double *fc4,
       for (k = 0; k < num_atom; k++) {
 	atom_rot_k = atom_mapping[k];
 
-	tensor = (fc4 +
-		  81 * num_atom * num_atom * num_atom * fourth_atom +
-		  81 * num_atom * num_atom * i +
-		  81 * num_atom * j +
-		  81 * k);
-	tensor4_roation(tensor,
-			fc4,
-			fourth_atom,
-			i,
-			j,
-			k,
-			fourth_atom_rot,
-			atom_rot_i,
-			atom_rot_j,
-			atom_rot_k,
-			num_atom,
-			rot_cart);
+	tensor4_rotation(fc4 +
+			 81 * (((fourth_atom * n + i) * n + j) * n + k),
+			 fc4 +
+			 81 * (((fourth_atom_rot * n + atom_rot_i) * n +
+				atom_rot_j) * n + atom_rot_k),
+			 rot_cart);
       }
     }
   }
   return 1;
 }
 
+/* Translational invariance is imposed along the four indices in turn. */
+/* Drifts along all indices are summed from fc4 before it is modified. */
+/* The drift along each later index is then corrected for the earlier */
+/* corrections by partial sums of the earlier drifts. All corrections */
+/* are applied in one pass. The result equals that of calling */
+/* set_translational_invariance_fc4_per_index for index 0, 1, 2, 3. */
 void set_translational_invariance_fc4(double *fc4,
 				      const int num_atom)
 {
-  int i;
+  long i, j, k, l, m, n, n2, n3, adrs;
+  double *drifts[4], *sum_0[3], *sum_1[2], *sum_2;
+
+  n = num_atom;
+  n2 = n * n * 81;
+  n3 = n * n * n * 81;
 
   for (i = 0; i < 4; i++) {
-    set_translational_invariance_fc4_per_index(fc4, num_atom, i);
+    drifts[i] = (double*)malloc(sizeof(double) * n3);
+    get_drift_fc4_index(drifts[i], fc4, n, i);
   }
-}
-  
-void set_translational_invariance_fc4_per_index(double *fc4,
-						const int num_atom,
-						const int index)
-{
-  int i, j, k, l, m;
-  double drift;
 
-#pragma omp parallel for private(j, k, l, m, drift)
-  for (i = 0; i < 81; i++) {
-    for (j = 0; j < num_atom; j++) {
-      for (k = 0; k < num_atom; k++) {
-	for (l = 0; l < num_atom; l++) {
-	  drift =
-	    get_drift_fc4_elem(fc4, num_atom, i, j, k, l, index) / num_atom;
-	  for (m = 0; m < num_atom; m++) {
-	    switch (index) {
-	    case 0:
-	      fc4[m * num_atom * num_atom * num_atom * 81 +
-		  j * num_atom * num_atom * 81 +
-		  k * num_atom * 81 +
-		  l * 81 + i] -= drift;
-	      break;
-	    case 1:
-	      fc4[j * num_atom * num_atom * num_atom * 81 +
-		  m * num_atom * num_atom * 81 +
-		  k * num_atom * 81 +
-		  l * 81 + i] -= drift;
-	      break;
-	    case 2:
-	      fc4[j * num_atom * num_atom * num_atom * 81 +
-		  k * num_atom * num_atom * 81 +
-		  m * num_atom * 81 +			 
-		  l * 81 + i] -= drift;
-	      break;
-	    case 3:
-	      fc4[j * num_atom * num_atom * num_atom * 81 +
-		  k * num_atom * num_atom * 81 +
-		  l * num_atom * 81 +
-		  m * 81 + i] -= drift;
-	      break;
-	    }
-	  }
-	}
-      }
-    }
+  /* drifts[1][i, k, l] after the correction along index 0 */
+  for (i = 0; i < 3; i++) {
+    sum_0[i] = (double*)malloc(sizeof(double) * n2);
+    sum_drift_fc4(sum_0[i], drifts[0], n, i);
+  }
+#pragma omp parallel for private(m)
+  for (i = 0; i < n3; i++) {
+    m = i % n2;
+    drifts[1][i] -= sum_0[0][m] / n;
   }
-}
 
-void set_permutation_symmetry_fc4(double *fc4, const int num_atom)
-{
-  double fc4_elem[81];
-  int i, j, k, l;
+  /* drifts[2][i, j, l] after the corrections along indices 0 and 1 */
+  for (i = 0; i < 2; i++) {
+    sum_1[i] = (double*)malloc(sizeof(double) * n2);
+    sum_drift_fc4(sum_1[i], drifts[1], n, i + 1);
+  }
+#pragma omp parallel for private(j, l, m)
+  for (i = 0; i < n * n2; i++) {
+    j = (i / (n * 81)) % n;
+    l = (i / 81) % n;
+    m = i % 81;
+    drifts[2][i] -= (sum_0[1][(j * n + l) * 81 + m] +
+		     sum_1[0][((i / n2) * n + l) * 81 + m]) / n;
+  }
 
-#pragma omp parallel for private(j, k, l, fc4_elem)
-  for (i = 0; i < num_atom; i++) {
-    for (j = i; j < num_atom; j++) {
-      for (k = j; k < num_atom; k++) {
-	for (l = k; l < num_atom; l++) {
-	  set_permutation_symmetry_fc4_elem(fc4_elem, fc4, i, j, k, l, num_atom);
-	  copy_permutation_symmetry_fc4_elem(fc4, fc4_elem,
-					     i, j, k, l, num_atom);
-	}
-      }
+  /* drifts[3][i, j, k] after the corrections along indices 0, 1, 2 */
+  sum_2 = (double*)malloc(sizeof(double) * n2);
+  sum_drift_fc4(sum_2, drifts[2], n, 2);
+#pragma omp parallel for private(j, k, m)
+  for (i = 0; i < n * n2; i++) {
+    j = (i / (n * 81)) % n;
+    k = (i / 81) % n;
+    m = i % 81;
+    drifts[3][i] -= (sum_0[2][(j * n + k) * 81 + m] +
+		     sum_1[1][((i / n2) * n + k) * 81 + m] +
+		     sum_2[(i / n2) * n * 81 + j * 81 + m]) / n;
+  }
+
+#pragma omp parallel for private(i, j, k, l, m, adrs)
+  for (adrs = 0; adrs < n * n * n2; adrs += 81) {
+    i = adrs / n3;
+    j = (adrs / n2) % n;
+    k = (adrs / (n * 81)) % n;
+    l = (adrs / 81) % n;
+    for (m = 0; m < 81; m++) {
+      fc4[adrs + m] -= (drifts[0][((j * n + k) * n + l) * 81 + m] +
+			drifts[1][((i * n + k) * n + l) * 81 + m] +
+			drifts[2][((i * n + j) * n + l) * 81 + m] +
+			drifts[3][((i * n + j) * n + k) * 81 + m]) / n;
     }
   }
+
+  for (i = 0; i < 4; i++) {
+    free(drifts[i]);
+  }
+  for (i = 0; i < 3; i++) {
+    free(sum_0[i]);
+  }
+  for (i = 0; i < 2; i++) {
+    free(sum_1[i]);
+  }
+  free(sum_2);
 }
 
-static void copy_permutation_symmetry_fc4_elem(double *fc4,
-					       const double fc4_elem[81],
-					       const int a,
-					       const int b,
-					       const int c,
-					       const int d,
-					       const int num_atom)
+void set_translational_invariance_fc4_per_index(double *fc4,
+						const int num_atom,
+						const int index)
 {
-  int i, j, k, l;
+  long i, j, k, l, m, n, n2, n3, adrs;
+  double *drift;
 
-  for (i = 0; i < 3; i++) {
-    for (j = 0; j < 3; j++) {
-      for (k = 0; k < 3; k++) {
-	for (l = 0; l < 3; l++) {
-	  fc4[a * num_atom * num_atom * num_atom * 81 +
-	      b * num_atom * num_atom * 81 +
-	      c * num_atom * 81+
-	      d * 81 + i * 27 + j * 9 + k * 3 + l] =
-	    fc4_elem[i * 27 + j * 9 + k * 3 + l];
-	  fc4[a * num_atom * num_atom * num_atom * 81 +
-	      b * num_atom * num_atom * 81 +
-	      d * num_atom * 81+
-	      c * 81 + i * 27 + j * 9 + l * 3 + k] = 
-	    fc4_elem[i * 27 + j * 9 + k * 3 + l];
-	  fc4[a * num_atom * num_atom * num_atom * 81 +
-	      c * num_atom * num_atom * 81 +
-	      b * num_atom * 81+
-	      d * 81 + i * 27 + k * 9 + j * 3 + l] =
-	    fc4_elem[i * 27 + j * 9 + k * 3 + l];
-	  fc4[a * num_atom * num_atom * num_atom * 81 +
-	      c * num_atom * num_atom * 81 +
-	      d * num_atom * 81+
-	      b * 81 + i * 27 + k * 9 + l * 3 + j] = 
-	    fc4_elem[i * 27 + j * 9 + k * 3 + l];
-	  fc4[a * num_atom * num_atom * num_atom * 81 +
-	      d * num_atom * num_atom * 81 +
-	      b * num_atom * 81+
-	      c * 81 + i * 27 + l * 9 + j * 3 + k] =
-	    fc4_elem[i * 27 + j * 9 + k * 3 + l];
-	  fc4[a * num_atom * num_atom * num_atom * 81 +
-	      d * num_atom * num_atom * 81 +
-	      c * num_atom * 81+
-	      b * 81 + i * 27 + l * 9 + k * 3 + j] =
-	    fc4_elem[i * 27 + j * 9 + k * 3 + l];
-	  fc4[b * num_atom * num_atom * num_atom * 81 +
-	      a * num_atom * num_atom * 81 +
-	      c * num_atom * 81+
-	      d * 81 + j * 27 + i * 9 + k * 3 + l] =
-	    fc4_elem[i * 27 + j * 9 + k * 3 + l];
-	  fc4[b * num_atom * num_atom * num_atom * 81 +
-	      a * num_atom * num_atom * 81 +
-	      d * num_atom * 81+
-	      c * 81 + j * 27 + i * 9 + l * 3 + k] =
-	    fc4_elem[i * 27 + j * 9 + k * 3 + l];
-	  fc4[b * num_atom * num_atom * num_atom * 81 +
-	      c * num_atom * num_atom * 81 +
-	      a * num_atom * 81+
-	      d * 81 + j * 27 + k * 9 + i * 3 + l] =
-	    fc4_elem[i * 27 + j * 9 + k * 3 + l];
-	  fc4[b * num_atom * num_atom * num_atom * 81 +
-	      c * num_atom * num_atom * 81 +
-	      d * num_atom * 81+
-	      a * 81 + j * 27 + k * 9 + l * 3 + i] =
-	    fc4_elem[i * 27 + j * 9 + k * 3 + l];
-	  fc4[b * num_atom * num_atom * num_atom * 81 +
-	      d * num_atom * num_atom * 81 +
-	      a * num_atom * 81+
-	      c * 81 + j * 27 + l * 9 + i * 3 + k] =
-	    fc4_elem[i * 27 + j * 9 + k * 3 + l];
-	  fc4[b * num_atom * num_atom * num_atom * 81 +
-	      d * num_atom * num_atom * 81 +
-	      c * num_atom * 81+
-	      a * 81 + j * 27 + l * 9 + k * 3 + i] =
-	    fc4_elem[i * 27 + j * 9 + k * 3 + l];
-	  fc4[c * num_atom * num_atom * num_atom * 81 +
-	      a * num_atom * num_atom * 81 +
-	      b * num_atom * 81+
-	      d * 81 + k * 27 + i * 9 + j * 3 + l] =
-	    fc4_elem[i * 27 + j * 9 + k * 3 + l];
-	  fc4[c * num_atom * num_atom * num_atom * 81 +
-	      a * num_atom * num_atom * 81 +
-	      d * num_atom * 81+
-	      b * 81 + k * 27 + i * 9 + l * 3 + j] =
-	    fc4_elem[i * 27 + j * 9 + k * 3 + l];
-	  fc4[c * num_atom * num_atom * num_atom * 81 +
-	      b * num_atom * num_atom * 81 +
-	      a * num_atom * 81+
-	      d * 81 + k * 27 + j * 9 + i * 3 + l] =
-	    fc4_elem[i * 27 + j * 9 + k * 3 + l];
-	  fc4[c * num_atom * num_atom * num_atom * 81 +
-	      b * num_atom * num_atom * 81 +
-	      d * num_atom * 81+
-	      a * 81 + k * 27 + j * 9 + l * 3 + i] =
-	    fc4_elem[i * 27 + j * 9 + k * 3 + l];
-	  fc4[c * num_atom * num_atom * num_atom * 81 +
-	      d * num_atom * num_atom * 81 +
-	      a * num_atom * 81+
-	      b * 81 + k * 27 + l * 9 + i * 3 + j] =
-	    fc4_elem[i * 27 + j * 9 + k * 3 + l];
-	  fc4[c * num_atom * num_atom * num_atom * 81 +
-	      d * num_atom * num_atom * 81 +
-	      b * num_atom * 81+
-	      a * 81 + k * 27 + l * 9 + j * 3 + i] =
-	    fc4_elem[i * 27 + j * 9 + k * 3 + l];
-	  fc4[d * num_atom * num_atom * num_atom * 81 +
-	      a * num_atom * num_atom * 81 +
-	      b * num_atom * 81+
-	      c * 81 + l * 27 + i * 9 + j * 3 + k] =
-	    fc4_elem[i * 27 + j * 9 + k * 3 + l];
-	  fc4[d * num_atom * num_atom * num_atom * 81 +
-	      a * num_atom * num_atom * 81 +
-	      c * num_atom * 81+
-	      b * 81 + l * 27 + i * 9 + k * 3 + j] =
-	    fc4_elem[i * 27 + j * 9 + k * 3 + l];
-	  fc4[d * num_atom * num_atom * num_atom * 81 +
-	      b * num_atom * num_atom * 81 +
-	      a * num_atom * 81+
-	      c * 81 + l * 27 + j * 9 + i * 3 + k] =
-	    fc4_elem[i * 27 + j * 9 + k * 3 + l];
-	  fc4[d * num_atom * num_atom * num_atom * 81 +
-	      b * num_atom * num_atom * 81 +
-	      c * num_atom * 81+
-	      a * 81 + l * 27 + j * 9 + k * 3 + i] =
-	    fc4_elem[i * 27 + j * 9 + k * 3 + l];
-	  fc4[d * num_atom * num_atom * num_atom * 81 +
-	      c * num_atom * num_atom * 81 +
-	      a * num_atom * 81+
-	      b * 81 + l * 27 + k * 9 + i * 3 + j] =
-	    fc4_elem[i * 27 + j * 9 + k * 3 + l];
-	  fc4[d * num_atom * num_atom * num_atom * 81 +
-	      c * num_atom * num_atom * 81 +
-	      b * num_atom * 81+
-	      a * 81 + l * 27 + k * 9 + j * 3 + i] =
-	   fc4_elem[i * 27 + j * 9 + k * 3 + l];
-	}
-      }
+  n = num_atom;
+  n2 = n * n * 81;
+  n3 = n * n * n * 81;
+  drift = (double*)malloc(sizeof(double) * n3);
+  get_drift_fc4_index(drift, fc4, n, index);
+
+#pragma omp parallel for private(i, j, k, l, m)
+  for (adrs = 0; adrs < n * n3; adrs += 81) {
+    i = adrs / n3;
+    j = (adrs / n2) % n;
+    k = (adrs / (n * 81)) % n;
+    l = (adrs / 81) % n;
+    switch (index) {
+    case 0:
+      i = j;
+      j = k;
+      k = l;
+      break;
+    case 1:
+      j = k;
+      k = l;
+      break;
+    case 2:
+      k = l;
+      break;
+    }
+    for (m = 0; m < 81; m++) {
+      fc4[adrs + m] -= drift[((i * n + j) * n + k) * 81 + m] / n;
     }
   }
+
+  free(drift);
 }
 
-static void set_permutation_symmetry_fc4_elem(double *fc4_elem,
-					      const double *fc4,
-					      const int a,
-					      const int b,
-					      const int c,
-					      const int d,
-					      const int num_atom)
+/* Orbits of atom quartets under index permutations are averaged in */
+/* place as for fc3 (see set_permutation_symmetry_fc3). */
+void set_permutation_symmetry_fc4(double *fc4, const int num_atom)
 {
-  int i, j, k, l;
+  int i, j, k, l, m, ij;
+  int atoms[4];
+  int atom_perms[24][4], cart_perms[24][81];
+  long adrs[24];
 
-  for (i = 0; i < 3; i++) {
-    for (j = 0; j < 3; j++) {
-      for (k = 0; k < 3; k++) {
-	for (l = 0; l < 3; l++) {
-	  fc4_elem[i * 27 + j * 9 + k * 3 + l] =
-	    (fc4[a * num_atom * num_atom * num_atom * 81 +
-		 b * num_atom * num_atom * 81 +
-		 c * num_atom * 81+
-		 d * 81 + i * 27 + j * 9 + k * 3 + l] +
-	     fc4[a * num_atom * num_atom * num_atom * 81 +
-		 b * num_atom * num_atom * 81 +
-		 d * num_atom * 81+
-		 c * 81 + i * 27 + j * 9 + l * 3 + k] +
-	     fc4[a * num_atom * num_atom * num_atom * 81 +
-		 c * num_atom * num_atom * 81 +
-		 b * num_atom * 81+
-		 d * 81 + i * 27 + k * 9 + j * 3 + l] +
-	     fc4[a * num_atom * num_atom * num_atom * 81 +
-		 c * num_atom * num_atom * 81 +
-		 d * num_atom * 81+
-		 b * 81 + i * 27 + k * 9 + l * 3 + j] +
-	     fc4[a * num_atom * num_atom * num_atom * 81 +
-		 d * num_atom * num_atom * 81 +
-		 b * num_atom * 81+
-		 c * 81 + i * 27 + l * 9 + j * 3 + k] +
-	     fc4[a * num_atom * num_atom * num_atom * 81 +
-		 d * num_atom * num_atom * 81 +
-		 c * num_atom * 81+
-		 b * 81 + i * 27 + l * 9 + k * 3 + j] +
-	     fc4[b * num_atom * num_atom * num_atom * 81 +
-		 a * num_atom * num_atom * 81 +
-		 c * num_atom * 81+
-		 d * 81 + j * 27 + i * 9 + k * 3 + l] +
-	     fc4[b * num_atom * num_atom * num_atom * 81 +
-		 a * num_atom * num_atom * 81 +
-		 d * num_atom * 81+
-		 c * 81 + j * 27 + i * 9 + l * 3 + k] +
-	     fc4[b * num_atom * num_atom * num_atom * 81 +
-		 c * num_atom * num_atom * 81 +
-		 a * num_atom * 81+
-		 d * 81 + j * 27 + k * 9 + i * 3 + l] +
-	     fc4[b * num_atom * num_atom * num_atom * 81 +
-		 c * num_atom * num_atom * 81 +
-		 d * num_atom * 81+
-		 a * 81 + j * 27 + k * 9 + l * 3 + i] +
-	     fc4[b * num_atom * num_atom * num_atom * 81 +
-		 d * num_atom * num_atom * 81 +
-		 a * num_atom * 81+
-		 c * 81 + j * 27 + l * 9 + i * 3 + k] +
-	     fc4[b * num_atom * num_atom * num_atom * 81 +
-		 d * num_atom * num_atom * 81 +
-		 c * num_atom * 81+
-		 a * 81 + j * 27 + l * 9 + k * 3 + i] +
-	     fc4[c * num_atom * num_atom * num_atom * 81 +
-		 a * num_atom * num_atom * 81 +
-		 b * num_atom * 81+
-		 d * 81 + k * 27 + i * 9 + j * 3 + l] +
-	     fc4[c * num_atom * num_atom * num_atom * 81 +
-		 a * num_atom * num_atom * 81 +
-		 d * num_atom * 81+
-		 b * 81 + k * 27 + i * 9 + l * 3 + j] +
-	     fc4[c * num_atom * num_atom * num_atom * 81 +
-		 b * num_atom * num_atom * 81 +
-		 a * num_atom * 81+
-		 d * 81 + k * 27 + j * 9 + i * 3 + l] +
-	     fc4[c * num_atom * num_atom * num_atom * 81 +
-		 b * num_atom * num_atom * 81 +
-		 d * num_atom * 81+
-		 a * 81 + k * 27 + j * 9 + l * 3 + i] +
-	     fc4[c * num_atom * num_atom * num_atom * 81 +
-		 d * num_atom * num_atom * 81 +
-		 a * num_atom * 81+
-		 b * 81 + k * 27 + l * 9 + i * 3 + j] +
-	     fc4[c * num_atom * num_atom * num_atom * 81 +
-		 d * num_atom * num_atom * 81 +
-		 b * num_atom * 81+
-		 a * 81 + k * 27 + l * 9 + j * 3 + i] +
-	     fc4[d * num_atom * num_atom * num_atom * 81 +
-		 a * num_atom * num_atom * 81 +
-		 b * num_atom * 81+
-		 c * 81 + l * 27 + i * 9 + j * 3 + k] +
-	     fc4[d * num_atom * num_atom * num_atom * 81 +
-		 a * num_atom * num_atom * 81 +
-		 c * num_atom * 81+
-		 b * 81 + l * 27 + i * 9 + k * 3 + j] +
-	     fc4[d * num_atom * num_atom * num_atom * 81 +
-		 b * num_atom * num_atom * 81 +
-		 a * num_atom * 81+
-		 c * 81 + l * 27 + j * 9 + i * 3 + k] +
-	     fc4[d * num_atom * num_atom * num_atom * 81 +
-		 b * num_atom * num_atom * 81 +
-		 c * num_atom * 81+
-		 a * 81 + l * 27 + j * 9 + k * 3 + i] +
-	     fc4[d * num_atom * num_atom * num_atom * 81 +
-		 c * num_atom * num_atom * 81 +
-		 a * num_atom * 81+
-		 b * 81 + l * 27 + k * 9 + i * 3 + j] +
-	     fc4[d * num_atom * num_atom * num_atom * 81 +
-		 c * num_atom * num_atom * 81 +
-		 b * num_atom * 81+
-		 a * 81 + l * 27 + k * 9 + j * 3 + i]) / 24;
+  set_index_permutations(atom_perms[0], cart_perms[0], 4);
+
+#pragma omp parallel for schedule(dynamic) private(i, j, k, l, m, atoms, adrs)
+  for (ij = 0; ij < num_atom * num_atom; ij++) {
+    i = ij / num_atom;
+    j = ij % num_atom;
+    if (j < i) {
+      continue;
+    }
+    atoms[0] = i;
+    atoms[1] = j;
+    for (k = j; k < num_atom; k++) {
+      atoms[2] = k;
+      for (l = k; l < num_atom; l++) {
+	atoms[3] = l;
+	for (m = 0; m < 24; m++) {
+	  adrs[m] = ((((long)atoms[atom_perms[m][0]] * num_atom +
+		       atoms[atom_perms[m][1]]) * num_atom +
+		      atoms[atom_perms[m][2]]) * num_atom +
+		     atoms[atom_perms[m][3]]) * 81;
 	}
+	symmetrize_permuted_elems(fc4, adrs, cart_perms[0], 24, 81);
       }
     }
   }
 }
-				  
 
 void get_drift_fc4(double *drifts_out, const double *fc4, const int num_atom)
 {
-  int i, j, k, l, index;
-  double drift;
-  double max_drift[81];
-  
-
-  for (index = 0; index < 4; index++) {
-    for (i = 0; i < 81; i++) {
-      max_drift[i] = 0;
-    }
+  long i, n3;
+  int index;
+  double *drift;
 
-#pragma omp parallel for private(j, k, l, drift)
-    for (i = 0; i < 81; i++) {
-      for (j = 0; j < num_atom; j++) {
-	for (k = 0; k < num_atom; k++) {
-	  for (l = 0; l < num_atom; l++) {
-	    drift = get_drift_fc4_elem(fc4, num_atom, i, j, k, l, index);
-	    if (fabs(max_drift[i]) < fabs(drift)) {
-	      max_drift[i] = drift;
-	    }
-	  }
-	}
-      }
-    }
+  n3 = (long)num_atom * num_atom * num_atom * 81;
+  drift = (double*)malloc(sizeof(double) * n3);
 
-    drift = 0;
-    for (i = 0; i < 81; i++) {
-      if (fabs(drift) < fabs(max_drift[i])) {
-	drift = max_drift[i];
+  for (index = 0; index < 4; index++) {
+    get_drift_fc4_index(drift, fc4, num_atom, index);
+    drifts_out[index] = 0;
+    for (i = 0; i < n3; i++) {
+      if (fabs(drifts_out[index]) < fabs(drift[i])) {
+	drifts_out[index] = drift[i];
       }
     }
-    drifts_out[index] = drift;
   }
+
+  free(drift);
 }
 
-static double get_drift_fc4_elem(const double *fc4,
-				 const int num_atom,
-				 const int i,
-				 const int j,
-				 const int k,
-				 const int l,
-				 const int index)
+/* drift[n, n, n, 81]: sums of fc4 along 'index' in order of the other */
+/* indices. Each thread owns an atom of the output and streams the */
+/* contiguous blocks of fc4 that contribute to it. */
+static void get_drift_fc4_index(double *drift,
+				const double *fc4,
+				const long num_atom,
+				const int index)
 {
-  double sum;
-  int m;
-  
-  sum = 0;
-  for (m = 0; m < num_atom; m++) {
-    switch (index) {
-    case 0:
-      sum += fc4[m * num_atom * num_atom * num_atom * 81 +
-		 j * num_atom * num_atom * 81 +
-		 k * num_atom * 81 +
-		 l * 81 + i];
-      break;
-    case 1:
-      sum += fc4[j * num_atom * num_atom * num_atom * 81 +
-		 m * num_atom * num_atom * 81 +
-		 k * num_atom * 81 +
-		 l * 81 + i];
-      break;
-    case 2:
-      sum += fc4[j * num_atom * num_atom * num_atom * 81 +
-		 k * num_atom * num_atom * 81 +
-		 m * num_atom * 81 +			 
-		 l * 81 + i];
-      break;
-    case 3:
-      sum += fc4[j * num_atom * num_atom * num_atom * 81 +
-		 k * num_atom * num_atom * 81 +
-		 l * num_atom * 81 +
-		 m * 81 + i];
-      break;
-    }
-  }
+  long i, j, k, n, n2, n3;
+  double *drift_i;
+  const double *fc4_i;
 
-  return sum;
-}
-static void tensor4_roation(double *rot_tensor,
-			    const double *fc4,
-			    const int atom_i,
-			    const int atom_j,
-			    const int atom_k,
-			    const int atom_l,
-			    const int atom_rot_i,
-			    const int atom_rot_j,
-			    const int atom_rot_k,
-			    const int atom_rot_l,
-			    const int num_atom,
-			    const double *rot_cartesian)
-{
-  int i, j, k, l;
-  double tensor[81];
+  n = num_atom;
+  n2 = n * n * 81;
+  n3 = n * n * n * 81;
 
-  for (i = 0; i < 3; i++) {
-    for (j = 0; j < 3; j++) {
-      for (k = 0; k < 3; k++) {
-	for (l = 0; l < 3; l++) {
-	  tensor[i * 27 + j * 9 + k * 3 + l] =
-	    fc4[81 * num_atom * num_atom * num_atom * atom_rot_i +
-		81 * num_atom * num_atom * atom_rot_j +
-		81 * num_atom * atom_rot_k +
-		81 * atom_rot_l +
-		27 * i + 9 * j + 3 * k + l];
+  if (index == 0) {
+    /* drift[j, k, l] = sum_i fc4[i, j, k, l] */
+#pragma omp parallel for private(i, k, drift_i, fc4_i)
+    for (j = 0; j < n; j++) {
+      drift_i = drift + j * n2;
+      for (k = 0; k < n2; k++) {
+	drift_i[k] = 0;
+      }
+      for (i = 0; i < n; i++) {
+	fc4_i = fc4 + i * n3 + j * n2;
+	for (k = 0; k < n2; k++) {
+	  drift_i[k] += fc4_i[k];
 	}
       }
     }
+    return;
   }
 
-  for (i = 0; i < 3; i++) {
-    for (j = 0; j < 3; j++) {
-      for (k = 0; k < 3; k++) {
-  	for (l = 0; l < 3; l++) {
-  	  rot_tensor[i * 27 + j * 9 + k * 3 + l] =
-  	    tensor4_rotation_elem(tensor, rot_cartesian, i, j, k, l);
-  	}
+#pragma omp parallel for private(j, k, drift_i, fc4_i)
+  for (i = 0; i < n; i++) {
+    drift_i = drift + i * n2;
+    fc4_i = fc4 + i * n3;
+    for (k = 0; k < n2; k++) {
+      drift_i[k] = 0;
+    }
+    for (j = 0; j < n3; j++) {
+      switch (index) {
+      case 1: /* drift[i, k, l] = sum_j fc4[i, j, k, l] */
+	k = j % n2;
+	break;
+      case 2: /* drift[i, j, l] = sum_k fc4[i, j, k, l] */
+	k = (j / n2) * n * 81 + j % (n * 81);
+	break;
+      case 3: /* drift[i, j, k] = sum_l fc4[i, j, k, l] */
+	k = (j / (n * 81)) * 81 + j % 81;
+	break;
       }
+      drift_i[k] += fc4_i[j];
     }
   }
 }
 
-static double tensor4_rotation_elem(const double tensor[81],
-				    const double *r,
-				    const int m,
-				    const int n,
-				    const int p,
-				    const int q)
+/* drift_sum[n, n, 81]: sum of drift[n, n, n, 81] along 'axis' */
+static void sum_drift_fc4(double *drift_sum,
+			  const double *drift,
+			  const long num_atom,
+			  const int axis)
 {
-  int i, j, k, l;
-  double sum;
+  long i, j, k, n, n2;
 
-  sum = 0.0;
-  for (i = 0; i < 3; i++) {
-    for (j = 0; j < 3; j++) {
-      for (k = 0; k < 3; k++) {
-	for (l = 0; l < 3; l++) {
-	sum += r[m * 3 + i] * r[n * 3 + j] * r[p * 3 + k] * r[q * 3 + l] *
-	  tensor[i * 27 + j * 9 + k * 3 + l];
-	}
+  n = num_atom;
+  n2 = n * n * 81;
+
+#pragma omp parallel for private(j, k)
+  for (i = 0; i < n2; i++) {
+    drift_sum[i] = 0;
+    for (j = 0; j < n; j++) {
+      switch (axis) {
+      case 0:
+	k = j * n2 + i;
+	break;
+      case 1:
+	k = (i / (n * 81)) * n2 + j * n * 81 + i % (n * 81);
+	break;
+      default:
+	k = (i / 81) * n * 81 + j * 81 + i % 81;
+	break;
       }
+      drift_sum[i] += drift[k];
     }
   }
-  return sum;
 }
-
@@ -6,22 +6,32 @@
 #include "phonon4_h/frequency_shift.h"
 #include "phonon4_h/real_to_reciprocal.h"
 
-static void get_fc4_normal_for_frequency_shift_at_gp
-(double *fc4_normal_real,
- const double *frequencies,
- const lapack_complex_double *eigenvectors,
- const int grid_point0,
- const int grid_point1,
- const int *grid_address,
- const int *mesh,
- const double *fc4,
- const Darray *shortest_vectors,
- const Iarray *multiplicity,
- const double *masses,
- const int *p2s_map,
- const int *s2p_map,
- const Iarray *band_indices,
- const double cutoff_frequency);
+static void set_fc4_q0(double *fc4_q0,
+		       const lapack_complex_double *eigvecs0,
+		       const double q[12],
+		       const double *fc4,
+		       const Darray *shortest_vectors,
+		       const Iarray *multiplicity,
+		       const double *masses,
+		       const int *p2s_map,
+		       const int *s2pp_map,
+		       const int *band_indices,
+		       const int num_band0);
+static void set_fc4_normal_at_q1(double *fc4_normal_real,
+				 double *fc2_q0,
+				 double *work,
+				 const double *fc4_q0,
+				 const double *freqs0,
+				 const double *freqs1,
+				 const lapack_complex_double *eigvecs1,
+				 const double q[12],
+				 const Darray *shortest_vectors,
+				 const Iarray *multiplicity,
+				 const double *masses,
+				 const int *s2pp_map,
+				 const int *band_indices,
+				 const int num_band0,
+				 const double cutoff_frequency);
 static lapack_complex_double fc4_sum(const int bi0,
 				     const int bi1,
 				     const lapack_complex_double *eigvecs0,
@@ -44,30 +54,38 @@ void get_fc4_frequency_shifts(double *frequency_shifts,
 			      const int num_band,
 			      const double unit_conversion_factor)
 {
-  int i, j, k, l;
-  double shift, num_phonon;
+  int i, j, k, l, num_gp, num_temp;
+  double shift, *occupations;
+  const double *occ, *fc4_normal;
 
+  num_gp = grid_points1->dims[0];
+  num_temp = temperatures->dims[0];
+  occupations = (double*)malloc(sizeof(double) * num_gp * num_band * num_temp);
+  get_bose_einstein_table(occupations,
+			  frequencies,
+			  grid_points1->data,
+			  num_gp,
+			  num_band,
+			  temperatures->data,
+			  num_temp);
 
-  for (i = 0; i < temperatures->dims[0]; i++) {
-    for (j = 0; j < num_band0; j++) {
-      shift = 0;
-#pragma omp parallel for reduction(+:shift) private(k, l, num_phonon)
-      for (k = 0; k < grid_points1->dims[0]; k++) {
-	for (l = 0; l < num_band; l++) {
-	  if (temperatures->data[i] > 0) {
-	    num_phonon = 2 *
-	      bose_einstein(frequencies[grid_points1->data[k] * num_band + l],
-			    temperatures->data[i]) + 1;
-	  } else {
-	    num_phonon = 1;
-	  }
-	  shift += unit_conversion_factor * fc4_normal_real
-	    [k * num_band0 * num_band + j * num_band + l] * num_phonon;
-	}
+  /* frequency_shifts[T, j] = */
+  /*   sum_{k, l} fc4_normal_real[k, j, l] (2 n[k, l, T] + 1) */
+#pragma omp parallel for private(i, j, k, l, shift, occ, fc4_normal)
+  for (i = 0; i < num_temp * num_band0; i++) {
+    j = i % num_band0;
+    shift = 0;
+    for (k = 0; k < num_gp; k++) {
+      fc4_normal = fc4_normal_real + (k * num_band0 + j) * num_band;
+      occ = occupations + k * num_band * num_temp + i / num_band0;
+      for (l = 0; l < num_band; l++) {
+	shift += fc4_normal[l] * (2 * occ[l * num_temp] + 1);
       }
-      frequency_shifts[i * num_band0 + j] = shift;
-    }    
+    }
+    frequency_shifts[i] = unit_conversion_factor * shift;
   }
+
+  free(occupations);
 }
 
 void
@@ -87,31 +105,78 @@ get_fc4_normal_for_frequency_shift(double *fc4_normal_real,
 				   const Iarray *band_indicies,
 				   const double cutoff_frequency)
 {
-  int i, num_atom, num_band, num_band0;
+  int i, j, num_patom, num_satom, num_band, num_band0;
+  int *s2pp_map;
+  double q[12], *fc4_q0, *fc2_q0, *work;
 
-  num_atom = multiplicity->dims[1];
-  num_band = num_atom * 3;
+  num_patom = multiplicity->dims[1];
+  num_satom = multiplicity->dims[0];
+  num_band = num_patom * 3;
   num_band0 = band_indicies->dims[0];
 
-#pragma omp parallel for private(i)
-  for (i = 0; i < grid_points1->dims[0]; i++) {
-    get_fc4_normal_for_frequency_shift_at_gp(fc4_normal_real +
-					     i * num_band0 * num_band,
-					     frequencies,
-					     eigenvectors,
-					     grid_point0,
-					     grid_points1->data[i],
-					     grid_address,
-					     mesh,
-					     fc4,
-					     shortest_vectors,
-					     multiplicity,
-					     masses,
-					     p2s_map,
-					     s2p_map,
-					     band_indicies,
-					     cutoff_frequency);
+  s2pp_map = (int*)malloc(sizeof(int) * num_satom);
+  for (i = 0; i < num_satom; i++) {
+    for (j = 0; j < num_patom; j++) {
+      if (s2p_map[i] == p2s_map[j]) {
+	s2pp_map[i] = j;
+	break;
+      }
+    }
+  }
+
+  for (i = 0; i < 3; i++) {
+    q[i + 3] = (double)grid_address[grid_point0 * 3 + i] / mesh[i];
+    q[i] = -q[i + 3];
   }
+
+  fc4_q0 = (double*)malloc(sizeof(double) * num_band0 * num_patom *
+			   num_satom * num_satom * 18);
+  set_fc4_q0(fc4_q0,
+	     eigenvectors + grid_point0 * num_band * num_band,
+	     q,
+	     fc4,
+	     shortest_vectors,
+	     multiplicity,
+	     masses,
+	     p2s_map,
+	     s2pp_map,
+	     band_indicies->data,
+	     num_band0);
+
+#pragma omp parallel private(j, fc2_q0, work) firstprivate(q)
+  {
+    fc2_q0 = (double*)malloc(sizeof(double) * num_band * num_band * 2);
+    work = (double*)malloc(sizeof(double) *
+			   (num_band * num_band + num_patom * num_satom * 2) * 2);
+#pragma omp for
+    for (i = 0; i < grid_points1->dims[0]; i++) {
+      for (j = 0; j < 3; j++) {
+	q[j + 6] = (double)grid_address[grid_points1->data[i] * 3 + j] / mesh[j];
+	q[j + 9] = -q[j + 6];
+      }
+      set_fc4_normal_at_q1(fc4_normal_real + i * num_band0 * num_band,
+			   fc2_q0,
+			   work,
+			   fc4_q0,
+			   frequencies + grid_point0 * num_band,
+			   frequencies + grid_points1->data[i] * num_band,
+			   eigenvectors +
+			   grid_points1->data[i] * num_band * num_band,
+			   q,
+			   shortest_vectors,
+			   multiplicity,
+			   masses,
+			   s2pp_map,
+			   band_indicies->data,
+			   num_band0,
+			   cutoff_frequency);
+    }
+    free(fc2_q0);
+    free(work);
+  }
+
+  free(fc4_q0);
+  free(s2pp_map);
 }
 
 
@@ -211,69 +276,201 @@ void reciprocal_to_normal4(lapack_complex_double *fc4_normal,
   }
 }
 
-static void get_fc4_normal_for_frequency_shift_at_gp
-(double *fc4_normal_real,
- const double *frequencies,
- const lapack_complex_double *eigenvectors,
- const int grid_point0,
- const int grid_point1,
- const int *grid_address,
- const int *mesh,
- const double *fc4,
- const Darray *shortest_vectors,
- const Iarray *multiplicity,
- const double *masses,
- const int *p2s_map,
- const int *s2p_map,
- const Iarray *band_indices,
- const double cutoff_frequency)
+/* fc4 contracted with the phonon of q0 in its first two indices */
+/* fc4_q0[band0, a, K, L, p, q] (complex) = */
+/*   sum_{J, m, n} e0[a, m]^* e0[J, n] exp(iq0.r_J) */
+/*     fc4[a, J, K, L, m, n, p, q] / sqrt(m_a m_J) */
+/* where a is an atom in primitive cell. This is independent of q1, */
+/* so fc4 is read only once per q0. */
+static void set_fc4_q0(double *fc4_q0,
+		       const lapack_complex_double *eigvecs0,
+		       const double q[12],
+		       const double *fc4,
+		       const Darray *shortest_vectors,
+		       const Iarray *multiplicity,
+		       const double *masses,
+		       const int *p2s_map,
+		       const int *s2pp_map,
+		       const int *band_indices,
+		       const int num_band0)
 {
-  int i, num_atom, num_band, num_band0;
-  lapack_complex_double *fc4_reciprocal, *fc4_normal;
-  double q[12];
+  long i, j, k, l, a, m, n, num_patom, num_satom, num_band, adrs;
+  double *u, *g;
+  const double *f;
+  lapack_complex_double phase, e0, e1;
 
-  num_atom = multiplicity->dims[1];
-  num_band = num_atom * 3;
-  num_band0 = band_indices->dims[0];
+  num_patom = multiplicity->dims[1];
+  num_satom = multiplicity->dims[0];
+  num_band = num_patom * 3;
 
-  fc4_reciprocal = (lapack_complex_double*)
-    malloc(sizeof(lapack_complex_double) *
-	   num_atom * num_atom * num_atom * num_atom * 81);
-  fc4_normal = (lapack_complex_double*)
-    malloc(sizeof(lapack_complex_double) * num_band0 * num_band);
+  /* u[band0, a, J, m, n] = e0[a, m]^* e0[J, n] exp(iq0.r_J) / sqrt(m_a m_J) */
+  u = (double*)malloc(sizeof(double) * num_band0 * num_patom * num_satom * 18);
+#pragma omp parallel for private(i, j, m, n, phase, e0, e1, adrs)
+  for (a = 0; a < num_patom; a++) {
+    for (j = 0; j < num_satom; j++) {
+      phase = get_phase_factor(q, shortest_vectors, multiplicity, a, j, 1);
+      for (i = 0; i < num_band0; i++) {
+	for (m = 0; m < 3; m++) {
+	  e0 = eigvecs0[(a * 3 + m) * num_band + band_indices[i]];
+	  e0 = lapack_make_complex_double(lapack_complex_double_real(e0),
+					  -lapack_complex_double_imag(e0));
+	  e0 = phonoc_complex_prod(e0, phase);
+	  for (n = 0; n < 3; n++) {
+	    e1 = phonoc_complex_prod
+	      (e0, eigvecs0[(s2pp_map[j] * 3 + n) * num_band + band_indices[i]]);
+	    adrs = (((i * num_patom + a) * num_satom + j) * 9 + m * 3 + n) * 2;
+	    u[adrs] = lapack_complex_double_real(e1) /
+	      sqrt(masses[a] * masses[s2pp_map[j]]);
+	    u[adrs + 1] = lapack_complex_double_imag(e1) /
+	      sqrt(masses[a] * masses[s2pp_map[j]]);
+	  }
+	}
+      }
+    }
+  }
 
-  for (i = 0; i < 3; i++) {
-    q[i + 3] = (double)grid_address[grid_point0 * 3 + i] / mesh[i];
-    q[i] = -q[i + 3];
-    q[i + 6] = (double)grid_address[grid_point1 * 3 + i] / mesh[i];
-    q[i + 9] = -q[i + 6];
+  /* Each thread owns fc4_q0[:, a, K] and streams fc4[a, :, K]. */
+#pragma omp parallel for private(a, i, j, k, l, m, n, g, f, adrs)
+  for (k = 0; k < num_patom * num_satom; k++) {
+    a = k / num_satom;
+    for (i = 0; i < num_band0; i++) {
+      g = fc4_q0 + ((i * num_patom + a) * num_satom + k % num_satom) *
+	num_satom * 18;
+      for (l = 0; l < num_satom * 18; l++) {
+	g[l] = 0;
+      }
+      for (j = 0; j < num_satom; j++) {
+	adrs = ((i * num_patom + a) * num_satom + j) * 18;
+	f = fc4 + (((p2s_map[a] * num_satom + j) * num_satom + k % num_satom) *
+		   num_satom) * 81;
+	for (l = 0; l < num_satom; l++) {
+	  for (m = 0; m < 9; m++) {
+	    for (n = 0; n < 9; n++) {
+	      g[(l * 9 + n) * 2] += u[adrs + m * 2] * f[l * 81 + m * 9 + n];
+	      g[(l * 9 + n) * 2 + 1] +=
+		u[adrs + m * 2 + 1] * f[l * 81 + m * 9 + n];
+	    }
+	  }
+	}
+      }
+    }
   }
-    
-  real_to_reciprocal4(fc4_reciprocal,
-		      q,
-		      fc4,
-		      shortest_vectors,
-		      multiplicity,
-		      p2s_map,
-		      s2p_map);
-  reciprocal_to_normal4(fc4_normal,
-			fc4_reciprocal,
-			frequencies + grid_point0 * num_band,
-			frequencies + grid_point1 * num_band,
-			eigenvectors + grid_point0 * num_band * num_band,
-			eigenvectors + grid_point1 * num_band * num_band,
-			masses,
-			band_indices->data,
-			num_band0,
-			num_band,
-			cutoff_frequency);
-  
-  for (i = 0; i < num_band0 * num_band; i++) {
-    fc4_normal_real[i] = lapack_complex_double_real(fc4_normal[i]);
+
+  free(u);
+}
+
+/* fc4_normal_real[band0, j] = */
+/*   Re sum e1[c, p, j] e1[d, q, j]^* fc2_q0[c, p, d, q] / f0 / f1 */
+/* with the effective fc2 for each band0 */
+/* fc2_q0[c, p, d, q] = sum_{a, K in c, L in d} exp(iq1.r_K) */
+/*   exp(-iq1.r_L) fc4_q0[band0, a, K, L, p, q] / sqrt(m_c m_d). */
+/* fc2_q0 and work are buffers of the calling thread. */
+static void set_fc4_normal_at_q1(double *fc4_normal_real,
+				 double *fc2_q0,
+				 double *work,
+				 const double *fc4_q0,
+				 const double *freqs0,
+				 const double *freqs1,
+				 const lapack_complex_double *eigvecs1,
+				 const double q[12],
+				 const Darray *shortest_vectors,
+				 const Iarray *multiplicity,
+				 const double *masses,
+				 const int *s2pp_map,
+				 const int *band_indices,
+				 const int num_band0,
+				 const double cutoff_frequency)
+{
+  long i, j, k, l, a, c, d, num_patom, num_satom, num_band, adrs;
+  double *phases, *x, ph_r, ph_i, re, im, sum;
+  const double *g;
+  lapack_complex_double phase;
+
+  num_patom = multiplicity->dims[1];
+  num_satom = multiplicity->dims[0];
+  num_band = num_patom * 3;
+  x = work;
+  phases = work + num_band * num_band * 2;
+
+  /* phases[0, a, K] = exp(iq1.r_K), phases[1, a, L] = exp(-iq1.r_L) */
+  for (a = 0; a < num_patom; a++) {
+    for (k = 0; k < num_satom; k++) {
+      for (l = 0; l < 2; l++) {
+	phase = get_phase_factor(q, shortest_vectors, multiplicity,
+				 a, k, l + 2);
+	adrs = ((l * num_patom + a) * num_satom + k) * 2;
+	phases[adrs] = lapack_complex_double_real(phase);
+	phases[adrs + 1] = lapack_complex_double_imag(phase);
+      }
+    }
   }
 
-  free(fc4_reciprocal);
-  free(fc4_normal);
+  for (i = 0; i < num_band0; i++) {
+    for (j = 0; j < num_band; j++) {
+      fc4_normal_real[i * num_band + j] = 0;
+    }
+    if (freqs0[band_indices[i]] <= cutoff_frequency) {
+      continue;
+    }
+
+    for (j = 0; j < num_band * num_band * 2; j++) {
+      fc2_q0[j] = 0;
+    }
+    for (a = 0; a < num_patom; a++) {
+      for (k = 0; k < num_satom; k++) {
+	c = s2pp_map[k];
+	for (l = 0; l < num_satom; l++) {
+	  d = s2pp_map[l];
+	  adrs = (a * num_satom + k) * 2;
+	  re = phases[adrs];
+	  im = phases[adrs + 1];
+	  adrs = ((num_patom + a) * num_satom + l) * 2;
+	  ph_r = re * phases[adrs] - im * phases[adrs + 1];
+	  ph_i = re * phases[adrs + 1] + im * phases[adrs];
+	  g = fc4_q0 + (((i * num_patom + a) * num_satom + k) * num_satom + l) * 18;
+	  for (j = 0; j < 9; j++) {
+	    adrs = ((c * 3 + j / 3) * num_band + d * 3 + j % 3) * 2;
+	    fc2_q0[adrs] += ph_r * g[j * 2] - ph_i * g[j * 2 + 1];
+	    fc2_q0[adrs + 1] += ph_r * g[j * 2 + 1] + ph_i * g[j * 2];
+	  }
+	}
+      }
+    }
+
+    /* x[y, j] = sum_z fc2_q0[y, z] e1[z, j]^* / sqrt(m_y m_z) */
+    for (k = 0; k < num_band; k++) {
+      for (j = 0; j < num_band; j++) {
+	re = 0;
+	im = 0;
+	for (l = 0; l < num_band; l++) {
+	  adrs = (k * num_band + l) * 2;
+	  ph_r = lapack_complex_double_real(eigvecs1[l * num_band + j]);
+	  ph_i = -lapack_complex_double_imag(eigvecs1[l * num_band + j]);
+	  re += (fc2_q0[adrs] * ph_r - fc2_q0[adrs + 1] * ph_i) /
+	    sqrt(masses[l / 3]);
+	  im += (fc2_q0[adrs] * ph_i + fc2_q0[adrs + 1] * ph_r) /
+	    sqrt(masses[l / 3]);
+	}
+	x[(k * num_band + j) * 2] = re / sqrt(masses[k / 3]);
+	x[(k * num_band + j) * 2 + 1] = im / sqrt(masses[k / 3]);
+      }
+    }
+
+    for (j = 0; j < num_band; j++) {
+      if (freqs1[j] <= cutoff_frequency) {
+	continue;
+      }
+      sum = 0;
+      for (k = 0; k < num_band; k++) {
+	sum += (lapack_complex_double_real(eigvecs1[k * num_band + j]) *
+		x[(k * num_band + j) * 2] -
+		lapack_complex_double_imag(eigvecs1[k * num_band + j]) *
+		x[(k * num_band + j) * 2 + 1]);
+      }
+      fc4_normal_real[i * num_band + j] =
+	sum / freqs0[band_indices[i]] / freqs1[j];
+    }
+  }
 }
 
 static lapack_complex_double fc4_sum(const int bi0,
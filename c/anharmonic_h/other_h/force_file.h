@@ -0,0 +1,9 @@
+#ifndef __force_file_H__
+#define __force_file_H__
+
+int read_force_blocks(double *forces,
+		      const char *filename,
+		      const int num_atom,
+		      const int num_disp);
+
+#endif
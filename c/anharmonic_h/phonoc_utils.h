@@ -65,6 +65,13 @@ lapack_complex_double get_phase_factor(const double q[],
 				       const int si,
 				       const int qi);
 double bose_einstein(const double x, const double t);
+void get_bose_einstein_table(double *occupations,
+			     const double *frequencies,
+			     const int *grid_points,
+			     const int num_grid_points,
+			     const int num_band,
+			     const double *temperatures,
+			     const int num_temp);
 double gaussian(const double x, const double sigma);
 double inv_sinh_occupation(const double x, const double t);
 
@@ -3,13 +3,47 @@
 
 void distribute_fc3(double *fc3_copy,
 		    const double *fc3,
-		    const int third_atom,
+		    const int target,
+		    const int source,
 		    const int *atom_mapping,
 		    const int num_atom,
 		    const double *rot_cart);
+void distribute_sparse_fc3(double *values,
+			   const int *triplets,
+			   const int num_triplets,
+			   const double *fc3,
+			   const int target,
+			   const int source,
+			   const int *atom_mapping,
+			   const int num_atom,
+			   const double *rot_cart);
 void tensor3_rotation(double *rot_tensor,
 		      const double *tensor,
 		      const double *rot_cartesian);
+void tensor4_rotation(double *rot_tensor,
+		      const double *tensor,
+		      const double *rot_cartesian);
 void set_permutation_symmetry_fc3(double *fc3, const int num_atom);
+void set_index_permutations(int *atom_perms, int *cart_perms, const int rank);
+void symmetrize_permuted_elems(double *fc,
+			       const long *adrs,
+			       const int *cart_perms,
+			       const int num_perms,
+			       const int num_elems);
+void set_permutation_symmetry_compact_fc3(double *fc3,
+					  const int *p2s,
+					  const int *s2pp,
+					  const int *trans,
+					  const int *perms,
+					  const int num_patom,
+					  const int num_satom);
+void set_permutation_symmetry_sparse_fc3(double *values,
+					 const int *triplets,
+					 const int num_triplets,
+					 const int *p2s,
+					 const int *s2pp,
+					 const int *trans,
+					 const int *perms,
+					 const int num_satom);
 
 #endif
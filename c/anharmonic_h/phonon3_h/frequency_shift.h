@@ -1,7 +1,32 @@
 #ifndef __frequency_shift_H__
 #define __frequency_shift_H__
 
-#include <lapacke.h>
 #include "phonoc_array.h"
 
+void get_frequency_shift_at_bands(double *frequency_shifts,
+				  const Darray *fc3_normal_squared,
+				  const int *band_indices,
+				  const double *frequencies,
+				  const int *grid_point_triplets,
+				  const int *triplet_weights,
+				  const double *epsilons,
+				  const int num_epsilon,
+				  const double *temperatures,
+				  const int num_temp,
+				  const double unit_conversion_factor,
+				  const double cutoff_frequency);
+void get_frequency_shift(double *frequency_shifts,
+			 const Darray *fc3_normal_squared,
+			 const double *frequency_points,
+			 const int num_fpoints,
+			 const double *frequencies,
+			 const int *grid_point_triplets,
+			 const int *triplet_weights,
+			 const double *epsilons,
+			 const int num_epsilon,
+			 const double *temperatures,
+			 const int num_temp,
+			 const double unit_conversion_factor,
+			 const double cutoff_frequency);
+
 #endif
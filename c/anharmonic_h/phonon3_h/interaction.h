@@ -10,6 +10,7 @@ void get_interaction(Darray *fc3_normal_squared,
 		     const int *grid_address,
 		     const int *mesh,
 		     const Darray *fc3,
+		     const Iarray *fc3_triplets,
 		     const Darray *shortest_vectors,
 		     const Iarray *multiplicity,
 		     const double *masses,
@@ -7,6 +7,7 @@
 void real_to_reciprocal(lapack_complex_double *fc3_reciprocal,
 			const double q[9],
 			const Darray *fc3,
+			const Iarray *fc3_triplets,
 			const Darray *shortest_vectors,
 			const Iarray *multiplicity,
 			const int *p2s_map,
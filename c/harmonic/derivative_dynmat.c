@@ -1,26 +1,13 @@
 #include <math.h>
 #include <stdlib.h>
+#include "derivative_dynmat.h"
 
-static void get_derivative_nac(double *ddnac,
-			       double *dnac,
-			       const int num_patom,
-			       const double *lattice,
-			       const double *mass,
-			       const double *q,
-			       const double *born,
-			       const double *dielectric,
-			       const double *q_direction,
-			       const double factor);
 static double get_A(const int atom_i,
 		    const int cart_i,
 		    const double q[3],
 		    const double *born);
 static double get_C(const double q[3],
 		    const double *dielectric);
-static double get_dA(const int atom_i,
-		     const int cart_i,
-		     const int cart_j,
-		     const double *born);
 static double get_dC(const int cart_i,
 		     const int cart_j,
 		     const int cart_k,
@@ -44,166 +31,236 @@ void get_derivative_dynmat_at_q(double *derivative_dynmat_real,
 				const double *dielectric,
 				const double *q_direction)
 {
-  int i, j, k, l, m, n, is_nac;
-  double coef[3], real_coef[3], imag_coef[3];
-  double c, s, phase, mass_sqrt, fc_elem, factor, real_phase, imag_phase;
-  double ddm_real[3][3][3], ddm_imag[3][3][3];
-  double *ddnac, *dnac;
+  int i, j, k, l, m, is_nac;
+  double *r_cart, *ddm_real, *ddm_imag, *ddnac, *dnac;
 
-  if (born) {
-    is_nac = 1;
-    if (q_direction) {
-      if (fabs(q_direction[0]) < 1e-5 &&
-	  fabs(q_direction[1]) < 1e-5 &&
-	  fabs(q_direction[2]) < 1e-5) {
-	is_nac = 0;
-      }
-    } else {
-      if (fabs(q[0]) < 1e-5 &&
-	  fabs(q[1]) < 1e-5 &&
-	  fabs(q[2]) < 1e-5) {
-	is_nac = 0;
-      }
-    }
-  } else {
-    is_nac = 0;
-  }
+  r_cart = (double*) malloc(sizeof(double) * num_satom * num_patom * 81);
+  get_cartesian_shortest_vectors(r_cart, num_patom, num_satom,
+				 lattice, r, multi);
+  ddm_real = (double*) malloc(sizeof(double) * num_patom * num_patom * 27);
+  ddm_imag = (double*) malloc(sizeof(double) * num_patom * num_patom * 27);
 
-  if (is_nac) {
+  is_nac = 0;
+  ddnac = NULL;
+  dnac = NULL;
+  if (born) {
     ddnac = (double*) malloc(sizeof(double) * num_patom * num_patom * 27);
     dnac = (double*) malloc(sizeof(double) * num_patom * num_patom * 9);
-    factor = nac_factor * num_patom / num_satom;
-    get_derivative_nac(ddnac,
-		       dnac,
-		       num_patom,
-		       lattice,
-		       mass,
-		       q,
-		       born,
-		       dielectric,
-		       q_direction,
-		       factor);
+    is_nac = get_derivative_nac(ddnac,
+				dnac,
+				num_patom,
+				num_satom,
+				lattice,
+				mass,
+				q,
+				born,
+				dielectric,
+				q_direction,
+				nac_factor);
   }
 
+  get_derivative_dynmat_pairs(ddm_real,
+			      ddm_imag,
+			      num_patom,
+			      num_satom,
+			      fc,
+			      q,
+			      r,
+			      r_cart,
+			      multi,
+			      mass,
+			      s2p_map,
+			      p2s_map,
+			      is_nac ? ddnac : NULL,
+			      is_nac ? dnac : NULL);
+
+  /* [pair, dir, 3, 3] -> [dir, num_patom * 3, num_patom * 3] */
   for (i = 0; i < num_patom; i++) {
     for (j = 0; j < num_patom; j++) {
-      mass_sqrt = sqrt(mass[i] * mass[j]);
-
       for (k = 0; k < 3; k++) {
 	for (l = 0; l < 3; l++) {
 	  for (m = 0; m < 3; m++) {
-	    ddm_real[m][k][l] = 0;
-	    ddm_imag[m][k][l] = 0;
+	    derivative_dynmat_real
+	      [k * num_patom * num_patom * 9 +
+	       (i * 3 + l) * num_patom * 3 + j * 3 + m] +=
+	      ddm_real[(i * num_patom + j) * 27 + k * 9 + l * 3 + m];
+	    derivative_dynmat_imag
+	      [k * num_patom * num_patom * 9 +
+	       (i * 3 + l) * num_patom * 3 + j * 3 + m] +=
+	      ddm_imag[(i * num_patom + j) * 27 + k * 9 + l * 3 + m];
 	  }
 	}
       }
+    }
+  }
 
-      for (k = 0; k < num_satom; k++) { /* Lattice points of right index of fc */
-	if (s2p_map[k] != p2s_map[j]) {
-	  continue;
-	}
+  if (born) {
+    free(ddnac);
+    free(dnac);
+  }
+  free(ddm_real);
+  free(ddm_imag);
+  free(r_cart);
+}
 
-	real_phase = 0;
-	imag_phase = 0;
-	for (l = 0; l < 3; l++) {
-	  real_coef[l] = 0;
-	  imag_coef[l] = 0;
-	}
-	for (l = 0; l < multi[k * num_patom + i]; l++) {
-	  phase = 0;
-	  for (m = 0; m < 3; m++) {
-	    phase += q[m] * r[k * num_patom * 81 + i * 81 + l * 3 + m];
-	  }
-	  s = sin(phase * 2 * M_PI);
-	  c = cos(phase * 2 * M_PI);
+/* Derivative of dynamical matrix in the layout of */
+/* ddm[num_patom * num_patom, 3 (dir), 3, 3], i.e., the three */
+/* Cartesian derivatives of an atom pair are contiguous. */
+/* r_cart is the q-independent table of 2pi L r made by */
+/* get_cartesian_shortest_vectors. ddnac and dnac are those computed */
+/* by get_derivative_nac, or NULL without NAC. */
+void get_derivative_dynmat_pairs(double *ddm_real,
+				 double *ddm_imag,
+				 const int num_patom, 
+				 const int num_satom,
+				 const double *fc,
+				 const double *q,
+				 const double *r,
+				 const double *r_cart,
+				 const int *multi,
+				 const double *mass,
+				 const int *s2p_map, 
+				 const int *p2s_map,
+				 const double *ddnac,
+				 const double *dnac)
+{
+  int i, j, ij, k, l, m, n, adrs, num_multi;
+  double real_coef[3], imag_coef[3];
+  double c, s, phase, mass_sqrt, fc_elem, real_phase, imag_phase;
+  double ddm_r[27], ddm_i[27];
 
-	  real_phase += c;
-	  imag_phase += s;
-	  
-	  for (m = 0; m < 3; m++) {
-	    coef[m] = 0;
-	    for (n = 0; n < 3; n++) {
-	      coef[m] += 2 * M_PI *
-		lattice[m * 3 + n] * r[k * num_patom * 81 + i * 81 + l * 3 + n];
-	    }
-	  }
-	  
-	  for (m =0; m < 3; m++) {
-	    real_coef[m] -= coef[m] * s;
-	    imag_coef[m] += coef[m] * c;
-	  }
-	}
+#pragma omp parallel for private(i, j, k, l, m, n, adrs, num_multi, real_coef, imag_coef, c, s, phase, mass_sqrt, fc_elem, real_phase, imag_phase, ddm_r, ddm_i)
+  for (ij = 0; ij < num_patom * num_patom; ij++) {
+    i = ij / num_patom;
+    j = ij % num_patom;
+    mass_sqrt = sqrt(mass[i] * mass[j]);
 
-	real_phase /= multi[k * num_patom + i];
-	imag_phase /= multi[k * num_patom + i];
-	
-	for (l = 0; l < 3; l++) {
-	  real_coef[l] /= multi[k * num_patom + i];
-	  imag_coef[l] /= multi[k * num_patom + i];
+    for (k = 0; k < 27; k++) {
+      ddm_r[k] = 0;
+      ddm_i[k] = 0;
+    }
+
+    for (k = 0; k < num_satom; k++) { /* Lattice points of right index of fc */
+      if (s2p_map[k] != p2s_map[j]) {
+	continue;
+      }
+
+      /* Phase and its derivative in one pass over equivalent vectors */
+      num_multi = multi[k * num_patom + i];
+      real_phase = 0;
+      imag_phase = 0;
+      for (l = 0; l < 3; l++) {
+	real_coef[l] = 0;
+	imag_coef[l] = 0;
+      }
+      for (l = 0; l < num_multi; l++) {
+	adrs = k * num_patom * 81 + i * 81 + l * 3;
+	phase = (q[0] * r[adrs] + q[1] * r[adrs + 1] + q[2] * r[adrs + 2])
+	  * 2 * M_PI;
+	s = sin(phase);
+	c = cos(phase);
+	real_phase += c;
+	imag_phase += s;
+	for (m = 0; m < 3; m++) {
+	  real_coef[m] -= r_cart[adrs + m] * s;
+	  imag_coef[m] += r_cart[adrs + m] * c;
 	}
+      }
+      real_phase /= num_multi;
+      imag_phase /= num_multi;
+      for (l = 0; l < 3; l++) {
+	real_coef[l] /= num_multi;
+	imag_coef[l] /= num_multi;
+      }
 
-	for (l = 0; l < 3; l++) {
-	  for (m = 0; m < 3; m++) {
-	    fc_elem = fc[p2s_map[i] * num_satom * 9 + k * 9 + l * 3 + m]
-	      / mass_sqrt;
-	    if (is_nac) {
-	      fc_elem += dnac[i * 9 * num_patom + j * 9 + l * 3 + m];
-	    }
-	    for (n = 0; n < 3; n++) {
-	      ddm_real[n][l][m] += fc_elem * real_coef[n];
-	      ddm_imag[n][l][m] += fc_elem * imag_coef[n];
-	      if (is_nac) {
-		ddm_real[n][l][m] +=
-		  ddnac[n * num_patom * num_patom * 9 +
-			i * 9 * num_patom + j * 9 + l * 3 + m] * real_phase;
-		ddm_imag[n][l][m] +=		
-		  ddnac[n * num_patom * num_patom * 9 +
-			i * 9 * num_patom + j * 9 + l * 3 + m] * imag_phase;
-	      }
-	    }
-	  }
+      adrs = p2s_map[i] * num_satom * 9 + k * 9;
+      for (l = 0; l < 9; l++) {
+	fc_elem = fc[adrs + l] / mass_sqrt;
+	if (dnac) {
+	  fc_elem += dnac[ij * 9 + l];
+	}
+	for (n = 0; n < 3; n++) {
+	  ddm_r[n * 9 + l] += fc_elem * real_coef[n];
+	  ddm_i[n * 9 + l] += fc_elem * imag_coef[n];
 	}
       }
-      
-      for (k = 0; k < 3; k++) {
+      if (ddnac) {
+	for (l = 0; l < 27; l++) {
+	  ddm_r[l] += ddnac[ij * 27 + l] * real_phase;
+	  ddm_i[l] += ddnac[ij * 27 + l] * imag_phase;
+	}
+      }
+    }
+
+    for (k = 0; k < 27; k++) {
+      ddm_real[ij * 27 + k] = ddm_r[k];
+      ddm_imag[ij * 27 + k] = ddm_i[k];
+    }
+  }
+}
+
+void get_cartesian_shortest_vectors(double *r_cart,
+				    const int num_patom,
+				    const int num_satom,
+				    const double *lattice, /* column vector */
+				    const double *r,
+				    const int *multi)
+{
+  int i, j, k, l, m, adrs;
+
+  for (i = 0; i < num_satom; i++) {
+    for (j = 0; j < num_patom; j++) {
+      for (k = 0; k < multi[i * num_patom + j]; k++) {
+	adrs = i * num_patom * 81 + j * 81 + k * 3;
 	for (l = 0; l < 3; l++) {
+	  r_cart[adrs + l] = 0;
 	  for (m = 0; m < 3; m++) {
-	    derivative_dynmat_real
-	      [k * num_patom * num_patom * 9 +
-	       (i * 3 + l) * num_patom * 3 + j * 3 + m] +=
-	      ddm_real[k][l][m];
-	    derivative_dynmat_imag
-	      [k * num_patom * num_patom * 9 +
-	       (i * 3 + l) * num_patom * 3 + j * 3 + m] +=
-	      ddm_imag[k][l][m];
+	    r_cart[adrs + l] += 2 * M_PI * lattice[l * 3 + m] * r[adrs + m];
 	  }
 	}
       }
     }
   }
-
-  if (is_nac) {
-    free(ddnac);
-    free(dnac);
-  }
 }
 
 /* D_nac = a * AB/C */
 /* dD_nac = a * D_nac * (A'/A + B'/B - C'/C) */
-static void get_derivative_nac(double *ddnac,
-			       double *dnac,
-			       const int num_patom,
-			       const double *lattice,
-			       const double *mass,
-			       const double *q,
-			       const double *born,
-			       const double *dielectric,
-			       const double *q_direction,
-			       const double factor)
+/* NAC term and its derivative, ddnac[num_patom^2, 3 (dir), 3, 3] and */
+/* dnac[num_patom^2, 3, 3]. These depend only on q (or q_direction), */
+/* so that they can be reused among q-points when q_direction is */
+/* given. Returns 0 when NAC is not applied at this q. */
+int get_derivative_nac(double *ddnac,
+		       double *dnac,
+		       const int num_patom,
+		       const int num_satom,
+		       const double *lattice,
+		       const double *mass,
+		       const double *q,
+		       const double *born,
+		       const double *dielectric,
+		       const double *q_direction,
+		       const double nac_factor)
 {
   int i, j, k, l, m;
-  double a, b, c, da, db, dc, volume, mass_sqrt;
-  double q_cart[3], rec_lat[9];
+  double a, b, c, da, db, volume, mass_sqrt, factor;
+  double q_cart[3], rec_lat[9], dc[3];
+  double *q_born;
+
+  if (q_direction) {
+    if (fabs(q_direction[0]) < 1e-5 &&
+	fabs(q_direction[1]) < 1e-5 &&
+	fabs(q_direction[2]) < 1e-5) {
+      return 0;
+    }
+  } else {
+    if (fabs(q[0]) < 1e-5 &&
+	fabs(q[1]) < 1e-5 &&
+	fabs(q[2]) < 1e-5) {
+      return 0;
+    }
+  }
+
+  factor = nac_factor * num_patom / num_satom;
 
   volume =
     lattice[0] * (lattice[4] * lattice[8] - lattice[5] * lattice[7]) +
@@ -232,30 +289,41 @@ static void get_derivative_nac(double *ddnac,
   }
 
   c = get_C(q_cart, dielectric);
+  for (k = 0; k < 3; k++) {
+    dc[k] = get_dC(0, 0, k, q_cart, dielectric);
+  }
+
+  /* Born charges contracted with q, shared by all atom pairs */
+  q_born = (double*) malloc(sizeof(double) * num_patom * 3);
+  for (i = 0; i < num_patom; i++) {
+    for (l = 0; l < 3; l++) {
+      q_born[i * 3 + l] = get_A(i, l, q_cart, born);
+    }
+  }
 
   for (i = 0; i < num_patom; i++) { /* atom_i */
     for (j = 0; j < num_patom; j++) { /* atom_j */
       mass_sqrt = sqrt(mass[i] * mass[j]);
-      for (k = 0; k < 3; k++) { /* derivative direction */
-	for (l = 0; l < 3; l++) { /* alpha */
-	  a = get_A(i, l, q_cart, born);
-	  da = get_dA(i, l, k, born);
-	  for (m = 0; m < 3; m++) { /* beta */
-	    b = get_A(j, m, q_cart, born);
-	    db = get_dA(j, m, k, born);
-	    dc = get_dC(l, m, k, q_cart, dielectric);
-	    ddnac[k * num_patom * num_patom * 9 +
-		  i * 9 * num_patom + j * 9 + l * 3 + m] =
-	      (da * b + db * a - a * b * dc / c) / (c * mass_sqrt) * factor;
-	    if (k == 0) {
-	      dnac[i * 9 * num_patom + j * 9 + l * 3 + m] =
-		a * b / (c * mass_sqrt) * factor; 
-	    }
+      for (l = 0; l < 3; l++) { /* alpha */
+	a = q_born[i * 3 + l];
+	for (m = 0; m < 3; m++) { /* beta */
+	  b = q_born[j * 3 + m];
+	  dnac[(i * num_patom + j) * 9 + l * 3 + m] =
+	    a * b / (c * mass_sqrt) * factor;
+	  for (k = 0; k < 3; k++) { /* derivative direction */
+	    da = born[i * 9 + k * 3 + l];
+	    db = born[j * 9 + k * 3 + m];
+	    ddnac[(i * num_patom + j) * 27 + k * 9 + l * 3 + m] =
+	      (da * b + db * a - a * b * dc[k] / c) / (c * mass_sqrt) * factor;
 	  }
 	}
       }
     }
   }
+
+  free(q_born);
+
+  return 1;
 }
 
 static double get_A(const int atom_i,
@@ -290,14 +358,6 @@ static double get_C(const double q[3],
   return sum;
 }
 
-static double get_dA(const int atom_i,
-		     const int cart_i,
-		     const int cart_j,
-		     const double *born)
-{
-  return born[atom_i * 9 + cart_j * 3 + cart_i];
-}
-
 static double get_dC(const int cart_i,
 		     const int cart_j,
 		     const int cart_k,
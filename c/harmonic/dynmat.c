@@ -111,3 +111,163 @@ void get_charge_sum(double *charge_sum,
   free(q_born);
 }
 
+
+/* Real space table of dynamical matrix */
+/* For each pair of atoms (i, j) in primitive cell, the lattice */
+/* vectors and the mass weighted force constants are listed so that */
+/* the dynamical matrix at any q-point is a plain sum over the */
+/* entries between table_index[i * num_patom + j] and */
+/* table_index[i * num_patom + j + 1]. The weights of the phase factor */
+/* (1 / multiplicity) are stored separately for the charge term of */
+/* non-analytical term correction. */
+int get_dynmat_table_size(const int num_patom,
+			  const int num_satom,
+			  const int *multi,
+			  const int *s2p_map,
+			  const int *p2s_map)
+{
+  int i, j, k, size;
+
+  size = 0;
+  for (i = 0; i < num_patom; i++) {
+    for (j = 0; j < num_patom; j++) {
+      for (k = 0; k < num_satom; k++) {
+	if (s2p_map[k] == p2s_map[j]) {
+	  size += multi[k * num_patom + i];
+	}
+      }
+    }
+  }
+  return size;
+}
+
+void set_dynmat_table(int *table_index,
+		      double *table_vectors,
+		      double *table_weights,
+		      double *table_phase_weights,
+		      const int num_patom,
+		      const int num_satom,
+		      const double *fc,
+		      const double *r,
+		      const int *multi,
+		      const double *mass,
+		      const int *s2p_map,
+		      const int *p2s_map)
+{
+  int i, j, k, l, m, n;
+  double mass_sqrt;
+
+  n = 0;
+  for (i = 0; i < num_patom; i++) {
+    for (j = 0; j < num_patom; j++) {
+      table_index[i * num_patom + j] = n;
+      mass_sqrt = sqrt(mass[i] * mass[j]);
+      for (k = 0; k < num_satom; k++) {
+	if (s2p_map[k] != p2s_map[j]) {
+	  continue;
+	}
+	for (l = 0; l < multi[k * num_patom + i]; l++) {
+	  for (m = 0; m < 3; m++) {
+	    table_vectors[n * 3 + m] =
+	      r[k * num_patom * 81 + i * 81 + l * 3 + m] * 2 * M_PI;
+	  }
+	  for (m = 0; m < 9; m++) {
+	    table_weights[n * 9 + m] =
+	      fc[p2s_map[i] * num_satom * 9 + k * 9 + m] /
+	      mass_sqrt / multi[k * num_patom + i];
+	  }
+	  table_phase_weights[n] = 1.0 / multi[k * num_patom + i];
+	  n++;
+	}
+      }
+    }
+  }
+  table_index[num_patom * num_patom] = n;
+}
+
+/* Dynamical matrices at many q-points from the real space table */
+/* Blocks of pairs of atoms at all q-points are distributed over */
+/* threads. Each block is written by only one thread. */
+/* When q_cart is not NULL, the charge term of non-analytical term */
+/* correction (Wang method) is added with nac_factors[i_q], which */
+/* includes 1 / (q.epsilon.q) and 1 / N. */
+void get_dynamical_matrices_at_qpoints(double *dynamical_matrices_real,
+				       double *dynamical_matrices_imag,
+				       const int num_qpoints,
+				       const int num_patom,
+				       const double *qpoints,
+				       const int *table_index,
+				       const double *table_vectors,
+				       const double *table_weights,
+				       const double *table_phase_weights,
+				       const double *mass,
+				       const double *q_cart,
+				       const double *nac_factors,
+				       const double *born)
+{
+  int i_block, i_q, i, j, k, l, n, adrs;
+  double phase, cos_phase, sin_phase, cos_sum, sin_sum, charge, mass_sqrt;
+  double dm_real[9], dm_imag[9], q[3], zq_i[3], zq_j[3];
+  const double *w;
+
+#pragma omp parallel for private(i_q, i, j, k, l, n, adrs, phase, cos_phase, sin_phase, cos_sum, sin_sum, charge, mass_sqrt, dm_real, dm_imag, q, zq_i, zq_j, w)
+  for (i_block = 0; i_block < num_qpoints * num_patom * num_patom; i_block++) {
+    i_q = i_block / (num_patom * num_patom);
+    i = (i_block / num_patom) % num_patom;
+    j = i_block % num_patom;
+    for (k = 0; k < 3; k++) {
+      q[k] = qpoints[i_q * 3 + k];
+    }
+    for (k = 0; k < 9; k++) {
+      dm_real[k] = 0;
+      dm_imag[k] = 0;
+    }
+    cos_sum = 0;
+    sin_sum = 0;
+
+    for (n = table_index[i * num_patom + j];
+	 n < table_index[i * num_patom + j + 1]; n++) {
+      phase = (q[0] * table_vectors[n * 3] +
+	       q[1] * table_vectors[n * 3 + 1] +
+	       q[2] * table_vectors[n * 3 + 2]);
+      cos_phase = cos(phase);
+      sin_phase = sin(phase);
+      w = table_weights + n * 9;
+      for (k = 0; k < 9; k++) {
+	dm_real[k] += w[k] * cos_phase;
+	dm_imag[k] += w[k] * sin_phase;
+      }
+      cos_sum += table_phase_weights[n] * cos_phase;
+      sin_sum += table_phase_weights[n] * sin_phase;
+    }
+
+    if (q_cart && nac_factors[i_q] != 0) {
+      for (k = 0; k < 3; k++) {
+	zq_i[k] = 0;
+	zq_j[k] = 0;
+	for (l = 0; l < 3; l++) {
+	  zq_i[k] += q_cart[i_q * 3 + l] * born[i * 9 + l * 3 + k];
+	  zq_j[k] += q_cart[i_q * 3 + l] * born[j * 9 + l * 3 + k];
+	}
+      }
+      mass_sqrt = sqrt(mass[i] * mass[j]);
+      for (k = 0; k < 3; k++) {
+	for (l = 0; l < 3; l++) {
+	  charge = zq_i[k] * zq_j[l] * nac_factors[i_q] / mass_sqrt;
+	  dm_real[k * 3 + l] += charge * cos_sum;
+	  dm_imag[k * 3 + l] += charge * sin_sum;
+	}
+      }
+    }
+
+    adrs = i_q * num_patom * num_patom * 9;
+    for (k = 0; k < 3; k++) {
+      for (l = 0; l < 3; l++) {
+	dynamical_matrices_real[adrs + (i * 3 + k) * num_patom * 3 + j * 3 + l] =
+	  dm_real[k * 3 + l];
+	dynamical_matrices_imag[adrs + (i * 3 + k) * num_patom * 3 + j * 3 + l] =
+	  dm_imag[k * 3 + l];
+      }
+    }
+  }
+}
@@ -0,0 +1,469 @@
+#include <math.h>
+#include <stdlib.h>
+#include "derivative_dynmat.h"
+#include "group_velocity.h"
+
+static void get_group_velocities_at_q(double *gv,
+				      const double *freqs,
+				      const double *eigvecs,
+				      const double *ddm_real,
+				      const double *ddm_imag,
+				      double *work,
+				      const int num_patom,
+				      const double perturbation[3],
+				      const double degeneracy_tolerance);
+static void get_projected_ddm(double *ddm_proj,
+			      double *vec,
+			      const double *ddm_real,
+			      const double *ddm_imag,
+			      const double *eigvecs,
+			      const int band_start,
+			      const int deg,
+			      const int num_patom);
+static void rotate_degenerate_subspace(double *rot_vecs,
+				       double *work,
+				       const double *ddm_proj,
+				       const double perturbation[3],
+				       const int deg);
+static void jacobi_eigen(double *w,
+			 double *v,
+			 double *a,
+			 const int n);
+
+/* group_velocities[num_qpoints, num_band, 3] (Cartesian) */
+/* frequencies[num_qpoints, num_band] in THz, ascending as given by zheev */
+/* eigenvectors[num_qpoints, num_band, num_band] complex128 (re, im) */
+/* with the second index running over bands as in numpy.linalg.eigh. */
+/* Degenerate subspaces are rotated so as to diagonalize the */
+/* derivative of dynamical matrix along perturbation (Cartesian). */
+void get_group_velocities(double *group_velocities,
+			  const double *frequencies,
+			  const double *eigenvectors,
+			  const double *qpoints,
+			  const int num_qpoints,
+			  const int num_patom,
+			  const int num_satom,
+			  const double *fc,
+			  const double *lattice, /* column vector */
+			  const double *r,
+			  const int *multi,
+			  const double *mass,
+			  const int *s2p_map,
+			  const int *p2s_map,
+			  const double nac_factor,
+			  const double *born,
+			  const double *dielectric,
+			  const double *q_direction,
+			  const double perturbation[3],
+			  const double frequency_factor,
+			  const double cutoff_frequency,
+			  const double degeneracy_tolerance)
+{
+  int i, j, k, num_band, is_nac, is_nac_shared;
+  double f;
+  double *r_cart, *ddm_real, *ddm_imag, *ddnac, *dnac, *work;
+  double *ddnac_shared, *dnac_shared;
+
+  num_band = num_patom * 3;
+
+  r_cart = (double*) malloc(sizeof(double) * num_satom * num_patom * 81);
+  get_cartesian_shortest_vectors(r_cart, num_patom, num_satom,
+				 lattice, r, multi);
+
+  /* With q_direction, NAC terms are common to all q-points. */
+  is_nac_shared = 0;
+  ddnac_shared = NULL;
+  dnac_shared = NULL;
+  if (born && q_direction) {
+    ddnac_shared =
+      (double*) malloc(sizeof(double) * num_patom * num_patom * 27);
+    dnac_shared =
+      (double*) malloc(sizeof(double) * num_patom * num_patom * 9);
+    is_nac_shared = get_derivative_nac(ddnac_shared,
+				       dnac_shared,
+				       num_patom,
+				       num_satom,
+				       lattice,
+				       mass,
+				       NULL,
+				       born,
+				       dielectric,
+				       q_direction,
+				       nac_factor);
+  }
+
+#pragma omp parallel private(i, j, k, f, is_nac, ddm_real, ddm_imag, ddnac, dnac, work)
+  {
+    ddm_real = (double*) malloc(sizeof(double) * num_patom * num_patom * 27);
+    ddm_imag = (double*) malloc(sizeof(double) * num_patom * num_patom * 27);
+    if (born && (! q_direction)) {
+      ddnac = (double*) malloc(sizeof(double) * num_patom * num_patom * 27);
+      dnac = (double*) malloc(sizeof(double) * num_patom * num_patom * 9);
+    } else {
+      ddnac = ddnac_shared;
+      dnac = dnac_shared;
+    }
+    work = (double*) malloc(sizeof(double) * num_band * num_band * 24);
+
+#pragma omp for
+    for (i = 0; i < num_qpoints; i++) {
+      if (born && (! q_direction)) {
+	is_nac = get_derivative_nac(ddnac,
+				    dnac,
+				    num_patom,
+				    num_satom,
+				    lattice,
+				    mass,
+				    qpoints + i * 3,
+				    born,
+				    dielectric,
+				    NULL,
+				    nac_factor);
+      } else {
+	is_nac = is_nac_shared;
+      }
+      get_derivative_dynmat_pairs(ddm_real,
+				  ddm_imag,
+				  num_patom,
+				  num_satom,
+				  fc,
+				  qpoints + i * 3,
+				  r,
+				  r_cart,
+				  multi,
+				  mass,
+				  s2p_map,
+				  p2s_map,
+				  is_nac ? ddnac : NULL,
+				  is_nac ? dnac : NULL);
+      get_group_velocities_at_q(group_velocities + i * num_band * 3,
+				frequencies + i * num_band,
+				eigenvectors + i * num_band * num_band * 2,
+				ddm_real,
+				ddm_imag,
+				work,
+				num_patom,
+				perturbation,
+				degeneracy_tolerance);
+      for (j = 0; j < num_band; j++) {
+	f = frequencies[i * num_band + j];
+	for (k = 0; k < 3; k++) {
+	  if (f > cutoff_frequency) {
+	    group_velocities[i * num_band * 3 + j * 3 + k] *=
+	      frequency_factor * frequency_factor / f / 2;
+	  } else {
+	    group_velocities[i * num_band * 3 + j * 3 + k] = 0;
+	  }
+	}
+      }
+    }
+
+    free(ddm_real);
+    free(ddm_imag);
+    if (born && (! q_direction)) {
+      free(ddnac);
+      free(dnac);
+    }
+    free(work);
+  }
+
+  if (ddnac_shared) {
+    free(ddnac_shared);
+    free(dnac_shared);
+  }
+  free(r_cart);
+}
+
+/* work has to be allocated at least with num_band^2 * 24 elements. */
+static void get_group_velocities_at_q(double *gv,
+				      const double *freqs,
+				      const double *eigvecs,
+				      const double *ddm_real,
+				      const double *ddm_imag,
+				      double *work,
+				      const int num_patom,
+				      const double perturbation[3],
+				      const double degeneracy_tolerance)
+{
+  int i, j, a, b, start, deg, num_band;
+  double *ddm_proj, *rot_vecs, *vec, *work_rot;
+  double sum;
+
+  num_band = num_patom * 3;
+  ddm_proj = work;                             /* [3, deg, deg, 2] */
+  rot_vecs = ddm_proj + num_band * num_band * 6; /* [deg, deg, 2] */
+  vec = rot_vecs + num_band * num_band * 2;    /* [num_band, 2] */
+  work_rot = vec + num_band * 2;  /* [2deg, 2deg] * 2 + 4deg, int [2deg] */
+
+  start = 0;
+  while (start < num_band) {
+    deg = 1;
+    while (start + deg < num_band &&
+	   freqs[start + deg] - freqs[start + deg - 1] < degeneracy_tolerance) {
+      deg++;
+    }
+
+    get_projected_ddm(ddm_proj, vec, ddm_real, ddm_imag,
+		      eigvecs, start, deg, num_patom);
+
+    if (deg == 1) {
+      for (i = 0; i < 3; i++) {
+	gv[start * 3 + i] = ddm_proj[i * 2];
+      }
+    } else {
+      rotate_degenerate_subspace(rot_vecs, work_rot, ddm_proj,
+				 perturbation, deg);
+      /* Re(u^dagger G u) for rotated vectors u (columns of rot_vecs) */
+      for (i = 0; i < deg; i++) {
+	for (j = 0; j < 3; j++) {
+	  sum = 0;
+	  for (a = 0; a < deg; a++) {
+	    for (b = 0; b < deg; b++) {
+	      sum +=
+		(rot_vecs[(a * deg + i) * 2] *
+		 rot_vecs[(b * deg + i) * 2] +
+		 rot_vecs[(a * deg + i) * 2 + 1] *
+		 rot_vecs[(b * deg + i) * 2 + 1]) *
+		ddm_proj[((j * deg + a) * deg + b) * 2] -
+		(rot_vecs[(a * deg + i) * 2] *
+		 rot_vecs[(b * deg + i) * 2 + 1] -
+		 rot_vecs[(a * deg + i) * 2 + 1] *
+		 rot_vecs[(b * deg + i) * 2]) *
+		ddm_proj[((j * deg + a) * deg + b) * 2 + 1];
+	    }
+	  }
+	  gv[(start + i) * 3 + j] = sum;
+	}
+      }
+    }
+    start += deg;
+  }
+}
+
+/* ddm_proj[3, deg, deg] = hermite part of E^dagger ddm E where E */
+/* is the set of eigenvectors of bands [band_start, band_start + deg). */
+/* ddm is in the layout of [num_patom^2, 3 (dir), 3, 3]. */
+static void get_projected_ddm(double *ddm_proj,
+			      double *vec,
+			      const double *ddm_real,
+			      const double *ddm_imag,
+			      const double *eigvecs,
+			      const int band_start,
+			      const int deg,
+			      const int num_patom)
+{
+  int i, j, k, a, b, l, m, adrs, num_band;
+  double er, ei, dr, di, sum_re, sum_im, x_re, x_im;
+
+  num_band = num_patom * 3;
+
+  for (i = 0; i < 3; i++) {
+    for (b = 0; b < deg; b++) {
+      for (j = 0; j < num_patom; j++) {
+	for (l = 0; l < 3; l++) {
+	  sum_re = 0;
+	  sum_im = 0;
+	  for (k = 0; k < num_patom; k++) {
+	    adrs = ((j * num_patom + k) * 3 + i) * 9 + l * 3;
+	    for (m = 0; m < 3; m++) {
+	      er = eigvecs[((k * 3 + m) * num_band + band_start + b) * 2];
+	      ei = eigvecs[((k * 3 + m) * num_band + band_start + b) * 2 + 1];
+	      dr = ddm_real[adrs + m];
+	      di = ddm_imag[adrs + m];
+	      sum_re += dr * er - di * ei;
+	      sum_im += dr * ei + di * er;
+	    }
+	  }
+	  vec[(j * 3 + l) * 2] = sum_re;
+	  vec[(j * 3 + l) * 2 + 1] = sum_im;
+	}
+      }
+      for (a = 0; a < deg; a++) {
+	sum_re = 0;
+	sum_im = 0;
+	for (j = 0; j < num_band; j++) {
+	  er = eigvecs[(j * num_band + band_start + a) * 2];
+	  ei = eigvecs[(j * num_band + band_start + a) * 2 + 1];
+	  sum_re += er * vec[j * 2] + ei * vec[j * 2 + 1];
+	  sum_im += er * vec[j * 2 + 1] - ei * vec[j * 2];
+	}
+	adrs = ((i * deg + a) * deg + b) * 2;
+	ddm_proj[adrs] = sum_re;
+	ddm_proj[adrs + 1] = sum_im;
+      }
+    }
+
+    /* (X + X^dagger) / 2 */
+    for (a = 0; a < deg; a++) {
+      for (b = a; b < deg; b++) {
+	x_re = (ddm_proj[((i * deg + a) * deg + b) * 2] +
+		ddm_proj[((i * deg + b) * deg + a) * 2]) / 2;
+	x_im = (ddm_proj[((i * deg + a) * deg + b) * 2 + 1] -
+		ddm_proj[((i * deg + b) * deg + a) * 2 + 1]) / 2;
+	ddm_proj[((i * deg + a) * deg + b) * 2] = x_re;
+	ddm_proj[((i * deg + a) * deg + b) * 2 + 1] = x_im;
+	ddm_proj[((i * deg + b) * deg + a) * 2] = x_re;
+	ddm_proj[((i * deg + b) * deg + a) * 2 + 1] = -x_im;
+      }
+    }
+  }
+}
+
+/* Hermitian matrix P = A + iB is diagonalized through the real */
+/* symmetric matrix [[A, -B], [B, A]] whose eigenvalues are those of */
+/* P doubled. An orthonormal set of deg complex eigenvectors is picked */
+/* up in ascending order of eigenvalues. work has [n, n] * 2 + 2n */
+/* doubles followed by n ints, where n = 2deg. */
+static void rotate_degenerate_subspace(double *rot_vecs,
+				       double *work,
+				       const double *ddm_proj,
+				       const double perturbation[3],
+				       const int deg)
+{
+  int i, j, k, n, num_sel, tmp_index;
+  int *order;
+  double *a, *v, *w, *u;
+  double p_re, p_im, o_re, o_im, norm;
+
+  n = deg * 2;
+  a = work;
+  v = a + n * n;
+  w = v + n * n;
+  u = w + n;
+  order = (int*)(u + n);
+
+  for (i = 0; i < deg; i++) {
+    for (j = 0; j < deg; j++) {
+      p_re = 0;
+      p_im = 0;
+      for (k = 0; k < 3; k++) {
+	p_re += perturbation[k] * ddm_proj[((k * deg + i) * deg + j) * 2];
+	p_im += perturbation[k] * ddm_proj[((k * deg + i) * deg + j) * 2 + 1];
+      }
+      a[i * n + j] = p_re;
+      a[(i + deg) * n + j + deg] = p_re;
+      a[i * n + j + deg] = -p_im;
+      a[(i + deg) * n + j] = p_im;
+    }
+  }
+
+  jacobi_eigen(w, v, a, n);
+
+  for (i = 0; i < n; i++) {
+    order[i] = i;
+  }
+  for (i = 1; i < n; i++) {
+    for (j = i; j > 0 && w[order[j - 1]] > w[order[j]]; j--) {
+      tmp_index = order[j];
+      order[j] = order[j - 1];
+      order[j - 1] = tmp_index;
+    }
+  }
+
+  num_sel = 0;
+  for (i = 0; i < n; i++) {
+    for (j = 0; j < deg; j++) {
+      u[j * 2] = v[j * n + order[i]];
+      u[j * 2 + 1] = v[(j + deg) * n + order[i]];
+    }
+    /* Gram-Schmidt against already selected vectors */
+    for (k = 0; k < num_sel; k++) {
+      o_re = 0;
+      o_im = 0;
+      for (j = 0; j < deg; j++) {
+	o_re += (rot_vecs[(j * deg + k) * 2] * u[j * 2] +
+		 rot_vecs[(j * deg + k) * 2 + 1] * u[j * 2 + 1]);
+	o_im += (rot_vecs[(j * deg + k) * 2] * u[j * 2 + 1] -
+		 rot_vecs[(j * deg + k) * 2 + 1] * u[j * 2]);
+      }
+      for (j = 0; j < deg; j++) {
+	u[j * 2] -= (o_re * rot_vecs[(j * deg + k) * 2] -
+		     o_im * rot_vecs[(j * deg + k) * 2 + 1]);
+	u[j * 2 + 1] -= (o_re * rot_vecs[(j * deg + k) * 2 + 1] +
+			 o_im * rot_vecs[(j * deg + k) * 2]);
+      }
+    }
+    norm = 0;
+    for (j = 0; j < deg * 2; j++) {
+      norm += u[j] * u[j];
+    }
+    norm = sqrt(norm);
+    if (norm > 0.5) {
+      for (j = 0; j < deg; j++) {
+	rot_vecs[(j * deg + num_sel) * 2] = u[j * 2] / norm;
+	rot_vecs[(j * deg + num_sel) * 2 + 1] = u[j * 2 + 1] / norm;
+      }
+      num_sel++;
+      if (num_sel == deg) {
+	break;
+      }
+    }
+  }
+}
+
+/* Cyclic Jacobi method for real symmetric matrix a[n, n]. */
+/* a is destroyed. Eigenvectors are stored in columns of v. */
+static void jacobi_eigen(double *w,
+			 double *v,
+			 double *a,
+			 const int n)
+{
+  int i, j, k, sweep;
+  double off, total, theta, t, c, s, akp, akq;
+
+  for (i = 0; i < n; i++) {
+    for (j = 0; j < n; j++) {
+      v[i * n + j] = (i == j);
+    }
+  }
+
+  for (sweep = 0; sweep < 100; sweep++) {
+    off = 0;
+    total = 0;
+    for (i = 0; i < n; i++) {
+      for (j = 0; j < n; j++) {
+	total += a[i * n + j] * a[i * n + j];
+	if (i != j) {
+	  off += a[i * n + j] * a[i * n + j];
+	}
+      }
+    }
+    if (off <= 1e-28 * total) {
+      break;
+    }
+
+    for (i = 0; i < n - 1; i++) {
+      for (j = i + 1; j < n; j++) {
+	if (fabs(a[i * n + j]) < 1e-300) {
+	  continue;
+	}
+	theta = (a[j * n + j] - a[i * n + i]) / (2 * a[i * n + j]);
+	t = ((theta >= 0) ? 1 : -1) / (fabs(theta) + sqrt(theta * theta + 1));
+	c = 1 / sqrt(t * t + 1);
+	s = t * c;
+	for (k = 0; k < n; k++) {
+	  akp = a[k * n + i];
+	  akq = a[k * n + j];
+	  a[k * n + i] = c * akp - s * akq;
+	  a[k * n + j] = s * akp + c * akq;
+	}
+	for (k = 0; k < n; k++) {
+	  akp = a[i * n + k];
+	  akq = a[j * n + k];
+	  a[i * n + k] = c * akp - s * akq;
+	  a[j * n + k] = s * akp + c * akq;
+	}
+	for (k = 0; k < n; k++) {
+	  akp = v[k * n + i];
+	  akq = v[k * n + j];
+	  v[k * n + i] = c * akp - s * akq;
+	  v[k * n + j] = s * akp + c * akq;
+	}
+      }
+    }
+  }
+
+  for (i = 0; i < n; i++) {
+    w[i] = a[i * n + i];
+  }
+}
@@ -17,5 +17,36 @@ void get_derivative_dynmat_at_q(double *derivative_dynmat_real,
 				const double *born,
 				const double *dielectric,
 				const double *q_direction);
+void get_derivative_dynmat_pairs(double *ddm_real,
+				 double *ddm_imag,
+				 const int num_patom, 
+				 const int num_satom,
+				 const double *fc,
+				 const double *q,
+				 const double *r,
+				 const double *r_cart,
+				 const int *multi,
+				 const double *mass,
+				 const int *s2p_map, 
+				 const int *p2s_map,
+				 const double *ddnac,
+				 const double *dnac);
+void get_cartesian_shortest_vectors(double *r_cart,
+				    const int num_patom,
+				    const int num_satom,
+				    const double *lattice, /* column vector */
+				    const double *r,
+				    const int *multi);
+int get_derivative_nac(double *ddnac,
+		       double *dnac,
+		       const int num_patom,
+		       const int num_satom,
+		       const double *lattice, /* column vector */
+		       const double *mass,
+		       const double *q,
+		       const double *born,
+		       const double *dielectric,
+		       const double *q_direction,
+		       const double nac_factor);
 
 #endif
@@ -18,4 +18,34 @@ void get_charge_sum(double *charge_sum,
 		    const double factor,
 		    const double q_vector[3],
 		    const double *born);
+int get_dynmat_table_size(const int num_patom,
+			  const int num_satom,
+			  const int *multi,
+			  const int *s2p_map,
+			  const int *p2s_map);
+void set_dynmat_table(int *table_index,
+		      double *table_vectors,
+		      double *table_weights,
+		      double *table_phase_weights,
+		      const int num_patom,
+		      const int num_satom,
+		      const double *fc,
+		      const double *r,
+		      const int *multi,
+		      const double *mass,
+		      const int *s2p_map,
+		      const int *p2s_map);
+void get_dynamical_matrices_at_qpoints(double *dynamical_matrices_real,
+				       double *dynamical_matrices_imag,
+				       const int num_qpoints,
+				       const int num_patom,
+				       const double *qpoints,
+				       const int *table_index,
+				       const double *table_vectors,
+				       const double *table_weights,
+				       const double *table_phase_weights,
+				       const double *mass,
+				       const double *q_cart,
+				       const double *nac_factors,
+				       const double *born);
 #endif
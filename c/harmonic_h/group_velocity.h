@@ -0,0 +1,27 @@
+#ifndef __group_velocity_H__
+#define __group_velocity_H__
+
+void get_group_velocities(double *group_velocities,
+			  const double *frequencies,
+			  const double *eigenvectors,
+			  const double *qpoints,
+			  const int num_qpoints,
+			  const int num_patom,
+			  const int num_satom,
+			  const double *fc,
+			  const double *lattice, /* column vector */
+			  const double *r,
+			  const int *multi,
+			  const double *mass,
+			  const int *s2p_map,
+			  const int *p2s_map,
+			  const double nac_factor,
+			  const double *born,
+			  const double *dielectric,
+			  const double *q_direction,
+			  const double perturbation[3],
+			  const double frequency_factor,
+			  const double cutoff_frequency,
+			  const double degeneracy_tolerance);
+
+#endif
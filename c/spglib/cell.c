@@ -1,6 +1,7 @@
 /* cell.c */
 /* Copyright (C) 2008 Atsushi Togo */
 
+#include <math.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include "cell.h"
@@ -8,6 +9,9 @@
 
 #include "debug.h"
 
+static int get_bin_index( const double pos[3],
+			  const int mesh[3] );
+
 /* cell->size = 0 is a sign of False */
 Cell * cel_alloc_cell( const int size )
 {
@@ -98,3 +102,165 @@ int cel_is_overlap( const double a[3],
   }
 }
 
+
+/* Number of bins along each axis is limited so that the number of */
+/* bins does not exceed much the number of atoms. */
+AtomBins * cel_alloc_atom_bins( SPGCONST Cell * cell,
+				const double symprec )
+{
+  int i, j, num_bins, max_mesh, bin;
+  int *atom_bins;
+  double inv_lat[3][3];
+  double norm;
+  AtomBins *bins;
+
+  if ((bins = (AtomBins*) malloc( sizeof( AtomBins ) )) == NULL) {
+    warning_print("spglib: Memory of atom bins could not be allocated.");
+    exit(1);
+  }
+
+  max_mesh = 1;
+  while ( max_mesh * max_mesh * max_mesh < cell->size ) {
+    max_mesh++;
+  }
+
+  if ( mat_inverse_matrix_d3( inv_lat, cell->lattice, 0 ) && symprec > 0 ) {
+    for ( i = 0; i < 3; i++ ) {
+      norm = 0;
+      for ( j = 0; j < 3; j++ ) {
+	norm += inv_lat[i][j] * inv_lat[i][j];
+      }
+      /* |df_i| <= |row_i of lattice^-1| |d| < 1 / mesh[i] */
+      bins->margin[i] = symprec * sqrt( norm );
+      if ( symprec * symprec * norm * max_mesh * max_mesh < 1 ) {
+	bins->mesh[i] = max_mesh;
+      } else {
+	bins->mesh[i] = (int)( 1.0 / ( symprec * sqrt( norm ) ) );
+	if ( bins->mesh[i] < 1 ) {
+	  bins->mesh[i] = 1;
+	}
+      }
+    }
+  } else {
+    for ( i = 0; i < 3; i++ ) {
+      bins->mesh[i] = 1;
+      bins->margin[i] = 0.5;
+    }
+  }
+
+  num_bins = bins->mesh[0] * bins->mesh[1] * bins->mesh[2];
+  bins->bin_start = (int*) malloc( sizeof( int ) * ( num_bins + 1 ) );
+  bins->atoms = (int*) malloc( sizeof( int ) * ( cell->size + 1 ) );
+  atom_bins = (int*) malloc( sizeof( int ) * ( cell->size + 1 ) );
+  if ( bins->bin_start == NULL || bins->atoms == NULL || atom_bins == NULL ) {
+    warning_print("spglib: Memory of atom bins could not be allocated.");
+    exit(1);
+  }
+
+  /* Counting sort of atoms by bin */
+  for ( i = 0; i < num_bins + 1; i++ ) {
+    bins->bin_start[i] = 0;
+  }
+  for ( i = 0; i < cell->size; i++ ) {
+    atom_bins[i] = get_bin_index( cell->position[i], bins->mesh );
+    bins->bin_start[atom_bins[i] + 1]++;
+  }
+  for ( i = 0; i < num_bins; i++ ) {
+    bins->bin_start[i + 1] += bins->bin_start[i];
+  }
+  for ( i = 0; i < cell->size; i++ ) {
+    bin = atom_bins[i];
+    bins->atoms[bins->bin_start[bin]] = i;
+    bins->bin_start[bin]++;
+  }
+  for ( i = num_bins; i > 0; i-- ) {
+    bins->bin_start[i] = bins->bin_start[i - 1];
+  }
+  bins->bin_start[0] = 0;
+
+  free( atom_bins );
+  atom_bins = NULL;
+
+  return bins;
+}
+
+void cel_free_atom_bins( AtomBins * bins )
+{
+  free( bins->bin_start );
+  bins->bin_start = NULL;
+  free( bins->atoms );
+  bins->atoms = NULL;
+  free( bins );
+  bins = NULL;
+}
+
+/* Index of an atom of 'type' overlapping with 'pos', or -1. */
+int cel_get_overlap_atom( const double pos[3],
+			  const int type,
+			  SPGCONST Cell * cell,
+			  const AtomBins * bins,
+			  const double symprec )
+{
+  int i, j, k, l, m, n, atom;
+  int first[3], range[3], b[3];
+  double f, symprec2;
+  double d[3];
+
+  symprec2 = symprec * symprec;
+
+  /* Only bins within margin from pos are searched. */
+  for ( i = 0; i < 3; i++ ) {
+    f = pos[i] - floor( pos[i] );
+    first[i] = (int)floor( ( f - bins->margin[i] ) * bins->mesh[i] );
+    range[i] =
+      (int)floor( ( f + bins->margin[i] ) * bins->mesh[i] ) - first[i] + 1;
+    if ( range[i] > bins->mesh[i] ) {
+      first[i] = 0;
+      range[i] = bins->mesh[i];
+    }
+    first[i] += bins->mesh[i];
+  }
+
+  for ( i = 0; i < range[0]; i++ ) {
+    b[0] = ( first[0] + i ) % bins->mesh[0];
+    for ( j = 0; j < range[1]; j++ ) {
+      b[1] = ( first[1] + j ) % bins->mesh[1];
+      for ( k = 0; k < range[2]; k++ ) {
+	b[2] = ( first[2] + k ) % bins->mesh[2];
+	l = ( b[0] * bins->mesh[1] + b[1] ) * bins->mesh[2] + b[2];
+	for ( m = bins->bin_start[l]; m < bins->bin_start[l + 1]; m++ ) {
+	  atom = bins->atoms[m];
+	  if ( cell->types[atom] != type ) {
+	    continue;
+	  }
+	  for ( n = 0; n < 3; n++ ) {
+	    d[n] = pos[n] - cell->position[atom][n];
+	    d[n] -= mat_Nint( d[n] );
+	  }
+	  mat_multiply_matrix_vector_d3( d, cell->lattice, d );
+	  if ( d[0] * d[0] + d[1] * d[1] + d[2] * d[2] < symprec2 ) {
+	    return atom;
+	  }
+	}
+      }
+    }
+  }
+
+  return -1;
+}
+
+static int get_bin_index( const double pos[3],
+			  const int mesh[3] )
+{
+  int i;
+  int b[3];
+  double f;
+
+  for ( i = 0; i < 3; i++ ) {
+    f = pos[i] - floor( pos[i] );
+    b[i] = ( (int)( f * mesh[i] ) ) % mesh[i];
+  }
+
+  return ( b[0] * mesh[1] + b[1] ) * mesh[2] + b[2];
+}
+
@@ -2,6 +2,7 @@
 /* Copyright (C) 2010 Atsushi Togo */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include "lattice.h"
 #include "hall_symbol.h"
 #include "spg_database.h"
@@ -2092,35 +2093,71 @@ static int tetra_generators[][3][9] = {
 
 
 
+#define NUM_ROTATION_CODES 19683 /* 3^9 */
+#define NUM_HALL_NUMBERS 531
+
 static int find_hall_symbol(double origin_shift[3],
 			    const Centering centering,
-			    SPGCONST Symmetry *symmetry);
+			    SPGCONST Symmetry *symmetry,
+			    double lattice[3][3],
+			    const double symprec);
+static int set_candidates(int is_candidate[],
+			  const int hall_start,
+			  const int hall_end,
+			  SPGCONST Symmetry *symmetry);
+static int get_rotation_code(SPGCONST int rot[3][3]);
 static int is_hall_symbol(double shift[3],
 			  const int hall_number,
 			  SPGCONST Symmetry *symmetry,
 			  Centering centering,
 			  SPGCONST int generators[3][9],
-			  SPGCONST double VSpU[3][9]);
+			  SPGCONST double VSpU[3][9],
+			  SPGCONST double lattice[3][3],
+			  const double symprec);
 static int is_hall_symbol_cubic(double shift[3],
 				SPGCONST Symmetry *symmetry,
-				Centering centering);
+				Centering centering,
+				double lattice[3][3],
+				const double symprec,
+				const int is_candidate[]);
 static int is_hall_symbol_hexa(double shift[3],
-			       SPGCONST Symmetry *symmetry);
+			       SPGCONST Symmetry *symmetry,
+			       SPGCONST double lattice[3][3],
+			       const double symprec,
+			       const int is_candidate[]);
 static int is_hall_symbol_rhombo(double shift[3],
-				 SPGCONST Symmetry *symmetry);
+				 SPGCONST Symmetry *symmetry,
+				 SPGCONST double lattice[3][3],
+				 const double symprec,
+				 const int is_candidate[]);
 static int is_hall_symbol_trigonal(double shift[3],
-				   SPGCONST Symmetry *symmetry);
+				   SPGCONST Symmetry *symmetry,
+				   SPGCONST double lattice[3][3],
+				   const double symprec,
+				   const int is_candidate[]);
 static int is_hall_symbol_tetra(double shift[3],
 				SPGCONST Symmetry *symmetry,
-				const Centering centering);
+				const Centering centering,
+				SPGCONST double lattice[3][3],
+				const double symprec,
+				const int is_candidate[]);
 static int is_hall_symbol_ortho(double shift[3],
 				SPGCONST Symmetry *symmetry,
-				const Centering centering);
+				const Centering centering,
+				SPGCONST double lattice[3][3],
+				const double symprec,
+				const int is_candidate[]);
 static int is_hall_symbol_monocli(double shift[3],
 				  SPGCONST Symmetry *symmetry,
-				  const Centering centering);
+				  const Centering centering,
+				  SPGCONST double lattice[3][3],
+				  const double symprec,
+				  const int is_candidate[]);
 static int is_hall_symbol_tricli(double shift[3],
-				 SPGCONST Symmetry *symmetry);
+				 SPGCONST Symmetry *symmetry,
+				 SPGCONST double lattice[3][3],
+				 const double symprec,
+				 const int is_candidate[]);
 static int get_translations(double trans[3][3],
 			    SPGCONST Symmetry *symmetry,
 			    SPGCONST int rot[3][3][3]);
@@ -2144,11 +2181,9 @@ static int set_dw(double dw[3],
 		  const Centering centering);
 static int is_match_database(const int hall_number,
 			     const double shift[3],
-			     SPGCONST Symmetry *symmetry);
-
-/* Used for passing to functions in deep */
-static double tolerance;
-static double lattice[3][3];
+			     SPGCONST Symmetry *symmetry,
+			     SPGCONST double lattice[3][3],
+			     const double symprec);
 
 int hal_get_hall_symbol(double origin_shift[3],
 			const Centering centering,
@@ -2156,58 +2191,93 @@ int hal_get_hall_symbol(double origin_shift[3],
 			SPGCONST Symmetry *symmetry,
 			const double symprec)
 {
-  int hall_number;
-
-  /* Pass tolerance and Bravais lattice to the function in deep */
-  mat_copy_matrix_d3(lattice, bravais_lattice);
-  tolerance = symprec;
-
-  hall_number = find_hall_symbol(origin_shift, centering, symmetry);
-
   /* In the case of Pa-3 (205), Bravais lattice may change. */
-  mat_copy_matrix_d3(bravais_lattice, lattice);
-  
-  return hall_number;
+  return find_hall_symbol(origin_shift,
+			  centering,
+			  symmetry,
+			  bravais_lattice,
+			  symprec);
 }
 
 static int find_hall_symbol(double origin_shift[3],
 			    const Centering centering,
-			    SPGCONST Symmetry *symmetry)
+			    SPGCONST Symmetry *symmetry,
+			    double lattice[3][3],
+			    const double symprec)
 {
   int hall_number = 0;
+  int is_candidate[NUM_HALL_NUMBERS];
+
+  /* Hall symbols whose rotations differ from those of symmetry are */
+  /* excluded before searching origin shifts. */
+  set_candidates(is_candidate, 1, NUM_HALL_NUMBERS, symmetry);
 
   /* CUBIC IT: 195-230, Hall: 489-530 */
   hall_number = is_hall_symbol_cubic(origin_shift,
 				     symmetry,
-				     centering);
+				     centering,
+				     lattice,
+				     symprec,
+				     is_candidate);
   if (hall_number) { goto end; }
 
   /* HEXA, IT: 168-194, Hall: 462-488 */
-  hall_number = is_hall_symbol_hexa(origin_shift, symmetry);
+  hall_number = is_hall_symbol_hexa(origin_shift,
+				    symmetry,
+				    lattice,
+				    symprec,
+				    is_candidate);
   if (hall_number) { goto end; }
 
   /* TRIGO, IT: 143-167, Hall: 430-461 */
-  hall_number = is_hall_symbol_trigonal(origin_shift, symmetry);
+  hall_number = is_hall_symbol_trigonal(origin_shift,
+					symmetry,
+					lattice,
+					symprec,
+					is_candidate);
   if (hall_number) { goto end; }
 
   /* RHOMB, IT: 143-167, Hall: 430-461 */
-  hall_number = is_hall_symbol_rhombo(origin_shift, symmetry);
+  hall_number = is_hall_symbol_rhombo(origin_shift,
+				      symmetry,
+				      lattice,
+				      symprec,
+				      is_candidate);
   if (hall_number) { goto end; }
 
   /* TETRA, IT: 75-142, Hall: 349-429 */
-  hall_number = is_hall_symbol_tetra(origin_shift, symmetry, centering);
+  hall_number = is_hall_symbol_tetra(origin_shift,
+				     symmetry,
+				     centering,
+				     lattice,
+				     symprec,
+				     is_candidate);
   if (hall_number) { goto end; }
   
   /* ORTHO, IT: 16-74, Hall: 108-348 */
-  hall_number = is_hall_symbol_ortho(origin_shift, symmetry, centering);
+  hall_number = is_hall_symbol_ortho(origin_shift,
+				     symmetry,
+				     centering,
+				     lattice,
+				     symprec,
+				     is_candidate);
   if (hall_number) { goto end; }
 
   /* MONOCLI, IT: 3-15, Hall: 3-107 */
-  hall_number = is_hall_symbol_monocli(origin_shift, symmetry, centering);
+  hall_number = is_hall_symbol_monocli(origin_shift,
+				       symmetry,
+				       centering,
+				       lattice,
+				       symprec,
+				       is_candidate);
   if (hall_number) { goto end; }
 
   /* TRICLI, IT: 1-2, Hall: 1-2 */
-  hall_number = is_hall_symbol_tricli(origin_shift, symmetry);
+  hall_number = is_hall_symbol_tricli(origin_shift,
+				      symmetry,
+				      lattice,
+				      symprec,
+				      is_candidate);
   if (hall_number) { goto end; }
 
  end:
@@ -2216,45 +2286,66 @@ static int find_hall_symbol(double origin_shift[3],
 
 static int is_hall_symbol_cubic(double shift[3],
 				SPGCONST Symmetry *symmetry,
-				Centering centering)
+				Centering centering,
+				double lattice[3][3],
+				const double symprec,
+				const int is_candidate[])
 {
   int i, hall_number;
+  int is_conv_candidate[NUM_HALL_NUMBERS];
+  int operation_index[2];
   Symmetry *conv_symmetry;
   double trans_mat[3][3] = { { 0, 0, 1 },
 			     { 0,-1, 0 },
 			     { 1, 0, 0 } };
 
+  /* Pa-3 (205) is also searched in another basis. */
+  conv_symmetry = NULL;
+  spgdb_get_operation_index(operation_index, 501);
+  if (operation_index[0] == symmetry->size) {
+    conv_symmetry = spa_get_conventional_symmetry(trans_mat,
+						  centering,
+						  symmetry);
+    if (! set_candidates(is_conv_candidate, 501, 502, conv_symmetry)) {
+      sym_free_symmetry(conv_symmetry);
+      conv_symmetry = NULL;
+    }
+  }
+
   for (i = 0; i < 24; i++) {
     for (hall_number = 489; hall_number < 531; hall_number++) {
       /* Special case of Pa-3 (205) */
       if (hall_number==501) {
-	if (is_hall_symbol(shift,
+	if (is_candidate[501] &&
+	    is_hall_symbol(shift,
 			   501,
 			   symmetry,
 			   centering,
 			   cubic_generators[i],
-			   cubic_VSpU[i])) { goto found; }
+			   cubic_VSpU[i],
+			   lattice,
+			   symprec)) { goto found; }
 
 	/* Try another basis */
-	conv_symmetry = spa_get_conventional_symmetry(trans_mat,
-						      centering,
-						      symmetry);
-	
-	if (is_hall_symbol(shift,
+	if (conv_symmetry != NULL &&
+	    is_hall_symbol(shift,
 			   501,
 			   conv_symmetry,
 			   centering,
 			   cubic_generators[i],
-			   cubic_VSpU[i])) {
+			   cubic_VSpU[i],
+			   lattice,
+			   symprec)) {
 	  /* Lattice is multiplied by transformation matrix. */
 	  mat_multiply_matrix_d3(lattice,
 				 lattice,
 				 trans_mat);
 	  goto found; }
 
-	sym_free_symmetry(conv_symmetry);
 	continue;
       }
+
+      if (! is_candidate[hall_number]) { continue; }
       
       if (centering==NO_CENTER) {
 	if (is_hall_symbol(shift,
@@ -2262,7 +2353,9 @@ static int is_hall_symbol_cubic(double shift[3],
 			   symmetry,
 			   centering,
 			   cubic_generators[i],
-			   cubic_VSpU[i])) { goto found; }
+			   cubic_VSpU[i],
+			   lattice,
+			   symprec)) { goto found; }
       }
 
       if (centering==BODY) {
@@ -2271,7 +2364,9 @@ static int is_hall_symbol_cubic(double shift[3],
 			   symmetry,
 			   centering,
 			   cubic_generators[i],
-			   cubic_I_VSpU[i])) { goto found; }
+			   cubic_I_VSpU[i],
+			   lattice,
+			   symprec)) { goto found; }
       }
 
       if (centering==FACE) {
@@ -2280,31 +2375,45 @@ static int is_hall_symbol_cubic(double shift[3],
 			   symmetry,
 			   centering,
 			   cubic_generators[i],
-			   cubic_F_VSpU[i])) { goto found; }
+			   cubic_F_VSpU[i],
+			   lattice,
+			   symprec)) { goto found; }
       }
     }
   }
 
+  if (conv_symmetry != NULL) {
+    sym_free_symmetry(conv_symmetry);
+  }
   return 0;
 
  found:
+  if (conv_symmetry != NULL) {
+    sym_free_symmetry(conv_symmetry);
+  }
   return hall_number;
 
 }
 
 static int is_hall_symbol_hexa(double shift[3],
-			       SPGCONST Symmetry *symmetry)
+			       SPGCONST Symmetry *symmetry,
+			       SPGCONST double lattice[3][3],
+			       const double symprec,
+			       const int is_candidate[])
 {
   int i, hall_number;
 
   for (i = 0; i < 12; i++) {
     for (hall_number = 462; hall_number < 489; hall_number++) {
+      if (! is_candidate[hall_number]) { continue; }
       if (is_hall_symbol(shift,
 			 hall_number,
 			 symmetry,
 			 NO_CENTER,
 			 hexa_generators[i],
-			 hexa_VSpU[i])) {goto found;}
+			 hexa_VSpU[i],
+			 lattice,
+			 symprec)) {goto found;}
     }
   }
 
@@ -2315,18 +2424,24 @@ static int is_hall_symbol_hexa(double shift[3],
 }
 
 static int is_hall_symbol_trigonal(double shift[3],
-				   SPGCONST Symmetry *symmetry)
+				   SPGCONST Symmetry *symmetry,
+				   SPGCONST double lattice[3][3],
+				   const double symprec,
+				   const int is_candidate[])
 {
   int i, hall_number;
 
   for (i = 0; i < 20; i++) {
     for (hall_number = 430; hall_number < 462; hall_number++) {
+      if (! is_candidate[hall_number]) { continue; }
       if (is_hall_symbol(shift,
 			 hall_number,
 			 symmetry,
 			 NO_CENTER,
 			 trigo_generators[i],
-			 trigo_VSpU[i])) { goto found; }
+			 trigo_VSpU[i],
+			 lattice,
+			 symprec)) { goto found; }
     }
   }
 
@@ -2338,18 +2453,24 @@ static int is_hall_symbol_trigonal(double shift[3],
 }
 
 static int is_hall_symbol_rhombo(double shift[3],
-				 SPGCONST Symmetry *symmetry)
+				 SPGCONST Symmetry *symmetry,
+				 SPGCONST double lattice[3][3],
+				 const double symprec,
+				 const int is_candidate[])
 {
   int i, hall_number;
 
   for (i = 0; i < 20; i++) {
     for (hall_number = 430; hall_number < 462; hall_number++) {
+      if (! is_candidate[hall_number]) { continue; }
       if (is_hall_symbol(shift,
 			 hall_number,
 			 symmetry,
 			 NO_CENTER,
 			 rhombo_generators[i],
-			 rhombo_VSpU[i])) { goto found; }
+			 rhombo_VSpU[i],
+			 lattice,
+			 symprec)) { goto found; }
     }
   }
 
@@ -2362,19 +2483,25 @@ static int is_hall_symbol_rhombo(double shift[3],
 
 static int is_hall_symbol_tetra(double shift[3],
 				SPGCONST Symmetry *symmetry,
-				const Centering centering)
+				const Centering centering,
+				SPGCONST double lattice[3][3],
+				const double symprec,
+				const int is_candidate[])
 {
   int i,  hall_number;
 
   for (i = 0; i < 12; i++) {
     for (hall_number = 349; hall_number < 429; hall_number++) {
+      if (! is_candidate[hall_number]) { continue; }
       if (centering==NO_CENTER) {
 	if (is_hall_symbol(shift,
 			   hall_number,
 			   symmetry,
 			   centering,
 			   tetra_generators[i],
-			   tetra_VSpU[i])) { goto found; }
+			   tetra_VSpU[i],
+			   lattice,
+			   symprec)) { goto found; }
       }
 
       if (centering==BODY) {
@@ -2383,7 +2510,9 @@ static int is_hall_symbol_tetra(double shift[3],
 			   symmetry,
 			   centering,
 			   tetra_generators[i],
-			   tetra_I_VSpU[i])) { goto found; }
+			   tetra_I_VSpU[i],
+			   lattice,
+			   symprec)) { goto found; }
       }
     }
   }
@@ -2396,20 +2525,26 @@ static int is_hall_symbol_tetra(double shift[3],
 
 static int is_hall_symbol_ortho(double shift[3],
 				SPGCONST Symmetry *symmetry,
-				const Centering centering)
+				const Centering centering,
+				SPGCONST double lattice[3][3],
+				const double symprec,
+				const int is_candidate[])
 {
   int hall_number;
   int i;
 
   for (i = 0; i < 12; i++) {
     for (hall_number = 108; hall_number < 348; hall_number++) {
+      if (! is_candidate[hall_number]) { continue; }
       if (centering==NO_CENTER) {
 	if (is_hall_symbol(shift,
 			   hall_number,
 			   symmetry,
 			   centering,
 			   ortho_generators[i],
-			   ortho_VSpU[i])) { goto found; }
+			   ortho_VSpU[i],
+			   lattice,
+			   symprec)) { goto found; }
       }
 
       if (centering==BODY) {
@@ -2418,7 +2553,9 @@ static int is_hall_symbol_ortho(double shift[3],
 			   symmetry,
 			   centering,
 			   ortho_generators[i],
-			   ortho_I_VSpU[i])) { goto found; }
+			   ortho_I_VSpU[i],
+			   lattice,
+			   symprec)) { goto found; }
       }
 
       if (centering==FACE) {
@@ -2427,7 +2564,9 @@ static int is_hall_symbol_ortho(double shift[3],
 			   symmetry,
 			   centering,
 			   ortho_generators[i],
-			   ortho_F_VSpU[i])) { goto found; }
+			   ortho_F_VSpU[i],
+			   lattice,
+			   symprec)) { goto found; }
       }
 
       if (centering==A_FACE) {
@@ -2436,7 +2575,9 @@ static int is_hall_symbol_ortho(double shift[3],
 			   symmetry,
 			   centering,
 			   ortho_generators[i],
-			   ortho_A_VSpU[i])) { goto found; }
+			   ortho_A_VSpU[i],
+			   lattice,
+			   symprec)) { goto found; }
       }
 
       if (centering==B_FACE) {
@@ -2445,7 +2586,9 @@ static int is_hall_symbol_ortho(double shift[3],
 			   symmetry,
 			   centering,
 			   ortho_generators[i],
-			   ortho_B_VSpU[i])) { goto found; }
+			   ortho_B_VSpU[i],
+			   lattice,
+			   symprec)) { goto found; }
       }
 
       if (centering==C_FACE) {
@@ -2454,7 +2597,9 @@ static int is_hall_symbol_ortho(double shift[3],
 			   symmetry,
 			   centering,
 			   ortho_generators[i],
-			   ortho_C_VSpU[i])) { goto found; }
+			   ortho_C_VSpU[i],
+			   lattice,
+			   symprec)) { goto found; }
       }
     }
   }
@@ -2468,20 +2613,26 @@ static int is_hall_symbol_ortho(double shift[3],
 
 static int is_hall_symbol_monocli(double shift[3],
 				  SPGCONST Symmetry *symmetry,
-				  const Centering centering)
+				  const Centering centering,
+				  SPGCONST double lattice[3][3],
+				  const double symprec,
+				  const int is_candidate[])
 {
   int hall_number;
   int i;
 
   for (i = 0; i < 12; i++) {
     for (hall_number = 3; hall_number < 108; hall_number++) {
+      if (! is_candidate[hall_number]) { continue; }
       if (centering==NO_CENTER) {
 	if (is_hall_symbol(shift,
 			   hall_number,
 			   symmetry,
 			   centering,
 			   monocli_generators[i],
-			   monocli_VSpU[i])) {goto found;}
+			   monocli_VSpU[i],
+			   lattice,
+			   symprec)) {goto found;}
       }
 
       if (centering==A_FACE) {
@@ -2490,7 +2641,9 @@ static int is_hall_symbol_monocli(double shift[3],
 			   symmetry,
 			   centering,
 			   monocli_generators[i],
-			   monocli_A_VSpU[i])) {goto found;}
+			   monocli_A_VSpU[i],
+			   lattice,
+			   symprec)) {goto found;}
       }
 
       if (centering==B_FACE) {
@@ -2499,7 +2652,9 @@ static int is_hall_symbol_monocli(double shift[3],
 			   symmetry,
 			   centering,
 			   monocli_generators[i],
-			   monocli_B_VSpU[i])) {goto found;}
+			   monocli_B_VSpU[i],
+			   lattice,
+			   symprec)) {goto found;}
       }
 
       if (centering==C_FACE) {
@@ -2508,7 +2663,9 @@ static int is_hall_symbol_monocli(double shift[3],
 			   symmetry,
 			   centering,
 			   monocli_generators[i],
-			   monocli_C_VSpU[i])) {goto found;}
+			   monocli_C_VSpU[i],
+			   lattice,
+			   symprec)) {goto found;}
       }
 
       if (centering==BODY) {
@@ -2517,7 +2674,9 @@ static int is_hall_symbol_monocli(double shift[3],
 			   symmetry,
 			   centering,
 			   monocli_generators[i],
-			   monocli_I_VSpU[i])) {goto found;}
+			   monocli_I_VSpU[i],
+			   lattice,
+			   symprec)) {goto found;}
       }
 
     
@@ -2531,18 +2690,24 @@ static int is_hall_symbol_monocli(double shift[3],
 }
 
 static int is_hall_symbol_tricli(double shift[3],
-				 SPGCONST Symmetry *symmetry)
+				 SPGCONST Symmetry *symmetry,
+				 SPGCONST double lattice[3][3],
+				 const double symprec,
+				 const int is_candidate[])
 {
   int i, hall_number;
 
   for (i = 0; i < 2; i++) {
     for (hall_number = 1; hall_number < 3; hall_number++) {
+      if (! is_candidate[hall_number]) { continue; }
       if (is_hall_symbol(shift,
 			 hall_number,
 			 symmetry,
 			 NO_CENTER,
 			 tricli_generators[i],
-			 tricli_VSpU[i])) { goto found; }
+			 tricli_VSpU[i],
+			 lattice,
+			 symprec)) { goto found; }
     }
   }
 
@@ -2553,6 +2718,100 @@ static int is_hall_symbol_tricli(double shift[3],
 
 }
 
+/* is_candidate[hall_number] is set 1 for hall_start <= hall_number < */
+/* hall_end if the database has the same number of operations and the */
+/* same set of rotations as symmetry, otherwise 0. This is necessary for */
+/* is_match_database, and is checked by the integer codes of rotations */
+/* of spg_database.c. Number of candidates is returned. */
+static int set_candidates(int is_candidate[],
+			  const int hall_start,
+			  const int hall_end,
+			  SPGCONST Symmetry *symmetry)
+{
+  int i, hall_number, code, num_codes, num_found, num_candidates;
+  int operation_index[2];
+  char *is_rotation;
+
+  for (hall_number = hall_start; hall_number < hall_end; hall_number++) {
+    is_candidate[hall_number] = 0;
+  }
+
+  is_rotation = (char*)malloc(sizeof(char) * NUM_ROTATION_CODES);
+  for (i = 0; i < NUM_ROTATION_CODES; i++) {
+    is_rotation[i] = 0;
+  }
+
+  num_codes = 0;
+  for (i = 0; i < symmetry->size; i++) {
+    code = get_rotation_code(symmetry->rot[i]);
+    if (code < 0) {
+      /* This rotation is not found in the database. */
+      free(is_rotation);
+      return 0;
+    }
+    if (! is_rotation[code]) {
+      is_rotation[code] = 1;
+      num_codes++;
+    }
+  }
+
+  num_candidates = 0;
+  for (hall_number = hall_start; hall_number < hall_end; hall_number++) {
+    spgdb_get_operation_index(operation_index, hall_number);
+    if (! (operation_index[0] == symmetry->size)) {
+      continue;
+    }
+
+    /* Rotations found in symmetry are marked 2 during the check. */
+    num_found = 0;
+    for (i = 0; i < operation_index[0]; i++) {
+      code = spgdb_get_rotation_code(operation_index[1] + i);
+      if (! is_rotation[code]) {
+	break;
+      }
+      if (is_rotation[code] == 1) {
+	is_rotation[code] = 2;
+	num_found++;
+      }
+    }
+
+    if (i == operation_index[0] && num_found == num_codes) {
+      is_candidate[hall_number] = 1;
+      num_candidates++;
+    }
+
+    for (i = 0; i < operation_index[0]; i++) {
+      code = spgdb_get_rotation_code(operation_index[1] + i);
+      if (is_rotation[code] == 2) {
+	is_rotation[code] = 1;
+      }
+    }
+  }
+
+  free(is_rotation);
+
+  return num_candidates;
+}
+
+/* Ternary code of rotation matrix as in spg_database.c, */
+/* or -1 if an element is not one of -1, 0, 1. */
+static int get_rotation_code(SPGCONST int rot[3][3])
+{
+  int i, j, code;
+
+  code = 0;
+  for (i = 0; i < 3; i++) {
+    for (j = 0; j < 3; j++) {
+      if (rot[i][j] < -1 || rot[i][j] > 1) {
+	return -1;
+      }
+      code = code * 3 + rot[i][j] + 1;
+    }
+  }
+
+  return code;
+}
+
 static void unpack_generators(int rot[3][3][3], int generators[3][9])
 {
   int i, j, k;
@@ -2570,7 +2829,9 @@ static int is_hall_symbol(double shift[3],
 			  SPGCONST Symmetry *symmetry,
 			  Centering centering,
 			  SPGCONST int generators[3][9],
-			  SPGCONST double VSpU[3][9])
+			  SPGCONST double VSpU[3][9],
+			  SPGCONST double lattice[3][3],
+			  const double symprec)
 {
   int is_origin_shift;
   int operation_index[2];
@@ -2595,7 +2856,9 @@ static int is_hall_symbol(double shift[3],
     if (is_origin_shift) {
       if (is_match_database(hall_number,
 			    shift,
-			    symmetry)) {
+			    symmetry,
+			    lattice,
+			    symprec)) {
 	debug_print("Match with database %d\n", hall_number);
 	goto found;
       }
@@ -2849,34 +3112,42 @@ static int set_dw(double dw[3],
 
 static int is_match_database(const int hall_number,
 			     const double origin_shift[3],
-			     SPGCONST Symmetry *symmetry)
+			     SPGCONST Symmetry *symmetry,
+			     SPGCONST double lattice[3][3],
+			     const double symprec)
 {
   int i, j, k, is_found;
   int operation_index[2];
-  int rot_db[3][3];
   int found_list[192];
-  double trans_db[3], conv_trans[3], tmp_vec[3];
+  int (*rot_db)[3][3];
+  double (*trans_db)[3];
+  double conv_trans[3], tmp_vec[3];
 
   spgdb_get_operation_index(operation_index, hall_number);
 
+  /* Operations are decoded once instead of for each of symmetry. */
+  rot_db = (int (*)[3][3])malloc(sizeof(int[3][3]) * operation_index[0]);
+  trans_db = (double (*)[3])malloc(sizeof(double[3]) * operation_index[0]);
+  for (j = 0; j < operation_index[0]; j++) {
+    spgdb_get_operation(rot_db[j], trans_db[j], operation_index[1] + j);
+  }
+
   for (i = 0; i < symmetry->size; i++) { found_list[i] = 0; }
 
   for (i = 0; i < symmetry->size; i++) {
     is_found = 0;
     for (j = 0; j < operation_index[0]; j++) {
       /* rotation matrix matching and set difference of translations */
-      spgdb_get_operation(rot_db, trans_db, operation_index[1]+j);
-
-      if (mat_check_identity_matrix_i3(symmetry->rot[i], rot_db)) {
-	mat_multiply_matrix_vector_id3(tmp_vec, rot_db, origin_shift);
+      if (mat_check_identity_matrix_i3(symmetry->rot[i], rot_db[j])) {
+	mat_multiply_matrix_vector_id3(tmp_vec, rot_db[j], origin_shift);
 	for (k = 0; k < 3; k++) {
 	  conv_trans[k] = tmp_vec[k] + symmetry->trans[i][k] - origin_shift[k];
 	}
 	
 	if (cel_is_overlap(conv_trans,
-			   trans_db,
+			   trans_db[j],
 			   lattice,
-			   tolerance) && (! found_list[j])) {
+			   symprec) && (! found_list[j])) {
 	  found_list[j] = 1;
 	  is_found = 1;
 	  
@@ -2889,9 +3160,13 @@ static int is_match_database(const int hall_number,
     }
   }
 
+  free(rot_db);
+  free(trans_db);
   return 1;
 
  not_found:
+  free(rot_db);
+  free(trans_db);
   return 0;
 }
 
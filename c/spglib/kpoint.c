@@ -49,12 +49,28 @@ static int get_ir_reciprocal_mesh(int grid_address[][3],
 				  const int mesh[3],
 				  const int is_shift[3],
 				  const MatINT * rot_reciprocal);
-static int
-get_ir_reciprocal_mesh_openmp(int grid_address[][3],
+static int get_ir_grid_points(int ir_grid_points[],
+			      int ir_weights[],
 			      int map[],
+			      const int max_num_ir,
 			      const int mesh[3],
 			      const int is_shift[3],
-			      const MatINT* rot_reciprocal);
+			      const MatINT * rot_reciprocal);
+static int get_ir_grid_points_in_slab(int **ir_grid_points,
+				      int **ir_weights,
+				      int stamp[],
+				      const int slab_start,
+				      const int slab_size,
+				      const int mesh[3],
+				      const int is_shift[3],
+				      const MatINT * rot_reciprocal,
+				      const int is_closed);
+static int is_mesh_closed(const int mesh[3],
+			  const int is_shift[3],
+			  const MatINT * rot_reciprocal);
+static void get_grid_addresses(int grid_address[][3],
+			       const int mesh[3],
+			       const int is_shift[3]);
 static int relocate_BZ_grid_address(int bz_grid_address[][3],
 				    int bz_map[],
 				    SPGCONST int grid_address[][3],
@@ -68,6 +84,14 @@ static int get_ir_triplets_at_q(int map_triplets[],
 				const int grid_point,
 				const int mesh[3],
 				const MatINT * rot_reciprocal);
+static MatINT *get_point_group_reciprocal_at_grid_point(const MatINT * rot_reciprocal,
+							const int grid_point,
+							const int mesh[3]);
+static int get_map_triplets(int map_triplets[],
+			    const int map_q[],
+			    const int num_ir_q,
+			    const int grid_point,
+			    const int mesh[3]);
 static int get_BZ_triplets_at_q(int triplets[][3],
 				const int grid_point,
 				SPGCONST int bz_grid_address[][3],
@@ -75,12 +99,31 @@ static int get_BZ_triplets_at_q(int triplets[][3],
 				const int map_triplets[],
 				const int num_map_triplets,
 				const int mesh[3]);
+static int get_BZ_triplets_at_qs(int triplets[][3],
+				 int weights[],
+				 int triplets_offsets[],
+				 int map_triplets[],
+				 int map_q[],
+				 const int max_num_triplets,
+				 const int grid_points[],
+				 const int num_grid_points,
+				 SPGCONST int bz_grid_address[][3],
+				 const int bz_map[],
+				 const int mesh[3],
+				 const MatINT * rot_reciprocal);
+static int is_same_rotations(const MatINT * rot_a, const MatINT * rot_b);
 static int get_third_q_of_triplets_at_q(int address[3][3],
 					const int q_index,
+					SPGCONST int bz_grid_address[][3],
 					const int bz_map[],
-					const int mesh[3],
-					const int bzmesh[3],
-					const int bzmesh_double[3]);
+					const int mesh[3]);
+static int get_bz_grid_point(const int address[3],
+			     const int mesh[3],
+			     SPGCONST int bz_grid_address[][3],
+			     const int bz_map[]);
+static int is_same_address_modulo(const int address_a[3],
+				  const int address_b[3],
+				  const int m[3]);
 static int get_grid_point_double_mesh(const int address_double[3],
 				      const int mesh[3]);
 static int get_grid_point_single_mesh(const int address[3],
@@ -127,21 +170,11 @@ int kpt_get_irreducible_reciprocal_mesh(int grid_address[][3],
 
   rot_reciprocal = get_point_group_reciprocal(rotations, is_time_reversal);
 
-#ifdef _OPENMP
-  num_ir = get_ir_reciprocal_mesh_openmp(grid_address,
-					 map,
-					 mesh,
-					 is_shift,
-					 rot_reciprocal);
-  
-#else
   num_ir = get_ir_reciprocal_mesh(grid_address,
 				  map,
 				  mesh,
 				  is_shift,
 				  rot_reciprocal);
-#endif
-  
   mat_free_MatINT(rot_reciprocal);
   return num_ir;
 }
@@ -166,24 +199,58 @@ int kpt_get_stabilized_reciprocal_mesh(int grid_address[][3],
 						       num_q,
 						       qpoints);
 
-#ifdef _OPENMP
-  num_ir = get_ir_reciprocal_mesh_openmp(grid_address,
-					 map,
-					 mesh,
-					 is_shift,
-					 rot_reciprocal_q);
-#else
   num_ir = get_ir_reciprocal_mesh(grid_address,
 				  map,
 				  mesh,
 				  is_shift,
 				  rot_reciprocal_q);
-#endif
   mat_free_MatINT(rot_reciprocal_q);
   mat_free_MatINT(rot_reciprocal);
   return num_ir;
 }
 
+/* Irreducible grid points in ascending order and their weights are */
+/* returned up to max_num_ir, and the number of all irreducible grid */
+/* points is the return value. 'map' may be NULL, then memory of the */
+/* size of the mesh is not needed. If num_q > 0, the rotations are */
+/* restricted to those leaving the set of qpoints invariant. */
+int kpt_get_ir_grid_points(int ir_grid_points[],
+			   int ir_weights[],
+			   int map[],
+			   const int max_num_ir,
+			   const int mesh[3],
+			   const int is_shift[3],
+			   const int is_time_reversal,
+			   const MatINT * rotations,
+			   const int num_q,
+			   SPGCONST double qpoints[][3])
+{
+  int num_ir;
+  MatINT *rot_reciprocal, *rot_reciprocal_q;
+  double tolerance;
+
+  rot_reciprocal = get_point_group_reciprocal(rotations, is_time_reversal);
+  if (num_q > 0) {
+    tolerance = 0.01 / (mesh[0] + mesh[1] + mesh[2]);
+    rot_reciprocal_q = get_point_group_reciprocal_with_q(rot_reciprocal,
+							 tolerance,
+							 num_q,
+							 qpoints);
+    mat_free_MatINT(rot_reciprocal);
+    rot_reciprocal = rot_reciprocal_q;
+  }
+
+  num_ir = get_ir_grid_points(ir_grid_points,
+			      ir_weights,
+			      map,
+			      max_num_ir,
+			      mesh,
+			      is_shift,
+			      rot_reciprocal);
+  mat_free_MatINT(rot_reciprocal);
+  return num_ir;
+}
+
 void kpt_get_grid_points_by_rotations(int rot_grid_points[],
 				      const int address_orig[3],
 				      const MatINT * rot_reciprocal,
@@ -211,13 +278,13 @@ void kpt_get_BZ_grid_points_by_rotations(int rot_grid_points[],
 					 const MatINT * rot_reciprocal,
 					 const int mesh[3],
 					 const int is_shift[3],
+					 SPGCONST int bz_grid_address[][3],
 					 const int bz_map[])
 {
-  int i;
-  int address_double_orig[3], address_double[3], mesh_double[3], bzmesh_double[3];
+  int i, j;
+  int address_double_orig[3], address_double[3], address[3], bzmesh_double[3];
 
   for (i = 0; i < 3; i++) {
-    mesh_double[i] = mesh[i] * 2;
     bzmesh_double[i] = mesh[i] * 4;
     address_double_orig[i] = address_orig[i] * 2 + is_shift[i];
   }
@@ -226,8 +293,13 @@ void kpt_get_BZ_grid_points_by_rotations(int rot_grid_points[],
 				  rot_reciprocal->mat[i],
 				  address_double_orig);
     get_vector_modulo(address_double, bzmesh_double);
-    rot_grid_points[i] =
-      bz_map[get_grid_point_double_mesh(address_double, mesh_double)];
+    for (j = 0; j < 3; j++) {
+      address[j] = (address_double[j] - address_double[j] % 2) / 2;
+    }
+    rot_grid_points[i] = get_bz_grid_point(address,
+					   mesh,
+					   bz_grid_address,
+					   bz_map);
   }
 }
 
@@ -285,6 +357,47 @@ int kpt_get_BZ_triplets_at_q(int triplets[][3],
 			      mesh);
 }
 
+/* Triplets at the grid points are stored one after another. Those */
+/* at grid_points[i] are triplets[triplets_offsets[i]] to */
+/* triplets[triplets_offsets[i + 1] - 1] with their weights, and */
+/* triplets_offsets[0 .. num_grid_points] are always filled. Triplets */
+/* and weights are written only up to max_num_triplets, and the */
+/* total number of triplets is returned. map_triplets and map_q */
+/* have the shape of [num_grid_points][prod(mesh)] or are NULL. */
+int kpt_get_BZ_triplets_at_qs(int triplets[][3],
+			      int weights[],
+			      int triplets_offsets[],
+			      int map_triplets[],
+			      int map_q[],
+			      const int max_num_triplets,
+			      const int grid_points[],
+			      const int num_grid_points,
+			      SPGCONST int bz_grid_address[][3],
+			      const int bz_map[],
+			      const int mesh[3],
+			      const int is_time_reversal,
+			      const MatINT * rotations)
+{
+  int num_triplets;
+  MatINT *rot_reciprocal;
+
+  rot_reciprocal = get_point_group_reciprocal(rotations, is_time_reversal);
+  num_triplets = get_BZ_triplets_at_qs(triplets,
+				       weights,
+				       triplets_offsets,
+				       map_triplets,
+				       map_q,
+				       max_num_triplets,
+				       grid_points,
+				       num_grid_points,
+				       bz_grid_address,
+				       bz_map,
+				       mesh,
+				       rot_reciprocal);
+  mat_free_MatINT(rot_reciprocal);
+  return num_triplets;
+}
+
 void kpt_get_neighboring_grid_points(int neighboring_grid_points[],
 				     const int grid_point,
 				     SPGCONST int relative_grid_address[][3],
@@ -293,27 +406,16 @@ void kpt_get_neighboring_grid_points(int neighboring_grid_points[],
 				     SPGCONST int bz_grid_address[][3],
 				     const int bz_map[])
 {
-  int mesh_double[3], bzmesh[3], bzmesh_double[3],
-    address_double[3], bz_address_double[3];
+  int address[3];
   int i, j, bz_gp;
 
-  for (i = 0; i < 3; i++) {
-    mesh_double[i] = mesh[i] * 2;
-    bzmesh[i] = mesh[i] * 2;
-    bzmesh_double[i] = bzmesh[i] * 2;
-  }
   for (i = 0; i < num_relative_grid_address; i++) {
     for (j = 0; j < 3; j++) {
-      address_double[j] = (bz_grid_address[grid_point][j] +
-			   relative_grid_address[i][j]) * 2;
-      bz_address_double[j] = address_double[j];
+      address[j] = bz_grid_address[grid_point][j] + relative_grid_address[i][j];
     }
-    get_vector_modulo(bz_address_double, bzmesh_double);
-    bz_gp = bz_map[get_grid_point_double_mesh(bz_address_double, bzmesh)];
+    bz_gp = get_bz_grid_point(address, mesh, bz_grid_address, bz_map);
     if (bz_gp == -1) {
-      get_vector_modulo(address_double, mesh_double);
-      neighboring_grid_points[i] =
-	get_grid_point_double_mesh(address_double, mesh);
+      neighboring_grid_points[i] = kpt_get_grid_point(address, mesh);
     } else {
       neighboring_grid_points[i] = bz_gp;
     }
@@ -440,138 +542,225 @@ static int get_ir_reciprocal_mesh(int grid_address[][3],
 				  const int is_shift[3],
 				  const MatINT *rot_reciprocal)
 {
-  /* In the following loop, mesh is doubled. */
-  /* Even and odd mesh numbers correspond to */
-  /* is_shift[i] are 0 or 1, respectively. */
-  /* is_shift = [0,0,0] gives Gamma center mesh. */
   /* grid: reducible grid points */
   /* map: the mapping from each point to ir-point. */
+  get_grid_addresses(grid_address, mesh, is_shift);
+  return get_ir_grid_points(NULL,
+			    NULL,
+			    map,
+			    0,
+			    mesh,
+			    is_shift,
+			    rot_reciprocal);
+}
 
-  int i, j, k, l, grid_point, grid_point_rot, num_ir = 0;
-  int address_double[3], address_rot[3], mesh_double[3];
+/* Orbits of grid points are walked once per slab, where a slab is a */
+/* range of grid points sharing the slowest running index. The first */
+/* unvisited point of an orbit in a slab stamps all its images falling */
+/* into the same slab by the smallest grid point of the orbit, so that */
+/* each slab is written by only one thread. map[i] is the smallest grid */
+/* point of the orbit of i, which is irreducible. */
+static int get_ir_grid_points(int ir_grid_points[],
+			      int ir_weights[],
+			      int map[],
+			      const int max_num_ir,
+			      const int mesh[3],
+			      const int is_shift[3],
+			      const MatINT * rot_reciprocal)
+{
+  int i, j, num_slabs, slab_size, num_ir, is_closed;
+  int *stamp, *num_ir_slab;
+  int **ir_slab, **weights_slab;
 
-  for (i = 0; i < 3; i++) {
-    mesh_double[i] = mesh[i] * 2;
-  }
+#ifndef GRID_ORDER_XYZ
+  num_slabs = mesh[2];
+#else
+  num_slabs = mesh[0];
+#endif
+  slab_size = mesh[0] * mesh[1] * mesh[2] / num_slabs;
+  is_closed = is_mesh_closed(mesh, is_shift, rot_reciprocal);
 
-  /* "-1" means the element is not touched yet. */
-  for (i = 0; i < mesh[0] * mesh[1] * mesh[2]; i++) {
-    map[i] = -1;
+  num_ir_slab = (int*)malloc(sizeof(int) * num_slabs);
+  ir_slab = (int**)malloc(sizeof(int*) * num_slabs);
+  weights_slab = (int**)malloc(sizeof(int*) * num_slabs);
+
+#pragma omp parallel for schedule(dynamic) private(stamp)
+  for (i = 0; i < num_slabs; i++) {
+    if (map) {
+      stamp = map + i * slab_size;
+    } else {
+      stamp = (int*)malloc(sizeof(int) * slab_size);
+    }
+    num_ir_slab[i] = get_ir_grid_points_in_slab(ir_slab + i,
+						weights_slab + i,
+						stamp,
+						i * slab_size,
+						slab_size,
+						mesh,
+						is_shift,
+						rot_reciprocal,
+						is_closed);
+    if (! map) {
+      free(stamp);
+    }
   }
 
-#ifndef GRID_ORDER_XYZ
-  for (i = 0; i < mesh[2]; i++) {
-    for (j = 0; j < mesh[1]; j++) {
-      for (k = 0; k < mesh[0]; k++) {
-	address_double[0] = k * 2 + is_shift[0];
-	address_double[1] = j * 2 + is_shift[1];
-	address_double[2] = i * 2 + is_shift[2];
-#else
-  for (i = 0; i < mesh[0]; i++) {
-    for (j = 0; j < mesh[1]; j++) {
-      for (k = 0; k < mesh[2]; k++) {
-  	address_double[0] = i * 2 + is_shift[0];
-  	address_double[1] = j * 2 + is_shift[1];
-  	address_double[2] = k * 2 + is_shift[2];
-#endif	
-
-	grid_point = get_grid_point_double_mesh(address_double, mesh);
-	get_grid_address(grid_address[grid_point], address_double, mesh);
-
-	for (l = 0; l < rot_reciprocal->size; l++) {
-	  mat_multiply_matrix_vector_i3(address_rot,
-					rot_reciprocal->mat[l],
-					address_double);
-	  get_vector_modulo(address_rot, mesh_double);
-	  grid_point_rot = get_grid_point_double_mesh(address_rot, mesh);
-
-	  if (grid_point_rot > -1) { /* Invalid if even --> odd or odd --> even */
-	    if (map[grid_point_rot] > -1) {
-	      map[grid_point] = map[grid_point_rot];
-	      break;
-	    }
-	  }
+  num_ir = 0;
+  for (i = 0; i < num_slabs; i++) {
+    for (j = 0; j < num_ir_slab[i]; j++) {
+      if (num_ir < max_num_ir) {
+	if (ir_grid_points) {
+	  ir_grid_points[num_ir] = ir_slab[i][j];
 	}
-	
-	if (map[grid_point] == -1) {
-	  map[grid_point] = grid_point;
-	  num_ir++;
+	if (ir_weights) {
+	  ir_weights[num_ir] = weights_slab[i][j];
 	}
       }
+      num_ir++;
     }
+    free(ir_slab[i]);
+    free(weights_slab[i]);
   }
 
+  free(weights_slab);
+  free(ir_slab);
+  free(num_ir_slab);
+
   return num_ir;
 }
 
-static int
-get_ir_reciprocal_mesh_openmp(int grid_address[][3],
-			      int map[],
-			      const int mesh[3],
-			      const int is_shift[3],
-			      const MatINT * rot_reciprocal)
+/* stamp[slab_size] receives the map of the grid points in the slab. */
+/* Irreducible grid points found in the slab and their weights are */
+/* allocated and returned with their number. */
+static int get_ir_grid_points_in_slab(int **ir_grid_points,
+				      int **ir_weights,
+				      int stamp[],
+				      const int slab_start,
+				      const int slab_size,
+				      const int mesh[3],
+				      const int is_shift[3],
+				      const MatINT * rot_reciprocal,
+				      const int is_closed)
 {
-  int i, j, k, l, grid_point, grid_point_rot, num_ir;
+  int i, j, grid_point, min_grid_point, num_stab, num_ir, size;
   int address_double[3], address_rot[3], mesh_double[3];
+  int *grid_points_rot;
 
   for (i = 0; i < 3; i++) {
     mesh_double[i] = mesh[i] * 2;
   }
 
-#ifndef GRID_ORDER_XYZ
-#pragma omp parallel for private(j, k, l, grid_point, grid_point_rot, address_double, address_rot)
-  for (i = 0; i < mesh[2]; i++) {
-    for (j = 0; j < mesh[1]; j++) {
-      for (k = 0; k < mesh[0]; k++) {
-	address_double[0] = k * 2 + is_shift[0];
-	address_double[1] = j * 2 + is_shift[1];
-	address_double[2] = i * 2 + is_shift[2];
-#else
-#pragma omp parallel for private(j, k, l, grid_point, grid_point_rot, address_double, address_rot)
-  for (i = 0; i < mesh[0]; i++) {
-    for (j = 0; j < mesh[1]; j++) {
-      for (k = 0; k < mesh[2]; k++) {
-  	address_double[0] = i * 2 + is_shift[0];
-  	address_double[1] = j * 2 + is_shift[1];
-  	address_double[2] = k * 2 + is_shift[2];
-#endif	
-
-	grid_point = get_grid_point_double_mesh(address_double, mesh);
-	map[grid_point] = grid_point;
-	get_grid_address(grid_address[grid_point], address_double, mesh);
-
-	for (l = 0; l < rot_reciprocal->size; l++) {
-	  mat_multiply_matrix_vector_i3(address_rot,
-					rot_reciprocal->mat[l],
-					address_double);
-	  get_vector_modulo(address_rot, mesh_double);
-	  grid_point_rot = get_grid_point_double_mesh(address_rot, mesh);
-
-	  if (grid_point_rot > -1) { /* Invalid if even --> odd or odd --> even */
-	    if (grid_point_rot < map[grid_point]) {
-	      map[grid_point] = grid_point_rot;
-	    }
-	  }
-	}
+  grid_points_rot = (int*)malloc(sizeof(int) * rot_reciprocal->size);
+  size = 16;
+  *ir_grid_points = (int*)malloc(sizeof(int) * size);
+  *ir_weights = (int*)malloc(sizeof(int) * size);
+  num_ir = 0;
+
+  /* "-1" means the element is not touched yet. */
+  for (i = 0; i < slab_size; i++) {
+    stamp[i] = -1;
+  }
+
+  for (i = 0; i < slab_size; i++) {
+    if (stamp[i] > -1) {
+      continue;
+    }
+
+    grid_point = slab_start + i;
+    grid_point_to_address_double(address_double, grid_point, mesh, is_shift);
+    min_grid_point = grid_point;
+    num_stab = 0;
+    for (j = 0; j < rot_reciprocal->size; j++) {
+      mat_multiply_matrix_vector_i3(address_rot,
+				    rot_reciprocal->mat[j],
+				    address_double);
+      get_vector_modulo(address_rot, mesh_double);
+      grid_points_rot[j] = get_grid_point_double_mesh(address_rot, mesh);
+      if (grid_points_rot[j] < min_grid_point) {
+	min_grid_point = grid_points_rot[j];
+      }
+      if (grid_points_rot[j] == grid_point) {
+	num_stab++;
       }
     }
-  }
 
-  num_ir = 0;
+    /* Images are not an orbit unless the mesh is closed. */
+    if (is_closed) {
+      for (j = 0; j < rot_reciprocal->size; j++) {
+	if (grid_points_rot[j] >= slab_start &&
+	    grid_points_rot[j] < slab_start + slab_size) {
+	  stamp[grid_points_rot[j] - slab_start] = min_grid_point;
+	}
+      }
+    } else {
+      stamp[i] = min_grid_point;
+    }
 
-#pragma omp parallel for reduction(+:num_ir)
-  for (i = 0; i < mesh[0] * mesh[1] * mesh[2]; i++) {
-    if (map[i] == i) {
+    if (min_grid_point == grid_point) {
+      if (num_ir == size) {
+	size *= 2;
+	*ir_grid_points = (int*)realloc(*ir_grid_points, sizeof(int) * size);
+	*ir_weights = (int*)realloc(*ir_weights, sizeof(int) * size);
+      }
+      (*ir_grid_points)[num_ir] = grid_point;
+      (*ir_weights)[num_ir] = rot_reciprocal->size / num_stab;
       num_ir++;
     }
   }
-  
+
+  free(grid_points_rot);
+
   return num_ir;
 }
 
+/* Rotations map the mesh onto itself if the mesh is commensurate */
+/* with them and the shift is not changed from even to odd or odd */
+/* to even. */
+static int is_mesh_closed(const int mesh[3],
+			  const int is_shift[3],
+			  const MatINT * rot_reciprocal)
+{
+  int i, j, k;
+  int shift_rot[3];
+
+  for (i = 0; i < rot_reciprocal->size; i++) {
+    for (j = 0; j < 3; j++) {
+      for (k = 0; k < 3; k++) {
+	if ((rot_reciprocal->mat[i][j][k] * mesh[k]) % mesh[j] != 0) {
+	  return 0;
+	}
+      }
+    }
+    mat_multiply_matrix_vector_i3(shift_rot, rot_reciprocal->mat[i], is_shift);
+    for (j = 0; j < 3; j++) {
+      if ((shift_rot[j] - is_shift[j]) % 2 != 0) {
+	return 0;
+      }
+    }
+  }
+  return 1;
+}
+
+static void get_grid_addresses(int grid_address[][3],
+			       const int mesh[3],
+			       const int is_shift[3])
+{
+  int i;
+  int address_double[3];
+
+#pragma omp parallel for private(address_double)
+  for (i = 0; i < mesh[0] * mesh[1] * mesh[2]; i++) {
+    grid_point_to_address_double(address_double, i, mesh, is_shift);
+    get_grid_address(grid_address[i], address_double, mesh);
+  }
+}
+
 /* Relocate grid addresses to first Brillouin zone */
 /* bz_grid_address[prod(mesh + 1)][3] */
-/* bz_map[prod(mesh * 2)] */
+/* bz_map[prod(mesh) + 1] */
+/* Grid points translationally equivalent to grid point i on BZ */
+/* surface are stored from bz_grid_address[prod(mesh) + bz_map[i]] */
+/* to bz_grid_address[prod(mesh) + bz_map[i + 1] - 1]. */
 static int relocate_BZ_grid_address(int bz_grid_address[][3],
 				    int bz_map[],
 				    SPGCONST int grid_address[][3],
@@ -581,21 +770,15 @@ static int relocate_BZ_grid_address(int bz_grid_address[][3],
 {
   double tolerance, min_distance;
   double vector[3], distance[27];
-  int bzmesh[3], bzmesh_double[3], address_double[3];
-  int i, j, k, min_index, boundary_num_gp, total_num_gp, bzgp, gp;
+  int address_double[3];
+  int i, j, k, min_index, boundary_num_gp, total_num_gp, gp;
 
   tolerance = get_tolerance_for_BZ_reduction(rec_lattice);
-  for (i = 0; i < 3; i++) {
-    bzmesh[i] = mesh[i] * 2;
-    bzmesh_double[i] = bzmesh[i] * 2;
-  }
-  for (i = 0; i < bzmesh[0] * bzmesh[1] * bzmesh[2]; i++) {
-    bz_map[i] = -1;
-  }
-  
+
   boundary_num_gp = 0;
   total_num_gp = mesh[0] * mesh[1] * mesh[2];
   for (i = 0; i < total_num_gp; i++) {
+    bz_map[i] = boundary_num_gp;
     for (j = 0; j < 27; j++) {
       for (k = 0; k < 3; k++) {
 	address_double[k] =
@@ -623,19 +806,14 @@ static int relocate_BZ_grid_address(int bz_grid_address[][3],
 	for (k = 0; k < 3; k++) {
 	  bz_grid_address[gp][k] = 
 	    grid_address[i][k] + search_space[j][k] * mesh[k];
-	  address_double[k] = bz_grid_address[gp][k] * 2 + is_shift[k];
-	  if (address_double[k] < 0) {
-	    address_double[k] += bzmesh_double[k];
-	  }
 	}
-	bzgp = get_grid_point_double_mesh(address_double, bzmesh);
-	bz_map[bzgp] = gp;
 	if (j != min_index) {
 	  boundary_num_gp++;
 	}
       }
     }
   }
+  bz_map[total_num_gp] = boundary_num_gp;
 
   return boundary_num_gp + total_num_gp;
 }
@@ -669,63 +847,94 @@ static int get_ir_triplets_at_q(int map_triplets[],
 				const int mesh[3],
 				const MatINT * rot_reciprocal)
 {
-  int i, j, num_grid, q_2, num_ir_q, num_ir_triplets, ir_grid_point;
-  int mesh_double[3], is_shift[3];
-  int address_double0[3], address_double1[3], address_double2[3];
-  int *ir_grid_points, *third_q;
-  double tolerance;
-  double stabilizer_q[1][3];
+  int i, num_ir_q;
+  int is_shift[3];
   MatINT *rot_reciprocal_q;
 
-  tolerance = 0.01 / (mesh[0] + mesh[1] + mesh[2]);
-  num_grid = mesh[0] * mesh[1] * mesh[2];
-
   for (i = 0; i < 3; i++) {
     /* Only consider the gamma-point */
     is_shift[i] = 0;
-    mesh_double[i] = mesh[i] * 2;
   }
 
   /* Search irreducible q-points (map_q) with a stabilizer */
-  /* q */  
-  grid_point_to_address_double(address_double0, grid_point, mesh, is_shift);
-  for (i = 0; i < 3; i++) {
-    stabilizer_q[0][i] =
-      (double)address_double0[i] / mesh_double[i] - (address_double0[i] > mesh[i]);
-  }
-
-  rot_reciprocal_q = get_point_group_reciprocal_with_q(rot_reciprocal,
-						       tolerance,
-						       1,
-						       stabilizer_q);
-#ifdef _OPENMP
-  num_ir_q = get_ir_reciprocal_mesh_openmp(grid_address,
-					   map_q,
-					   mesh,
-					   is_shift,
-					   rot_reciprocal_q);
-#else
+  rot_reciprocal_q = get_point_group_reciprocal_at_grid_point(rot_reciprocal,
+							      grid_point,
+							      mesh);
   num_ir_q = get_ir_reciprocal_mesh(grid_address,
 				    map_q,
 				    mesh,
 				    is_shift,
 				    rot_reciprocal_q);
-#endif
   mat_free_MatINT(rot_reciprocal_q);
 
+  return get_map_triplets(map_triplets, map_q, num_ir_q, grid_point, mesh);
+}
+
+/* Little group of the q-point at grid_point (gamma-centered mesh) */
+static MatINT *get_point_group_reciprocal_at_grid_point(const MatINT * rot_reciprocal,
+							const int grid_point,
+							const int mesh[3])
+{
+  int i;
+  int mesh_double[3], is_shift[3], address_double[3];
+  double tolerance;
+  double stabilizer_q[1][3];
+
+  tolerance = 0.01 / (mesh[0] + mesh[1] + mesh[2]);
+  for (i = 0; i < 3; i++) {
+    is_shift[i] = 0;
+    mesh_double[i] = mesh[i] * 2;
+  }
+
+  grid_point_to_address_double(address_double, grid_point, mesh, is_shift);
+  for (i = 0; i < 3; i++) {
+    stabilizer_q[0][i] =
+      (double)address_double[i] / mesh_double[i] - (address_double[i] > mesh[i]);
+  }
+
+  return get_point_group_reciprocal_with_q(rot_reciprocal,
+					   tolerance,
+					   1,
+					   stabilizer_q);
+}
+
+/* map_q is the map of the mesh by the little group of grid_point */
+/* with num_ir_q irreducible points. Pairs of q' and q'' = -q - q' */
+/* are further reduced by exchanging q' and q''. */
+static int get_map_triplets(int map_triplets[],
+			    const int map_q[],
+			    const int num_ir_q,
+			    const int grid_point,
+			    const int mesh[3])
+{
+  int i, j, num_grid, q_2, num_ir, num_ir_triplets, ir_grid_point;
+  int mesh_double[3], is_shift[3];
+  int address_double0[3], address_double1[3], address_double2[3];
+  int *ir_grid_points, *third_q;
+
+  num_grid = mesh[0] * mesh[1] * mesh[2];
+
+  for (i = 0; i < 3; i++) {
+    is_shift[i] = 0;
+    mesh_double[i] = mesh[i] * 2;
+  }
+
+  /* q */
+  grid_point_to_address_double(address_double0, grid_point, mesh, is_shift);
+
   third_q = (int*) malloc(sizeof(int) * num_ir_q);
   ir_grid_points = (int*) malloc(sizeof(int) * num_ir_q);
-  num_ir_q = 0;
+  num_ir = 0;
   for (i = 0; i < num_grid; i++) {
     if (map_q[i] == i) {
-      ir_grid_points[num_ir_q] = i;
-      num_ir_q++;
+      ir_grid_points[num_ir] = i;
+      num_ir++;
     }
     map_triplets[i] = -1;
   }
 
 #pragma omp parallel for private(j, address_double1, address_double2)
-  for (i = 0; i < num_ir_q; i++) {
+  for (i = 0; i < num_ir; i++) {
     grid_point_to_address_double(address_double1,
 				 ir_grid_points[i],
 				 mesh,
@@ -738,7 +947,7 @@ static int get_ir_triplets_at_q(int map_triplets[],
   }
 
   num_ir_triplets = 0;
-  for (i = 0; i < num_ir_q; i++) {
+  for (i = 0; i < num_ir; i++) {
     ir_grid_point = ir_grid_points[i];
     q_2 = third_q[i];
     if (map_triplets[map_q[q_2]] > -1) {
@@ -762,6 +971,184 @@ static int get_ir_triplets_at_q(int map_triplets[],
   return num_ir_triplets;
 }
 
+/* Grid points sharing the same little group share the reduction */
+/* of the mesh (map_q), which is made only once for each group. */
+static int get_BZ_triplets_at_qs(int triplets[][3],
+				 int weights[],
+				 int triplets_offsets[],
+				 int map_triplets[],
+				 int map_q[],
+				 const int max_num_triplets,
+				 const int grid_points[],
+				 const int num_grid_points,
+				 SPGCONST int bz_grid_address[][3],
+				 const int bz_map[],
+				 const int mesh[3],
+				 const MatINT * rot_reciprocal)
+{
+  int i, j, k, num_grid, num_groups, num_ir_q, first, num_triplets;
+  int is_shift[3];
+  int *group_ids, *num_triplets_at_q, *counts, *map_q_group, *map_triplets_q;
+  int **weights_at_q;
+  int (**triplets_at_q)[3];
+  MatINT *rot_reciprocal_q;
+  MatINT **little_groups;
+
+  num_grid = mesh[0] * mesh[1] * mesh[2];
+  for (i = 0; i < 3; i++) {
+    is_shift[i] = 0;
+  }
+
+  group_ids = (int*)malloc(sizeof(int) * num_grid_points);
+  little_groups = (MatINT**)malloc(sizeof(MatINT*) * num_grid_points);
+  num_groups = 0;
+  for (i = 0; i < num_grid_points; i++) {
+    rot_reciprocal_q = get_point_group_reciprocal_at_grid_point(rot_reciprocal,
+								grid_points[i],
+								mesh);
+    for (j = 0; j < num_groups; j++) {
+      if (is_same_rotations(little_groups[j], rot_reciprocal_q)) {
+	break;
+      }
+    }
+    if (j < num_groups) {
+      mat_free_MatINT(rot_reciprocal_q);
+    } else {
+      little_groups[num_groups] = rot_reciprocal_q;
+      num_groups++;
+    }
+    group_ids[i] = j;
+  }
+
+  num_triplets_at_q = (int*)malloc(sizeof(int) * num_grid_points);
+  triplets_at_q = (int(**)[3])malloc(sizeof(int(*)[3]) * num_grid_points);
+  weights_at_q = (int**)malloc(sizeof(int*) * num_grid_points);
+  counts = (int*)malloc(sizeof(int) * num_grid);
+  map_q_group = NULL;
+  if (! map_q) {
+    map_q_group = (int*)malloc(sizeof(int) * num_grid);
+  }
+  map_triplets_q = NULL;
+  if (! map_triplets) {
+    map_triplets_q = (int*)malloc(sizeof(int) * num_grid);
+  }
+
+  for (i = 0; i < num_groups; i++) {
+    first = -1;
+    num_ir_q = 0;
+    for (j = 0; j < num_grid_points; j++) {
+      if (group_ids[j] != i) {
+	continue;
+      }
+
+      if (map_q) {
+	map_q_group = map_q + j * num_grid;
+      }
+      if (first < 0) {
+	num_ir_q = get_ir_grid_points(NULL,
+				      NULL,
+				      map_q_group,
+				      0,
+				      mesh,
+				      is_shift,
+				      little_groups[i]);
+	first = j;
+      } else if (map_q) {
+	for (k = 0; k < num_grid; k++) {
+	  map_q_group[k] = map_q[first * num_grid + k];
+	}
+      }
+
+      if (map_triplets) {
+	map_triplets_q = map_triplets + j * num_grid;
+      }
+      num_triplets_at_q[j] = get_map_triplets(map_triplets_q,
+					      map_q_group,
+					      num_ir_q,
+					      grid_points[j],
+					      mesh);
+      triplets_at_q[j] =
+	(int(*)[3])malloc(sizeof(int[3]) * num_triplets_at_q[j]);
+      weights_at_q[j] = (int*)malloc(sizeof(int) * num_triplets_at_q[j]);
+      get_BZ_triplets_at_q(triplets_at_q[j],
+			   grid_points[j],
+			   bz_grid_address,
+			   bz_map,
+			   map_triplets_q,
+			   num_grid,
+			   mesh);
+
+      for (k = 0; k < num_grid; k++) {
+	counts[k] = 0;
+      }
+      for (k = 0; k < num_grid; k++) {
+	counts[map_triplets_q[k]]++;
+      }
+      num_triplets = 0;
+      for (k = 0; k < num_grid; k++) {
+	if (map_triplets_q[k] == k) {
+	  weights_at_q[j][num_triplets] = counts[k];
+	  num_triplets++;
+	}
+      }
+    }
+  }
+
+  num_triplets = 0;
+  triplets_offsets[0] = 0;
+  for (i = 0; i < num_grid_points; i++) {
+    for (j = 0; j < num_triplets_at_q[i]; j++) {
+      if (num_triplets < max_num_triplets) {
+	for (k = 0; k < 3; k++) {
+	  triplets[num_triplets][k] = triplets_at_q[i][j][k];
+	}
+	weights[num_triplets] = weights_at_q[i][j];
+      }
+      num_triplets++;
+    }
+    triplets_offsets[i + 1] = num_triplets;
+    free(triplets_at_q[i]);
+    free(weights_at_q[i]);
+  }
+
+  if (! map_triplets) {
+    free(map_triplets_q);
+  }
+  if (! map_q) {
+    free(map_q_group);
+  }
+  free(counts);
+  free(weights_at_q);
+  free(triplets_at_q);
+  free(num_triplets_at_q);
+  for (i = 0; i < num_groups; i++) {
+    mat_free_MatINT(little_groups[i]);
+  }
+  free(little_groups);
+  free(group_ids);
+
+  return num_triplets;
+}
+
+static int is_same_rotations(const MatINT * rot_a, const MatINT * rot_b)
+{
+  int i, j, k;
+
+  if (rot_a->size != rot_b->size) {
+    return 0;
+  }
+  for (i = 0; i < rot_a->size; i++) {
+    for (j = 0; j < 3; j++) {
+      for (k = 0; k < 3; k++) {
+	if (rot_a->mat[i][j][k] != rot_b->mat[i][j][k]) {
+	  return 0;
+	}
+      }
+    }
+  }
+  return 1;
+}
+
 static int get_BZ_triplets_at_q(int triplets[][3],
 				const int grid_point,
 				SPGCONST int bz_grid_address[][3],
@@ -770,15 +1157,10 @@ static int get_BZ_triplets_at_q(int triplets[][3],
 				const int num_map_triplets,
 				const int mesh[3])
 {
-  int i, j, k, num_ir;
-  int address[3][3], address_double[3], bzmesh[3], bzmesh_double[3];
+  int i, j, num_ir;
+  int address[3][3];
   int *ir_grid_points;
 
-  for (i = 0; i < 3; i++) {
-    bzmesh[i] = mesh[i] * 2;
-    bzmesh_double[i] = bzmesh[i] * 2;
-  }
-
   num_ir = 0;
   ir_grid_points = (int*) malloc(sizeof(int) * num_map_triplets);
   for (i = 0; i < num_map_triplets; i++) {
@@ -788,7 +1170,7 @@ static int get_BZ_triplets_at_q(int triplets[][3],
     }
   }
  
-#pragma omp parallel for private(j, k, address, address_double)
+#pragma omp parallel for private(j, address)
   for (i = 0; i < num_ir; i++) {
     for (j = 0; j < 3; j++) {
       address[0][j] = bz_grid_address[grid_point][j];
@@ -798,22 +1180,17 @@ static int get_BZ_triplets_at_q(int triplets[][3],
     for (j = 2; j > -1; j--) {
       if (get_third_q_of_triplets_at_q(address,
     				       j,
+				       bz_grid_address,
     				       bz_map,
-    				       mesh,
-    				       bzmesh,
-    				       bzmesh_double) == 0) {
+    				       mesh) == 0) {
     	break;
       }
     }
     for (j = 0; j < 3; j++) {
-      for (k = 0; k < 3; k++) {
-	address_double[k] = address[j][k] * 2;
-	if (address_double[k] < 0) {
-	  address_double[k] += bzmesh_double[k];
-	}
-      }
-      triplets[i][j] =
-	bz_map[get_grid_point_double_mesh(address_double, bzmesh)];
+      triplets[i][j] = get_bz_grid_point(address[j],
+					 mesh,
+					 bz_grid_address,
+					 bz_map);
     }
   }
 
@@ -824,13 +1201,12 @@ static int get_BZ_triplets_at_q(int triplets[][3],
 
 static int get_third_q_of_triplets_at_q(int address[3][3],
 					const int q_index,
+					SPGCONST int bz_grid_address[][3],
 					const int bz_map[],
-					const int mesh[3],
-					const int bzmesh[3],
-					const int bzmesh_double[3])
+					const int mesh[3])
 {
   int i, j, smallest_g, smallest_index, sum_g, delta_g[3];
-  int bzgp[27], address_double[3];
+  int bzgp[27], address_bz[3];
 
   get_vector_modulo(address[q_index], mesh);
   for (i = 0; i < 3; i++) {
@@ -843,15 +1219,9 @@ static int get_third_q_of_triplets_at_q(int address[3][3],
   
   for (i = 0; i < 27; i++) {
     for (j = 0; j < 3; j++) {
-      address_double[j] = (address[q_index][j] +
-			   search_space[i][j] * mesh[j]) * 2;
+      address_bz[j] = address[q_index][j] + search_space[i][j] * mesh[j];
     }
-    for (j = 0; j < 3; j++) {
-      if (address_double[j] < 0) {
-	address_double[j] += bzmesh_double[j];
-      }
-    }
-    bzgp[i] = bz_map[get_grid_point_double_mesh(address_double, bzmesh)];
+    bzgp[i] = get_bz_grid_point(address_bz, mesh, bz_grid_address, bz_map);
   }
 
   for (i = 0; i < 27; i++) {
@@ -887,6 +1257,47 @@ static int get_third_q_of_triplets_at_q(int address[3][3],
   return smallest_g;
 }
 
+/* Grid point in BZ whose address is equal to address modulo mesh * 2 */
+/* is returned. -1 is returned if address is not in BZ. */
+static int get_bz_grid_point(const int address[3],
+			     const int mesh[3],
+			     SPGCONST int bz_grid_address[][3],
+			     const int bz_map[])
+{
+  int i, gp, num_grid;
+  int mesh_double[3];
+
+  for (i = 0; i < 3; i++) {
+    mesh_double[i] = mesh[i] * 2;
+  }
+  num_grid = mesh[0] * mesh[1] * mesh[2];
+
+  gp = kpt_get_grid_point(address, mesh);
+  if (is_same_address_modulo(bz_grid_address[gp], address, mesh_double)) {
+    return gp;
+  }
+  for (i = num_grid + bz_map[gp]; i < num_grid + bz_map[gp + 1]; i++) {
+    if (is_same_address_modulo(bz_grid_address[i], address, mesh_double)) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+static int is_same_address_modulo(const int address_a[3],
+				  const int address_b[3],
+				  const int m[3])
+{
+  int i;
+
+  for (i = 0; i < 3; i++) {
+    if ((address_a[i] - address_b[i]) % m[i] != 0) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
 static int get_grid_point_double_mesh(const int address_double[3],
 				      const int mesh[3])
 {
@@ -13,14 +13,15 @@
 
 #define INCREASE_RATE 2.0
 #define REDUCE_RATE 0.95
-static double current_tolerance;
-
 
 static Primitive get_primitive_and_pure_translation(SPGCONST Cell * cell,
-						    const double symprec);
+						    const double symprec,
+						    const double angle_tolerance);
 static Cell * get_primitive_and_mapping_table(int * mapping_table,
+					      double * tolerance_found,
 					      SPGCONST Cell * cell,
-					      const double symprec);
+					      const double symprec,
+					      const double angle_tolerance);
 static int set_primitive_positions(Cell * primitive_cell,
 				   const VecDBL * position,
 				   const Cell * cell,
@@ -42,7 +43,8 @@ static Cell * get_cell_with_smallest_lattice(SPGCONST Cell * cell,
 static Cell * get_primitive(int * mapping_table,
 			    SPGCONST Cell * cell,
 			    const VecDBL * pure_trans,
-			    const double symprec);
+			    const double symprec,
+			    const double angle_tolerance);
 static int trim_cell(Cell * primitive_cell,
 		     int * mapping_table,
 		     SPGCONST Cell * cell,
@@ -50,54 +52,60 @@ static int trim_cell(Cell * primitive_cell,
 static int get_primitive_lattice_vectors_iterative(double prim_lattice[3][3],
 						   SPGCONST Cell * cell,
 						   const VecDBL * pure_trans,
-						   const double symprec);
+						   const double symprec,
+						   const double angle_tolerance);
 static int get_primitive_lattice_vectors(double prim_lattice[3][3],
 					 const VecDBL * vectors,
 					 SPGCONST Cell * cell,
 					 const double symprec);
 static VecDBL * get_translation_candidates(const VecDBL * pure_trans);
-static void set_current_tolerance(const double tolerance);
 
-Cell * prm_get_primitive(SPGCONST Cell * cell,
-			 const double symprec)
+/* Tolerance may be reduced iteratively to find the primitive cell. */
+/* The tolerance used at last is returned as tolerance_found. */
+Cell * prm_get_primitive(double * tolerance_found,
+			 SPGCONST Cell * cell,
+			 const double symprec,
+			 const double angle_tolerance)
 {
   int *mapping_table;
   Cell *primitive_cell;
 
   mapping_table = (int*) malloc(sizeof(int) * cell->size);
   primitive_cell = prm_get_primitive_and_mapping_table(mapping_table,
+						       tolerance_found,
 						       cell,
-						       symprec);
+						       symprec,
+						       angle_tolerance);
   free(mapping_table);
   return primitive_cell;
 }
 
 Primitive prm_get_primitive_and_pure_translations(SPGCONST Cell * cell,
-						  const double symprec)
+						  const double symprec,
+						  const double angle_tolerance)
 {
-  return get_primitive_and_pure_translation(cell, symprec);
+  return get_primitive_and_pure_translation(cell, symprec, angle_tolerance);
 }
 
 Cell * prm_get_primitive_and_mapping_table(int * mapping_table,
+					   double * tolerance_found,
 					   SPGCONST Cell * cell,
-					   const double symprec)
+					   const double symprec,
+					   const double angle_tolerance)
 {
   return get_primitive_and_mapping_table(mapping_table,
+					 tolerance_found,
 					 cell,
-					 symprec);
-}
-
-double prm_get_current_tolerance(void)
-{
-  debug_print("prm_get_current_tolerance %f\n", current_tolerance);
-  return current_tolerance;
+					 symprec,
+					 angle_tolerance);
 }
 
 /* If primitive could not be found, primitive->size = 0 is returned. */
 /* If cell is already primitive cell, */
 /* primitive cell with smallest lattice is returned. */
 static Primitive get_primitive_and_pure_translation(SPGCONST Cell * cell,
-						    const double symprec)
+						    const double symprec,
+						    const double angle_tolerance)
 {
   int attempt, is_found = 0;
   double tolerance;
@@ -119,7 +127,8 @@ static Primitive get_primitive_and_pure_translation(SPGCONST Cell * cell,
       primitive.cell = get_primitive(mapping_table,
 				     cell,
 				     primitive.pure_trans,
-				     tolerance);
+				     tolerance,
+				     angle_tolerance);
       free(mapping_table);
     } 
 
@@ -147,8 +156,10 @@ static Primitive get_primitive_and_pure_translation(SPGCONST Cell * cell,
 /* If cell is already primitive cell, */
 /* primitive cell with smallest lattice is returned. */
 static Cell * get_primitive_and_mapping_table(int * mapping_table,
+					      double * tolerance_found,
 					      SPGCONST Cell * cell,
-					      const double symprec)
+					      const double symprec,
+					      const double angle_tolerance)
 {
   int i, attempt;
   double tolerance;
@@ -166,7 +177,11 @@ static Cell * get_primitive_and_mapping_table(int * mapping_table,
       goto ret;
     }
     if (pure_trans->size > 1) {
-      primitive_cell = get_primitive(mapping_table, cell, pure_trans, tolerance);
+      primitive_cell = get_primitive(mapping_table,
+				     cell,
+				     pure_trans,
+				     tolerance,
+				     angle_tolerance);
       if (primitive_cell->size > 0) {
 	goto ret;
       }
@@ -182,19 +197,15 @@ static Cell * get_primitive_and_mapping_table(int * mapping_table,
   /* not found: I hope this will not happen. */
   warning_print("spglib: Primitive cell could not be found ");
   warning_print("(line %d, %s).\n", __LINE__, __FILE__);
+  *tolerance_found = symprec;
   return cel_alloc_cell(0);
 
  ret:
   mat_free_VecDBL(pure_trans);
-  set_current_tolerance(tolerance);
+  *tolerance_found = tolerance;
   return primitive_cell;
 }
 
-static void set_current_tolerance(const double tolerance)
-{
-  current_tolerance = tolerance;
-}
-
 static Cell * get_cell_with_smallest_lattice(SPGCONST Cell * cell,
 					     const double symprec)
 {
@@ -230,7 +241,8 @@ static Cell * get_cell_with_smallest_lattice(SPGCONST Cell * cell,
 static Cell * get_primitive(int * mapping_table,
 			    SPGCONST Cell * cell,
 			    const VecDBL * pure_trans,
-			    const double symprec)
+			    const double symprec,
+			    const double angle_tolerance)
 {
   int multi;
   double prim_lattice[3][3];
@@ -240,11 +252,11 @@ static Cell * get_primitive(int * mapping_table,
 
   /* Primitive lattice vectors are searched. */
   /* To be consistent, sometimes tolerance is decreased iteratively. */
-  /* The descreased tolerance is stored in 'static double tolerance'. */
   multi = get_primitive_lattice_vectors_iterative(prim_lattice,
 						  cell,
 						  pure_trans,
-						  symprec);
+						  symprec,
+						  angle_tolerance);
   if (! multi) {
     goto not_found;
   }
@@ -540,7 +552,8 @@ static int ** allocate_overlap_table(const int size)
 static int get_primitive_lattice_vectors_iterative(double prim_lattice[3][3],
 						   SPGCONST Cell * cell,
 						   const VecDBL * pure_trans,
-						   const double symprec)
+						   const double symprec,
+						   const double angle_tolerance)
 {
   int i, multi, attempt;
   double tolerance;
@@ -575,7 +588,8 @@ static int get_primitive_lattice_vectors_iterative(double prim_lattice[3][3],
       mat_free_VecDBL(pure_trans_reduced);
       pure_trans_reduced = sym_reduce_pure_translation(cell,
 						       tmp_vec,
-						       tolerance);
+						       tolerance,
+						       angle_tolerance);
       warning_print("Tolerance is reduced to %f (%d), size = %d\n",
 		    tolerance, attempt, pure_trans_reduced->size);
 
@@ -17,7 +17,8 @@
 #define REDUCE_RATE 0.95
 
 static Cell * refine_cell(SPGCONST Cell * cell,
-			  const double symprec);
+			  const double symprec,
+			  const double angle_tolerance);
 static Cell * get_bravais_exact_positions_and_lattice(int * wyckoffs,
 						      int * equiv_atoms,
 						      SPGCONST Spacegroup * spacegroup,
@@ -94,9 +95,10 @@ static SPGCONST int identity[3][3] = {
 
 
 Cell * ref_refine_cell(SPGCONST Cell * cell,
-		       const double symprec)
+		       const double symprec,
+		       const double angle_tolerance)
 {
-  return refine_cell(cell, symprec);
+  return refine_cell(cell, symprec, angle_tolerance);
 }
 
 /* symmetry->size = 0 is returned when it failed. */
@@ -166,7 +168,8 @@ Cell * ref_get_Wyckoff_positions(int * wyckoffs,
 }
 
 static Cell * refine_cell(SPGCONST Cell * cell,
-			  const double symprec)
+			  const double symprec,
+			  const double angle_tolerance)
 {
   int attempt, found;
   int *wyckoffs_bravais, *equiv_atoms_bravais;
@@ -179,11 +182,14 @@ static Cell * refine_cell(SPGCONST Cell * cell,
   tolerance = symprec;
   found = 0;
   for (attempt = 0; attempt < 100; attempt++) {
-    primitive = prm_get_primitive(cell, tolerance);
+    primitive = prm_get_primitive(&tolerance_from_prim,
+				  cell,
+				  tolerance,
+				  angle_tolerance);
     if (primitive->size > 0) {  
-      tolerance_from_prim = prm_get_current_tolerance();
       spacegroup = spa_get_spacegroup_with_primitive(primitive,
-						     tolerance_from_prim);
+						     tolerance_from_prim,
+						     angle_tolerance);
       if (spacegroup.number > 0) {
 	wyckoffs_bravais = (int*)malloc(sizeof(int) * primitive->size * 4);
 	equiv_atoms_bravais = (int*)malloc(sizeof(int) * primitive->size * 4);
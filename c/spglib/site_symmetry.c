@@ -179,9 +179,10 @@ static int get_Wyckoff_notation(double position[3],
 				const int hall_number,
 				const double symprec)
 {
-  int i, j, k, l, at_orbit, num_sitesym, wyckoff_letter=-1;
+  int i, j, k, l, m, at_orbit, num_sitesym, wyckoff_letter=-1;
   int indices_wyc[2];
   int rot[3][3];
+  int *num_overlaps, *overlaps;
   double trans[3], orbit[3];
   VecDBL *pos_rot;
 
@@ -193,26 +194,39 @@ static int get_Wyckoff_notation(double position[3],
     }
   }
 
+  /* overlaps[j * size + m] (m < num_overlaps[j]) are the orbit points */
+  /* overlapping pos_rot[j]. They don't depend on Wyckoff positions. */
+  num_overlaps = (int*)malloc(sizeof(int) * pos_rot->size);
+  overlaps = (int*)malloc(sizeof(int) * pos_rot->size * pos_rot->size);
+  for (j = 0; j < pos_rot->size; j++) {
+    num_overlaps[j] = 0;
+    for (k = 0; k < pos_rot->size; k++) {
+      if (cel_is_overlap(pos_rot->vec[j],
+			 pos_rot->vec[k],
+			 bravais_lattice,
+			 symprec)) {
+	overlaps[j * pos_rot->size + num_overlaps[j]] = k;
+	num_overlaps[j]++;
+      }
+    }
+  }
+
   ssmdb_get_wyckoff_indices(indices_wyc, hall_number);
   for (i = 0; i < indices_wyc[1]; i++) {
     num_sitesym = ssmdb_get_coordinate(rot, trans, i + indices_wyc[0]);
     for (j = 0; j < pos_rot->size; j++) {
       at_orbit = 0;
-      for (k = 0; k < pos_rot->size; k++) {
-	if (cel_is_overlap(pos_rot->vec[j],
-			   pos_rot->vec[k],
+      for (m = 0; m < num_overlaps[j]; m++) {
+	k = overlaps[j * pos_rot->size + m];
+	mat_multiply_matrix_vector_id3(orbit, rot, pos_rot->vec[k]);
+	for (l = 0; l < 3; l++) {
+	  orbit[l] += trans[l];
+	}
+	if (cel_is_overlap(pos_rot->vec[k],
+			   orbit,
 			   bravais_lattice,
 			   symprec)) {
-	  mat_multiply_matrix_vector_id3(orbit, rot, pos_rot->vec[k]);
-	  for (l = 0; l < 3; l++) {
-	    orbit[l] += trans[l];
-	  }
-	  if (cel_is_overlap(pos_rot->vec[k],
-			     orbit,
-			     bravais_lattice,
-			     symprec)) {
-	    at_orbit++;
-	  }
+	  at_orbit++;
 	}
       }
       if (at_orbit == conv_sym->size / num_sitesym) {
@@ -225,6 +239,8 @@ static int get_Wyckoff_notation(double position[3],
   }
 
  end:
+  free(overlaps);
+  free(num_overlaps);
   mat_free_VecDBL(pos_rot);
   return wyckoff_letter;
 }
@@ -19,17 +19,20 @@
 #define REDUCE_RATE 0.95
 
 static Spacegroup get_spacegroup(SPGCONST Cell * primitive,
-				 const double symprec);
+				 const double symprec,
+				 const double angle_tolerance);
 static int get_hall_number(double origin_shift[3],
 			   double conv_lattice[3][3],
 			   SPGCONST Cell * primitive,
 			   SPGCONST Symmetry * symmetry,
-			   const double symprec);
+			   const double symprec,
+			   const double angle_tolerance);
 static int get_hall_number_local_iteration(double origin_shift[3],
 					   double conv_lattice[3][3],
 					   SPGCONST Cell * primitive,
 					   SPGCONST Symmetry * symmetry,
-					   const double symprec);
+					   const double symprec,
+					   const double angle_tolerance);
 static int get_hall_number_local(double origin_shift[3],
 				 double conv_lattice[3][3],
 				 SPGCONST Cell * primitive,
@@ -40,17 +43,17 @@ static Symmetry * get_conventional_symmetry(SPGCONST double transform_mat[3][3],
 					    const Symmetry *primitive_sym);
 
 Spacegroup spa_get_spacegroup(SPGCONST Cell * cell,
-			      const double symprec)
+			      const double symprec,
+			      const double angle_tolerance)
 {
   double tolerance;
   Cell *primitive;
   Spacegroup spacegroup;
 
-  primitive = prm_get_primitive(cell, symprec);
-  tolerance = prm_get_current_tolerance();
+  primitive = prm_get_primitive(&tolerance, cell, symprec, angle_tolerance);
   
   if (primitive->size > 0) {
-    spacegroup = get_spacegroup(primitive, tolerance);
+    spacegroup = get_spacegroup(primitive, tolerance, angle_tolerance);
   } else {
     spacegroup.number = 0;
     warning_print("spglib: Space group could not be found ");
@@ -62,12 +65,13 @@ Spacegroup spa_get_spacegroup(SPGCONST Cell * cell,
 }
 
 Spacegroup spa_get_spacegroup_with_primitive(SPGCONST Cell * primitive,
-					     const double symprec)
+					     const double symprec,
+					     const double angle_tolerance)
 {
   Spacegroup spacegroup;
 
   if (primitive->size > 0) {
-    spacegroup = get_spacegroup(primitive, symprec);
+    spacegroup = get_spacegroup(primitive, symprec, angle_tolerance);
   } else {
     spacegroup.number = 0;
     warning_print("spglib: Space group could not be found ");
@@ -86,7 +90,8 @@ Symmetry * spa_get_conventional_symmetry(SPGCONST double transform_mat[3][3],
 }
 
 static Spacegroup get_spacegroup(SPGCONST Cell * primitive,
-				 const double symprec)
+				 const double symprec,
+				 const double angle_tolerance)
 {
   int hall_number;
   double conv_lattice[3][3];
@@ -95,7 +100,7 @@ static Spacegroup get_spacegroup(SPGCONST Cell * primitive,
   Spacegroup spacegroup;
   SpacegroupType spacegroup_type;
 
-  symmetry = sym_get_operation(primitive, symprec);
+  symmetry = sym_get_operation(primitive, symprec, angle_tolerance);
   if (symmetry->size == 0) {
     spacegroup.number = 0;
     warning_print("spglib: Space group could not be found ");
@@ -107,7 +112,8 @@ static Spacegroup get_spacegroup(SPGCONST Cell * primitive,
 				conv_lattice,
 				primitive,
 				symmetry,
-				symprec);
+				symprec,
+				angle_tolerance);
 
   if (hall_number == 0) {
     spacegroup.number = 0;
@@ -153,7 +159,8 @@ static int get_hall_number(double origin_shift[3],
 			   double conv_lattice[3][3],
 			   SPGCONST Cell * primitive,
 			   SPGCONST Symmetry * symmetry,
-			   const double symprec)
+			   const double symprec,
+			   const double angle_tolerance)
 {
   int pg_num, hall_number=0;
 
@@ -178,7 +185,8 @@ static int get_hall_number(double origin_shift[3],
 						conv_lattice,
 						primitive,
 						symmetry,
-						symprec);
+						symprec,
+						angle_tolerance);
 
  ret:
   return hall_number;
@@ -188,7 +196,8 @@ static int get_hall_number_local_iteration(double origin_shift[3],
 					   double conv_lattice[3][3],
 					   SPGCONST Cell * primitive,
 					   SPGCONST Symmetry * symmetry,
-					   const double symprec)
+					   const double symprec,
+					   const double angle_tolerance)
 {
   int attempt, pg_num, hall_number=0;
   double tolerance;
@@ -200,7 +209,10 @@ static int get_hall_number_local_iteration(double origin_shift[3],
   for (attempt = 0; attempt < 100; attempt++) {
     tolerance *= REDUCE_RATE;
     debug_print("  Attempt %d tolerance = %f\n", attempt, tolerance);
-    sym_reduced = sym_reduce_operation(primitive, symmetry, tolerance);
+    sym_reduced = sym_reduce_operation(primitive,
+				       symmetry,
+				       tolerance,
+				       angle_tolerance);
     pg_num = ptg_get_pointgroup_number(sym_reduced);
 
     if (pg_num > -1) {
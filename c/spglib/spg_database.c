@@ -8499,6 +8499,13 @@ int spgdb_get_operation(int rot[3][3], double trans[3], const int hall_number)
   return 1;
 }
 
+/* Ternary code of rotation matrix of spgdb_get_operation without */
+/* decoding it. Equal codes mean equal rotation matrices. */
+int spgdb_get_rotation_code(const int hall_number)
+{
+  return symmetry_operations[hall_number] % 19683; /* 19683 = 3**9 */
+}
+
 void spgdb_get_operation_index(int indices[2], const int hall_number)
 {
   indices[0] = symmetry_operation_index[hall_number][0];
@@ -28,7 +28,16 @@ static SpglibDataset * get_dataset(SPGCONST double lattice[3][3],
 				   SPGCONST double position[][3],
 				   const int types[],
 				   const int num_atom,
-				   const double symprec);
+				   const double symprec,
+				   const double angle_tolerance);
+static void get_datasets(SpglibDataset * datasets[],
+			 SPGCONST double lattices[][3][3],
+			 SPGCONST double positions[][3],
+			 const int types[],
+			 const int num_atoms[],
+			 const int num_cells,
+			 const double symprec,
+			 const double angle_tolerance);
 static void set_dataset(SpglibDataset * dataset,
 			SPGCONST Cell * cell,
 			SPGCONST Cell * primitive,
@@ -42,7 +51,8 @@ static int get_symmetry(int rotation[][3][3],
 			SPGCONST double position[][3],
 			const int types[],
 			const int num_atom,
-			const double symprec);
+			const double symprec,
+			const double angle_tolerance);
 static int get_symmetry_from_dataset(int rotation[][3][3],
 				     double translation[][3],
 				     const int max_size,
@@ -50,7 +60,8 @@ static int get_symmetry_from_dataset(int rotation[][3][3],
 				     SPGCONST double position[][3],
 				     const int types[],
 				     const int num_atom,
-				     const double symprec);
+				     const double symprec,
+				     const double angle_tolerance);
 static int get_symmetry_with_collinear_spin(int rotation[][3][3],
 					    double translation[][3],
 					    const int max_size,
@@ -59,33 +70,39 @@ static int get_symmetry_with_collinear_spin(int rotation[][3][3],
 					    const int types[],
 					    const double spins[],
 					    const int num_atom,
-					    const double symprec);
+					    const double symprec,
+					    const double angle_tolerance);
 static int get_multiplicity(SPGCONST double lattice[3][3],
 			    SPGCONST double position[][3],
 			    const int types[],
 			    const int num_atom,
-			    const double symprec);
+			    const double symprec,
+			    const double angle_tolerance);
 static int find_primitive(double lattice[3][3],
 			  double position[][3],
 			  int types[],
 			  const int num_atom,
-			  const double symprec);
+			  const double symprec,
+			  const double angle_tolerance);
 static int get_international(char symbol[11],
 			     SPGCONST double lattice[3][3],
 			     SPGCONST double position[][3],
 			     const int types[],
 			     const int num_atom,
-			     const double symprec);
+			     const double symprec,
+			     const double angle_tolerance);
 static int get_schoenflies(char symbol[10],
 			   SPGCONST double lattice[3][3],
 			   SPGCONST double position[][3],
 			   const int types[], const int num_atom,
-			   const double symprec);
+			   const double symprec,
+			   const double angle_tolerance);
 static int refine_cell(double lattice[3][3],
 		       double position[][3],
 		       int types[],
 		       const int num_atom,
-		       const double symprec);
+		       const double symprec,
+		       const double angle_tolerance);
 
 /*---------*/
 /* kpoints */
@@ -99,7 +116,8 @@ static int get_ir_reciprocal_mesh(int grid_address[][3],
 				  SPGCONST double position[][3],
 				  const int types[],
 				  const int num_atom,
-				  const double symprec);
+				  const double symprec,
+				  const double angle_tolerance);
 
 static int get_stabilized_reciprocal_mesh(int grid_address[][3],
 					  int map[],
@@ -110,6 +128,17 @@ static int get_stabilized_reciprocal_mesh(int grid_address[][3],
 					  SPGCONST int rotations[][3][3],
 					  const int num_q,
 					  SPGCONST double qpoints[][3]);
+static int get_ir_grid_points(int ir_grid_points[],
+			      int ir_weights[],
+			      int map[],
+			      const int max_num_ir,
+			      const int mesh[3],
+			      const int is_shift[3],
+			      const int is_time_reversal,
+			      const int num_rot,
+			      SPGCONST int rotations[][3][3],
+			      const int num_q,
+			      SPGCONST double qpoints[][3]);
 static int get_triplets_reciprocal_mesh_at_q(int map_triplets[],
 					     int map_q[],
 					     int grid_address[][3],
@@ -118,6 +147,20 @@ static int get_triplets_reciprocal_mesh_at_q(int map_triplets[],
 					     const int is_time_reversal,
 					     const int num_rot,
 					     SPGCONST int rotations[][3][3]);
+static int get_BZ_triplets_at_qs(int triplets[][3],
+				 int weights[],
+				 int triplets_offsets[],
+				 int map_triplets[],
+				 int map_q[],
+				 const int max_num_triplets,
+				 const int grid_points[],
+				 const int num_grid_points,
+				 SPGCONST int bz_grid_address[][3],
+				 const int bz_map[],
+				 const int mesh[3],
+				 const int is_time_reversal,
+				 const int num_rot,
+				 SPGCONST int rotations[][3][3]);
 
 
 /*========*/
@@ -133,13 +176,12 @@ SpglibDataset * spg_get_dataset(SPGCONST double lattice[3][3],
 				const int num_atom,
 				const double symprec)
 {
-  sym_set_angle_tolerance(-1.0);
-
   return get_dataset(lattice,
 		     position,
 		     types,
 		     num_atom,
-		     symprec);
+		     symprec,
+		     -1.0);
 }
 
 SpglibDataset * spgat_get_dataset(SPGCONST double lattice[3][3],
@@ -149,13 +191,49 @@ SpglibDataset * spgat_get_dataset(SPGCONST double lattice[3][3],
 				  const double symprec,
 				  const double angle_tolerance)
 {
-  sym_set_angle_tolerance(angle_tolerance);
-
   return get_dataset(lattice,
 		     position,
 		     types,
 		     num_atom,
-		     symprec);
+		     symprec,
+		     angle_tolerance);
+}
+
+void spg_get_datasets(SpglibDataset * datasets[],
+		      SPGCONST double lattices[][3][3],
+		      SPGCONST double positions[][3],
+		      const int types[],
+		      const int num_atoms[],
+		      const int num_cells,
+		      const double symprec)
+{
+  get_datasets(datasets,
+	       lattices,
+	       positions,
+	       types,
+	       num_atoms,
+	       num_cells,
+	       symprec,
+	       -1.0);
+}
+
+void spgat_get_datasets(SpglibDataset * datasets[],
+			SPGCONST double lattices[][3][3],
+			SPGCONST double positions[][3],
+			const int types[],
+			const int num_atoms[],
+			const int num_cells,
+			const double symprec,
+			const double angle_tolerance)
+{
+  get_datasets(datasets,
+	       lattices,
+	       positions,
+	       types,
+	       num_atoms,
+	       num_cells,
+	       symprec,
+	       angle_tolerance);
 }
 
 void spg_free_dataset(SpglibDataset *dataset)
@@ -190,8 +268,6 @@ int spg_get_symmetry(int rotation[][3][3],
 		     const int num_atom,
 		     const double symprec)
 {
-  sym_set_angle_tolerance(-1.0);
-
   return get_symmetry_from_dataset(rotation,
 				   translation,
 				   max_size,
@@ -199,7 +275,8 @@ int spg_get_symmetry(int rotation[][3][3],
 				   position,
 				   types,
 				   num_atom,
-				   symprec);
+				   symprec,
+				   -1.0);
 }
 
 int spgat_get_symmetry(int rotation[][3][3],
@@ -212,8 +289,6 @@ int spgat_get_symmetry(int rotation[][3][3],
 		       const double symprec,
 		       const double angle_tolerance)
 {
-  sym_set_angle_tolerance(angle_tolerance);
-
   return get_symmetry_from_dataset(rotation,
 				   translation,
 				   max_size,
@@ -221,7 +296,78 @@ int spgat_get_symmetry(int rotation[][3][3],
 				   position,
 				   types,
 				   num_atom,
-				   symprec);
+				   symprec,
+				   angle_tolerance);
+}
+
+int spg_get_supercell_symmetry(int rotation[][3][3],
+			       double translation[][3],
+			       const int max_size,
+			       SPGCONST int rotations[][3][3],
+			       SPGCONST double translations[][3],
+			       const int num_operations,
+			       SPGCONST int supercell_matrix[3][3])
+{
+  int i, size;
+  Symmetry *symmetry, *supercell_symmetry;
+
+  symmetry = sym_alloc_symmetry(num_operations);
+  for (i = 0; i < num_operations; i++) {
+    mat_copy_matrix_i3(symmetry->rot[i], rotations[i]);
+    mat_copy_vector_d3(symmetry->trans[i], translations[i]);
+  }
+  supercell_symmetry = sym_get_supercell_operation(symmetry, supercell_matrix);
+  sym_free_symmetry(symmetry);
+
+  if (supercell_symmetry == NULL) {
+    return 0;
+  }
+
+  if (supercell_symmetry->size > max_size) {
+    fprintf(stderr, "spglib: Indicated max size(=%d) is less than number ", max_size);
+    fprintf(stderr, "spglib: of symmetry operations(=%d).\n", supercell_symmetry->size);
+    sym_free_symmetry(supercell_symmetry);
+    return 0;
+  }
+
+  for (i = 0; i < supercell_symmetry->size; i++) {
+    mat_copy_matrix_i3(rotation[i], supercell_symmetry->rot[i]);
+    mat_copy_vector_d3(translation[i], supercell_symmetry->trans[i]);
+  }
+  size = supercell_symmetry->size;
+  sym_free_symmetry(supercell_symmetry);
+
+  return size;
+}
+
+int spg_get_atom_permutations(int permutations[],
+			      SPGCONST int rotations[][3][3],
+			      SPGCONST double translations[][3],
+			      const int num_operations,
+			      SPGCONST double lattice[3][3],
+			      SPGCONST double position[][3],
+			      const int types[],
+			      const int num_atom,
+			      const double symprec)
+{
+  int i, is_found;
+  Symmetry *symmetry;
+  Cell *cell;
+
+  cell = cel_alloc_cell(num_atom);
+  cel_set_cell(cell, lattice, position, types);
+  symmetry = sym_alloc_symmetry(num_operations);
+  for (i = 0; i < num_operations; i++) {
+    mat_copy_matrix_i3(symmetry->rot[i], rotations[i]);
+    mat_copy_vector_d3(symmetry->trans[i], translations[i]);
+  }
+
+  is_found = sym_get_atom_permutations(permutations, symmetry, cell, symprec);
+
+  sym_free_symmetry(symmetry);
+  cel_free_cell(cell);
+
+  return is_found;
 }
 
 int spg_get_symmetry_with_collinear_spin(int rotation[][3][3],
@@ -234,8 +380,6 @@ int spg_get_symmetry_with_collinear_spin(int rotation[][3][3],
 					 const int num_atom,
 					 const double symprec)
 {
-  sym_set_angle_tolerance(-1.0);
-
   return get_symmetry_with_collinear_spin(rotation,
 					  translation,
 					  max_size,
@@ -244,7 +388,8 @@ int spg_get_symmetry_with_collinear_spin(int rotation[][3][3],
 					  types,
 					  spins,
 					  num_atom,
-					  symprec);
+					  symprec,
+					  -1.0);
 }
 
 int spgat_get_symmetry_with_collinear_spin(int rotation[][3][3],
@@ -258,8 +403,6 @@ int spgat_get_symmetry_with_collinear_spin(int rotation[][3][3],
 					   const double symprec,
 					   const double angle_tolerance)
 {
-  sym_set_angle_tolerance(angle_tolerance);
-
   return get_symmetry_with_collinear_spin(rotation,
 					  translation,
 					  max_size,
@@ -268,7 +411,8 @@ int spgat_get_symmetry_with_collinear_spin(int rotation[][3][3],
 					  types,
 					  spins,
 					  num_atom,
-					  symprec);
+					  symprec,
+					  angle_tolerance);
 }
 
 int spg_get_multiplicity(SPGCONST double lattice[3][3],
@@ -277,13 +421,12 @@ int spg_get_multiplicity(SPGCONST double lattice[3][3],
 			 const int num_atom,
 			 const double symprec)
 {
-  sym_set_angle_tolerance(-1.0);
-
   return get_multiplicity(lattice,
 			  position,
 			  types,
 			  num_atom,
-			  symprec);
+			  symprec,
+			  -1.0);
 }
 
 int spgat_get_multiplicity(SPGCONST double lattice[3][3],
@@ -293,13 +436,12 @@ int spgat_get_multiplicity(SPGCONST double lattice[3][3],
 			   const double symprec,
 			   const double angle_tolerance)
 {
-  sym_set_angle_tolerance(angle_tolerance);
-
   return get_multiplicity(lattice,
 			  position,
 			  types,
 			  num_atom,
-			  symprec);
+			  symprec,
+			  angle_tolerance);
 }
 
 int spg_get_smallest_lattice(double smallest_lattice[3][3],
@@ -315,13 +457,12 @@ int spg_find_primitive(double lattice[3][3],
 		       const int num_atom,
 		       const double symprec)
 {
-  sym_set_angle_tolerance(-1.0);
-
   return find_primitive(lattice,
 			position,
 			types,
 			num_atom,
-			symprec);
+			symprec,
+			-1.0);
 }
 
 int spgat_find_primitive(double lattice[3][3],
@@ -331,13 +472,12 @@ int spgat_find_primitive(double lattice[3][3],
 			 const double symprec,
 			 const double angle_tolerance)
 {
-  sym_set_angle_tolerance(angle_tolerance);
-
   return find_primitive(lattice,
 			position,
 			types,
 			num_atom,
-			symprec);
+			symprec,
+			angle_tolerance);
 }
 
 int spg_get_international(char symbol[11],
@@ -347,14 +487,13 @@ int spg_get_international(char symbol[11],
 			  const int num_atom,
 			  const double symprec)
 {
-  sym_set_angle_tolerance(-1.0);
-
   return get_international(symbol,
 			   lattice,
 			   position,
 			   types,
 			   num_atom,
-			   symprec);
+			   symprec,
+			   -1.0);
 }
 
 int spgat_get_international(char symbol[11],
@@ -365,14 +504,13 @@ int spgat_get_international(char symbol[11],
 			    const double symprec,
 			    const double angle_tolerance)
 {
-  sym_set_angle_tolerance(angle_tolerance);
-
   return get_international(symbol,
 			   lattice,
 			   position,
 			   types,
 			   num_atom,
-			   symprec);
+			   symprec,
+			   angle_tolerance);
 }
 
 int spg_get_schoenflies(char symbol[10],
@@ -382,14 +520,13 @@ int spg_get_schoenflies(char symbol[10],
 			const int num_atom,
 			const double symprec)
 {
-  sym_set_angle_tolerance(-1.0);
-
   return get_schoenflies(symbol,
 			 lattice,
 			 position,
 			 types,
 			 num_atom,
-			 symprec);
+			 symprec,
+			 -1.0);
 }
 
 int spgat_get_schoenflies(char symbol[10],
@@ -400,14 +537,13 @@ int spgat_get_schoenflies(char symbol[10],
 			  const double symprec,
 			  const double angle_tolerance)
 {
-  sym_set_angle_tolerance(angle_tolerance);
-
   return get_schoenflies(symbol,
 			 lattice,
 			 position,
 			 types,
 			 num_atom,
-			 symprec);
+			 symprec,
+			 angle_tolerance);
 }
 
 int spg_get_pointgroup(char symbol[6],
@@ -467,13 +603,12 @@ int spg_refine_cell(double lattice[3][3],
 		    const int num_atom,
 		    const double symprec)
 {
-  sym_set_angle_tolerance(-1.0);
-
   return refine_cell(lattice,
 		     position,
 		     types,
 		     num_atom,
-		     symprec);
+		     symprec,
+		     -1.0);
 }
 
 int spgat_refine_cell(double lattice[3][3],
@@ -483,13 +618,12 @@ int spgat_refine_cell(double lattice[3][3],
 		      const double symprec,
 		      const double angle_tolerance)
 {
-  sym_set_angle_tolerance(angle_tolerance);
-
   return refine_cell(lattice,
 		     position,
 		     types,
 		     num_atom,
-		     symprec);
+		     symprec,
+		     angle_tolerance);
 }
 
 /*---------*/
@@ -512,8 +646,6 @@ int spg_get_ir_reciprocal_mesh(int grid_address[][3],
 			       const int num_atom,
 			       const double symprec)
 {
-  sym_set_angle_tolerance(-1.0);
-
   return get_ir_reciprocal_mesh(grid_address,
 				map,
 				mesh,
@@ -523,7 +655,8 @@ int spg_get_ir_reciprocal_mesh(int grid_address[][3],
 				position,
 				types,
 				num_atom,
-				symprec);
+				symprec,
+				-1.0);
 }
 
 int spg_get_stabilized_reciprocal_mesh(int grid_address[][3],
@@ -547,6 +680,31 @@ int spg_get_stabilized_reciprocal_mesh(int grid_address[][3],
 					qpoints);
 }
 
+int spg_get_ir_grid_points(int ir_grid_points[],
+			   int ir_weights[],
+			   int map[],
+			   const int max_num_ir,
+			   const int mesh[3],
+			   const int is_shift[3],
+			   const int is_time_reversal,
+			   const int num_rot,
+			   SPGCONST int rotations[][3][3],
+			   const int num_q,
+			   SPGCONST double qpoints[][3])
+{
+  return get_ir_grid_points(ir_grid_points,
+			    ir_weights,
+			    map,
+			    max_num_ir,
+			    mesh,
+			    is_shift,
+			    is_time_reversal,
+			    num_rot,
+			    rotations,
+			    num_q,
+			    qpoints);
+}
+
 void spg_get_grid_points_by_rotations(int rot_grid_points[],
 				      const int address_orig[3],
 				      const int num_rot,
@@ -575,6 +733,7 @@ void spg_get_BZ_grid_points_by_rotations(int rot_grid_points[],
 					 SPGCONST int rot_reciprocal[][3][3],
 					 const int mesh[3],
 					 const int is_shift[3],
+					 SPGCONST int bz_grid_address[][3],
 					 const int bz_map[])
 {
   int i;
@@ -589,6 +748,7 @@ void spg_get_BZ_grid_points_by_rotations(int rot_grid_points[],
 				      rot,
 				      mesh,
 				      is_shift,
+				      bz_grid_address,
 				      bz_map);
   mat_free_MatINT(rot);
 }
@@ -644,6 +804,37 @@ int spg_get_BZ_triplets_at_q(int triplets[][3],
 				  mesh);
 }
 
+int spg_get_BZ_triplets_at_qs(int triplets[][3],
+			      int weights[],
+			      int triplets_offsets[],
+			      int map_triplets[],
+			      int map_q[],
+			      const int max_num_triplets,
+			      const int grid_points[],
+			      const int num_grid_points,
+			      SPGCONST int bz_grid_address[][3],
+			      const int bz_map[],
+			      const int mesh[3],
+			      const int is_time_reversal,
+			      const int num_rot,
+			      SPGCONST int rotations[][3][3])
+{
+  return get_BZ_triplets_at_qs(triplets,
+			       weights,
+			       triplets_offsets,
+			       map_triplets,
+			       map_q,
+			       max_num_triplets,
+			       grid_points,
+			       num_grid_points,
+			       bz_grid_address,
+			       bz_map,
+			       mesh,
+			       is_time_reversal,
+			       num_rot,
+			       rotations);
+}
+
 void spg_get_neighboring_grid_points(int relative_grid_points[],
 				     const int grid_point,
 				     SPGCONST int relative_grid_address[][3],
@@ -715,7 +906,8 @@ static SpglibDataset * get_dataset(SPGCONST double lattice[3][3],
 				   SPGCONST double position[][3],
 				   const int types[],
 				   const int num_atom,
-				   const double symprec)
+				   const double symprec,
+				   const double angle_tolerance)
 {
   int attempt;
   int *mapping_table;
@@ -747,12 +939,14 @@ static SpglibDataset * get_dataset(SPGCONST double lattice[3][3],
   tolerance = symprec;
   for (attempt = 0; attempt < 100; attempt++) {
     primitive = prm_get_primitive_and_mapping_table(mapping_table,
+						    &tolerance_from_prim,
 						    cell,
-						    tolerance);
+						    tolerance,
+						    angle_tolerance);
     if (primitive->size > 0) {
-      tolerance_from_prim = prm_get_current_tolerance();
       spacegroup = spa_get_spacegroup_with_primitive(primitive,
-						     tolerance_from_prim);
+						     tolerance_from_prim,
+						     angle_tolerance);
       if (spacegroup.number > 0) {
 	set_dataset(dataset,
 		    cell,
@@ -779,6 +973,40 @@ static SpglibDataset * get_dataset(SPGCONST double lattice[3][3],
   return dataset;
 }
 
+/* All states of symmetry search are passed through arguments, */
+/* therefore structures can be searched by threads independently. */
+static void get_datasets(SpglibDataset * datasets[],
+			 SPGCONST double lattices[][3][3],
+			 SPGCONST double positions[][3],
+			 const int types[],
+			 const int num_atoms[],
+			 const int num_cells,
+			 const double symprec,
+			 const double angle_tolerance)
+{
+  int i;
+  int *offsets;
+
+  offsets = (int*) malloc(sizeof(int) * (num_cells + 1));
+  offsets[0] = 0;
+  for (i = 0; i < num_cells; i++) {
+    offsets[i + 1] = offsets[i] + num_atoms[i];
+  }
+
+#pragma omp parallel for schedule(dynamic)
+  for (i = 0; i < num_cells; i++) {
+    datasets[i] = get_dataset(lattices[i],
+			      positions + offsets[i],
+			      types + offsets[i],
+			      num_atoms[i],
+			      symprec,
+			      angle_tolerance);
+  }
+
+  free(offsets);
+  offsets = NULL;
+}
+
 static void set_dataset(SpglibDataset * dataset,
 			SPGCONST Cell * cell,
 			SPGCONST Cell * primitive,
@@ -841,7 +1069,8 @@ static int get_symmetry(int rotation[][3][3],
 			SPGCONST double position[][3],
 			const int types[],
 			const int num_atom,
-			const double symprec)
+			const double symprec,
+			const double angle_tolerance)
 {
   int i, size;
   Symmetry *symmetry;
@@ -849,7 +1078,7 @@ static int get_symmetry(int rotation[][3][3],
 
   cell = cel_alloc_cell(num_atom);
   cel_set_cell(cell, lattice, position, types);
-  symmetry = sym_get_operation(cell, symprec);
+  symmetry = sym_get_operation(cell, symprec, angle_tolerance);
 
   if (symmetry->size > max_size) {
     fprintf(stderr, "spglib: Indicated max size(=%d) is less than number ", max_size);
@@ -878,7 +1107,8 @@ static int get_symmetry_from_dataset(int rotation[][3][3],
 				     SPGCONST double position[][3],
 				     const int types[],
 				     const int num_atom,
-				     const double symprec)
+				     const double symprec,
+				     const double angle_tolerance)
 {
   int i, num_sym;
   SpglibDataset *dataset;
@@ -887,7 +1117,8 @@ static int get_symmetry_from_dataset(int rotation[][3][3],
 			position,
 			types,
 			num_atom,
-			symprec);
+			symprec,
+			angle_tolerance);
   
   if (dataset->n_operations > max_size) {
     fprintf(stderr,
@@ -917,7 +1148,8 @@ static int get_symmetry_with_collinear_spin(int rotation[][3][3],
 					    const int types[],
 					    const double spins[],
 					    const int num_atom,
-					    const double symprec)
+					    const double symprec,
+					    const double angle_tolerance)
 {
   int i, size;
   Symmetry *symmetry;
@@ -925,7 +1157,7 @@ static int get_symmetry_with_collinear_spin(int rotation[][3][3],
 
   cell = cel_alloc_cell(num_atom);
   cel_set_cell(cell, lattice, position, types);
-  symmetry = spn_get_collinear_operation(cell, spins, symprec);
+  symmetry = spn_get_collinear_operation(cell, spins, symprec, angle_tolerance);
   
   if (symmetry->size > max_size) {
     fprintf(stderr, "spglib: Indicated max size(=%d) is less than number ", max_size);
@@ -951,7 +1183,8 @@ static int get_multiplicity(SPGCONST double lattice[3][3],
 			    SPGCONST double position[][3],
 			    const int types[],
 			    const int num_atom,
-			    const double symprec)
+			    const double symprec,
+			    const double angle_tolerance)
 {
   Symmetry *symmetry;
   Cell *cell;
@@ -959,7 +1192,7 @@ static int get_multiplicity(SPGCONST double lattice[3][3],
 
   cell = cel_alloc_cell(num_atom);
   cel_set_cell(cell, lattice, position, types);
-  symmetry = sym_get_operation(cell, symprec);
+  symmetry = sym_get_operation(cell, symprec, angle_tolerance);
 
   size = symmetry->size;
 
@@ -973,16 +1206,18 @@ static int find_primitive(double lattice[3][3],
 			  double position[][3],
 			  int types[],
 			  const int num_atom,
-			  const double symprec)
+			  const double symprec,
+			  const double angle_tolerance)
 {
   int i, num_prim_atom=0;
+  double tolerance;
   Cell *cell, *primitive;
 
   cell = cel_alloc_cell(num_atom);
   cel_set_cell(cell, lattice, position, types);
 
   /* find primitive cell */
-  primitive = prm_get_primitive(cell, symprec);
+  primitive = prm_get_primitive(&tolerance, cell, symprec, angle_tolerance);
   if (primitive->size == cell->size) { /* Already primitive */
     num_prim_atom = 0;
   } else { /* Primitive cell was found. */
@@ -1007,14 +1242,15 @@ static int get_international(char symbol[11],
 			     SPGCONST double position[][3],
 			     const int types[],
 			     const int num_atom,
-			     const double symprec)
+			     const double symprec,
+			     const double angle_tolerance)
 {
   Cell *cell;
   Spacegroup spacegroup;
 
   cell = cel_alloc_cell(num_atom);
   cel_set_cell(cell, lattice, position, types);
-  spacegroup = spa_get_spacegroup(cell, symprec);
+  spacegroup = spa_get_spacegroup(cell, symprec, angle_tolerance);
   if (spacegroup.number > 0) {
     strcpy(symbol, spacegroup.international_short);
   }
@@ -1029,7 +1265,8 @@ static int get_schoenflies(char symbol[10],
 			   SPGCONST double position[][3],
 			   const int types[],
 			   const int num_atom,
-			   const double symprec)
+			   const double symprec,
+			   const double angle_tolerance)
 {
   Cell *cell;
   Spacegroup spacegroup;
@@ -1037,7 +1274,7 @@ static int get_schoenflies(char symbol[10],
   cell = cel_alloc_cell(num_atom);
   cel_set_cell(cell, lattice, position, types);
 
-  spacegroup = spa_get_spacegroup(cell, symprec);
+  spacegroup = spa_get_spacegroup(cell, symprec, angle_tolerance);
   if (spacegroup.number > 0) {
     strcpy(symbol, spacegroup.schoenflies);
   }
@@ -1051,7 +1288,8 @@ static int refine_cell(double lattice[3][3],
 		       double position[][3],
 		       int types[],
 		       const int num_atom,
-		       const double symprec)
+		       const double symprec,
+		       const double angle_tolerance)
 {
   int i, num_atom_bravais;
   Cell *cell, *bravais;
@@ -1059,7 +1297,7 @@ static int refine_cell(double lattice[3][3],
   cell = cel_alloc_cell(num_atom);
   cel_set_cell(cell, lattice, position, types);
 
-  bravais = ref_refine_cell(cell, symprec);
+  bravais = ref_refine_cell(cell, symprec, angle_tolerance);
   cel_free_cell(cell);
 
   if (bravais->size > 0) {
@@ -1090,7 +1328,8 @@ static int get_ir_reciprocal_mesh(int grid_address[][3],
 				  SPGCONST double position[][3],
 				  const int types[],
 				  const int num_atom,
-				  const double symprec)
+				  const double symprec,
+				  const double angle_tolerance)
 {
   SpglibDataset *dataset;
   int num_ir, i;
@@ -1100,7 +1339,8 @@ static int get_ir_reciprocal_mesh(int grid_address[][3],
 			position,
 			types,
 			num_atom,
-			symprec);
+			symprec,
+			angle_tolerance);
   rotations = mat_alloc_MatINT(dataset->n_operations);
   for (i = 0; i < dataset->n_operations; i++) {
     mat_copy_matrix_i3(rotations->mat[i], dataset->rotations[i]);
@@ -1148,6 +1388,42 @@ static int get_stabilized_reciprocal_mesh(int grid_address[][3],
   return num_ir;
 }
 
+static int get_ir_grid_points(int ir_grid_points[],
+			      int ir_weights[],
+			      int map[],
+			      const int max_num_ir,
+			      const int mesh[3],
+			      const int is_shift[3],
+			      const int is_time_reversal,
+			      const int num_rot,
+			      SPGCONST int rotations[][3][3],
+			      const int num_q,
+			      SPGCONST double qpoints[][3])
+{
+  MatINT *rot_real;
+  int i, num_ir;
+
+  rot_real = mat_alloc_MatINT(num_rot);
+  for (i = 0; i < num_rot; i++) {
+    mat_copy_matrix_i3(rot_real->mat[i], rotations[i]);
+  }
+
+  num_ir = kpt_get_ir_grid_points(ir_grid_points,
+				  ir_weights,
+				  map,
+				  max_num_ir,
+				  mesh,
+				  is_shift,
+				  is_time_reversal,
+				  rot_real,
+				  num_q,
+				  qpoints);
+
+  mat_free_MatINT(rot_real);
+
+  return num_ir;
+}
+
 static int get_triplets_reciprocal_mesh_at_q(int map_triplets[],
 					     int map_q[],
 					     int grid_address[][3],
@@ -1178,3 +1454,45 @@ static int get_triplets_reciprocal_mesh_at_q(int map_triplets[],
   return num_ir;
 }
 
+static int get_BZ_triplets_at_qs(int triplets[][3],
+				 int weights[],
+				 int triplets_offsets[],
+				 int map_triplets[],
+				 int map_q[],
+				 const int max_num_triplets,
+				 const int grid_points[],
+				 const int num_grid_points,
+				 SPGCONST int bz_grid_address[][3],
+				 const int bz_map[],
+				 const int mesh[3],
+				 const int is_time_reversal,
+				 const int num_rot,
+				 SPGCONST int rotations[][3][3])
+{
+  MatINT *rot_real;
+  int i, num_triplets;
+
+  rot_real = mat_alloc_MatINT(num_rot);
+  for (i = 0; i < num_rot; i++) {
+    mat_copy_matrix_i3(rot_real->mat[i], rotations[i]);
+  }
+
+  num_triplets = kpt_get_BZ_triplets_at_qs(triplets,
+					   weights,
+					   triplets_offsets,
+					   map_triplets,
+					   map_q,
+					   max_num_triplets,
+					   grid_points,
+					   num_grid_points,
+					   bz_grid_address,
+					   bz_map,
+					   mesh,
+					   is_time_reversal,
+					   rot_real);
+
+  mat_free_MatINT(rot_real);
+
+  return num_triplets;
+}
+
@@ -79,10 +79,11 @@ Symmetry  * spn_get_collinear_operation_with_symmetry(SPGCONST Symmetry *sym_non
 
 Symmetry * spn_get_collinear_operation(SPGCONST Cell *cell,
 				       const double spins[],
-				       const double symprec) {
+				       const double symprec,
+				       const double angle_tolerance) {
   Symmetry *sym_nonspin, *symmetry;
 
-  sym_nonspin = sym_get_operation(cell, symprec);
+  sym_nonspin = sym_get_operation(cell, symprec, angle_tolerance);
   symmetry = spn_get_collinear_operation_with_symmetry(sym_nonspin,
 						       cell,
 						       spins,
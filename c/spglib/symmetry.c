@@ -16,9 +16,6 @@
 #define NUM_ATOMS_CRITERION_FOR_OPENMP 1000
 #define REDUCE_RATE 0.95
 #define PI 3.14159265358979323846
-/* Tolerance of angle between lattice vectors in degrees */
-/* Negative value invokes converter from symprec. */
-static double angle_tolerance = -1.0; 
 
 static int relative_axes[][3] = {
   { 1, 0, 0},
@@ -56,15 +53,19 @@ static int identity[3][3] = {{1, 0, 0},
 static int get_index_with_least_atoms(const Cell *cell);
 static VecDBL * get_translation(SPGCONST int rot[3][3],
 				SPGCONST Cell *cell,
+				const AtomBins *bins,
 				const double symprec,
 				const int is_identity);
 static Symmetry * get_operations(SPGCONST Cell * cell,
-				 const double symprec);
+				 const double symprec,
+				 const double angle_tolerance);
 static Symmetry * reduce_operation(SPGCONST Cell * cell,
 				   SPGCONST Symmetry * symmetry,
-				   const double symprec);
+				   const double symprec,
+				   const double angle_tolerance);
 static void search_translation_part(int lat_point_atoms[],
 				    SPGCONST Cell * cell,
+				    const AtomBins * bins,
 				    SPGCONST int rot[3][3],
 				    const int min_atom_index,
 				    const double origin[3],
@@ -73,6 +74,7 @@ static void search_translation_part(int lat_point_atoms[],
 static int is_overlap_all_atoms(const double test_trans[3],
 				SPGCONST int rot[3][3],
 				SPGCONST Cell * cell,
+				const AtomBins * bins,
 				const double symprec,
 				const int is_identity);
 static PointSymmetry
@@ -90,13 +92,19 @@ static Symmetry * recover_operations_original(SPGCONST Symmetry *symmetry,
 static void set_axes(int axes[3][3],
 		     const int a1, const int a2, const int a3);
 static PointSymmetry get_lattice_symmetry(SPGCONST Cell *cell,
-					  const double symprec);
+					  const double symprec,
+					  const double angle_tolerance);
 static int is_identity_metric(SPGCONST double metric_rotated[3][3],
 			      SPGCONST double metric_orig[3][3],
-			      const double symprec);
+			      const double symprec,
+			      const double angle_tolerance);
 static double get_angle(SPGCONST double metric[3][3],
 			const int i,
 			const int j);
+static int get_adjugate_matrix_i3(int adj[3][3], SPGCONST int m[3][3]);
+static int (*get_lattice_points(SPGCONST int supercell_matrix[3][3],
+				SPGCONST int adj[3][3],
+				const int det))[3];
 
 Symmetry * sym_alloc_symmetry(const int size)
 {
@@ -133,11 +141,14 @@ void sym_free_symmetry(Symmetry *symmetry)
   symmetry = NULL;
 }
 
+/* angle_tolerance is the tolerance of angles between lattice vectors */
+/* in degrees. Negative value invokes converter from symprec. */
 Symmetry * sym_get_operation(SPGCONST Cell *cell,
-			     const double symprec) {
+			     const double symprec,
+			     const double angle_tolerance) {
   Symmetry *symmetry;
   
-  symmetry = get_operations(cell, symprec);
+  symmetry = get_operations(cell, symprec, angle_tolerance);
 
   return symmetry;
 }
@@ -145,9 +156,10 @@ Symmetry * sym_get_operation(SPGCONST Cell *cell,
 /* Number of operations may be reduced with smaller symprec. */
 Symmetry * sym_reduce_operation(SPGCONST Cell * cell,
 				SPGCONST Symmetry * symmetry,
-				const double symprec)
+				const double symprec,
+				const double angle_tolerance)
 {
-  return reduce_operation(cell, symmetry, symprec);
+  return reduce_operation(cell, symmetry, symprec, angle_tolerance);
 }
 
 int sym_get_multiplicity(SPGCONST Cell *cell,
@@ -155,8 +167,11 @@ int sym_get_multiplicity(SPGCONST Cell *cell,
 {
   int multi;
   VecDBL * trans;
+  AtomBins * bins;
 
-  trans = get_translation(identity, cell, symprec, 1);
+  bins = cel_alloc_atom_bins(cell, symprec);
+  trans = get_translation(identity, cell, bins, symprec, 1);
+  cel_free_atom_bins(bins);
   multi = trans->size;
   mat_free_VecDBL(trans);
   return multi;
@@ -167,8 +182,11 @@ VecDBL * sym_get_pure_translation(SPGCONST Cell *cell,
 {
   int multi;
   VecDBL * pure_trans;
+  AtomBins * bins;
 
-  pure_trans = get_translation(identity, cell, symprec, 1);
+  bins = cel_alloc_atom_bins(cell, symprec);
+  pure_trans = get_translation(identity, cell, bins, symprec, 1);
+  cel_free_atom_bins(bins);
   multi = pure_trans->size;
   if ((cell->size / multi) * multi == cell->size) {
     debug_print("sym_get_pure_translation: pure_trans->size = %d\n", multi);
@@ -183,7 +201,8 @@ VecDBL * sym_get_pure_translation(SPGCONST Cell *cell,
 
 VecDBL * sym_reduce_pure_translation(SPGCONST Cell * cell,
 				     const VecDBL * pure_trans,
-				     const double symprec)
+				     const double symprec,
+				     const double angle_tolerance)
 {
   int i, multi;
   Symmetry *symmetry, *symmetry_reduced;
@@ -196,7 +215,7 @@ VecDBL * sym_reduce_pure_translation(SPGCONST Cell * cell,
     mat_copy_vector_d3(symmetry->trans[i], pure_trans->vec[i]);
   }
 
-  symmetry_reduced = reduce_operation(cell, symmetry, symprec);
+  symmetry_reduced = reduce_operation(cell, symmetry, symprec, angle_tolerance);
   sym_free_symmetry(symmetry);
 
   multi = symmetry_reduced->size;
@@ -210,14 +229,107 @@ VecDBL * sym_reduce_pure_translation(SPGCONST Cell * cell,
   return pure_trans_reduced;
 }
 
-void sym_set_angle_tolerance(double tolerance)
+/* Operations of the supercell whose lattice is lattice * supercell_matrix */
+/* are made from operations of the cell without searching. Rotations */
+/* that do not keep the supercell lattice are dropped, and the others */
+/* are combined with lattice translations of the cell in the supercell. */
+/* NULL is returned when supercell_matrix is singular. */
+Symmetry * sym_get_supercell_operation(SPGCONST Symmetry * symmetry,
+				       SPGCONST int supercell_matrix[3][3])
 {
-  angle_tolerance = tolerance;
+  int i, j, k, l, det, num_rot;
+  int adj[3][3], rot[3][3];
+  int *rot_indices;
+  int (*lattice_points)[3];
+  Symmetry *supercell_symmetry;
+
+  /* supercell_matrix^-1 = adj / det */
+  det = get_adjugate_matrix_i3(adj, supercell_matrix);
+  if (det == 0) {
+    return NULL;
+  }
+
+  rot_indices = (int*) malloc(sizeof(int) * symmetry->size);
+  num_rot = 0;
+  for (i = 0; i < symmetry->size; i++) {
+    mat_multiply_matrix_i3(rot, adj, symmetry->rot[i]);
+    mat_multiply_matrix_i3(rot, rot, supercell_matrix);
+    for (j = 0; j < 9; j++) {
+      if (rot[j / 3][j % 3] % det) {
+	break;
+      }
+    }
+    if (j == 9) {
+      rot_indices[num_rot] = i;
+      num_rot++;
+    }
+  }
+
+  lattice_points = get_lattice_points(supercell_matrix, adj, det);
+  supercell_symmetry = sym_alloc_symmetry(num_rot * det);
+
+  for (i = 0; i < num_rot; i++) {
+    mat_multiply_matrix_i3(rot, adj, symmetry->rot[rot_indices[i]]);
+    mat_multiply_matrix_i3(rot, rot, supercell_matrix);
+    for (j = 0; j < 9; j++) {
+      rot[j / 3][j % 3] /= det;
+    }
+    for (j = 0; j < det; j++) {
+      mat_copy_matrix_i3(supercell_symmetry->rot[i * det + j], rot);
+      for (k = 0; k < 3; k++) {
+	supercell_symmetry->trans[i * det + j][k] = 0;
+	for (l = 0; l < 3; l++) {
+	  supercell_symmetry->trans[i * det + j][k] += adj[k][l] *
+	    (symmetry->trans[rot_indices[i]][l] + lattice_points[j][l]);
+	}
+	supercell_symmetry->trans[i * det + j][k] =
+	  mat_Dmod1(supercell_symmetry->trans[i * det + j][k] / det);
+      }
+    }
+  }
+
+  free(lattice_points);
+  lattice_points = NULL;
+  free(rot_indices);
+  rot_indices = NULL;
+
+  return supercell_symmetry;
 }
 
-double sym_get_angle_tolerance(void)
+/* permutations[i * cell->size + j] is the atom at */
+/* rot[i] * position[j] + trans[i], or -1 if there is no such atom. */
+/* 1 is returned when all the atoms are found. */
+int sym_get_atom_permutations(int * permutations,
+			      SPGCONST Symmetry * symmetry,
+			      SPGCONST Cell * cell,
+			      const double symprec)
 {
-  return angle_tolerance;
+  int i, j, k;
+  double pos[3];
+  AtomBins *bins;
+
+  bins = cel_alloc_atom_bins(cell, symprec);
+
+#pragma omp parallel for private(j, k, pos)
+  for (i = 0; i < symmetry->size; i++) {
+    for (j = 0; j < cell->size; j++) {
+      mat_multiply_matrix_vector_id3(pos, symmetry->rot[i], cell->position[j]);
+      for (k = 0; k < 3; k++) {
+	pos[k] += symmetry->trans[i][k];
+      }
+      permutations[i * cell->size + j] =
+	cel_get_overlap_atom(pos, cell->types[j], cell, bins, symprec);
+    }
+  }
+
+  cel_free_atom_bins(bins);
+
+  for (i = 0; i < symmetry->size * cell->size; i++) {
+    if (permutations[i] < 0) {
+      return 0;
+    }
+  }
+  return 1;
 }
 
 
@@ -232,7 +344,8 @@ double sym_get_angle_tolerance(void)
 /*    transformed to those of original input cells, if the input cell */
 /*    was not a primitive cell. */
 static Symmetry * get_operations(SPGCONST Cell *cell,
-				 const double symprec)
+				 const double symprec,
+				 const double angle_tolerance)
 {
   int i, j, attempt;
   double tolerance;
@@ -244,13 +357,15 @@ static Symmetry * get_operations(SPGCONST Cell *cell,
 
   symmetry_orig = NULL;
 
-  lattice_sym = get_lattice_symmetry(cell, symprec);
+  lattice_sym = get_lattice_symmetry(cell, symprec, angle_tolerance);
   if (lattice_sym.size == 0) {
     debug_print("get_lattice_symmetry failed.\n");
     goto end;
   }
 
-  primitive = prm_get_primitive_and_pure_translations(cell, symprec);
+  primitive = prm_get_primitive_and_pure_translations(cell,
+						      symprec,
+						      angle_tolerance);
   if (primitive.cell->size == 0) {
     goto deallocate_and_end;
   }
@@ -274,7 +389,8 @@ static Symmetry * get_operations(SPGCONST Cell *cell,
       warning_print("tolerance is reduced to %f\n", tolerance);
       symmetry_reduced = reduce_operation(primitive.cell,
 					  symmetry,
-					  tolerance);
+					  tolerance,
+					  angle_tolerance);
       sym_free_symmetry(symmetry);
       symmetry = symmetry_reduced;
       if (symmetry_reduced->size > 48) {
@@ -310,19 +426,22 @@ static Symmetry * get_operations(SPGCONST Cell *cell,
 
 static Symmetry * reduce_operation(SPGCONST Cell * cell,
 				   SPGCONST Symmetry * symmetry,
-				   const double symprec)
+				   const double symprec,
+				   const double angle_tolerance)
 {
   int i, j, num_sym;
   Symmetry * sym_reduced;
   PointSymmetry point_symmetry;
   MatINT *rot;
   VecDBL *trans;
+  AtomBins *bins;
 
   debug_print("reduce_operation:\n");
 
-  point_symmetry = get_lattice_symmetry(cell, symprec);
+  point_symmetry = get_lattice_symmetry(cell, symprec, angle_tolerance);
   rot = mat_alloc_MatINT(symmetry->size);
   trans = mat_alloc_VecDBL(symmetry->size);
+  bins = cel_alloc_atom_bins(cell, symprec);
 
   num_sym = 0;
   for (i = 0; i < point_symmetry.size; i++) {
@@ -332,6 +451,7 @@ static Symmetry * reduce_operation(SPGCONST Cell * cell,
 	if (is_overlap_all_atoms(symmetry->trans[j],
 				 symmetry->rot[j],
 				 cell,
+				 bins,
 				 symprec,
 				 0)) {
 	  mat_copy_matrix_i3(rot->mat[num_sym], symmetry->rot[j]);
@@ -342,6 +462,8 @@ static Symmetry * reduce_operation(SPGCONST Cell * cell,
     }
   }
 
+  cel_free_atom_bins(bins);
+
   sym_reduced = sym_alloc_symmetry(num_sym);
   for (i = 0; i < num_sym; i++) {
     mat_copy_matrix_i3(sym_reduced->rot[i], rot->mat[i]);
@@ -360,6 +482,7 @@ static Symmetry * reduce_operation(SPGCONST Cell * cell,
 /* This function is heaviest in this code. */
 static VecDBL * get_translation(SPGCONST int rot[3][3],
 				SPGCONST Cell *cell,
+				const AtomBins *bins,
 				const double symprec,
 				const int is_identity)
 {
@@ -389,6 +512,7 @@ static VecDBL * get_translation(SPGCONST int rot[3][3],
   if (cell->size < NUM_ATOMS_CRITERION_FOR_OPENMP) {
     search_translation_part(is_found,
 			    cell,
+			    bins,
 			    rot,
 			    min_atom_index,
 			    origin,
@@ -413,6 +537,7 @@ static VecDBL * get_translation(SPGCONST int rot[3][3],
       if (is_overlap_all_atoms(vec,
 			       rot,
 			       cell,
+			       bins,
 			       symprec,
 			       is_identity)) {
 	is_found[min_type_atoms[i]] = 1;
@@ -424,6 +549,7 @@ static VecDBL * get_translation(SPGCONST int rot[3][3],
 #else
   search_translation_part(is_found,
 			  cell,
+			  bins,
 			  rot,
 			  min_atom_index,
 			  origin,
@@ -454,6 +580,7 @@ static VecDBL * get_translation(SPGCONST int rot[3][3],
 
 static void search_translation_part(int lat_point_atoms[],
 				    SPGCONST Cell * cell,
+				    const AtomBins * bins,
 				    SPGCONST int rot[3][3],
 				    const int min_atom_index,
 				    const double origin[3],
@@ -474,6 +601,7 @@ static void search_translation_part(int lat_point_atoms[],
     if (is_overlap_all_atoms(vec,
 			     rot,
 			     cell,
+			     bins,
 			     symprec,
 			     is_identity)) {
       lat_point_atoms[i] = 1;
@@ -481,18 +609,17 @@ static void search_translation_part(int lat_point_atoms[],
   }
 }
 
+/* Overlapping atoms are searched only in the neighboring bins. */
 static int is_overlap_all_atoms(const double trans[3],
 				SPGCONST int rot[3][3],
 				SPGCONST Cell * cell,
+				const AtomBins * bins,
 				const double symprec,
 				const int is_identity)
 {
-  int i, j, k, is_found;
-  double symprec2;
-  double pos_rot[3], d[3];
+  int i, j;
+  double pos_rot[3];
 
-  symprec2 = symprec*symprec;
-  
   for (i = 0; i < cell->size; i++) {
     if (is_identity) { /* Identity matrix is treated as special for speed. */
       for (j = 0; j < 3; j++) {
@@ -507,32 +634,16 @@ static int is_overlap_all_atoms(const double trans[3],
       }
     }
 
-    is_found = 0;
-    for (j = 0; j < cell->size; j++) {
-      if (cell->types[i] == cell->types[j]) {
-	/* here cel_is_overlap can be used, but for the tuning */
-	/* purpose, write it again */
-	for (k = 0; k < 3; k++) {
-	  d[k] = pos_rot[k] - cell->position[j][k];
-	  d[k] -= mat_Nint(d[k]);
-	}
-	mat_multiply_matrix_vector_d3(d, cell->lattice, d);
-	if (d[0]*d[0]+d[1]*d[1]+d[2]*d[2] < symprec2) {
-	  is_found = 1;
-	  break;
-	}
-      }
-    }
-
-    if (! is_found) {
-      goto not_found;
+    if (cel_get_overlap_atom(pos_rot,
+			     cell->types[i],
+			     cell,
+			     bins,
+			     symprec) < 0) {
+      return 0; /* not found */
     }
   }
 
   return 1;  /* found */
-
- not_found:
-  return 0;
 }
 
 static int get_index_with_least_atoms(const Cell *cell)
@@ -577,15 +688,18 @@ get_space_group_operations(SPGCONST PointSymmetry *lattice_sym,
   int i, j, num_sym, total_num_sym;
   VecDBL **trans;
   Symmetry *symmetry;
+  AtomBins *bins;
 
   debug_print("get_space_group_operations:\n");
   
   trans = (VecDBL**) malloc(sizeof(VecDBL*) * lattice_sym->size);
+  bins = cel_alloc_atom_bins(cell, symprec);
   total_num_sym = 0;
   for (i = 0; i < lattice_sym->size; i++) {
-    trans[i] = get_translation(lattice_sym->rot[i], cell, symprec, 0);
+    trans[i] = get_translation(lattice_sym->rot[i], cell, bins, symprec, 0);
     total_num_sym += trans[i]->size;
   }
+  cel_free_atom_bins(bins);
 
   symmetry = sym_alloc_symmetry(total_num_sym);
   num_sym = 0;
@@ -657,7 +771,8 @@ static Symmetry * recover_operations_original(SPGCONST Symmetry *symmetry,
 }
 
 static PointSymmetry get_lattice_symmetry(SPGCONST Cell *cell,
-					  const double symprec)
+					  const double symprec,
+					  const double angle_tolerance)
 {
   int i, j, k, num_sym;
   int axes[3][3];
@@ -687,7 +802,7 @@ static PointSymmetry get_lattice_symmetry(SPGCONST Cell *cell,
 	mat_multiply_matrix_di3(lattice, min_lattice, axes);
 	mat_get_metric(metric, lattice);
 	
-	if (is_identity_metric(metric, metric_orig, symprec)) {
+	if (is_identity_metric(metric, metric_orig, symprec, angle_tolerance)) {
 	  mat_copy_matrix_i3(lattice_sym.rot[num_sym], axes);
 	  num_sym++;
 	}
@@ -714,7 +829,8 @@ static PointSymmetry get_lattice_symmetry(SPGCONST Cell *cell,
 
 static int is_identity_metric(SPGCONST double metric_rotated[3][3],
 			      SPGCONST double metric_orig[3][3],
-			      const double symprec)
+			      const double symprec,
+			      const double angle_tolerance)
 {
   int i, j, k;
   int elem_sets[3][2] = {{0, 1},
@@ -829,3 +945,75 @@ static void set_axes(int axes[3][3],
   for (i = 0; i < 3; i++) {axes[i][1] = relative_axes[a2][i]; }
   for (i = 0; i < 3; i++) {axes[i][2] = relative_axes[a3][i]; }
 }
+
+/* Sign of adj is chosen to return positive determinant. */
+static int get_adjugate_matrix_i3(int adj[3][3], SPGCONST int m[3][3])
+{
+  int i, j, det;
+
+  adj[0][0] = m[1][1] * m[2][2] - m[1][2] * m[2][1];
+  adj[0][1] = m[0][2] * m[2][1] - m[0][1] * m[2][2];
+  adj[0][2] = m[0][1] * m[1][2] - m[0][2] * m[1][1];
+  adj[1][0] = m[1][2] * m[2][0] - m[1][0] * m[2][2];
+  adj[1][1] = m[0][0] * m[2][2] - m[0][2] * m[2][0];
+  adj[1][2] = m[0][2] * m[1][0] - m[0][0] * m[1][2];
+  adj[2][0] = m[1][0] * m[2][1] - m[1][1] * m[2][0];
+  adj[2][1] = m[0][1] * m[2][0] - m[0][0] * m[2][1];
+  adj[2][2] = m[0][0] * m[1][1] - m[0][1] * m[1][0];
+  det = m[0][0] * adj[0][0] + m[0][1] * adj[1][0] + m[0][2] * adj[2][0];
+
+  if (det < 0) {
+    for (i = 0; i < 3; i++) {
+      for (j = 0; j < 3; j++) {
+	adj[i][j] = -adj[i][j];
+      }
+    }
+    det = -det;
+  }
+
+  return det;
+}
+
+/* Lattice points of the cell inside the supercell in the coordinates */
+/* of the cell. The number of the points is det. */
+static int (*get_lattice_points(SPGCONST int supercell_matrix[3][3],
+				SPGCONST int adj[3][3],
+				const int det))[3]
+{
+  int i, j, num_points;
+  int min[3], max[3], n[3], q[3];
+  int (*lattice_points)[3];
+
+  for (i = 0; i < 3; i++) {
+    min[i] = 0;
+    max[i] = 0;
+    for (j = 0; j < 3; j++) {
+      if (supercell_matrix[i][j] < 0) {
+	min[i] += supercell_matrix[i][j];
+      } else {
+	max[i] += supercell_matrix[i][j];
+      }
+    }
+  }
+
+  lattice_points = (int (*)[3]) malloc(sizeof(int[3]) * det);
+  num_points = 0;
+  for (n[0] = min[0]; n[0] <= max[0]; n[0]++) {
+    for (n[1] = min[1]; n[1] <= max[1]; n[1]++) {
+      for (n[2] = min[2]; n[2] <= max[2]; n[2]++) {
+	mat_multiply_matrix_vector_i3(q, adj, n);
+	for (i = 0; i < 3; i++) {
+	  if (q[i] < 0 || q[i] >= det) {
+	    break;
+	  }
+	}
+	if (i == 3 && num_points < det) {
+	  mat_copy_vector_i3(lattice_points[num_points], n);
+	  num_points++;
+	}
+      }
+    }
+  }
+
+  return lattice_points;
+}
@@ -137,65 +137,38 @@ static int db_relative_grid_address[4][24][4][3] = {
   },
 };
 
-static void
-get_integration_weight_at_omegas(double *integration_weights,
-				 const int num_omegas,
-				 const double *omegas,
-				 SPGCONST double tetrahedra_omegas[24][4],
-				 double (*gn)(const int,
-					      const double,
-					      const double[4]),
-				 double (*IJ)(const int,
-					      const int,
-					      const double,
-					      const double[4]));
 static double
 get_integration_weight(const double omega,
-		       SPGCONST double tetrahedra_omegas[24][4],
-		       double (*gn)(const int,
-				    const double,
-				    const double[4]),
-		       double (*IJ)(const int,
-				    const int,
-				    const double,
-				    const double[4]));
+		       SPGCONST double sorted_omegas[24][4],
+		       const int ci[24],
+		       const char function);
+static void sort_tetrahedra_omegas(double sorted_omegas[24][4],
+				   int ci[24],
+				   SPGCONST double tetrahedra_omegas[24][4]);
 static int get_main_diagonal(SPGCONST double rec_lattice[3][3]);
 static int sort_omegas(double v[4]);
 static double _f(const int n,
 		 const int m,
 		 const double omega,
 		 const double vertices_omegas[4]);
-static double _J(const int i,
-		 const int ci,
-		 const double omega,
-		 const double vertices_omegas[4]);
-static double _I(const int i,
-		 const int ci,
-		 const double omega,
-		 const double vertices_omegas[4]);
-static double _n(const int i,
-		 const double omega,
-		 const double vertices_omegas[4]);
-static double _g(const int i,
-		 const double omega,
-		 const double vertices_omegas[4]);
-static double _n_0(void);
+static double _IJg(const int ci,
+		   const double omega,
+		   const double vertices_omegas[4]);
+static double _JJn(const int ci,
+		   const double omega,
+		   const double vertices_omegas[4]);
 static double _n_1(const double omega,
 		   const double vertices_omegas[4]);
 static double _n_2(const double omega,
 		   const double vertices_omegas[4]);
 static double _n_3(const double omega,
 		   const double vertices_omegas[4]);
-static double _n_4(void);
-static double _g_0(void);
 static double _g_1(const double omega,
 		   const double vertices_omegas[4]);
 static double _g_2(const double omega,
 		   const double vertices_omegas[4]);
 static double _g_3(const double omega,
 		   const double vertices_omegas[4]);
-static double _g_4(void);
-static double _J_0(void);
 static double _J_10(const double omega,
 		    const double vertices_omegas[4]);
 static double _J_11(const double omega,
@@ -220,8 +193,6 @@ static double _J_32(const double omega,
 		    const double vertices_omegas[4]);
 static double _J_33(const double omega,
 		    const double vertices_omegas[4]);
-static double _J_4(void);
-static double _I_0(void);
 static double _I_10(const double omega,
 		    const double vertices_omegas[4]);
 static double _I_11(const double omega,
@@ -246,7 +217,6 @@ static double _I_32(const double omega,
 		    const double vertices_omegas[4]);
 static double _I_33(const double omega,
 		    const double vertices_omegas[4]);
-static double _I_4(void);
 
 
 void thm_get_relative_grid_address(int relative_grid_address[24][4][3],
@@ -286,106 +256,71 @@ double thm_get_integration_weight(const double omega,
 				  SPGCONST double tetrahedra_omegas[24][4],
 				  const char function)
 {
-  if (function == 'I') {
-    return get_integration_weight(omega,
-				  tetrahedra_omegas,
-				  _g, _I);
-  } else {
-    return get_integration_weight(omega,
-				  tetrahedra_omegas,
-				  _n, _J);
-  }
+  int ci[24];
+  double sorted_omegas[24][4];
+
+  sort_tetrahedra_omegas(sorted_omegas, ci, tetrahedra_omegas);
+  return get_integration_weight(omega, sorted_omegas, ci, function);
 }
 
+/* Vertices are sorted only once for all omegas. */
 void
 thm_get_integration_weight_at_omegas(double *integration_weights,
 				     const int num_omegas,
 				     const double *omegas,
 				     SPGCONST double tetrahedra_omegas[24][4],
 				     const char function)
-{
-  if (function == 'I') {
-    get_integration_weight_at_omegas(integration_weights,
-				     num_omegas,
-				     omegas,
-				     tetrahedra_omegas,
-				     _g, _I);
-  } else {
-    get_integration_weight_at_omegas(integration_weights,
-				     num_omegas,
-				     omegas,
-				     tetrahedra_omegas,
-				     _n, _J);
-  }
-}
-
-static void
-get_integration_weight_at_omegas(double *integration_weights,
-				 const int num_omegas,
-				 const double *omegas,
-				 SPGCONST double tetrahedra_omegas[24][4],
-				 double (*gn)(const int,
-					      const double,
-					      const double[4]),
-				 double (*IJ)(const int,
-					      const int,
-					      const double,
-					      const double[4]))
 {
   int i;
+  int ci[24];
+  double sorted_omegas[24][4];
 
+  sort_tetrahedra_omegas(sorted_omegas, ci, tetrahedra_omegas);
 #pragma omp parallel for
   for (i = 0; i < num_omegas; i++) {
     integration_weights[i] = get_integration_weight(omegas[i],
-						    tetrahedra_omegas,
-						    gn, IJ);
+						    sorted_omegas,
+						    ci,
+						    function);
   }
 }
 
 static double
 get_integration_weight(const double omega,
-		       SPGCONST double tetrahedra_omegas[24][4],
-		       double (*gn)(const int,
-				    const double,
-				    const double[4]),
-		       double (*IJ)(const int,
-				    const int,
-				    const double,
-				    const double[4]))
-{
-  int i, j, ci;
+		       SPGCONST double sorted_omegas[24][4],
+		       const int ci[24],
+		       const char function)
+{
+  int i;
   double sum;
-  double v[4];
 
   sum = 0;
-  for (i = 0; i < 24; i++) {
-    for (j = 0; j < 4; j++) {
-      v[j] = tetrahedra_omegas[i][j];
+  if (function == 'I') {
+    for (i = 0; i < 24; i++) {
+      sum += _IJg(ci[i], omega, sorted_omegas[i]);
     }
-    ci = sort_omegas(v);
-    if (omega < v[0]) {
-      sum += IJ(0, ci, omega, v) * gn(0, omega, v);
-    } else {
-      if (v[0] < omega && omega < v[1]) {
-	sum += IJ(1, ci, omega, v) * gn(1, omega, v);
-      } else {
-	if (v[1] < omega && omega < v[2]) {
-	  sum += IJ(2, ci, omega, v) * gn(2, omega, v);
-	} else {
-	  if (v[2] < omega && omega < v[3]) {
-	    sum += IJ(3, ci, omega, v) * gn(3, omega, v);
-	  } else {
-	    if (v[3] < omega) {
-	      sum += IJ(4, ci, omega, v) * gn(4, omega, v);
-	    }
-	  }
-	}
-      }
+  } else {
+    for (i = 0; i < 24; i++) {
+      sum += _JJn(ci[i], omega, sorted_omegas[i]);
     }
   }
   return sum / 6;
 }
 
+static void sort_tetrahedra_omegas(double sorted_omegas[24][4],
+				   int ci[24],
+				   SPGCONST double tetrahedra_omegas[24][4])
+{
+  int i, j;
+
+  for (i = 0; i < 24; i++) {
+    for (j = 0; j < 4; j++) {
+      sorted_omegas[i][j] = tetrahedra_omegas[i][j];
+    }
+    ci[i] = sort_omegas(sorted_omegas[i]);
+  }
+}
+
 static int sort_omegas(double v[4])
 {
   int i;
@@ -485,166 +420,101 @@ static double _f(const int n,
 	  (vertices_omegas[n] - vertices_omegas[m]));
 }
 
-static double _J(const int i,
-		 const int ci,
-		 const double omega,
-		 const double vertices_omegas[4])
+/* I * g for omega in (omega1, omega4). Zero outside of it and */
+/* at omega equal to one of vertices. */
+static double _IJg(const int ci,
+		   const double omega,
+		   const double vertices_omegas[4])
 {
-  switch (i) {
-  case 0:
-    return _J_0();
-  case 1:
+  const double *v;
+
+  v = vertices_omegas;
+  if (v[0] < omega && omega < v[1]) {
     switch (ci) {
     case 0:
-      return _J_10(omega, vertices_omegas);
+      return _I_10(omega, v) * _g_1(omega, v);
     case 1:
-      return _J_11(omega, vertices_omegas);
+      return _I_11(omega, v) * _g_1(omega, v);
     case 2:
-      return _J_12(omega, vertices_omegas);
-    case 3:
-      return _J_13(omega, vertices_omegas);
+      return _I_12(omega, v) * _g_1(omega, v);
+    default:
+      return _I_13(omega, v) * _g_1(omega, v);
     }
-  case 2:
+  }
+  if (v[1] < omega && omega < v[2]) {
     switch (ci) {
     case 0:
-      return _J_20(omega, vertices_omegas);
+      return _I_20(omega, v) * _g_2(omega, v);
     case 1:
-      return _J_21(omega, vertices_omegas);
+      return _I_21(omega, v) * _g_2(omega, v);
     case 2:
-      return _J_22(omega, vertices_omegas);
-    case 3:
-      return _J_23(omega, vertices_omegas);
+      return _I_22(omega, v) * _g_2(omega, v);
+    default:
+      return _I_23(omega, v) * _g_2(omega, v);
     }
-  case 3:
+  }
+  if (v[2] < omega && omega < v[3]) {
     switch (ci) {
     case 0:
-      return _J_30(omega, vertices_omegas);
+      return _I_30(omega, v) * _g_3(omega, v);
     case 1:
-      return _J_31(omega, vertices_omegas);
+      return _I_31(omega, v) * _g_3(omega, v);
     case 2:
-      return _J_32(omega, vertices_omegas);
-    case 3:
-      return _J_33(omega, vertices_omegas);
+      return _I_32(omega, v) * _g_3(omega, v);
+    default:
+      return _I_33(omega, v) * _g_3(omega, v);
     }
-  case 4:
-    return _J_4();
   }
-
-  warning_print("******* Warning *******\n");
-  warning_print(" J is something wrong. \n");
-  warning_print("******* Warning *******\n");
-  warning_print("(line %d, %s).\n", __LINE__, __FILE__);
-
-  return 0;
+  return 0.0;
 }
 
-
-static double _I(const int i,
-		 const int ci,
-		 const double omega,
-		 const double vertices_omegas[4])
+/* J * n for omega in (omega1, omega4) and 1/4 for omega4 < omega. */
+static double _JJn(const int ci,
+		   const double omega,
+		   const double vertices_omegas[4])
 {
-  switch (i) {
-  case 0:
-    return _I_0();
-  case 1:
+  const double *v;
+
+  v = vertices_omegas;
+  if (v[0] < omega && omega < v[1]) {
     switch (ci) {
     case 0:
-      return _I_10(omega, vertices_omegas);
+      return _J_10(omega, v) * _n_1(omega, v);
     case 1:
-      return _I_11(omega, vertices_omegas);
+      return _J_11(omega, v) * _n_1(omega, v);
     case 2:
-      return _I_12(omega, vertices_omegas);
-    case 3:
-      return _I_13(omega, vertices_omegas);
+      return _J_12(omega, v) * _n_1(omega, v);
+    default:
+      return _J_13(omega, v) * _n_1(omega, v);
     }
-  case 2:
+  }
+  if (v[1] < omega && omega < v[2]) {
     switch (ci) {
     case 0:
-      return _I_20(omega, vertices_omegas);
+      return _J_20(omega, v) * _n_2(omega, v);
     case 1:
-      return _I_21(omega, vertices_omegas);
+      return _J_21(omega, v) * _n_2(omega, v);
     case 2:
-      return _I_22(omega, vertices_omegas);
-    case 3:
-      return _I_23(omega, vertices_omegas);
+      return _J_22(omega, v) * _n_2(omega, v);
+    default:
+      return _J_23(omega, v) * _n_2(omega, v);
     }
-  case 3:
+  }
+  if (v[2] < omega && omega < v[3]) {
     switch (ci) {
     case 0:
-      return _I_30(omega, vertices_omegas);
+      return _J_30(omega, v) * _n_3(omega, v);
     case 1:
-      return _I_31(omega, vertices_omegas);
+      return _J_31(omega, v) * _n_3(omega, v);
     case 2:
-      return _I_32(omega, vertices_omegas);
-    case 3:
-      return _I_33(omega, vertices_omegas);
+      return _J_32(omega, v) * _n_3(omega, v);
+    default:
+      return _J_33(omega, v) * _n_3(omega, v);
     }
-  case 4:
-    return _I_4();
   }
-
-  warning_print("******* Warning *******\n");
-  warning_print(" I is something wrong. \n");
-  warning_print("******* Warning *******\n");
-  warning_print("(line %d, %s).\n", __LINE__, __FILE__);
-
-  return 0;
-}
-
-static double _n(const int i,
-		 const double omega,
-		 const double vertices_omegas[4])
-{
-  switch (i) {
-  case 0:
-    return _n_0();
-  case 1:
-    return _n_1(omega, vertices_omegas);
-  case 2:
-    return _n_2(omega, vertices_omegas);
-  case 3:
-    return _n_3(omega, vertices_omegas);
-  case 4:
-    return _n_4();
+  if (v[3] < omega) {
+    return 0.25;
   }
-  
-  warning_print("******* Warning *******\n");
-  warning_print(" n is something wrong. \n");
-  warning_print("******* Warning *******\n");
-  warning_print("(line %d, %s).\n", __LINE__, __FILE__);
-
-  return 0;
-}
-
-static double _g(const int i,
-		 const double omega,
-		 const double vertices_omegas[4])
-{
-  switch (i) {
-  case 0:
-    return _g_0();
-  case 1:
-    return _g_1(omega, vertices_omegas);
-  case 2:
-    return _g_2(omega, vertices_omegas);
-  case 3:
-    return _g_3(omega, vertices_omegas);
-  case 4:
-    return _g_4();
-  }
-  
-  warning_print("******* Warning *******\n");
-  warning_print(" g is something wrong. \n");
-  warning_print("******* Warning *******\n");
-  warning_print("(line %d, %s).\n", __LINE__, __FILE__);
-
-  return 0;
-}
-
-/* omega < omega1 */
-static double _n_0(void)
-{
   return 0.0;
 }
 
@@ -681,18 +551,6 @@ static double _n_3(const double omega,
 	  _f(2, 3, omega, vertices_omegas));
 }
 
-/* omega4 < omega */
-static double _n_4(void)
-{
-  return 1.0;
-}
-
-/* omega < omega1 */
-static double _g_0(void)
-{
-  return 0.0;
-}
-
 /* omega1 < omega < omega2 */
 static double _g_1(const double omega,
 		   const double vertices_omegas[4])
@@ -725,17 +583,6 @@ static double _g_3(const double omega,
             (vertices_omegas[3] - vertices_omegas[0]));
 }
 
-/* omega4 < omega */
-static double _g_4(void)
-{
-  return 0.0;
-}
-
-static double _J_0(void)
-{
-  return 0.0;
-}
-
 static double _J_10(const double omega,
 		    const double vertices_omegas[4])
 {
@@ -877,16 +724,6 @@ static double _J_33(const double omega,
 	   _f(3, 2, omega, vertices_omegas))) / 4 / _n_3(omega, vertices_omegas);
 }
 
-static double _J_4(void)
-{
-  return 0.25;
-}
-
-static double _I_0(void)
-{
-  return 0.0;
-}
-
 static double _I_10(const double omega,
 		    const double vertices_omegas[4])
 {
@@ -991,7 +828,3 @@ static double _I_33(const double omega,
 	  _f(3, 2, omega, vertices_omegas)) / 3;
 }
 
-static double _I_4(void)
-{
-  return 0.0;
-}
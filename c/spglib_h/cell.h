@@ -13,6 +13,17 @@ typedef struct {
     double (*position)[3];
 } Cell;
 
+/* Atoms sorted into bins of fractional coordinates. Bins are not */
+/* narrower than symprec, so overlapping atoms are found in */
+/* neighboring bins. Fractional coordinates of atoms overlapping */
+/* with a position differ by less than margin from it. */
+typedef struct {
+    int mesh[3];
+    double margin[3];
+    int *bin_start;
+    int *atoms;
+} AtomBins;
+
 Cell *cel_alloc_cell( const int size );
 void cel_free_cell( Cell * cell );
 void cel_set_cell( Cell * cell,
@@ -24,5 +35,13 @@ int cel_is_overlap( const double a[3],
 		    const double b[3],
 		    SPGCONST double lattice[3][3],
 		    const double symprec );
+AtomBins * cel_alloc_atom_bins( SPGCONST Cell * cell,
+				const double symprec );
+void cel_free_atom_bins( AtomBins * bins );
+int cel_get_overlap_atom( const double pos[3],
+			  const int type,
+			  SPGCONST Cell * cell,
+			  const AtomBins * bins,
+			  const double symprec );
 
 #endif
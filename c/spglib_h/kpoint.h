@@ -27,6 +27,16 @@ int kpt_get_stabilized_reciprocal_mesh(int grid_address[][3],
 				       const MatINT * rotations,
 				       const int num_q,
 				       SPGCONST double qpoints[][3]);
+int kpt_get_ir_grid_points(int ir_grid_points[],
+			   int ir_weights[],
+			   int map[],
+			   const int max_num_ir,
+			   const int mesh[3],
+			   const int is_shift[3],
+			   const int is_time_reversal,
+			   const MatINT * rotations,
+			   const int num_q,
+			   SPGCONST double qpoints[][3]);
 void kpt_get_grid_points_by_rotations(int rot_grid_points[],
 				      const int address_orig[3],
 				      const MatINT * rot_reciprocal,
@@ -37,6 +47,7 @@ void kpt_get_BZ_grid_points_by_rotations(int rot_grid_points[],
 					 const MatINT * rot_reciprocal,
 					 const int mesh[3],
 					 const int is_shift[3],
+					 SPGCONST int bz_grid_address[][3],
 					 const int bz_map[]);
 int kpt_relocate_BZ_grid_address(int bz_grid_address[][3],
 				 int bz_map[],
@@ -58,6 +69,19 @@ int kpt_get_BZ_triplets_at_q(int triplets[][3],
 			     const int map_triplets[],
 			     const int num_map_triplets,
 			     const int mesh[3]);
+int kpt_get_BZ_triplets_at_qs(int triplets[][3],
+			      int weights[],
+			      int triplets_offsets[],
+			      int map_triplets[],
+			      int map_q[],
+			      const int max_num_triplets,
+			      const int grid_points[],
+			      const int num_grid_points,
+			      SPGCONST int bz_grid_address[][3],
+			      const int bz_map[],
+			      const int mesh[3],
+			      const int is_time_reversal,
+			      const MatINT * rotations);
 void kpt_get_neighboring_grid_points(int neighboring_grid_points[],
 				     const int grid_point,
 				     SPGCONST int relative_grid_address[][3],
@@ -13,12 +13,16 @@ typedef struct {
   VecDBL *pure_trans;
 } Primitive;
 
-Cell * prm_get_primitive(SPGCONST Cell * cell,
-			 const double symprec);
+Cell * prm_get_primitive(double * tolerance_found,
+			 SPGCONST Cell * cell,
+			 const double symprec,
+			 const double angle_tolerance);
 Cell * prm_get_primitive_and_mapping_table(int * mapping_table,
+					   double * tolerance_found,
 					   SPGCONST Cell * cell,
-					   const double symprec);
+					   const double symprec,
+					   const double angle_tolerance);
 Primitive prm_get_primitive_and_pure_translations(SPGCONST Cell * cell,
-						  const double symprec);
-double prm_get_current_tolerance(void);
+						  const double symprec,
+						  const double angle_tolerance);
 #endif
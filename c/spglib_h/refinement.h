@@ -10,7 +10,8 @@
 #include "symmetry.h"
 
 Cell * ref_refine_cell(SPGCONST Cell * cell,
-		       const double symprec);
+		       const double symprec,
+		       const double angle_tolerance);
 Symmetry *
 ref_get_refined_symmetry_operations(SPGCONST Cell * cell,
 				    SPGCONST Cell * primitive,
@@ -25,9 +25,11 @@ typedef struct {
 } Spacegroup;
 
 Spacegroup spa_get_spacegroup(SPGCONST Cell * cell,
-			      const double symprec);
+			      const double symprec,
+			      const double angle_tolerance);
 Spacegroup spa_get_spacegroup_with_primitive(SPGCONST Cell * primitive,
-					     const double symprec);
+					     const double symprec,
+					     const double angle_tolerance);
 Symmetry * spa_get_conventional_symmetry(SPGCONST double transform_mat[3][3],
 					 const Centering centering,
 					 const Symmetry *primitive_sym);
@@ -100,6 +100,28 @@ SpglibDataset * spgat_get_dataset(SPGCONST double lattice[3][3],
 
 void spg_free_dataset(SpglibDataset *dataset);
 
+/* Datasets of many structures are searched in parallel. Positions */
+/* and types of all structures are concatenated in ``positions`` and */
+/* ``types``, and ``num_atoms[i]`` atoms belong to the i-th structure */
+/* of ``lattices[i]``. Each of ``datasets`` has to be freed by */
+/* ``spg_free_dataset``. */
+void spg_get_datasets(SpglibDataset * datasets[],
+		      SPGCONST double lattices[][3][3],
+		      SPGCONST double positions[][3],
+		      const int types[],
+		      const int num_atoms[],
+		      const int num_cells,
+		      const double symprec);
+
+void spgat_get_datasets(SpglibDataset * datasets[],
+			SPGCONST double lattices[][3][3],
+			SPGCONST double positions[][3],
+			const int types[],
+			const int num_atoms[],
+			const int num_cells,
+			const double symprec,
+			const double angle_tolerance);
+
 /* Find symmetry operations. The operations are stored in */
 /* ``rotatiion`` and ``translation``. The number of operations is */
 /* return as the return value. Rotations and translations are */
@@ -125,6 +147,37 @@ int spgat_get_symmetry(int rotation[][3][3],
 		       const double symprec,
 		       const double angle_tolerance);
 
+/* Symmetry operations of a supercell are made from ``rotations`` and */
+/* ``translations`` of a smaller cell, e.g., those in the dataset of */
+/* the primitive cell, without searching them in the supercell. */
+/* Supercell lattice is given by ``lattice * supercell_matrix`` with */
+/* column lattice vectors. Rotations that do not keep the supercell */
+/* lattice are dropped. The number of operations is returned, and 0 is */
+/* returned when ``supercell_matrix`` is singular or ``max_size`` is */
+/* smaller than the number. */
+int spg_get_supercell_symmetry(int rotation[][3][3],
+			       double translation[][3],
+			       const int max_size,
+			       SPGCONST int rotations[][3][3],
+			       SPGCONST double translations[][3],
+			       const int num_operations,
+			       SPGCONST int supercell_matrix[3][3]);
+
+/* Atoms sent by symmetry operations are searched with bins of atomic */
+/* positions. ``permutations[i * num_atom + j]`` is the atom at */
+/* ``rotations[i] * position[j] + translations[i]``, or -1 when there */
+/* is no such atom. 1 is returned when all the atoms are found, */
+/* otherwise 0. */
+int spg_get_atom_permutations(int permutations[],
+			      SPGCONST int rotations[][3][3],
+			      SPGCONST double translations[][3],
+			      const int num_operations,
+			      SPGCONST double lattice[3][3],
+			      SPGCONST double position[][3],
+			      const int types[],
+			      const int num_atom,
+			      const double symprec);
+
 /* Find symmetry operations with collinear spins on atoms. */
 int spg_get_symmetry_with_collinear_spin(int rotation[][3][3],
 					 double translation[][3],
@@ -321,6 +374,27 @@ int spg_get_stabilized_reciprocal_mesh(int grid_address[][3],
 				       const int num_q,
 				       SPGCONST double qpoints[][3]);
 
+/* Irreducible grid points of the mesh are returned in ascending */
+/* order as ``ir_grid_points`` with their multiplicities as */
+/* ``ir_weights``, up to ``max_num_ir`` points. The number of all */
+/* the irreducible grid points is the return value, so a larger */
+/* buffer can be given when it exceeds ``max_num_ir``. ``map`` is */
+/* filled as in spg_get_stabilized_reciprocal_mesh if it is not */
+/* NULL. With NULL, no array of the size of the mesh is allocated, */
+/* which is useful for very dense meshes. Stabilizers are ignored */
+/* if ``num_q`` is 0. */
+int spg_get_ir_grid_points(int ir_grid_points[],
+			   int ir_weights[],
+			   int map[],
+			   const int max_num_ir,
+			   const int mesh[3],
+			   const int is_shift[3],
+			   const int is_time_reversal,
+			   const int num_rot,
+			   SPGCONST int rotations[][3][3],
+			   const int num_q,
+			   SPGCONST double qpoints[][3]);
+
 /* Rotation operations in reciprocal space ``rot_reciprocal`` are applied */
 /* to a grid address ``address_orig`` and resulting grid points are stored in */
 /* ``rot_grid_points``. */
@@ -331,11 +405,22 @@ void spg_get_grid_points_by_rotations(int rot_grid_points[],
 				      const int mesh[3],
 				      const int is_shift[3]);
 
+/* The same as spg_get_grid_points_by_rotations, but grid points in */
+/* BZ given by spg_relocate_BZ_grid_address are stored. */
+void spg_get_BZ_grid_points_by_rotations(int rot_grid_points[],
+					 const int address_orig[3],
+					 const int num_rot,
+					 SPGCONST int rot_reciprocal[][3][3],
+					 const int mesh[3],
+					 const int is_shift[3],
+					 SPGCONST int bz_grid_address[][3],
+					 const int bz_map[]);
+
 /* Grid addresses are relocated inside Brillouin zone. */
 /* Number of ir-grid-points inside Brillouin zone is returned. */
 /* It is assumed that the following arrays have the shapes of */
 /*   bz_grid_address[prod(mesh + 1)][3] */
-/*   bz_map[prod(mesh * 2)] */
+/*   bz_map[prod(mesh) + 1] */
 /* where grid_address[prod(mesh)][3]. */
 /* Each element of grid_address is mapped to each element of */
 /* bz_grid_address with keeping element order. bz_grid_address has */
@@ -351,8 +436,10 @@ void spg_get_grid_points_by_rotations(int rot_grid_points[],
 /* where xxx means the memory space that may not be used. Number of grid */
 /* points stored in bz_grid_address is returned. */
 /* bz_map is used to recover grid point index expanded to include BZ */
-/* surface from grid address. The grid point indices are mapped to */
-/* (mesh[0] * 2) x (mesh[1] * 2) x (mesh[2] * 2) space (bz_map). */
+/* surface from grid address. The added ones equivalent to grid point i */
+/* are bz_grid_address[prod(mesh) + bz_map[i]] to */
+/* bz_grid_address[prod(mesh) + bz_map[i + 1] - 1], so bz_map is */
+/* searched only for the few grid points on BZ surface. */
 int spg_relocate_BZ_grid_address(int bz_grid_address[][3],
 				 int bz_map[],
 				 SPGCONST int grid_address[][3],
@@ -389,6 +476,30 @@ int spg_get_BZ_triplets_at_q(int triplets[][3],
 			     const int num_map_triplets,
 			     const int mesh[3]);
 
+/* Irreducible grid-point-triplets in BZ at many grid points are */
+/* searched at once. Grid points with the same little group share */
+/* the reduction of the mesh. Triplets and their weights at */
+/* grid_points[i] are stored from triplets_offsets[i] to */
+/* triplets_offsets[i + 1] - 1 in triplets and weights, which are */
+/* written up to max_num_triplets. triplets_offsets needs */
+/* num_grid_points + 1 elements. map_triplets and map_q are */
+/* [num_grid_points][prod(mesh)] or NULL if not needed. */
+/* Total number of ir-triplets is returned. */
+int spg_get_BZ_triplets_at_qs(int triplets[][3],
+			      int weights[],
+			      int triplets_offsets[],
+			      int map_triplets[],
+			      int map_q[],
+			      const int max_num_triplets,
+			      const int grid_points[],
+			      const int num_grid_points,
+			      SPGCONST int bz_grid_address[][3],
+			      const int bz_map[],
+			      const int mesh[3],
+			      const int is_time_reversal,
+			      const int num_rot,
+			      SPGCONST int rotations[][3][3]);
+
 void spg_get_neighboring_grid_points(int relative_grid_points[],
 				     const int grid_point,
 				     SPGCONST int relative_grid_address[][3],
@@ -14,6 +14,7 @@ Symmetry  * spn_get_collinear_operation_with_symmetry(SPGCONST Symmetry *sym_non
 						      const double symprec);
 Symmetry * spn_get_collinear_operation(SPGCONST Cell *cell,
 				       const double spins[],
-				       const double symprec);
+				       const double symprec,
+				       const double angle_tolerance);
 
 #endif
@@ -23,16 +23,23 @@ void sym_free_symmetry( Symmetry * symmetry );
 int sym_get_multiplicity( SPGCONST Cell * cell,
 			  const double symprec );
 Symmetry * sym_get_operation( SPGCONST Cell * cell,
-			      const double symprec );
+			      const double symprec,
+			      const double angle_tolerance );
 Symmetry * sym_reduce_operation( SPGCONST Cell * cell,
 				 SPGCONST Symmetry * symmetry,
-				 const double symprec );
+				 const double symprec,
+				 const double angle_tolerance );
 VecDBL * sym_get_pure_translation( SPGCONST Cell *cell,
 				   const double symprec );
 VecDBL * sym_reduce_pure_translation( SPGCONST Cell * cell,
 				      const VecDBL * pure_trans,
-				      const double symprec );
-void sym_set_angle_tolerance(double tolerance);
-double sym_get_angle_tolerance(void);
+				      const double symprec,
+				      const double angle_tolerance );
+Symmetry * sym_get_supercell_operation( SPGCONST Symmetry * symmetry,
+					SPGCONST int supercell_matrix[3][3] );
+int sym_get_atom_permutations( int * permutations,
+			       SPGCONST Symmetry * symmetry,
+			       SPGCONST Cell * cell,
+			       const double symprec );
 
 #endif
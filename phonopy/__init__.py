@@ -88,8 +88,8 @@ class Phonopy:
         # Set supercell and primitive symmetry
         self._symmetry = None
         self._primitive_symmetry = None
-        self._search_symmetry()
         self._search_primitive_symmetry()
+        self._search_symmetry()
 
         # set_displacements (used only in preprocess)
         self._displacement_dataset = None
@@ -398,38 +398,41 @@ class Phonopy:
         Calculate phonon frequencies at q
         
         q: q-vector in reduced coordinates of primitive cell
+           A list of q-vectors gives frequencies at the q-points.
         """
         self._set_dynamical_matrix()
-        self._dynamical_matrix.set_dynamical_matrix(q)
-        dm = self._dynamical_matrix.get_dynamical_matrix()
-        frequencies = []
-        for eig in np.linalg.eigvalsh(dm).real:
-            if eig < 0:
-                frequencies.append(-np.sqrt(-eig))
-            else:
-                frequencies.append(np.sqrt(eig))
-            
-        return np.array(frequencies) * self._factor
+        qpoints = np.array(q, dtype='double')
+        dm = self._dynamical_matrix.get_dynamical_matrices(qpoints)
+        eigvals = np.array([np.linalg.eigvalsh(dm_q).real for dm_q in dm])
+        frequencies = np.sqrt(np.abs(eigvals)) * np.sign(eigvals)
+        if qpoints.ndim == 1:
+            return frequencies[0] * self._factor
+        else:
+            return frequencies * self._factor
 
     def get_frequencies_with_eigenvectors(self, q):
         """
         Calculate phonon frequencies and eigenvectors at q
         
         q: q-vector in reduced coordinates of primitive cell
+           A list of q-vectors gives frequencies and eigenvectors at
+           the q-points.
         """
         self._set_dynamical_matrix()
-        self._dynamical_matrix.set_dynamical_matrix(q)
-        dm = self._dynamical_matrix.get_dynamical_matrix()
-        frequencies = []
-        eigvals, eigenvectors = np.linalg.eigh(dm)
-        frequencies = []
-        for eig in eigvals:
-            if eig < 0:
-                frequencies.append(-np.sqrt(-eig))
-            else:
-                frequencies.append(np.sqrt(eig))
-
-        return np.array(frequencies) * self._factor, eigenvectors
+        qpoints = np.array(q, dtype='double')
+        dm = self._dynamical_matrix.get_dynamical_matrices(qpoints)
+        eigvals = []
+        eigenvectors = []
+        for dm_q in dm:
+            eigvals_q, eigvecs_q = np.linalg.eigh(dm_q)
+            eigvals.append(eigvals_q.real)
+            eigenvectors.append(eigvecs_q)
+        eigvals = np.array(eigvals)
+        frequencies = np.sqrt(np.abs(eigvals)) * np.sign(eigvals)
+        if qpoints.ndim == 1:
+            return frequencies[0] * self._factor, eigenvectors[0]
+        else:
+            return frequencies * self._factor, np.array(eigenvectors)
 
     def set_band_structure(self,
                            bands,
@@ -954,13 +957,18 @@ class Phonopy:
     def _search_symmetry(self):
         self._symmetry = Symmetry(self._supercell,
                                   self._symprec,
-                                  self._is_symmetry)
+                                  self._is_symmetry,
+                                  primitive_symmetry=self._primitive_symmetry)
+        self._check_primitive_symmetry()
 
     def _search_primitive_symmetry(self):
         self._primitive_symmetry = Symmetry(self._primitive,
                                             self._symprec,
                                             self._is_symmetry)
-        
+        if self._symmetry is not None:
+            self._check_primitive_symmetry()
+
+    def _check_primitive_symmetry(self):
         if (len(self._symmetry.get_pointgroup_operations()) !=
             len(self._primitive_symmetry.get_pointgroup_operations())):
             print ("Warning: point group symmetries of supercell and primitive"
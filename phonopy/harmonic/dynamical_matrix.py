@@ -35,6 +35,8 @@
 import numpy as np
 from phonopy.structure.cells import get_reduced_bases
 DAMPING_FACTOR = 0.25
+# Dynamical matrices computed at once are limited to about this size (bytes)
+BATCH_MEMORY = 2 ** 27
 
 class DynamicalMatrix:
     """Dynamical matrix class
@@ -78,6 +80,8 @@ class DynamicalMatrix:
         self._mass = self._pcell.get_masses()
         # Non analytical term correction
         self._nac = False
+        # Real space table for dynamical matrices at many q-points
+        self._dynmat_table = None
 
     def is_nac(self):
         return self._nac
@@ -124,6 +128,133 @@ class DynamicalMatrix:
         except ImportError:
             self._set_py_dynamical_matrix(q, verbose=verbose)
 
+    def get_dynamical_matrices(self,
+                               qpoints,
+                               q_direction=None,
+                               gamma_tolerance=1e-5,
+                               verbose=False):
+        """Dynamical matrices at q-points
+
+        Sums over lattice points are taken from a real space table of
+        mass weighted force constants that is made once, and the
+        dynamical matrices at all q-points are computed at once in C.
+        q_direction is only used with non-analytical term correction at
+        q-points whose reduced coordinates are within gamma_tolerance
+        from Gamma point. frequency_scale_factor and decimals are
+        applied as get_dynamical_matrix.
+        """
+        qpoints = np.array(qpoints, dtype='double', order='C').reshape(-1, 3)
+        try:
+            import phonopy._phonopy as phonoc
+            dm = self._get_c_dynamical_matrices(qpoints,
+                                                q_direction,
+                                                gamma_tolerance)
+        except ImportError:
+            dim = self.get_dimension()
+            dm = np.zeros((len(qpoints), dim, dim), dtype='complex128')
+            for i, q in enumerate(qpoints):
+                self._set_dynamical_matrix_for_batch(q,
+                                                     q_direction,
+                                                     gamma_tolerance,
+                                                     verbose)
+                dm[i] = self._dynamical_matrix
+            
+        if self._freq_scale is not None:
+            dm *= self._freq_scale ** 2
+
+        if self._decimals is None:
+            return dm
+        else:
+            return dm.round(decimals=self._decimals)
+
+    def iter_dynamical_matrices(self,
+                                qpoints,
+                                q_direction=None,
+                                gamma_tolerance=1e-5,
+                                verbose=False):
+        """Dynamical matrices at q-points one by one
+
+        Dynamical matrices are computed by get_dynamical_matrices in
+        batches whose size is limited by BATCH_MEMORY.
+        """
+        dim = self.get_dimension()
+        batch_size = max(1, BATCH_MEMORY // (dim * dim * 16))
+        for i in range(0, len(qpoints), batch_size):
+            for dm in self.get_dynamical_matrices(
+                qpoints[i:(i + batch_size)],
+                q_direction=q_direction,
+                gamma_tolerance=gamma_tolerance,
+                verbose=verbose):
+                yield dm
+
+    def _set_dynamical_matrix_for_batch(self,
+                                        q,
+                                        q_direction,
+                                        gamma_tolerance,
+                                        verbose):
+        self.set_dynamical_matrix(q, verbose=verbose)
+
+    def _get_c_dynamical_matrices(self, qpoints, q_direction, gamma_tolerance):
+        import phonopy._phonopy as phonoc
+
+        if self._dynmat_table is None:
+            self._set_dynmat_table()
+        (table_index,
+         table_vectors,
+         table_weights,
+         table_phase_weights) = self._dynmat_table
+        dim = self.get_dimension()
+        dm_real = np.zeros((len(qpoints), dim, dim), dtype='double')
+        dm_imag = np.zeros_like(dm_real)
+        q_cart, nac_factors, born = self._get_nac_for_batch(qpoints,
+                                                            q_direction,
+                                                            gamma_tolerance)
+        phonoc.dynamical_matrices(dm_real,
+                                  dm_imag,
+                                  qpoints,
+                                  table_index,
+                                  table_vectors,
+                                  table_weights,
+                                  table_phase_weights,
+                                  np.array(self._mass, dtype='double'),
+                                  q_cart,
+                                  nac_factors,
+                                  born)
+        dm = dm_real + dm_imag * 1j
+        return (dm + dm.conj().transpose(0, 2, 1)) / 2
+
+    def _get_nac_for_batch(self, qpoints, q_direction, gamma_tolerance):
+        return None, None, None
+
+    def _set_dynmat_table(self):
+        import phonopy._phonopy as phonoc
+
+        num_patom = len(self._p2s_map)
+        size = phonoc.dynmat_table_size(self._multiplicity,
+                                        self._s2p_map,
+                                        self._p2s_map)
+        table_index = np.zeros(num_patom ** 2 + 1, dtype='intc')
+        table_vectors = np.zeros((size, 3), dtype='double')
+        table_weights = np.zeros((size, 3, 3), dtype='double')
+        table_phase_weights = np.zeros(size, dtype='double')
+        phonoc.dynmat_table(table_index,
+                            table_vectors,
+                            table_weights,
+                            table_phase_weights,
+                            self._get_bare_force_constants(),
+                            self._smallest_vectors,
+                            self._multiplicity,
+                            np.array(self._mass, dtype='double'),
+                            self._s2p_map,
+                            self._p2s_map)
+        self._dynmat_table = (table_index,
+                              table_vectors,
+                              table_weights,
+                              table_phase_weights)
+
+    def _get_bare_force_constants(self):
+        return self._force_constants
+
     def _set_py_dynamical_matrix(self,
                                  q,
                                  verbose=False):
@@ -246,6 +377,75 @@ class DynamicalMatrixNAC(DynamicalMatrix):
     def get_dielectric_constant(self):
         return self._dielectric
     
+    def get_dynamical_matrices(self,
+                               qpoints,
+                               q_direction=None,
+                               gamma_tolerance=1e-5,
+                               verbose=False):
+        """Dynamical matrices at q-points
+
+        q_direction is used at q-points within gamma_tolerance from
+        Gamma point. Parlinski method is computed q-point by q-point.
+        """
+        if self._method == 'parlinski':
+            qpoints = np.reshape(qpoints, (-1, 3))
+            dim = self.get_dimension()
+            dm = np.zeros((len(qpoints), dim, dim), dtype='complex128')
+            for i, q in enumerate(qpoints):
+                self._set_dynamical_matrix_for_batch(q,
+                                                     q_direction,
+                                                     gamma_tolerance,
+                                                     verbose)
+                dm[i] = self.get_dynamical_matrix()
+            return dm
+        else:
+            return DynamicalMatrix.get_dynamical_matrices(
+                self,
+                qpoints,
+                q_direction=q_direction,
+                gamma_tolerance=gamma_tolerance,
+                verbose=verbose)
+
+    def _set_dynamical_matrix_for_batch(self,
+                                        q,
+                                        q_direction,
+                                        gamma_tolerance,
+                                        verbose):
+        if q_direction is not None and (np.abs(q) < gamma_tolerance).all():
+            self.set_dynamical_matrix(q,
+                                      q_direction=q_direction,
+                                      verbose=verbose)
+        else:
+            self.set_dynamical_matrix(q, verbose=verbose)
+
+    def _get_nac_for_batch(self, qpoints, q_direction, gamma_tolerance):
+        """Cartesian q-vectors and prefactors of charge term
+
+        The prefactor is zero where non-analytical term is not added.
+        """
+        rec_lat = np.linalg.inv(self._pcell.get_cell()).T
+        q_cart = np.array(np.dot(qpoints, rec_lat), dtype='double', order='C')
+        nac_factors = np.zeros(len(qpoints), dtype='double')
+        N = (self._scell.get_number_of_atoms() /
+             self._pcell.get_number_of_atoms())
+        # Same conditions as _set_dynamical_matrix_for_batch and
+        # set_dynamical_matrix
+        for i, q_red in enumerate(qpoints):
+            if (q_direction is not None and
+                (np.abs(q_red) < gamma_tolerance).all()):
+                q_cart[i] = np.dot(q_direction, rec_lat)
+                if np.abs(q_direction).sum() < self._symprec:
+                    continue
+            elif np.abs(q_cart[i]).sum() < self._symprec:
+                continue
+            nac_factors[i] = (self.get_nac_factor() / N /
+                              np.dot(q_cart[i],
+                                     np.dot(self._dielectric, q_cart[i])))
+        return q_cart, nac_factors, self._born
+
+    def _get_bare_force_constants(self):
+        return self._bare_force_constants
+
     def set_nac_params(self, nac_params, method='wang'):
         self._method = method
         self._born = np.array(nac_params['born'], dtype='double', order='C')
@@ -34,6 +34,7 @@
 
 import numpy as np
 import sys
+import phonopy.structure.spglib as spg
 from phonopy.structure.cells import get_reduced_bases
 from phonopy.harmonic.dynamical_matrix import get_equivalent_smallest_vectors
 
@@ -158,28 +159,79 @@ def distribute_force_constants(force_constants,
                                rotations,
                                trans,
                                symprec):
-    for atom_disp in atom_list:
-        if atom_disp in atom_list_done:
-            continue
-            
-        map_atom_disp, map_sym = get_atom_mapping_by_symmetry(
-            atom_list_done,
-            atom_disp,
-            rotations, 
-            trans,
-            positions,
-            symprec)
+    atom_list_todo = [a for a in atom_list if a not in atom_list_done]
+    if len(atom_list_todo) == 0:
+        return
+
+    try:
+        import phonopy._phonopy as phonoc
+    except ImportError:
+        for atom_disp in atom_list_todo:
+            map_atom_disp, map_sym = get_atom_mapping_by_symmetry(
+                atom_list_done,
+                atom_disp,
+                rotations, 
+                trans,
+                positions,
+                symprec)
+
+            _distribute_fc2_part(force_constants,
+                                 positions,
+                                 atom_disp,
+                                 map_atom_disp,
+                                 lattice,
+                                 rotations[map_sym],
+                                 trans[map_sym],
+                                 symprec)
+        return
+
+    permutations = get_atom_permutations(positions,
+                                         rotations,
+                                         trans,
+                                         symprec)
+    is_done = np.zeros(len(positions) + 1, dtype='bool')
+    is_done[np.array(atom_list_done, dtype='intc')] = True
+    map_atoms = []
+    map_syms = []
+    for atom_disp in atom_list_todo:
+        # is_done[-1] is False for atoms not found (-1)
+        syms = np.where(is_done[permutations[:, atom_disp]])[0]
+        if len(syms) == 0:
+            print 'Input forces are not enough to calculate force constants,'
+            print 'or something wrong (e.g. crystal structure does not match).'
+            raise ValueError
+        map_syms.append(syms[0])
+        map_atoms.append(permutations[syms[0], atom_disp])
+
+    if (permutations[map_syms] < 0).any():
+        print 'Input forces are not enough to calculate force constants,'
+        print 'or something wrong (e.g. crystal structure does not match).'
+        raise ValueError
 
-        _distribute_fc2_part(force_constants,
-                             positions,
-                             atom_disp,
-                             map_atom_disp,
-                             lattice,
-                             rotations[map_sym],
-                             trans[map_sym],
-                             symprec)
+    # L R L^-1
+    rotations_cart = np.array(
+        [similarity_transformation(lattice, r) for r in rotations],
+        dtype='double', order='C')
+    phonoc.distribute_fc2(force_constants,
+                          np.array(atom_list_todo, dtype='intc'),
+                          np.array(map_atoms, dtype='intc'),
+                          np.array(map_syms, dtype='intc'),
+                          rotations_cart,
+                          permutations)
+
+def get_atom_permutations(positions, rotations, translations, symprec=1e-5):
+    """Atoms sent by symmetry operations
+
+    permutations[i, j] is the atom at rotations[i] * positions[j] +
+    translations[i], or -1 if there is no such atom. This table is
+    computed once and shared by all displaced atoms. Positions are
+    compared in fractional coordinates.
+    """
+    return spg.get_atom_permutations(rotations,
+                                     translations,
+                                     positions,
+                                     symprec=symprec)
 
-    
 def get_atom_mapping_by_symmetry(atom_list_done,
                                  atom_number,
                                  rotations,
@@ -230,20 +282,16 @@ def solve_force_constants(force_constants,
         return None
     
 def get_positions_sent_by_rot_inv(positions, site_symmetry, symprec):
-    rot_map_syms = []
-    for sym in site_symmetry:
-        rot_map = np.zeros(len(positions), dtype='intc')
-        rot_pos = np.dot(positions, sym.T)
-        is_found = False
-        for i, rot_pos_i in enumerate(rot_pos):
-            diff = positions - rot_pos_i
-            j = np.nonzero((
-                    np.abs(diff - np.rint(diff)) < symprec).all(axis=1))[0]
-            rot_map[j] = i
-
-        rot_map_syms.append(rot_map)
+    permutations = get_atom_permutations(positions,
+                                         site_symmetry,
+                                         np.zeros((len(site_symmetry), 3)),
+                                         symprec)
+    rot_map_syms = np.zeros(permutations.shape, dtype='intc')
+    for rot_map, perm in zip(rot_map_syms, permutations):
+        atoms = np.arange(len(positions))[perm > -1]
+        rot_map[perm[atoms]] = atoms
 
-    return np.array(rot_map_syms, dtype='intc', order='C')
+    return rot_map_syms
 
 def get_rotated_displacement(displacements, site_sym_cart):
     rot_disps = []
@@ -593,33 +641,22 @@ def _distribute_fc2_part(force_constants,
     rot_cartesian = np.array(
         similarity_transformation(lattice, r), dtype='double', order='C')
 
-    try:
-        import phonopy._phonopy as phonoc
-        phonoc.distribute_fc2(force_constants,
-                              positions,
-                              atom_disp,
-                              map_atom_disp,
-                              rot_cartesian,
-                              np.array(r, dtype='intc', order='C'),
-                              np.array(t, dtype='double'),
-                              symprec)
-    except ImportError:
-        for i, pos_i in enumerate(positions):
-            rot_pos = np.dot(pos_i, r.T) + t
-            rot_atom = -1
-            for j, pos_j in enumerate(positions):
-                diff = pos_j - rot_pos
-                if (abs(diff - np.rint(diff)) < symprec).all():
-                    rot_atom = j
-                    break
-        
-            if rot_atom < 0:
-                print 'Input forces are not enough to calculate force constants,'
-                print 'or something wrong (e.g. crystal structure does not match).'
-                raise ValueError
-            
-            # R^-1 P R (inverse transformation)
-            force_constants[atom_disp, i] += similarity_transformation(
-                rot_cartesian.T,
-                force_constants[map_atom_disp, rot_atom])
+    for i, pos_i in enumerate(positions):
+        rot_pos = np.dot(pos_i, r.T) + t
+        rot_atom = -1
+        for j, pos_j in enumerate(positions):
+            diff = pos_j - rot_pos
+            if (abs(diff - np.rint(diff)) < symprec).all():
+                rot_atom = j
+                break
+
+        if rot_atom < 0:
+            print 'Input forces are not enough to calculate force constants,'
+            print 'or something wrong (e.g. crystal structure does not match).'
+            raise ValueError
+
+        # R^-1 P R (inverse transformation)
+        force_constants[atom_disp, i] += similarity_transformation(
+            rot_cartesian.T,
+            force_constants[map_atom_disp, rot_atom])
     
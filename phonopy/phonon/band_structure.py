@@ -226,20 +226,22 @@ class BandStructure:
             self._group_velocity.set_q_points(path)
             gv = self._group_velocity.get_group_velocity()
         
-        for i, q in enumerate(path):
+        if is_nac:
+            # Used at Gamma point
+            q_direction = np.array(path[0]) - np.array(path[-1])
+        else:
+            q_direction = None
+        # q_direction is used at Gamma point found with the same
+        # tolerance as before batching.
+        dynamical_matrices = self._dynamical_matrix.iter_dynamical_matrices(
+            path,
+            q_direction=q_direction,
+            gamma_tolerance=0.0001,
+            verbose=verbose)
+
+        for i, (q, dm) in enumerate(zip(path, dynamical_matrices)):
             self._shift_point(q)
             distances_on_path.append(self._distance)
-            
-            if is_nac:
-                q_direction = None
-                if (np.abs(q) < 0.0001).all(): # For Gamma point
-                    q_direction = path[0] - path[-1]
-                self._dynamical_matrix.set_dynamical_matrix(
-                    q, q_direction=q_direction, verbose=verbose)
-            else:
-                self._dynamical_matrix.set_dynamical_matrix(
-                    q, verbose=verbose)
-            dm = self._dynamical_matrix.get_dynamical_matrix()
 
             if self._is_eigenvectors:
                 eigvals, eigvecs = np.linalg.eigh(dm)
@@ -118,7 +118,16 @@ class GroupVelocity:
         self._group_velocity = None
         self._perturbation = None
 
-    def set_q_points(self, q_points, perturbation=None):
+    def set_q_points(self,
+                     q_points,
+                     perturbation=None,
+                     frequencies=None,
+                     eigenvectors=None):
+        """
+        frequencies and eigenvectors at q_points can be given, e.g.,
+        those already calculated by Mesh. They are used only for the
+        analytical derivative of dynamical matrix.
+        """
         self._q_points = q_points
         self._perturbation = perturbation
         if perturbation is None:
@@ -127,7 +136,10 @@ class GroupVelocity:
             self._directions[0] = np.dot(
                 self._reciprocal_lattice, perturbation)
         self._directions[0] /= np.linalg.norm(self._directions[0])
-        self._set_group_velocity()
+        if self._q_length is None:
+            self._set_group_velocity_c(frequencies, eigenvectors)
+        else:
+            self._set_group_velocity()
 
     def set_q_length(self, q_length):
         self._q_length = q_length
@@ -139,6 +151,68 @@ class GroupVelocity:
         gv = [self._set_group_velocity_at_q(q) for q in self._q_points]
         self._group_velocity = np.array(gv)
 
+    def _set_group_velocity_c(self, frequencies, eigenvectors):
+        import phonopy._phonopy as phonoc
+
+        q_points = np.array(self._q_points, dtype='double', order='C')
+        if frequencies is None or eigenvectors is None:
+            frequencies, eigenvectors = self._get_phonons(q_points)
+        num_band = frequencies.shape[1]
+        gv = np.zeros((len(q_points), num_band, 3), dtype='double')
+
+        dm = self._dynmat
+        svecs, multiplicity = dm.get_shortest_vectors()
+        primitive = dm.get_primitive()
+        if dm.is_nac():
+            born = dm.get_born_effective_charges()
+            dielectric = dm.get_dielectric_constant()
+            nac_factor = dm.get_nac_factor()
+        else:
+            born = None
+            dielectric = None
+            nac_factor = 0
+
+        phonoc.group_velocities(gv,
+                                np.array(frequencies,
+                                         dtype='double', order='C'),
+                                np.array(eigenvectors,
+                                         dtype='complex128', order='C'),
+                                q_points,
+                                dm.get_force_constants(),
+                                np.array(primitive.get_cell().T,
+                                         dtype='double', order='C'),
+                                svecs,
+                                multiplicity,
+                                primitive.get_masses(),
+                                dm.get_supercell_to_primitive_map(),
+                                dm.get_primitive_to_supercell_map(),
+                                nac_factor,
+                                born,
+                                dielectric,
+                                None,
+                                np.array(self._directions[0], dtype='double'),
+                                self._factor,
+                                self._cutoff_frequency,
+                                1e-4) # same as degenerate_sets
+
+        if self._perturbation is None:
+            gv = [self._symmetrize_group_velocity(gv_q, q)
+                  for gv_q, q in zip(gv, q_points)]
+        self._group_velocity = np.array(gv)
+
+    def _get_phonons(self, q_points):
+        eigvecs = []
+        freqs = []
+        for q in q_points:
+            self._dynmat.set_dynamical_matrix(q)
+            dm = self._dynmat.get_dynamical_matrix()
+            eigvals, eigvecs_q = np.linalg.eigh(dm)
+            eigvals = eigvals.real
+            freqs.append(np.sqrt(abs(eigvals)) * np.sign(eigvals) *
+                         self._factor)
+            eigvecs.append(eigvecs_q)
+        return np.array(freqs), np.array(eigvecs)
+
     def _set_group_velocity_at_q(self, q):
         self._dynmat.set_dynamical_matrix(q)
         dm = self._dynmat.get_dynamical_matrix()
@@ -181,5 +181,10 @@ class Mesh:
                                      np.sign(self._eigenvalues)) * self._factor
 
     def _set_group_velocities(self, group_velocity):
-        group_velocity.set_q_points(self._qpoints)
+        if self._is_eigenvectors:
+            group_velocity.set_q_points(self._qpoints,
+                                        frequencies=self._frequencies,
+                                        eigenvectors=self._eigenvectors)
+        else:
+            group_velocity.set_q_points(self._qpoints)
         self._group_velocities = group_velocity.get_group_velocity()
@@ -129,8 +129,8 @@ class QpointsPhonon:
         if self._is_eigenvectors:
             self._eigenvectors = []
             
-        for q in self._qpoints:
-            dm = self._get_dynamical_matrix(q)
+        for dm in self._dynamical_matrix.iter_dynamical_matrices(
+            self._qpoints, q_direction=self._nac_q_direction):
             if self._write_dynamical_matrix:
                 self._dm.append(dm)
             if self._is_eigenvectors:
@@ -146,13 +146,3 @@ class QpointsPhonon:
                                      dtype='double', order='C')
         self._eigenvectors = np.array(self._eigenvectors,
                                       dtype='complex128', order='C')
-                
-    def _get_dynamical_matrix(self, q):
-        if self._nac_q_direction is not None and (np.abs(q) < 1e-5).all():
-            self._dynamical_matrix.set_dynamical_matrix(
-                q, q_direction=self._nac_q_direction)
-        else:
-            self._dynamical_matrix.set_dynamical_matrix(q)
-        return self._dynamical_matrix.get_dynamical_matrix()
-        
-            
@@ -161,28 +161,29 @@ class ThermalProperties(ThermalPropertiesBase):
     def set_thermal_properties(self, t_step=10, t_max=1000, t_min=0):
         temperatures = np.arange(t_min, t_max + t_step / 2.0, t_step,
                                  dtype='double')
-        fe = []
-        entropy = []
-        cv = []
-        energy = []
         try:
             import phonopy._phonopy as phonoc
-            for t in temperatures:
-                props = self._get_c_thermal_properties(t)
-                fe.append(props[0] * EvTokJmol + self._zero_point_energy)
-                entropy.append(props[1] * EvTokJmol * 1000)
-                cv.append(props[2] * EvTokJmol * 1000)
+            props = self._get_c_thermal_properties(temperatures)
+            fe = props[:, 0] * EvTokJmol + self._zero_point_energy
+            entropy = props[:, 1] * EvTokJmol * 1000
+            cv = props[:, 2] * EvTokJmol * 1000
+            energy = props[:, 3] * EvTokJmol + self._zero_point_energy
         except ImportError:
+            fe = []
+            entropy = []
+            cv = []
             for t in temperatures:
                 props = self._get_py_thermal_properties(t)
                 fe.append(props[0])
                 entropy.append(props[1] * 1000,)
                 cv.append(props[2] * 1000)
+            fe = np.array(fe, dtype='double')
+            entropy = np.array(entropy, dtype='double')
+            cv = np.array(cv, dtype='double')
+            energy = fe + entropy * temperatures / 1000
 
-        self._thermal_properties = [temperatures,
-                                    np.array(fe, dtype='double'),
-                                    np.array(entropy, dtype='double'),
-                                    np.array(cv, dtype='double')]
+        self._thermal_properties = [temperatures, fe, entropy, cv]
+        self._energy = energy
 
         if self._is_projection:
             fe = []
@@ -203,6 +204,9 @@ class ThermalProperties(ThermalPropertiesBase):
     def get_thermal_properties( self ):
         return self._thermal_properties
 
+    def get_energy(self):
+        return self._energy
+
     def write_yaml(self, filename='thermal_properties.yaml'):
         f = open(filename, 'w')
         self._write_tp_yaml(f)
@@ -242,7 +246,7 @@ class ThermalProperties(ThermalPropertiesBase):
                 f.write("  heat_capacity: %15.7f\n" % 0 )
             else:
                 f.write("  heat_capacity: %15.7f\n" % cv[i])
-            f.write("  energy:        %15.7f\n" % (fe[i]+entropy[i]*t/1000))
+            f.write("  energy:        %15.7f\n" % self._energy[i])
             f.write("\n")
 
     def _write_projected_tp_yaml(self, f):
@@ -279,15 +283,19 @@ class ThermalProperties(ThermalPropertiesBase):
             f.write(" # %13.7f\n" % np.sum(energy))
             f.write("\n")
             
-    def _get_c_thermal_properties(self, t):
+    def _get_c_thermal_properties(self, temperatures):
+        """Free energy, entropy, heat capacity, and energy at temperatures
+
+        Zero point energy is not included. Values are zero at T <= 0.
+        """
         import phonopy._phonopy as phonoc
 
-        if t > 0:
-            return phonoc.thermal_properties(t,
-                                             self._frequencies,
-                                             self._weights)
-        else:
-            return (0.0, 0.0, 0.0)
+        thermal_props = np.zeros((len(temperatures), 4), dtype='double')
+        phonoc.thermal_properties(thermal_props,
+                                  np.array(temperatures, dtype='double'),
+                                  self._frequencies,
+                                  np.array(self._weights, dtype='intc'))
+        return thermal_props
 
     def _get_py_thermal_properties(self, t):
         return (self.get_free_energy(t),
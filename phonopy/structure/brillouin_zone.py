@@ -117,7 +117,7 @@ if __name__ == '__main__':
         np.linalg.inv(cell.get_cell()),
         is_shift=is_shift)
 
-    bz_points = np.extract(bz_map > -1, bz_map)
+    bz_points = np.arange(len(bz_grid_address))
     qpoints = (grid_address + is_shift / 2.0) / mesh
     qpoints -= (qpoints > 0.5001) * 1
 
@@ -57,14 +57,13 @@ def get_qpoints(mesh_numbers,
     return gp.get_ir_qpoints(), gp.get_ir_grid_weights()
     
 def extract_ir_grid_points(grid_mapping_table):
-    ir_gp = []
-    weights = np.zeros_like(grid_mapping_table)
-    for i, gp in enumerate(grid_mapping_table):
-        if i == gp:
-            ir_gp.append(i)
-        weights[gp]  += 1
-    ir_grid_points = np.array(ir_gp, dtype='intc')
-    ir_weights = weights[ir_grid_points]
+    ir_grid_points = np.array(
+        np.where(grid_mapping_table ==
+                 np.arange(len(grid_mapping_table)))[0], dtype='intc')
+    weights = np.bincount(grid_mapping_table,
+                          minlength=len(grid_mapping_table))
+    ir_weights = np.array(weights[ir_grid_points],
+                          dtype=grid_mapping_table.dtype)
     
     return ir_grid_points, ir_weights
 
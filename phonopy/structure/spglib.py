@@ -49,6 +49,74 @@ def get_symmetry(bulk, use_magmoms=False, symprec=1e-5, angle_tolerance=-1.0):
             'translations': np.array(translation[:num_sym],
                                      dtype='double', order='C')}
 
+def get_supercell_symmetry(symmetry_operations, supercell_matrix):
+    """
+    Return symmetry operations of supercell as hash.
+    symmetry_operations:
+      Hash of 'rotations' and 'translations' of a smaller cell, e.g.,
+      those of the primitive cell.
+    supercell_matrix:
+      Supercell lattice is given by np.dot(supercell_matrix, lattice)
+      with row lattice vectors as in Atoms class.
+    Rotations that do not keep the supercell lattice are dropped.
+    """
+    rotations = np.array(symmetry_operations['rotations'],
+                         dtype='intc', order='C')
+    translations = np.array(symmetry_operations['translations'],
+                            dtype='double', order='C')
+    smat = np.array(np.transpose(supercell_matrix), dtype='intc', order='C')
+    multi = len(rotations) * abs(int(round(np.linalg.det(smat))))
+    rotation = np.zeros((multi, 3, 3), dtype='intc')
+    translation = np.zeros((multi, 3), dtype='double')
+    num_sym = spg.supercell_symmetry(rotation,
+                                     translation,
+                                     rotations,
+                                     translations,
+                                     smat)
+
+    return {'rotations': np.array(rotation[:num_sym], dtype='intc', order='C'),
+            'translations': np.array(translation[:num_sym],
+                                     dtype='double', order='C')}
+
+def get_atom_permutations(rotations,
+                          translations,
+                          positions,
+                          lattice=None,
+                          numbers=None,
+                          symprec=1e-5):
+    """
+    Return permutations[i, j], the atom at
+    np.dot(rotations[i], positions[j]) + translations[i], or -1 when
+    there is no such atom.
+    lattice:
+      Row lattice vectors as in Atoms class. Distances between atoms are
+      measured in Cartesian coordinates. When None, they are measured in
+      fractional coordinates.
+    numbers:
+      Atoms of different numbers are not mapped to each other. When None,
+      atomic species are not distinguished.
+    """
+    rotations = np.array(rotations, dtype='intc', order='C')
+    translations = np.array(translations, dtype='double', order='C')
+    if lattice is None:
+        lattice = np.eye(3, dtype='double')
+    else:
+        lattice = np.array(np.transpose(lattice), dtype='double', order='C')
+    positions = np.array(positions, dtype='double', order='C')
+    if numbers is None:
+        numbers = np.zeros(len(positions), dtype='intc')
+    else:
+        numbers = np.array(numbers, dtype='intc')
+    permutations = np.zeros((len(rotations), len(positions)), dtype='intc')
+    spg.atom_permutations(permutations,
+                          rotations,
+                          translations,
+                          lattice,
+                          positions,
+                          numbers,
+                          symprec)
+    return permutations
+
 def get_symmetry_dataset(bulk, symprec=1e-5, angle_tolerance=-1.0):
     """
     number: International space group number
@@ -266,6 +334,7 @@ def get_grid_points_by_rotations(address_orig,
 def get_BZ_grid_points_by_rotations(address_orig,
                                     reciprocal_rotations,
                                     mesh,
+                                    bz_grid_address,
                                     bz_map,
                                     is_shift=np.zeros(3, dtype='intc')):
     """
@@ -280,6 +349,7 @@ def get_BZ_grid_points_by_rotations(address_orig,
         np.array(reciprocal_rotations, dtype='intc', order='C'),
         np.array(mesh, dtype='intc'),
         np.array(is_shift, dtype='intc'),
+        bz_grid_address,
         bz_map)
     
     return rot_grid_points
@@ -293,7 +363,7 @@ def relocate_BZ_grid_address(grid_address,
     Number of ir-grid-points inside Brillouin zone is returned. 
     It is assumed that the following arrays have the shapes of 
       bz_grid_address[prod(mesh + 1)][3] 
-      bz_map[prod(mesh * 2)] 
+      bz_map[prod(mesh) + 1] 
     where grid_address[prod(mesh)][3]. 
     Each element of grid_address is mapped to each element of 
     bz_grid_address with keeping element order. bz_grid_address has 
@@ -309,14 +379,14 @@ def relocate_BZ_grid_address(grid_address,
     where xxx means the memory space that may not be used. Number of grid 
     points stored in bz_grid_address is returned. 
     bz_map is used to recover grid point index expanded to include BZ 
-    surface from grid address. The grid point indices are mapped to 
-    (mesh[0] * 2) x (mesh[1] * 2) x (mesh[2] * 2) space (bz_map).
+    surface from grid address. The added ones equivalent to grid point i
+    are bz_grid_address[prod(mesh) + bz_map[i]:prod(mesh) + bz_map[i + 1]].
+    Use get_BZ_grid_points_from_addresses to look them up.
     """
     
     bz_grid_address = np.zeros(
         ((mesh[0] + 1) * (mesh[1] + 1) * (mesh[2] + 1), 3), dtype='intc')
-    bz_map = np.zeros(
-        (2 * mesh[0]) * (2 * mesh[1]) * (2 * mesh[2]), dtype='intc')
+    bz_map = np.zeros(np.prod(mesh) + 1, dtype='intc')
     num_bz_ir = spg.BZ_grid_address(
         bz_grid_address,
         bz_map,
@@ -325,7 +395,41 @@ def relocate_BZ_grid_address(grid_address,
         np.array(reciprocal_lattice, dtype='double', order='C'),
         np.array(is_shift, dtype='intc'))
 
-    return bz_grid_address[:num_bz_ir], bz_map
+    return np.array(bz_grid_address[:num_bz_ir], dtype='intc'), bz_map
+
+def get_BZ_grid_points_from_addresses(addresses,
+                                      mesh,
+                                      bz_grid_address,
+                                      bz_map):
+    """
+    Grid points in BZ of grid addresses are returned. Addresses equal
+    modulo mesh * 2 are identified and -1 is given if an address is not
+    in BZ. bz_grid_address and bz_map are those given by
+    relocate_BZ_grid_address.
+    """
+
+    mesh = np.array(mesh, dtype='intc')
+    num_grid = np.prod(mesh)
+    addresses = np.array(addresses, dtype='intc')
+    shape = addresses.shape[:-1]
+    addresses = addresses.reshape(-1, 3)
+    # X runs first in XYZ (Z first is possible with macro in spglib)
+    grid_points = np.dot(addresses % mesh, [1, mesh[0], mesh[0] * mesh[1]])
+    bz_grid_points = np.where(
+        ((bz_grid_address[grid_points] - addresses) %
+         (mesh * 2) == 0).all(axis=1), grid_points, -1)
+
+    # Surface points have additional translationally equivalent points
+    num_equivalents = bz_map[grid_points + 1] - bz_map[grid_points]
+    for i in range(num_equivalents.max() if len(grid_points) else 0):
+        remaining = np.where(np.logical_and(bz_grid_points == -1,
+                                            num_equivalents > i))[0]
+        candidates = num_grid + bz_map[grid_points[remaining]] + i
+        found = ((bz_grid_address[candidates] - addresses[remaining]) %
+                 (mesh * 2) == 0).all(axis=1)
+        bz_grid_points[remaining[found]] = candidates[found]
+
+    return np.array(bz_grid_points.reshape(shape), dtype='intc')
   
 def get_stabilized_reciprocal_mesh(mesh,
                                    rotations,
@@ -360,6 +464,53 @@ def get_stabilized_reciprocal_mesh(mesh,
     
     return mapping, mesh_points
 
+def get_ir_grid_points(mesh,
+                       rotations,
+                       is_shift=np.zeros(3, dtype='intc'),
+                       is_time_reversal=True,
+                       qpoints=np.array([], dtype='double'),
+                       with_mapping=True):
+    """
+    Return irreducible grid points, their weights and k-point map.
+
+    Orbits of grid points are visited only once. Without mapping, no
+    array of the size of the mesh is allocated and mapping is None,
+    which is useful for very dense meshes. The rotations are restricted
+    to those leaving qpoints invariant when qpoints are given.
+    """
+
+    num_grid = np.prod(mesh)
+    rotations = np.array(rotations, dtype='intc', order='C')
+    qpoints = np.array(qpoints, dtype='double', order='C')
+    if qpoints.shape == (3,):
+        qpoints = np.array([qpoints], dtype='double', order='C')
+    if qpoints.shape == (0,):
+        qpoints = np.zeros((0, 3), dtype='double')
+
+    if with_mapping:
+        mapping = np.zeros(num_grid, dtype='intc')
+        max_num_ir = num_grid
+    else:
+        mapping = None
+        max_num_ir = min(num_grid, num_grid * 2 // len(rotations) + 1000)
+
+    while True:
+        ir_grid_points = np.zeros(max_num_ir, dtype='intc')
+        ir_weights = np.zeros(max_num_ir, dtype='intc')
+        num_ir = spg.ir_grid_points(ir_grid_points,
+                                    ir_weights,
+                                    mapping,
+                                    np.array(mesh, dtype='intc'),
+                                    np.array(is_shift, dtype='intc'),
+                                    is_time_reversal * 1,
+                                    rotations,
+                                    qpoints)
+        if num_ir <= max_num_ir:
+            break
+        max_num_ir = num_ir
+
+    return ir_grid_points[:num_ir], ir_weights[:num_ir], mapping
+
 def get_triplets_reciprocal_mesh_at_q(fixed_grid_number,
                                       mesh,
                                       rotations,
@@ -400,6 +551,66 @@ def get_BZ_triplets_at_q(grid_point,
     
     return triplets, ir_weights
 
+def get_BZ_triplets_at_qs(grid_points,
+                          mesh,
+                          rotations,
+                          bz_grid_address,
+                          bz_map,
+                          is_time_reversal=True,
+                          stores_triplets_map=False,
+                          max_num_triplets=None):
+    """Triplets at many grid points in one call
+
+    Triplets and weights at grid_points[i] are
+    triplets[offsets[i]:offsets[i + 1]] and
+    weights[offsets[i]:offsets[i + 1]]. map_triplets and map_q have
+    the shape of (len(grid_points), prod(mesh)) and are None unless
+    stores_triplets_map is True.
+
+    max_num_triplets is the size of the buffers for the first try. If
+    it is too small, the buffers are allocated again with the number
+    of triplets returned.
+    """
+    grid_points = np.array(grid_points, dtype='intc').ravel()
+    num_grid = np.prod(mesh)
+    if stores_triplets_map:
+        map_triplets = np.zeros((len(grid_points), num_grid), dtype='intc')
+        map_q = np.zeros((len(grid_points), num_grid), dtype='intc')
+    else:
+        map_triplets = None
+        map_q = None
+    offsets = np.zeros(len(grid_points) + 1, dtype='intc')
+
+    # Triplets at a grid point are usually less than a half of grid
+    # points. Otherwise the exact number is returned and used.
+    if max_num_triplets is None:
+        max_num_triplets = len(grid_points) * (num_grid // 2 + 1)
+    while True:
+        triplets = np.zeros((max_num_triplets, 3), dtype='intc')
+        weights = np.zeros(max_num_triplets, dtype='intc')
+        num_triplets = spg.BZ_triplets_at_qs(
+            triplets,
+            weights,
+            offsets,
+            map_triplets,
+            map_q,
+            grid_points,
+            bz_grid_address,
+            bz_map,
+            np.array(mesh, dtype='intc'),
+            is_time_reversal * 1,
+            np.array(rotations, dtype='intc', order='C'))
+        if num_triplets <= max_num_triplets:
+            break
+        max_num_triplets = num_triplets
+
+    # Copied so that the buffers are not held by views
+    return (np.array(triplets[:num_triplets], dtype='intc'),
+            np.array(weights[:num_triplets], dtype='intc'),
+            offsets,
+            map_triplets,
+            map_q)
+
 def get_neighboring_grid_points(grid_point,
                                 relative_grid_address,
                                 mesh,
@@ -38,7 +38,14 @@ import phonopy.structure.spglib as spg
 from phonopy.structure.atoms import Atoms
 
 class Symmetry:
-    def __init__(self, cell, symprec=1e-5, is_symmetry=True):
+    def __init__(self, cell, symprec=1e-5, is_symmetry=True,
+                 primitive_symmetry=None):
+        """
+        primitive_symmetry:
+          Symmetry of the Primitive cell made from this supercell. When it
+          is given, operations of the supercell are generated from those of
+          the primitive cell instead of searching them in the supercell.
+        """
         self._cell = cell
         self._symprec = symprec
 
@@ -50,7 +57,10 @@ class Symmetry:
         if not is_symmetry:
             self._set_nosym()
         elif cell.get_magnetic_moments() is None:
-            self._set_symmetry_dataset()
+            if primitive_symmetry is not None:
+                self._set_symmetry_dataset_from_primitive(primitive_symmetry)
+            if self._dataset is None:
+                self._set_symmetry_dataset()
         else:
             self._set_symmetry_operations_with_magmoms()
 
@@ -61,6 +71,10 @@ class Symmetry:
         self._independent_atoms = None
         self._set_independent_atoms()
         self._map_operations = None
+        self._atom_permutations = None
+
+    def get_cell(self):
+        return self._cell
 
     def get_symmetry_operations(self):
         return self._symmetry_operations
@@ -98,6 +112,23 @@ class Symmetry:
             self._set_map_operations()
         return self._map_operations
 
+    def get_atom_permutations(self):
+        """Atoms sent by symmetry operations
+
+        permutations[i, j] is the atom at the position of atom j sent by
+        the i-th symmetry operation. Positions are compared in fractional
+        coordinates as in get_site_symmetry.
+        """
+        if self._atom_permutations is None:
+            ops = self._symmetry_operations
+            self._atom_permutations = spg.get_atom_permutations(
+                ops['rotations'],
+                ops['translations'],
+                self._cell.get_scaled_positions(),
+                numbers=self._cell.get_atomic_numbers(),
+                symprec=self._symprec)
+        return self._atom_permutations
+
     def get_site_symmetry(self, atom_number):
         pos = self._cell.get_scaled_positions()[atom_number]
         symprec = self._symprec
@@ -136,6 +167,66 @@ class Symmetry:
         
         self._map_atoms = self._dataset['equivalent_atoms']
 
+    def _set_symmetry_dataset_from_primitive(self, primitive_symmetry):
+        """
+        Operations of the primitive cell combined with its lattice
+        translations in the supercell are those of the supercell. The
+        dataset is made from that of the primitive cell only when the
+        supercell lattice keeps all the rotations. Otherwise self._dataset
+        is left None.
+
+        Atoms are equivalent when their atoms in the primitive cell are
+        equivalent, and the smallest index among them is taken as in
+        spglib. Wyckoff letters and transformation matrix are those in
+        the setting found for the primitive cell.
+        """
+        primitive = primitive_symmetry.get_cell()
+        prim_dataset = primitive_symmetry.get_dataset()
+        if (prim_dataset is None or
+            'get_supercell_to_primitive_map' not in dir(primitive)):
+            return
+
+        s2p_map = primitive.get_supercell_to_primitive_map()
+        if len(s2p_map) != self._cell.get_number_of_atoms():
+            return
+
+        # Supercell lattice = np.dot(smat, primitive lattice)
+        smat = np.dot(self._cell.get_cell(),
+                      np.linalg.inv(primitive.get_cell()))
+        supercell_matrix = np.array(np.rint(smat), dtype='intc')
+        if (abs(smat - supercell_matrix) > self._symprec).any():
+            return
+        num_lattice_points = abs(int(round(np.linalg.det(supercell_matrix))))
+        operations = spg.get_supercell_symmetry(prim_dataset, supercell_matrix)
+        if (len(operations['rotations']) !=
+            len(prim_dataset['rotations']) * num_lattice_points):
+            return
+
+        p2p_map = primitive.get_primitive_to_primitive_map()
+        prim_atoms = [p2p_map[i] for i in s2p_map]
+        map_atoms = np.zeros(len(prim_atoms), dtype='intc')
+        first_atoms = {}
+        for i, j in enumerate(prim_dataset['equivalent_atoms'][prim_atoms]):
+            if j not in first_atoms:
+                first_atoms[j] = i
+            map_atoms[i] = first_atoms[j]
+
+        dataset = prim_dataset.copy()
+        dataset['transformation_matrix'] = np.dot(
+            np.linalg.inv(supercell_matrix.T),
+            prim_dataset['transformation_matrix'])
+        dataset['rotations'] = operations['rotations']
+        dataset['translations'] = operations['translations']
+        dataset['wyckoffs'] = [prim_dataset['wyckoffs'][i] for i in prim_atoms]
+        dataset['equivalent_atoms'] = map_atoms
+
+        self._dataset = dataset
+        self._symmetry_operations = operations
+        self._international_table = "%s (%d)" % (dataset['international'],
+                                                 dataset['number'])
+        self._wyckoff_letters = dataset['wyckoffs']
+        self._map_atoms = map_atoms
+
     def _set_symmetry_operations_with_magmoms(self):
         self._symmetry_operations = spg.get_symmetry(self._cell,
                                                      use_magmoms=True,
@@ -196,18 +287,13 @@ class Symmetry:
                                                dtype='intc')
 
     def _set_map_operations(self):
-        ops = self._symmetry_operations
-        pos = self._cell.get_scaled_positions()
-        map_operations = np.zeros(len(pos), dtype=int)
+        permutations = self.get_atom_permutations()
+        map_operations = np.zeros(len(self._map_atoms), dtype=int)
 
         for i, eq_atom in enumerate(self._map_atoms):
-            for j, (r, t) in enumerate(
-                zip(ops['rotations'], ops['translations'])):
-                
-                diff = np.dot(pos[i], r.T) + t - pos[eq_atom]
-                if (abs(diff - np.rint(diff)) < self._symprec).all():
-                    map_operations[i] = j
-                    break
+            syms = np.where(permutations[:, i] == eq_atom)[0]
+            if len(syms) > 0:
+                map_operations[i] = syms[0]
 
         self._map_operations = map_operations
 
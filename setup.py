@@ -9,7 +9,8 @@ extension = Extension('phonopy._phonopy',
                       include_dirs=['c/harmonic_h'] + include_dirs_numpy,
                       sources=['c/_phonopy.c',
                                'c/harmonic/dynmat.c',
-                               'c/harmonic/derivative_dynmat.c'])
+                               'c/harmonic/derivative_dynmat.c',
+                               'c/harmonic/group_velocity.c'])
 
 extension_spglib = Extension(
     'phonopy._spglib',
@@ -21,6 +21,7 @@ sources = ['c/_phono3py.c',
            'c/anharmonic/phonon3/imag_self_energy_with_g.c',
            'c/anharmonic/phonon3/collision_matrix.c',
            'c/anharmonic/other/isotope.c',
+           'c/anharmonic/other/force_file.c',
            'c/spglib/debug.c',
            'c/spglib/kpoint.c',
            'c/spglib/mathfunc.c',